@@ -0,0 +1,215 @@
+/* PVCAM - single gateway to the PVCAM commands
+
+      OPS = PVCAM returns a structure whose fields are the command names and
+	  whose values are the matching opcodes:
+
+					open = 1		(PVCAMOPEN)
+					close = 2		(PVCAMCLOSE)
+					list = 3		(PVCAMLIST)
+					get = 4			(PVCAMGET)
+					set = 5			(PVCAMSET)
+					shutter = 6		(PVCAMSHUTTER)
+					acq = 7			(PVCAMACQ)
+					multi = 8		(PVCAMMULTI)
+					defect = 9		(PVCAMDEFECT)
+					stats = 10		(PVCAMSTATS)
+					ppshow = 11		(PVCAMPPSHOW)
+					ppselect = 12	(PVCAMPPSELECT)
+					arm = 13		(PVCAMARM)
+					clock = 14		(PVCAMCLOCK)
+					smart = 15		(PVCAMSMART)
+					bin = 16		(PVCAMBIN)
+					orient = 17		(PVCAMORIENT)
+					read = 18		(PVCAMREAD)
+					unpack = 19		(PVCAMUNPACK)
+					ring = 20		(PVCAMRING)
+					threads = 21	(PVCAMTHREADS)
+
+      [...] = PVCAM(CMD, ...) runs command CMD with the remaining arguments
+	  and returns its outputs, exactly as the function named in the table,
+	  so PVCAM('get', HCAM, PARAM) is the same as PVCAMGET(HCAM, PARAM).
+	  CMD is either a command name or its opcode.  An opcode indexes the
+	  command table directly; a name is hashed into the table, which costs
+	  one comparison.  Inside acquisition loops use the opcode:
+
+					OP = PVCAM;
+					TEMP = PVCAM(OP.get, HCAM, 'PARAM_TEMP');
+
+	  All commands live in this one MEX file and share one copy of the
+	  utilities.  Parameter attributes (availability, access, type and count)
+	  are cached in the core library, so repeated PVCAM('get', ...) and
+	  PVCAM('set', ...) calls on the same parameter skip four driver calls.
+	  The cache for a camera is flushed whenever a parameter is set or the
+	  camera is closed. */
+
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+
+
+// definitions
+#define NUM_COMMAND		21		// number of commands in table
+#define CMD_HASH		64		// command hash slots, power of 2 above twice NUM_COMMAND
+#define CMD_NAME_LEN	16		// max length for command names
+
+
+// command table entry, opcode is position in table plus one
+typedef struct pvcam_command {
+	const char		*name;		// command name
+	pvcam_command_fn	run;	// command routine
+} pvcam_command;
+
+
+// function prototypes
+
+// return opcode of command CMD, 0 if not recognized
+int pvcam_opcode(const mxArray *cmd);
+
+// build command name hash
+void pvcam_hash_build(void);
+
+// hash of command name
+uns32 pvcam_hash_name(const char *name);
+
+// build opcode structure
+mxArray *pvcam_opcode_struct(void);
+
+
+// global variables
+static const pvcam_command command_table[NUM_COMMAND] = {
+	{"open",		pvcam_cmd_open},
+	{"close",		pvcam_cmd_close},
+	{"list",		pvcam_cmd_list},
+	{"get",			pvcam_cmd_get},
+	{"set",			pvcam_cmd_set},
+	{"shutter",		pvcam_cmd_shutter},
+	{"acq",			pvcam_cmd_acq},
+	{"multi",		pvcam_cmd_multi},
+	{"defect",		pvcam_cmd_defect},
+	{"stats",		pvcam_cmd_stats},
+	{"ppshow",		pvcam_cmd_ppshow},
+	{"ppselect",	pvcam_cmd_ppselect},
+	{"arm",			pvcam_cmd_arm},
+	{"clock",		pvcam_cmd_clock},
+	{"smart",		pvcam_cmd_smart},
+	{"bin",			pvcam_cmd_bin},
+	{"orient",		pvcam_cmd_orient},
+	{"read",		pvcam_cmd_read},
+	{"unpack",		pvcam_cmd_unpack},
+	{"ring",		pvcam_cmd_ring},
+	{"threads",		pvcam_cmd_threads}
+};
+static uns8		command_hash[CMD_HASH];		// opcode by name hash, 0 if empty
+static rs_bool	hash_built = 0;				// command_hash filled in
+
+
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	int		opcode;			// command opcode
+
+	// no command returns opcode structure
+	if (nrhs == 0) {
+		if (nlhs > 1) {
+			mexErrMsgTxt("type 'help pvcam' for syntax");
+		}
+		plhs[0] = pvcam_opcode_struct();
+		return;
+	}
+
+	// dispatch remaining arguments to command routine
+	if ((opcode = pvcam_opcode(prhs[0])) == 0) {
+		mexErrMsgTxt("CMD is not a recognized command name or opcode");
+	}
+	command_table[opcode - 1].run(nlhs, plhs, nrhs - 1, prhs + 1);
+}
+
+
+// return opcode of command CMD, 0 if not recognized
+int pvcam_opcode(const mxArray *cmd) {
+
+	// declarations
+	char	name[CMD_NAME_LEN];		// command name
+	double	value;			// numeric opcode
+	uns32	slot;			// hash slot
+
+	// opcode indexes table directly
+	if (mxIsNumeric(cmd) && (mxGetNumberOfElements(cmd) == 1)) {
+		value = mxGetScalar(cmd);
+		if ((value < 1.0) || (value > (double) NUM_COMMAND) || (value != (double) (int) value)) {
+			return(0);
+		}
+		return((int) value);
+	}
+
+	// name goes through hash, names too long for the buffer are not commands
+	if (!mxIsChar(cmd) || mxGetString(cmd, name, CMD_NAME_LEN)) {
+		return(0);
+	}
+	if (!hash_built) {
+		pvcam_hash_build();
+	}
+	for (slot = pvcam_hash_name(name); command_hash[slot] != 0; slot = (slot + 1) & (CMD_HASH - 1)) {
+		if (strcmp(command_table[command_hash[slot] - 1].name, name) == 0) {
+			return(command_hash[slot]);
+		}
+	}
+	return(0);
+}
+
+
+// build command name hash
+// linear probing, table is less than half full
+void pvcam_hash_build(void) {
+
+	// declarations
+	int		i;				// command counter
+	uns32	slot;			// hash slot
+
+	memset(command_hash, 0, sizeof(command_hash));
+	for (i = 0; i < NUM_COMMAND; i++) {
+		for (slot = pvcam_hash_name(command_table[i].name); command_hash[slot] != 0;
+			slot = (slot + 1) & (CMD_HASH - 1)) {
+		}
+		command_hash[slot] = (uns8) (i + 1);
+	}
+	hash_built = 1;
+}
+
+
+// hash of command name
+// FNV-1a folded to table size
+uns32 pvcam_hash_name(const char *name) {
+
+	// declarations
+	uns32	hash = 2166136261u;	// FNV offset basis
+
+	while (*name != '\0') {
+		hash = (hash ^ (uns8) *name++) * 16777619u;
+	}
+	return((hash ^ (hash >> 16)) & (CMD_HASH - 1));
+}
+
+
+// build opcode structure
+mxArray *pvcam_opcode_struct(void) {
+
+	// declarations
+	const char	*field_list[NUM_COMMAND];	// command names
+	int			i;				// command counter
+	mxArray		*opcode_struct;	// output structure
+
+	for (i = 0; i < NUM_COMMAND; i++) {
+		field_list[i] = command_table[i].name;
+	}
+	opcode_struct = mxCreateStructMatrix(1, 1, NUM_COMMAND, field_list);
+	for (i = 0; i < NUM_COMMAND; i++) {
+		mxSetFieldByNumber(opcode_struct, 0, i, mxCreateDoubleScalar((double) (i + 1)));
+	}
+	return(opcode_struct);
+}
@@ -0,0 +1,46 @@
+% PVCAM - single gateway to the PVCAM commands
+%
+%     OPS = PVCAM returns a structure whose fields are the command names and
+%	  whose values are the matching opcodes:
+%
+%					open = 1		(PVCAMOPEN)
+%					close = 2		(PVCAMCLOSE)
+%					list = 3		(PVCAMLIST)
+%					get = 4			(PVCAMGET)
+%					set = 5			(PVCAMSET)
+%					shutter = 6		(PVCAMSHUTTER)
+%					acq = 7			(PVCAMACQ)
+%					multi = 8		(PVCAMMULTI)
+%					defect = 9		(PVCAMDEFECT)
+%					stats = 10		(PVCAMSTATS)
+%					ppshow = 11		(PVCAMPPSHOW)
+%					ppselect = 12	(PVCAMPPSELECT)
+%					arm = 13		(PVCAMARM)
+%					clock = 14		(PVCAMCLOCK)
+%					smart = 15		(PVCAMSMART)
+%					bin = 16		(PVCAMBIN)
+%					orient = 17		(PVCAMORIENT)
+%					read = 18		(PVCAMREAD)
+%					unpack = 19		(PVCAMUNPACK)
+%					ring = 20		(PVCAMRING)
+%					threads = 21	(PVCAMTHREADS)
+%
+%     [...] = PVCAM(CMD, ...) runs command CMD with the remaining arguments
+%	  and returns its outputs, exactly as the function named in the table,
+%	  so PVCAM('get', HCAM, PARAM) is the same as PVCAMGET(HCAM, PARAM).
+%	  CMD is either a command name or its opcode.  An opcode indexes the
+%	  command table directly; a name is hashed into the table, which costs
+%	  one comparison.  Inside acquisition loops use the opcode:
+%
+%					OP = PVCAM;
+%					TEMP = PVCAM(OP.get, HCAM, 'PARAM_TEMP');
+%
+%	  All commands live in this one MEX file and share one copy of the
+%	  utilities.  Parameter attributes (availability, access, type and count)
+%	  are cached in the core library, so repeated PVCAM('get', ...) and
+%	  PVCAM('set', ...) calls on the same parameter skip four driver calls.
+%	  The cache for a camera is flushed whenever a parameter is set or the
+%	  camera is closed.
+
+% 10/18/26
+% mex DLL code
@@ -19,7 +19,200 @@
 	  regions that will be imaged.  If successful, DATA will be a vector
 	  (unsigned 16-bit integer) containing the data from the image sequence.
 	  The calling routine must reshape this vector based upon ROIs and images
-	  in the sequence.  If unsuccessful, DATA = []. */
+	  in the sequence.  If unsuccessful, DATA = [].
+
+	  Cameras that read fewer regions per frame than ROI holds (see
+	  PARAM_ROI_COUNT) read the smallest region covering them all instead,
+	  and the regions are cut and binned out of it in software.  DATA has
+	  the same layout either way; binned pixels are clipped at 65535.
+	  Such acquisitions always run through the acquisition engine below,
+	  so DATA holds pixels only, without metadata headers.
+
+      [DATA, META] = PVCAMACQ(HCAM, NI, ROI, EXPTIME, EXPMODE, OPTS) runs the
+	  sequence through the continuous acquisition engine instead.  DATA then
+	  holds pixel data only, and the per-frame metadata is returned in the
+	  structure META with fields frame, bof, eof, exptime, dropped, late,
+	  hostbof, hosteof, hostdata, hosttime, utc, smart and overwritten
+	  (1 x NI vectors, timestamps in ns).
+	  dropped counts the frames missing just before each frame and late
+	  flags frames whose EOF interval is well above the running average.
+	  overwritten flags frames the camera wrote over in the circular buffer
+	  while they were still being processed; their DATA may be corrupt.
+	  hostdata is the host clock when the frame was taken from the buffer;
+	  hostbof and hosteof are the host clock in the BOF and EOF callbacks
+	  when OPTS.latency is set, NaN otherwise.  These host times are
+	  measured from the start of the acquisition.  hosttime is the camera
+	  EOF converted to the host monotonic clock and utc the same instant in
+	  seconds since 1970 (POSIX time), both through the clock model of the
+	  camera, which is refitted with every acquisition (see PVCAMCLOCK);
+	  both are NaN without metadata.  smart is the position of the frame in
+	  the SMART streaming exposure list (see PVCAMSMART), 0 with SMART
+	  streaming off.  OPTS is an optional structure with
+	  fields:
+
+					buffer = frames in circular buffer (default 16)
+					accumulate = frames summed into each output frame (default 1)
+					accummode = 'sum' (uint32 DATA) or 'mean' (single DATA)
+					speckle = 'none', 'spatial' or 'temporal' speckle contrast
+					specklewin = speckle window (default 7 pixels or 25 frames)
+					hotpixels = N x 2 list of [serial parallel] defect coordinates
+					latency = 1 to time the host path with frame callbacks (default 0)
+					hdr = 1 to fuse each SMART streaming cycle into one HDR frame (default 0)
+					hdrbias = camera offset removed before fusing (default 0 DN)
+					hdrsat = saturation level (default 2^bitdepth - 1 DN)
+					centroids = 1 to return PrimeLocate centroids instead of pixels (default 0)
+					orient = 'none', 'transpose', 'rot90', 'rot180', 'rot270', 'fliplr' or 'flipud'
+					record = file to record every frame into (default '', no recording)
+					compress = 1 to Rice code the recording (default), 0 to bit-pack only
+					pack = bits per pixel of packed DATA, 8, 10, 12, 14 or 16, 1 for the sensor bit depth (default 0, not packed)
+					pipeline = structure array of processing stages (default [], no pipeline)
+					pipedepth = frames in flight through the pipeline, 1 to 1024 (default 8)
+					overload = 'block', 'dropoldest', 'dropnewest', 'skip' or 'decimate' (default 'block')
+					decimate = optional stages run on every decimate-th frame under 'decimate' (default 4)
+					highwater = frames waiting in the buffer that count as overload (default buffer / 2)
+
+	  NI must be a multiple of accumulate.  With speckle set, DATA is the
+	  single precision speckle contrast K = std / mean of every frame; the
+	  spatial window is clipped at ROI edges and the temporal window fills
+	  up over the first frames.  Pixels listed in hotpixels (see PVCAMDEFECT)
+	  are replaced by the mean of their good neighbors before any other
+	  processing.  orient reorients each region of every frame as it is
+	  copied out, exactly as PVCAMORIENT does afterwards; it applies to
+	  plain 16-bit frames only.
+
+	  With record set, every frame is also written to the named file as it
+	  arrives, after hot pixel correction and before any other processing,
+	  and DATA is returned as usual.  Frames are coded losslessly in tiles
+	  spread over the worker threads: bit-packed to their widest pixel,
+	  which stores a 12-bit sensor in 12 bits per pixel, and with compress
+	  set also delta coded in adaptive Rice codes wherever that is smaller.
+	  PVCAMREAD maps the file and decodes any of its frames.  Raise
+	  OPTS.buffer if the disk cannot keep up and overruns appear.
+
+	  With pack set, DATA is an unsigned 8-bit vector holding every plain
+	  frame packed to pack bits per pixel, least significant bit first,
+	  with each frame starting on a whole byte; pixels too large for pack
+	  bits are clipped.  A 12-bit sensor then takes 3/4 of the memory.
+	  pack = 1 uses the narrowest width that holds PARAM_BIT_DEPTH, 16 for
+	  a 15 or 16-bit sensor, whose frames are then only copied, and the
+	  acquisition stops with an error if frame metadata reports a deeper
+	  sensor than pack.  STATS.pack gives the width used, and PVCAMUNPACK
+	  turns DATA back into 16-bit frames.
+
+	  With pipeline set, every plain frame runs through a graph of
+	  processing stages on the worker threads (see PVCAMTHREADS) while the
+	  next frames are read out.  Each element of OPTS.pipeline is one
+	  stage with fields:
+
+					stage = stage type, one of the types below
+					name = name of the stage (default the stage type)
+					after = stages that must finish a frame first, as positions
+						in OPTS.pipeline or names (default the element before,
+						0 for none, so an unset after makes a chain)
+					optional = 1 if the stage may be left out under overload (default 0)
+
+	  and any other field is a parameter of the stage.  Built-in types:
+
+					defect = replace hotpixels (N x 2 [serial parallel]) by their neighbors
+					offset = subtract level (DN) from every pixel, clipping at 0
+					summary = mean, min and max of each region (3 x nregion results)
+					diff = mean absolute difference to the previous frame (1 result, NaN first)
+
+	  defect and offset modify pixels, so every other stage must come
+	  before or after them; stages that do not depend on each other run
+	  side by side.  DATA holds each frame as the last stage left it, and
+	  the results of each stage with any are returned in META.<name>, one
+	  column per frame.  Stages see frames in any order except diff, which
+	  sees them in frame order, and DATA and META are always in frame
+	  order.  The pipeline applies to plain frames only; hotpixels and
+	  record act on each frame before it enters.
+
+	  Only pipedepth frames are in flight at once.  The pipeline is
+	  overloaded when all are taken or when highwater frames are waiting
+	  in the circular buffer behind the frame just read, and overload
+	  then decides what happens to that frame:
+
+					block = wait for the oldest frame in flight to be done
+					dropoldest = drop the oldest frame in flight without waiting for it, or this frame if none can be dropped
+					dropnewest = drop this frame
+					skip = run this frame without its optional stages
+					decimate = as skip, except every decimate-th frame runs all stages
+
+	  With skip and decimate a frame still waits when every slot is taken,
+	  so no frame is lost to the policy; the optional stages give way
+	  first.  With dropoldest the frame takes one of a few spare slots
+	  while the dropped frame finishes the stage it is in, and is dropped
+	  itself if every spare is still taken.  META.overload holds 0 for
+	  frames that ran every stage, 1 for frames that skipped their
+	  optional stages and 2 for dropped frames, whose DATA stays 0 and
+	  whose results are NaN, as are the results of skipped stages.  A frame
+	  the camera overwrote in the buffer is lost whatever the policy, so
+	  raise OPTS.buffer if overruns appear.
+
+	  With hdr set, every cycle through the SMART streaming exposure list
+	  (see PVCAMSMART) is fused into one single precision frame of
+	  radiance in DN/s, so DATA holds NI / numel(EXPTIMES) frames and NI
+	  must be a multiple of numel(EXPTIMES).  Each pixel is the sum of its
+	  unsaturated, offset-corrected values over the sum of their metadata
+	  exposure times, which weights every exposure by its length; a pixel
+	  saturated in every exposure gets the lower bound from the shortest
+	  one.  Frames are grouped by frame number, so a dropped frame leaves
+	  its cycle with one exposure less rather than shifting later cycles,
+	  and a cycle with no frames at all is NaN.
+
+	  With centroids set, PrimeLocate must be on (PARAM_CENTROIDS_ENABLED,
+	  see PVCAMSET) and DATA is a structure of column vectors with one row
+	  per spot found:
+
+					frame = frame number (as META.frame)
+					roi = region number the camera gave the spot
+					x = serial sensor coordinate of the centroid
+					y = parallel sensor coordinate of the centroid
+					intensity = region sum above background (DN)
+					background = lowest pixel in the region (DN)
+					bor = beginning of region readout (ns), NaN if not reported
+					eor = end of region readout (ns), NaN if not reported
+
+	  x and y are intensity-weighted means above background, on the same
+	  0-based sensor coordinates as ROI, with binned pixels counted at the
+	  centre of the sensor pixels they cover.  Regions the camera flagged
+	  invalid and flat regions are left out, so the number of rows varies
+	  with the scene.  Centroids cannot be combined with the pixel
+	  processing options.
+
+      [DATA, META, STATS] = PVCAMACQ(...) also returns the structure STATS
+	  with fields frames (frames delivered), dropped (frames missing from the
+	  sequence), late (late frames), overruns (frames overwritten in the
+	  circular buffer before they were read, also counted in dropped),
+	  backlog (most frames waiting in the buffer), interval (average EOF
+	  interval in ns) and overwritten (frames overwritten while being
+	  processed).  Increase OPTS.buffer if overruns or overwritten is
+	  nonzero.
+	  STATS.clock is the camera clock model after this acquisition, as
+	  returned by PVCAMCLOCK, so other camera timestamps convert as
+	  offset + rate * bof.  STATS.pack is the bits per pixel of packed DATA,
+	  0 if DATA is not packed.  STATS.pipeline is a structure array with
+	  fields stage, name, frames, skipped, busy and mean (frames run and
+	  skipped under overload, total and mean time the stage ran in ns), one
+	  element per stage, and STATS.overload a structure with fields policy,
+	  overloaded (frames arriving overloaded), blocked (frames that waited),
+	  blockedtime (ns), droppedoldest, droppednewest and skipped (frames run
+	  without their optional stages); both are [] without a pipeline.
+
+	  With OPTS.latency set, STATS.latency is a structure array with fields
+	  measure, count, mean, std, min, p50, p99 and max (ns), one element per
+	  measure:
+
+					start_bof = start of acquisition to first BOF callback
+					bof_eof = BOF callback to EOF callback
+					eof_data = EOF callback to frame taken from buffer
+					camera_host = EOF callback minus metadata EOF
+
+	  Metadata timestamps restart with every acquisition, so camera_host
+	  holds a constant offset; its spread (std, p99 - p50) is the jitter
+	  the host adds on top of the camera.  With the camera in 'trigger' mode
+	  start_bof includes the wait for the first trigger.  STATS.latency is []
+	  unless OPTS.latency is set. */
 
 
 /* 2/19/03 SCM */
@@ -27,6 +220,31 @@
 
 // inclusions
 #include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamstream.h"
+#include "pvcambuffer.h"
+#include "pvcamproc.h"
+#include "pvcamtime.h"
+#include "pvcamrecord.h"
+#include "pvcampipe.h"
+#include "pvcamthread.h"
+#include <math.h>
+#include <stdlib.h>
+
+
+// definitions
+#define META_FIELD		13		// number of fields in metadata structure
+#define STATS_FIELD		12		// number of fields in statistics structure
+#define CENTROID_FIELD	8		// number of fields in centroid table
+#define LATENCY_FIELD	8		// number of fields in latency structure
+#define NUM_LATENCY		4		// number of latency measures
+#define PIPELINE_FIELD	6		// number of fields in pipeline statistics
+#define OVERLOAD_FIELD	7		// number of fields in overload statistics
+#define SPECKLE_NONE	0		// no speckle contrast
+#define SPECKLE_SPATIAL	1		// sliding window over each frame
+#define SPECKLE_TEMPORAL	2	// sliding window over consecutive frames
+#define SPATIAL_WINDOW	7		// default spatial window side length
+#define TEMPORAL_WINDOW	25		// default temporal window length
 
 
 // function prototypes
@@ -34,40 +252,55 @@
 // acquire image(s) from camera
 mxArray *pvcam_acquire(int16 hcam, uns16 nimage, uns16 nregion, rgn_type *region, uns32 exptime, int16 expmode);
 
-// obtain field values from ROI structure
-uns16 get_field_value(const mxArray *struct_array, uns16 nstruct, uns16 nfield);
+// acquire image(s) through continuous acquisition engine
+mxArray *pvcam_acquire_stream(int16 hcam, uns16 nimage, uns16 nregion, rgn_type *region, uns32 exptime, int16 expmode,
+							  const mxArray *opts, mxArray **meta_struct, mxArray **stats_struct);
 
+// read OPTS.pipeline into stage configurations, stage parameters borrow the option values
+uns32 pvcam_pipeline_config(const mxArray *pipeline, const mxArray *meta_struct, pvcam_stage_config *config);
 
-// gateway routine
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+// hand frames finished by the pipeline to MATLAB, waiting for every frame when draining
+rs_bool pvcam_pipeline_deliver(pvcam_pipe *pipe, rs_bool drain, uns16 *data_ptr, double **result_ptr, double *overload_ptr);
+
+// summarize time spent in each pipeline stage
+mxArray *pvcam_pipeline_struct(const pvcam_pipe *pipe);
+
+// summarize overload decisions of pipeline
+mxArray *pvcam_overload_struct(const pvcam_pipe *pipe, const char *policy);
+
+// summarize host latency from metadata columns
+mxArray *pvcam_latency_struct(double **meta_ptr, uns32 nframe);
+
+// distribution of latency samples, NaN samples are skipped
+void pvcam_latency_record(mxArray *latency_struct, int measure, const char *name, double *sample, uns32 nsample);
+
+// compare doubles for qsort
+int pvcam_compare_double(const void *a, const void *b);
+
+
+// command routine, also reached as pvcam('acq', ...)
+void pvcam_cmd_acq(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
 	// declarations
-	char		*modestr;	// exposure mode string
-	int			modelen;	// exposure mode string length
 	int16		hcam;		// camera handle
 	int16		expmode;	// exposure mode
+	const mxArray	*opts;	// options structure
 	rgn_type	*region;	// ROI structure
 	uns16		nimage;		// number of images
 	uns16		nregion;	// number of regions
-	uns16		nfield[6];	// field numbers in ROI structure
-	uns16		i;			// loop counters
 	uns32		exptime;	// exposure time
+	mxArray		*meta_struct;	// metadata output
+	mxArray		*stats_struct;	// frame continuity output
 
 	// validate arguments
-	if ((nrhs != 5) || (nlhs > 1)) {
+	if ((nrhs < 5) || (nrhs > 6) || (nlhs > 3)) {
         mexErrMsgTxt("type 'help pvcamacq' for syntax");
     }
+	pvcam_at_exit(pvcam_buffer_trim);
+	pvcam_at_exit(pvcam_thread_stop);
 
 	// obtain camera handle
-	if (!mxIsNumeric(prhs[0])) {
-		mexErrMsgTxt("HCAM must be numeric");
-	}
-	else if (mxGetNumberOfElements(prhs[0]) != 1) {
-		mexErrMsgTxt("HCAM must be a scalar");
-	}
-	else {
-		hcam = (int16) mxGetScalar(prhs[0]);
-	}
+	hcam = pvcam_camera_handle(prhs[0]);
 
 	// obtain number of images
 	if (!mxIsNumeric(prhs[1])) {
@@ -81,42 +314,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 	}
 
 	// obtain ROI structure from MATLAB structure array
-	if (!mxIsStruct(prhs[2])) {
-		mexErrMsgTxt("ROI must be a structure array");
-	}
-	else if ((nregion = mxGetNumberOfElements(prhs[2])) < 1) {
-		mexErrMsgTxt("ROI cannot be empty");
-	}
-	else if ((nfield[0] = mxGetFieldNumber(prhs[2], "s1")) < 0) {
-		mexErrMsgTxt("ROI must contain a field named s1");
-	}
-	else if ((nfield[1] = mxGetFieldNumber(prhs[2], "s2")) < 0) {
-		mexErrMsgTxt("ROI must contain a field named s2");
-	}
-	else if ((nfield[2] = mxGetFieldNumber(prhs[2], "sbin")) < 0) {
-		mexErrMsgTxt("ROI must contain a field named sbin");
-	}
-	else if ((nfield[3] = mxGetFieldNumber(prhs[2], "p1")) < 0) {
-		mexErrMsgTxt("ROI must contain a field named p1");
-	}
-	else if ((nfield[4] = mxGetFieldNumber(prhs[2], "p2")) < 0) {
-		mexErrMsgTxt("ROI must contain a field named p2");
-	}
-	else if ((nfield[5] = mxGetFieldNumber(prhs[2], "pbin")) < 0) {
-		mexErrMsgTxt("ROI must contain a field named pbin");
-	}
-
-	// allocate space for ROI data
-	// obtain elements from MATLAB structure
-	region = (rgn_type *) mxCalloc((size_t) nregion, sizeof(rgn_type));
-	for (i = 0; i < nregion; i++) {
-		region[i].s1 = get_field_value(prhs[2], i, nfield[0]);
-		region[i].s2 = get_field_value(prhs[2], i, nfield[1]);
-		region[i].sbin = get_field_value(prhs[2], i, nfield[2]);
-		region[i].p1 = get_field_value(prhs[2], i, nfield[3]);
-		region[i].p2 = get_field_value(prhs[2], i, nfield[4]);
-		region[i].pbin = get_field_value(prhs[2], i, nfield[5]);
-	}
+	region = pvcam_region_array(prhs[2], &nregion);
 
 	// obtain exposure time
 	if (!mxIsNumeric(prhs[3])) {
@@ -130,50 +328,54 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 	}
 
 	// obtain exposure mode
-	if (!mxIsChar(prhs[4])) {
-		mexErrMsgTxt("EXPMODE must be a string");
-	}
-	else if ((modelen = mxGetNumberOfElements(prhs[4])) < 1) {
-		mexErrMsgTxt("EXPMODE cannot be empty");
-	}
-	else {
-		modelen++;
-		modestr = (char *) mxCalloc(modelen, sizeof(char));
-		if (mxGetString(prhs[4], modestr, modelen)) {
-			mexErrMsgTxt("Cannot read EXPMODE string");
-		}
-		else if (strcmp(modestr, "timed") == 0) {
-			expmode = TIMED_MODE;
-		}
-		else if (strcmp(modestr, "trigger") == 0) {
-			expmode = TRIGGER_FIRST_MODE;
-		}
-		else if (strcmp(modestr, "strobe") == 0) {
-			expmode = STROBED_MODE;
-		}
-		else if (strcmp(modestr, "bulb") == 0) {
-			expmode = BULB_MODE;
-		}
-		else if (strcmp(modestr, "flash") == 0) {
-			expmode = FLASH_MODE;
+	expmode = pvcam_exposure_mode(prhs[4]);
+
+	// obtain options structure
+	opts = NULL;
+	if (nrhs > 5) {
+		if (!mxIsStruct(prhs[5]) && !mxIsEmpty(prhs[5])) {
+			mexErrMsgTxt("OPTS must be a structure");
 		}
-		else {
-			mexWarnMsgTxt("EXPMODE not recognized, using timed mode");
-			expmode = TIMED_MODE;
+		else if (mxIsStruct(prhs[5])) {
+			opts = prhs[5];
 		}
-		mxFree((void *) modestr);
 	}
 
 	// check for open camera
 	// acquire image sequence
 	// assign empty matrix if failure
 	
-	if (pl_cam_check(hcam)) {
-		plhs[0] = pvcam_acquire(hcam, nimage, nregion, region, exptime, expmode);
-	}
-	else {
+	// use acquisition engine when options or metadata requested,
+	// or when the camera cannot read all regions at once
+	if (!pl_cam_check(hcam)) {
 		pvcam_error(hcam, "HCAM is not a handle to an open camera");
 		plhs[0] = mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL);
+		if (nlhs > 1) {
+			plhs[1] = mxCreateDoubleMatrix(0, 0, mxREAL);
+		}
+		if (nlhs > 2) {
+			plhs[2] = mxCreateDoubleMatrix(0, 0, mxREAL);
+		}
+	}
+	else if ((opts != NULL) || (nlhs > 1) || !pvcam_region_hardware(hcam, nregion)) {
+		pvcam_core_touch(hcam);
+		plhs[0] = pvcam_acquire_stream(hcam, nimage, nregion, region, exptime, expmode, opts, &meta_struct, &stats_struct);
+		if (nlhs > 1) {
+			plhs[1] = meta_struct;
+		}
+		else {
+			mxDestroyArray(meta_struct);
+		}
+		if (nlhs > 2) {
+			plhs[2] = stats_struct;
+		}
+		else {
+			mxDestroyArray(stats_struct);
+		}
+	}
+	else {
+		pvcam_core_touch(hcam);
+		plhs[0] = pvcam_acquire(hcam, nimage, nregion, region, exptime, expmode);
 	}
 
 	// free allocated arrays
@@ -286,21 +488,870 @@ mxArray *pvcam_acquire(int16 hcam, uns16 nimage, uns16 nregion, rgn_type *region
 }
 
 
-// obtain field values from ROI structure
-uns16 get_field_value(const mxArray *struct_array, uns16 nstruct, uns16 nfield) {
+// acquire image(s) through continuous acquisition engine
+mxArray *pvcam_acquire_stream(int16 hcam, uns16 nimage, uns16 nregion, rgn_type *region, uns32 exptime, int16 expmode,
+							  const mxArray *opts, mxArray **meta_struct, mxArray **stats_struct) {
+
+	// declarations
+	const char	*field_list[META_FIELD] = {"frame", "bof", "eof", "exptime", "dropped", "late",
+											"hostbof", "hosteof", "hostdata", "hosttime", "utc", "smart", "overwritten"};
+	const char	*stats_list[STATS_FIELD] = {"frames", "dropped", "late", "overruns", "backlog", "interval",
+											"latency", "clock", "pack", "pipeline", "overload", "overwritten"};
+	const char	*centroid_list[CENTROID_FIELD] = {"frame", "roi", "x", "y", "intensity", "background",
+											"bor", "eor"};
+	const char	*overload_list[5] = {"block", "dropoldest", "dropnewest", "skip", "decimate"};
+	const md_frame_roi_header	*roi_header;	// header of current PrimeLocate region
+	double		*centroid_ptr[CENTROID_FIELD];	// centroid table columns
+	char		*modestr;		// accumulation / speckle mode string
+	char		*record_path;	// recording file, empty if not recording
+	double		*meta_ptr[META_FIELD];	// metadata output columns
+	double		*result_ptr[MAX_STAGE];	// pipeline results of each stage, NULL if none
+	double		*overload_ptr;	// overload decision of each frame
+	double		decimate;		// optional stage rate under 'decimate'
+	double		depth;			// frames in flight through pipeline, as given
+	double		highwater;		// frames waiting in buffer that count as overload
+	int			admit;			// ADMIT_ decision for current frame
+	int			policy;			// OVERLOAD_ policy
+	int			accum_mode;		// ACCUM_SUM or ACCUM_MEAN
+	int			codec;			// CODEC_PACK or CODEC_RICE for recording
+	int			field_nr;		// metadata field of stage results
+	int16		bit_depth;		// sensor bit depth for recording header and packing
+	int			orient;			// ORIENT_ code for plain frames
+	int			speckle_mode;	// SPECKLE_NONE, SPECKLE_SPATIAL or SPECKLE_TEMPORAL
+	mxArray		*data_struct;	// output data
+	mxArray		*hot_list;		// defect coordinates
+	mxArray		*pipe_list;		// pipeline stages
+	pvcam_centroid	centroid;	// centroid of current region
+	pvcam_clock_fit	clock_fit;	// camera to host clock model
+	pvcam_defect	defect;		// defect list for active regions
+	pvcam_frame	frame;			// current frame
+	pvcam_hdr	hdr;			// HDR running sums of current bracket
+	pvcam_pipe	pipe;			// processing pipeline, no stages if none
+	pvcam_stage_config	stage_config[MAX_STAGE];	// pipeline stages as configured
+	pvcam_recorder	recorder;	// recording file writer
+	pvcam_spatial	spatial;	// spatial speckle scratch
+	pvcam_stream	stream;		// acquisition engine state
+	pvcam_temporal	temporal;	// temporal speckle running sums
+	rs_bool		success;		// flag for successful allocation
+	rs_bool		attr_avail;		// flag for available parameter
+	rs_bool		centroid_on;	// return PrimeLocate centroid table
+	rs_bool		locate_on;		// PrimeLocate switched on
+	rs_bool		hdr_on;			// fuse SMART streaming brackets into HDR frames
+	rs_bool		record_on;		// write frames to recording file
+	rs_bool		smart_on;		// SMART streaming switched on
+	rs_bool		timing;			// time host path with frame callbacks
+	uns16		naccum;			// frames per output frame
+	uns16		ncentroid;		// most PrimeLocate regions per frame
+	uns16		nsmart;			// SMART streaming exposures in cycle, 0 if off
+	uns32		nbuffer;		// frames in circular buffer
+	uns32		npipe;			// frames in flight through pipeline
+	uns32		nstage;			// pipeline stages configured
+	uns32		nwindow;		// speckle window size
+	uns32		*accum;			// accumulator for current output frame
+	uns32		first_group;	// SMART streaming cycle of first frame
+	uns32		group;			// SMART streaming cycle of current frame
+	uns32		hdr_group;		// cycle held in HDR running sums
+	uns32		i;				// loop counter
+	uns32		k;				// output frame counter
+	uns32		npixel;			// pixels per frame
+	uns32		nrow;			// centroid table rows filled
+	uns32		pack;			// bits per pixel of packed DATA, 0 if not packed
+	uns32		r;				// region counter
+	ulong64		frame_ns;		// start of frame for latency statistics
+	ulong64		stage_ns;		// start of current instrumented stage
+
+	// obtain options
+	nbuffer = (uns32) pvcam_option_value(opts, "buffer", (double) STREAM_BUFFER);
+	naccum = (uns16) pvcam_option_value(opts, "accumulate", 1.0);
+	modestr = pvcam_option_string(opts, "accummode", "sum");
+	if (strcmp(modestr, "sum") == 0) {
+		accum_mode = ACCUM_SUM;
+	}
+	else if (strcmp(modestr, "mean") == 0) {
+		accum_mode = ACCUM_MEAN;
+	}
+	else {
+		mexErrMsgTxt("OPTS.accummode must be 'sum' or 'mean'");
+	}
+	mxFree((void *) modestr);
+	if ((naccum < 1) || (nimage % naccum != 0)) {
+		mexErrMsgTxt("NI must be a multiple of OPTS.accumulate");
+	}
+	modestr = pvcam_option_string(opts, "speckle", "none");
+	if (strcmp(modestr, "none") == 0) {
+		speckle_mode = SPECKLE_NONE;
+	}
+	else if (strcmp(modestr, "spatial") == 0) {
+		speckle_mode = SPECKLE_SPATIAL;
+	}
+	else if (strcmp(modestr, "temporal") == 0) {
+		speckle_mode = SPECKLE_TEMPORAL;
+	}
+	else {
+		mexErrMsgTxt("OPTS.speckle must be 'none', 'spatial' or 'temporal'");
+	}
+	mxFree((void *) modestr);
+	nwindow = (uns32) pvcam_option_value(opts, "specklewin",
+		(speckle_mode == SPECKLE_TEMPORAL) ? (double) TEMPORAL_WINDOW : (double) SPATIAL_WINDOW);
+	if ((speckle_mode != SPECKLE_NONE) && (naccum > 1)) {
+		mexErrMsgTxt("OPTS.speckle cannot be combined with OPTS.accumulate");
+	}
+	timing = (pvcam_option_value(opts, "latency", 0.0) != 0.0);
+	nsmart = pvcam_core_smart(hcam);
+	if ((nsmart > 0) &&
+		(!pl_get_param(hcam, PARAM_SMART_STREAM_MODE_ENABLED, ATTR_CURRENT, (void *) &smart_on) || !smart_on)) {
+		nsmart = 0;
+	}
+	hdr_on = (pvcam_option_value(opts, "hdr", 0.0) != 0.0);
+	if (hdr_on && (nsmart == 0)) {
+		mexErrMsgTxt("OPTS.hdr needs SMART streaming, see PVCAMSMART");
+	}
+	if (hdr_on && ((speckle_mode != SPECKLE_NONE) || (naccum > 1))) {
+		mexErrMsgTxt("OPTS.hdr cannot be combined with OPTS.speckle or OPTS.accumulate");
+	}
+	if (hdr_on && (nimage % nsmart != 0)) {
+		mexErrMsgTxt("NI must be a multiple of the SMART streaming exposure count with OPTS.hdr");
+	}
+	hot_list = (opts != NULL) ? mxGetField(opts, 0, "hotpixels") : NULL;
+	if ((hot_list != NULL) && !mxIsEmpty(hot_list) && (!mxIsDouble(hot_list) || (mxGetN(hot_list) != 2))) {
+		mexErrMsgTxt("OPTS.hotpixels must be an N x 2 double array");
+	}
+	centroid_on = (pvcam_option_value(opts, "centroids", 0.0) != 0.0);
+	ncentroid = 0;
+	if (centroid_on &&
+		(!pl_get_param(hcam, PARAM_CENTROIDS_ENABLED, ATTR_AVAIL, (void *) &attr_avail) || !attr_avail ||
+		!pl_get_param(hcam, PARAM_CENTROIDS_ENABLED, ATTR_CURRENT, (void *) &locate_on) || !locate_on ||
+		!pl_get_param(hcam, PARAM_CENTROIDS_COUNT, ATTR_CURRENT, (void *) &ncentroid))) {
+		mexErrMsgTxt("OPTS.centroids needs PARAM_CENTROIDS_ENABLED on, see PVCAMSET");
+	}
+	if (centroid_on && (hdr_on || (speckle_mode != SPECKLE_NONE) || (naccum > 1) ||
+		((hot_list != NULL) && !mxIsEmpty(hot_list)))) {
+		mexErrMsgTxt("OPTS.centroids cannot be combined with pixel processing options");
+	}
+	modestr = pvcam_option_string(opts, "orient", "none");
+	if ((orient = pvcam_orient_code(modestr)) < 0) {
+		mexErrMsgTxt("OPTS.orient must be 'none', 'transpose', 'rot90', 'rot180', 'rot270', 'fliplr' or 'flipud'");
+	}
+	mxFree((void *) modestr);
+	if ((orient != ORIENT_NONE) && (centroid_on || hdr_on || (speckle_mode != SPECKLE_NONE) || (naccum > 1))) {
+		mexErrMsgTxt("OPTS.orient applies to plain frames only");
+	}
+	record_path = pvcam_option_string(opts, "record", "");
+	record_on = (record_path[0] != '\0');
+	codec = (pvcam_option_value(opts, "compress", 1.0) != 0.0) ? CODEC_RICE : CODEC_PACK;
+	if (record_on && centroid_on) {
+		mexErrMsgTxt("OPTS.record cannot be combined with OPTS.centroids");
+	}
+	if (!pl_get_param(hcam, PARAM_BIT_DEPTH, ATTR_CURRENT, (void *) &bit_depth) || (bit_depth < 0)) {
+		bit_depth = 0;
+	}
+	pack = (uns32) pvcam_option_value(opts, "pack", 0.0);
+	if (pack == 1) {
+		if ((bit_depth <= 0) || (bit_depth > 16)) {
+			mexErrMsgTxt("OPTS.pack = 1 needs the sensor bit depth, see PARAM_BIT_DEPTH");
+		}
+		pack = (bit_depth < 8) ? 8 : (uns32) (bit_depth + 1) & ~1u;
+	}
+	if ((pack != 0) && ((pack < 8) || (pack > 16) || (pack % 2 != 0))) {
+		mexErrMsgTxt("OPTS.pack must be 0, 1, 8, 10, 12, 14 or 16");
+	}
+	if ((pack != 0) && (centroid_on || hdr_on || (speckle_mode != SPECKLE_NONE) || (naccum > 1) || (orient != ORIENT_NONE))) {
+		mexErrMsgTxt("OPTS.pack applies to plain frames only");
+	}
+	pipe_list = (opts != NULL) ? mxGetField(opts, 0, "pipeline") : NULL;
+	if ((pipe_list != NULL) && !mxIsEmpty(pipe_list) &&
+		(centroid_on || hdr_on || (speckle_mode != SPECKLE_NONE) || (naccum > 1) || (orient != ORIENT_NONE) || (pack != 0))) {
+		mexErrMsgTxt("OPTS.pipeline applies to plain frames only");
+	}
+	depth = pvcam_option_value(opts, "pipedepth", (double) PIPE_DEPTH);
+	if ((depth < 1.0) || (depth > (double) PIPE_MAX_DEPTH) || (depth != (double) (uns32) depth)) {
+		mexErrMsgTxt("OPTS.pipedepth must be a whole number of frames from 1 to 1024");
+	}
+	npipe = (uns32) depth;
+	modestr = pvcam_option_string(opts, "overload", overload_list[OVERLOAD_BLOCK]);
+	for (policy = 0; (policy < 5) && (strcmp(modestr, overload_list[policy]) != 0); policy++) {
+	}
+	mxFree((void *) modestr);
+	if (policy == 5) {
+		mexErrMsgTxt("OPTS.overload must be 'block', 'dropoldest', 'dropnewest', 'skip' or 'decimate'");
+	}
+	decimate = pvcam_option_value(opts, "decimate", (double) PIPE_DECIMATE);
+	if ((decimate < 1.0) || (decimate > 4294967295.0) || (decimate != (double) (uns32) decimate)) {
+		mexErrMsgTxt("OPTS.decimate must be a whole number of frames");
+	}
+	highwater = pvcam_option_value(opts, "highwater", (nbuffer > 2) ? floor((double) nbuffer / 2.0) : 1.0);
+	if (highwater < 1.0) {
+		mexErrMsgTxt("OPTS.highwater must be at least 1");
+	}
+
+	// create metadata output
+	*meta_struct = mxCreateStructMatrix(1, 1, META_FIELD, field_list);
+	for (i = 0; i < META_FIELD; i++) {
+		mxSetFieldByNumber(*meta_struct, 0, (int) i, mxCreateDoubleMatrix(1, nimage, mxREAL));
+		meta_ptr[i] = mxGetPr(mxGetFieldByNumber(*meta_struct, 0, (int) i));
+	}
+	*stats_struct = mxCreateStructMatrix(1, 1, STATS_FIELD, stats_list);
+	for (i = 0; i < STATS_FIELD - 6; i++) {
+		mxSetFieldByNumber(*stats_struct, 0, (int) i, mxCreateDoubleScalar(0.0));
+	}
+	mxSetFieldByNumber(*stats_struct, 0, 11, mxCreateDoubleScalar(0.0));
+	mxSetFieldByNumber(*stats_struct, 0, 8, mxCreateDoubleScalar((double) pack));
+
+	// build the pipeline before anything that would need releasing on an error
+	// its workers run until pvcam_pipe_close, so every later failure must close it
+	// overload decisions and stages with results get a metadata field, one column per frame
+	memset(&pipe, 0, sizeof(pvcam_pipe));
+	overload_ptr = NULL;
+	nstage = 0;
+	if ((pipe_list != NULL) && !mxIsEmpty(pipe_list)) {
+		field_nr = mxAddField(*meta_struct, "overload");
+		mxSetFieldByNumber(*meta_struct, 0, field_nr, mxCreateDoubleMatrix(1, nimage, mxREAL));
+		overload_ptr = mxGetPr(mxGetFieldByNumber(*meta_struct, 0, field_nr));
+		nstage = pvcam_pipeline_config(pipe_list, *meta_struct, stage_config);
+	}
+	if ((nstage > 0) && !pvcam_pipe_open(&pipe, nstage, stage_config, nregion, region, npipe, policy)) {
+		mexErrMsgTxt(pipe.err_msg);
+	}
+	pipe.decimate = (uns32) decimate;
+	for (i = 0; i < pipe.nstage; i++) {
+		result_ptr[i] = NULL;
+		if (pipe.stage[i].nresult > 0) {
+			field_nr = mxAddField(*meta_struct, pipe.stage[i].name);
+			mxSetFieldByNumber(*meta_struct, 0, field_nr, mxCreateDoubleMatrix(pipe.stage[i].nresult, nimage, mxREAL));
+			result_ptr[i] = mxGetPr(mxGetFieldByNumber(*meta_struct, 0, field_nr));
+			for (k = 0; k < pipe.stage[i].nresult * nimage; k++) {
+				result_ptr[i][k] = mxGetNaN();
+			}
+		}
+	}
+
+	// create output array
+	// plain frames stay 16-bit unless packed, accumulated frames are 32-bit
+	// speckle contrast maps and HDR frames are single precision
+	// centroid columns are sized for full frames and trimmed at the end
+	npixel = pvcam_region_pixels(nregion, region);
+	accum = NULL;
+	success = 1;
+	memset(&spatial, 0, sizeof(pvcam_spatial));
+	memset(&temporal, 0, sizeof(pvcam_temporal));
+	memset(&defect, 0, sizeof(pvcam_defect));
+	memset(&hdr, 0, sizeof(pvcam_hdr));
+	if (centroid_on) {
+		data_struct = mxCreateStructMatrix(1, 1, CENTROID_FIELD, centroid_list);
+		for (i = 0; i < CENTROID_FIELD; i++) {
+			mxSetFieldByNumber(data_struct, 0, (int) i, mxCreateDoubleMatrix((size_t) nimage * ncentroid, 1, mxREAL));
+			centroid_ptr[i] = mxGetPr(mxGetFieldByNumber(data_struct, 0, (int) i));
+		}
+	}
+	else if (hdr_on) {
+		data_struct = mxCreateNumericMatrix(1, (size_t) npixel * (nimage / nsmart), mxSINGLE_CLASS, mxREAL);
+		for (i = 0; i < npixel * (nimage / nsmart); i++) {
+			((flt32 *) mxGetData(data_struct))[i] = (flt32) mxGetNaN();
+		}
+		success = pvcam_hdr_init(&hdr, npixel, (flt32) pvcam_option_value(opts, "hdrbias", 0.0),
+			(flt32) pvcam_option_value(opts, "hdrsat", 0.0));
+	}
+	else if (speckle_mode == SPECKLE_SPATIAL) {
+		data_struct = mxCreateNumericMatrix(1, (size_t) npixel * nimage, mxSINGLE_CLASS, mxREAL);
+		success = pvcam_spatial_init(&spatial, nregion, region, nwindow);
+	}
+	else if (speckle_mode == SPECKLE_TEMPORAL) {
+		data_struct = mxCreateNumericMatrix(1, (size_t) npixel * nimage, mxSINGLE_CLASS, mxREAL);
+		success = pvcam_temporal_init(&temporal, npixel, nwindow);
+	}
+	else if (pack > 0) {
+		data_struct = mxCreateNumericMatrix(1, pvcam_packed_bytes(npixel, pack) * nimage, mxUINT8_CLASS, mxREAL);
+	}
+	else if (naccum == 1) {
+		data_struct = mxCreateNumericMatrix(1, (size_t) npixel * nimage, mxUINT16_CLASS, mxREAL);
+	}
+	else if (accum_mode == ACCUM_SUM) {
+		data_struct = mxCreateNumericMatrix(1, (size_t) npixel * (nimage / naccum), mxUINT32_CLASS, mxREAL);
+	}
+	else {
+		data_struct = mxCreateNumericMatrix(1, (size_t) npixel * (nimage / naccum), mxSINGLE_CLASS, mxREAL);
+		accum = (uns32 *) mxCalloc((size_t) npixel, sizeof(uns32));
+	}
+	if (!success) {
+		pvcam_error(hcam, "Cannot allocate processing storage");
+		pvcam_pipe_close(&pipe);
+		mxDestroyArray(data_struct);
+		return(mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL));
+	}
+
+	// map defects onto the active regions
+	if ((hot_list != NULL) && !mxIsEmpty(hot_list) &&
+		!pvcam_defect_init(&defect, nregion, region, mxGetPr(hot_list), (uns32) mxGetM(hot_list))) {
+		pvcam_error(hcam, "Cannot allocate defect list");
+		pvcam_pipe_close(&pipe);
+		pvcam_spatial_free(&spatial);
+		pvcam_temporal_free(&temporal);
+		pvcam_hdr_free(&hdr);
+		mxFree((void *) record_path);
+		mxDestroyArray(data_struct);
+		return(mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL));
+	}
+
+	// create recording file before the camera starts
+	memset(&recorder, 0, sizeof(pvcam_recorder));
+	if (record_on && !pvcam_record_open(&recorder, record_path, nregion, region, (uns32) bit_depth, codec)) {
+		pvcam_error(hcam, recorder.err_msg);
+		pvcam_pipe_close(&pipe);
+		pvcam_spatial_free(&spatial);
+		pvcam_temporal_free(&temporal);
+		pvcam_defect_free(&defect);
+		pvcam_hdr_free(&hdr);
+		mxFree((void *) record_path);
+		mxDestroyArray(data_struct);
+		return(mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL));
+	}
+	mxFree((void *) record_path);
+
+	// start continuous acquisition
+	pvcam_clock_begin(hcam);
+	if (!pvcam_stream_open(&stream, hcam, nregion, region, exptime, expmode, nbuffer, timing)) {
+		pvcam_error(hcam, stream.err_msg);
+		success = 0;
+	}
+	else if (hdr_on && !stream.has_meta) {
+		pvcam_error(hcam, "OPTS.hdr needs frame metadata for exposure times");
+		success = 0;
+	}
+	else if (centroid_on && !stream.centroids) {
+		pvcam_error(hcam, "OPTS.centroids needs frame metadata, see PARAM_METADATA_ENABLED");
+		success = 0;
+	}
+	else if (!centroid_on && stream.centroids) {
+		pvcam_error(hcam, "PrimeLocate is on, set OPTS.centroids to acquire centroids");
+		success = 0;
+	}
+	nrow = 0;
+	first_group = hdr_group = 0;
+
+	// pull each frame out of the circular buffer
+	for (i = 0; success && (i < nimage); i++) {
+		frame_ns = pvcam_stats_mark();
+		if (!pvcam_stream_next(&stream, &frame)) {
+			pvcam_error(hcam, stream.err_msg);
+			success = 0;
+			break;
+		}
+		if (!centroid_on && (frame.npixel != npixel)) {
+			pvcam_error(hcam, "Frame size does not match ROI");
+			success = 0;
+			break;
+		}
+
+		// record metadata
+		meta_ptr[0][i] = (double) frame.frame_nr;
+		meta_ptr[1][i] = frame.bof_ns;
+		meta_ptr[2][i] = frame.eof_ns;
+		meta_ptr[3][i] = frame.exp_ns;
+		meta_ptr[4][i] = (double) frame.ndropped;
+		meta_ptr[5][i] = (double) frame.late;
+		meta_ptr[6][i] = (frame.host_bof_ns >= 0.0) ? frame.host_bof_ns : mxGetNaN();
+		meta_ptr[7][i] = (frame.host_eof_ns >= 0.0) ? frame.host_eof_ns : mxGetNaN();
+		meta_ptr[8][i] = frame.host_data_ns;
+		meta_ptr[11][i] = (nsmart > 0) ? (double) ((frame.frame_nr - 1) % nsmart + 1) : 0.0;
+
+		// pair camera EOF with the host EOF callback for the clock model
+		// without callbacks, only frames taken as they arrive are paired, least delayed first
+		if (stream.has_meta) {
+			if (frame.host_eof_ns >= 0.0) {
+				pvcam_clock_sample(hcam, frame.eof_ns, (double) stream.start_ns + frame.host_eof_ns);
+			}
+			else if (!timing && (stream.backlog == 0)) {
+				pvcam_clock_sample_polled(hcam, frame.eof_ns, (double) stream.start_ns + frame.host_data_ns);
+			}
+		}
+
+		// correct defects, then copy, accumulate or reduce pixels
+		// plain copies only hand the frame to MATLAB, everything else is processing
+		stage_ns = pvcam_stats_mark();
+		if (defect.ndefect > 0) {
+			pvcam_defect_correct(&defect, frame.pixels);
+			stage_ns = pvcam_stats_lap(STAGE_DEFECT, stage_ns);
+		}
+		if (record_on) {
+			if (!pvcam_record_frame(&recorder, &frame)) {
+				pvcam_error(hcam, recorder.err_msg);
+				success = 0;
+				break;
+			}
+			stage_ns = pvcam_stats_lap(STAGE_RECORD, stage_ns);
+		}
+		k = i / naccum;
+		if (centroid_on) {
+
+			// flagged and truncated regions carry no centroid
+			for (r = 0; r < frame.nroi; r++) {
+				roi_header = frame.roi[r].header;
+				if ((roi_header->flags & PL_MD_ROI_FLAG_INVALID) || (nrow >= (uns32) nimage * ncentroid) ||
+					(frame.roi[r].dataSize < pvcam_region_pixels(1, &roi_header->roi) * sizeof(uns16)) ||
+					!pvcam_centroid_region((const uns16 *) frame.roi[r].data, &roi_header->roi, &centroid)) {
+					continue;
+				}
+				centroid_ptr[0][nrow] = (double) frame.frame_nr;
+				centroid_ptr[1][nrow] = (double) roi_header->roiNr;
+				centroid_ptr[2][nrow] = centroid.x;
+				centroid_ptr[3][nrow] = centroid.y;
+				centroid_ptr[4][nrow] = centroid.intensity;
+				centroid_ptr[5][nrow] = centroid.background;
+				centroid_ptr[6][nrow] = (frame.roi_res_ns > 0.0) ? (double) roi_header->timestampBOR * frame.roi_res_ns : mxGetNaN();
+				centroid_ptr[7][nrow] = (frame.roi_res_ns > 0.0) ? (double) roi_header->timestampEOR * frame.roi_res_ns : mxGetNaN();
+				nrow++;
+			}
+		}
+		else if (hdr_on) {
+
+			// brackets follow the SMART cycle, so a dropped frame leaves its bracket short
+			group = (frame.frame_nr - 1) / nsmart;
+			if (i == 0) {
+				first_group = hdr_group = group;
+				if (hdr.saturation <= 0.0f) {
+					hdr.saturation = (frame.bit_depth > 0) ? (flt32) ((1 << frame.bit_depth) - 1) : 65535.0f;
+				}
+			}
+			if ((group != hdr_group) && (hdr.nframe > 0)) {
+				pvcam_hdr_fuse(&hdr, (flt32 *) mxGetData(data_struct) + (size_t) npixel * (hdr_group - first_group));
+			}
+			hdr_group = group;
+			if ((group - first_group < nimage / nsmart) && (frame.exp_ns > 0.0)) {
+				pvcam_hdr_add(&hdr, frame.pixels, (flt32) (frame.exp_ns * 1e-9));
+			}
+		}
+		else if (speckle_mode == SPECKLE_SPATIAL) {
+			pvcam_spatial_contrast(&spatial, frame.pixels, (flt32 *) mxGetData(data_struct) + (size_t) npixel * i);
+		}
+		else if (speckle_mode == SPECKLE_TEMPORAL) {
+			pvcam_temporal_contrast(&temporal, frame.pixels, (flt32 *) mxGetData(data_struct) + (size_t) npixel * i);
+		}
+		else if (pack > 0) {
+
+			// a sensor deeper than the packing width would lose its top bits
+			if (frame.bit_depth > pack) {
+				pvcam_error(hcam, "Frame metadata bit depth exceeds OPTS.pack");
+				success = 0;
+				break;
+			}
+			pvcam_pack_pixels(frame.pixels, npixel, pack, (uns8 *) mxGetData(data_struct) + pvcam_packed_bytes(npixel, pack) * i);
+		}
+		else if (pipe.nstage > 0) {
+
+			// hand over frames already done, then let the overload policy decide on this one
+			// a frame let into a full pipeline holds the camera loop until the oldest frame is done
+			if (!pvcam_pipeline_deliver(&pipe, 0, (uns16 *) mxGetData(data_struct), result_ptr, overload_ptr)) {
+				pvcam_error(hcam, pipe.err_msg);
+				success = 0;
+				break;
+			}
+			admit = pvcam_pipe_admit(&pipe, stream.backlog >= (uns32) highwater);
+			if ((admit != ADMIT_REFUSED) && pvcam_pipe_full(&pipe) && (!pvcam_pipe_wait(&pipe) ||
+				!pvcam_pipeline_deliver(&pipe, 0, (uns16 *) mxGetData(data_struct), result_ptr, overload_ptr))) {
+				pvcam_error(hcam, pipe.err_msg);
+				success = 0;
+				break;
+			}
+			if (admit != ADMIT_REFUSED) {
+				pvcam_pipe_push(&pipe, &frame, i, admit);
+			}
+			overload_ptr[i] = (double) admit;
+		}
+		else if ((naccum == 1) && (orient == ORIENT_NONE)) {
+			memcpy((uns16 *) mxGetData(data_struct) + (size_t) npixel * i, frame.pixels, (size_t) npixel * sizeof(uns16));
+		}
+		else if (naccum == 1) {
+			if (!pvcam_orient_frames(frame.pixels, 1, nregion, region, orient,
+				(uns16 *) mxGetData(data_struct) + (size_t) npixel * i)) {
+				pvcam_error(hcam, "Cannot allocate processing storage");
+				success = 0;
+				break;
+			}
+		}
+		else if (accum_mode == ACCUM_SUM) {
+			pvcam_accum_add((uns32 *) mxGetData(data_struct) + (size_t) npixel * k, frame.pixels, npixel);
+		}
+		else {
+			pvcam_accum_add(accum, frame.pixels, npixel);
+			if ((i + 1) % naccum == 0) {
+				pvcam_accum_mean((flt32 *) mxGetData(data_struct) + (size_t) npixel * k, accum, npixel, naccum);
+				memset(accum, 0, (size_t) npixel * sizeof(uns32));
+			}
+		}
+		pvcam_stats_lap(((speckle_mode == SPECKLE_NONE) && (naccum == 1) && !hdr_on && !centroid_on && (orient == ORIENT_NONE) &&
+			(pack == 0) && (pipe.nstage == 0)) ? STAGE_HANDOFF : STAGE_PROCESS, stage_ns);
+
+		// a frame used in place may have been overwritten by the camera meanwhile
+		if (!pvcam_stream_done(&stream, &frame)) {
+			pvcam_error(hcam, stream.err_msg);
+			success = 0;
+			break;
+		}
+		meta_ptr[12][i] = (double) frame.overwritten;
+		pvcam_stats_lap(STAGE_FRAME, frame_ns);
+	}
+
+	// last bracket may still be open
+	if (hdr_on && (hdr.nframe > 0)) {
+		pvcam_hdr_fuse(&hdr, (flt32 *) mxGetData(data_struct) + (size_t) npixel * (hdr_group - first_group));
+	}
+	if (centroid_on) {
+		for (i = 0; i < CENTROID_FIELD; i++) {
+			mxSetM(mxGetFieldByNumber(data_struct, 0, (int) i), nrow);
+		}
+	}
+
+	// stop acquisition and report frame continuity
+	// frames already recorded stay readable even if the index cannot be written
+	pvcam_stream_close(&stream);
+	if (record_on && !pvcam_record_close(&recorder)) {
+		pvcam_error(hcam, recorder.err_msg);
+	}
+
+	// frames still in the pipeline are done with the camera stopped
+	if (pipe.nstage > 0) {
+		if (success && !pvcam_pipeline_deliver(&pipe, 1, (uns16 *) mxGetData(data_struct), result_ptr, overload_ptr)) {
+			pvcam_error(hcam, pipe.err_msg);
+			success = 0;
+		}
+		mxSetFieldByNumber(*stats_struct, 0, 9, pvcam_pipeline_struct(&pipe));
+		mxSetFieldByNumber(*stats_struct, 0, 10, pvcam_overload_struct(&pipe, overload_list[policy]));
+		pvcam_pipe_close(&pipe);
+	}
+	*mxGetPr(mxGetFieldByNumber(*stats_struct, 0, 0)) = (double) stream.stats.nframe;
+	*mxGetPr(mxGetFieldByNumber(*stats_struct, 0, 1)) = (double) stream.stats.ndropped;
+	*mxGetPr(mxGetFieldByNumber(*stats_struct, 0, 2)) = (double) stream.stats.nlate;
+	*mxGetPr(mxGetFieldByNumber(*stats_struct, 0, 3)) = (double) stream.stats.noverrun;
+	*mxGetPr(mxGetFieldByNumber(*stats_struct, 0, 4)) = (double) stream.stats.max_backlog;
+	*mxGetPr(mxGetFieldByNumber(*stats_struct, 0, 5)) = stream.stats.interval_ns;
+	*mxGetPr(mxGetFieldByNumber(*stats_struct, 0, 11)) = (double) stream.stats.noverwritten;
+	if (timing) {
+		mxSetFieldByNumber(*stats_struct, 0, 6, pvcam_latency_struct(meta_ptr, stream.stats.nframe));
+	}
+
+	// convert camera EOF to host clock and UTC with the updated model
+	if (pvcam_clock_end(hcam, &clock_fit)) {
+		for (i = 0; i < stream.stats.nframe; i++) {
+			meta_ptr[9][i] = clock_fit.offset + clock_fit.rate * meta_ptr[2][i];
+			meta_ptr[10][i] = (meta_ptr[9][i] + clock_fit.utc_offset) * 1e-9;
+		}
+		mxSetFieldByNumber(*stats_struct, 0, 7, pvcam_clock_struct(&clock_fit));
+	}
+	else {
+		for (i = 0; i < stream.stats.nframe; i++) {
+			meta_ptr[9][i] = mxGetNaN();
+			meta_ptr[10][i] = mxGetNaN();
+		}
+	}
+
+	// release processing storage
+	pvcam_spatial_free(&spatial);
+	pvcam_temporal_free(&temporal);
+	pvcam_defect_free(&defect);
+	pvcam_hdr_free(&hdr);
+	if (accum != NULL) {
+		mxFree((void *) accum);
+	}
+	if (!success) {
+		mxDestroyArray(data_struct);
+		return(mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL));
+	}
+	return(data_struct);
+}
+
+
+// read OPTS.pipeline into stage configurations, stage parameters borrow the option values
+// names must make metadata fields, after defaults to the element before
+uns32 pvcam_pipeline_config(const mxArray *pipeline, const mxArray *meta_struct, pvcam_stage_config *config) {
+
+	// declarations
+	char		err_msg[ERROR_MSG];	// error message
+	char		after_name[STAGE_NAME];	// name in after
+	const char	*field_name;	// parameter field name
+	const mxArray	*field;		// field value
+	const mxArray	*item;		// element of after
+	double		*after_ptr;		// positions in after
+	pvcam_stage_config	*stage;	// stage being read
+	uns32		after_mask;		// stages already in after, as a bit mask
+	uns32		f;				// field counter
+	uns32		g, h;			// stage counters
+	uns32		j;				// after counter
+	uns32		nafter;			// entries in after
+	uns32		nstage;			// stages listed
+
+	nstage = (uns32) mxGetNumberOfElements(pipeline);
+	if (!mxIsStruct(pipeline) || (nstage > MAX_STAGE)) {
+		sprintf(err_msg, "OPTS.pipeline must be a structure array of at most %d stages", MAX_STAGE);
+		mexErrMsgTxt(err_msg);
+	}
+	for (g = 0; g < nstage; g++) {
+		stage = &config[g];
+		memset(stage, 0, sizeof(pvcam_stage_config));
+
+		// stage type and name, the name becomes a metadata field
+		field = mxGetField(pipeline, g, "stage");
+		if ((field == NULL) || !mxIsChar(field) || (mxGetString(field, stage->type, STAGE_NAME) != 0)) {
+			sprintf(err_msg, "OPTS.pipeline(%u).stage must name a stage type", g + 1);
+			mexErrMsgTxt(err_msg);
+		}
+		field = mxGetField(pipeline, g, "name");
+		if ((field == NULL) || mxIsEmpty(field)) {
+			strcpy(stage->name, stage->type);
+		}
+		else if (!mxIsChar(field) || (mxGetString(field, stage->name, STAGE_NAME) != 0)) {
+			sprintf(err_msg, "OPTS.pipeline(%u).name must be a string of at most %d characters", g + 1, STAGE_NAME - 1);
+			mexErrMsgTxt(err_msg);
+		}
+		for (j = 0; stage->name[j] != '\0'; j++) {
+			if (!(((stage->name[j] >= 'a') && (stage->name[j] <= 'z')) || ((stage->name[j] >= 'A') && (stage->name[j] <= 'Z')) ||
+				((j > 0) && (((stage->name[j] >= '0') && (stage->name[j] <= '9')) || (stage->name[j] == '_'))))) {
+				break;
+			}
+		}
+		if ((j == 0) || (stage->name[j] != '\0') || (mxGetFieldNumber(meta_struct, stage->name) >= 0)) {
+			sprintf(err_msg, "OPTS.pipeline(%u).name must be a valid field name other than a META field", g + 1);
+			mexErrMsgTxt(err_msg);
+		}
+
+		// stages feeding this one, by position or name, an unset after chains to the element before
+		field = mxGetField(pipeline, g, "after");
+		after_mask = 0;
+		if ((field == NULL) || mxIsEmpty(field)) {
+			after_mask = (g > 0) ? (1u << (g - 1)) : 0;
+		}
+		else if (mxIsChar(field) || mxIsCell(field)) {
+			nafter = mxIsChar(field) ? 1 : (uns32) mxGetNumberOfElements(field);
+			for (j = 0; j < nafter; j++) {
+				item = mxIsChar(field) ? field : mxGetCell(field, j);
+				if ((item == NULL) || !mxIsChar(item) || (mxGetString(item, after_name, STAGE_NAME) != 0)) {
+					after_name[0] = '\0';
+				}
+				for (h = 0; (h < g) && (strcmp(after_name, config[h].name) != 0); h++) {
+				}
+				if (h == g) {
+					sprintf(err_msg, "OPTS.pipeline(%u).after must name stages listed before it", g + 1);
+					mexErrMsgTxt(err_msg);
+				}
+				after_mask |= 1u << h;
+			}
+		}
+		else if (mxIsDouble(field) && !mxIsComplex(field)) {
+			nafter = (uns32) mxGetNumberOfElements(field);
+			after_ptr = mxGetPr(field);
+			for (j = 0; j < nafter; j++) {
+				if ((after_ptr[j] < 0.0) || (after_ptr[j] > (double) g) || (after_ptr[j] != (double) (uns32) after_ptr[j])) {
+					sprintf(err_msg, "OPTS.pipeline(%u).after must hold positions of stages listed before it, or 0", g + 1);
+					mexErrMsgTxt(err_msg);
+				}
+				if (after_ptr[j] > 0.0) {
+					after_mask |= 1u << ((uns32) after_ptr[j] - 1);
+				}
+			}
+		}
+		else {
+			sprintf(err_msg, "OPTS.pipeline(%u).after must be positions or names of stages", g + 1);
+			mexErrMsgTxt(err_msg);
+		}
+		for (h = 0; h < g; h++) {
+			if (after_mask & (1u << h)) {
+				stage->after[stage->nafter++] = h;
+			}
+		}
+
+		// optional stages give way under overload
+		field = mxGetField(pipeline, g, "optional");
+		stage->optional = ((field != NULL) && !mxIsEmpty(field) && (mxGetScalar(field) != 0.0));
+
+		// every other field that is set is a parameter
+		for (f = 0; f < (uns32) mxGetNumberOfFields(pipeline); f++) {
+			field_name = mxGetFieldNameByNumber(pipeline, (int) f);
+			field = mxGetFieldByNumber(pipeline, g, (int) f);
+			if ((strcmp(field_name, "stage") == 0) || (strcmp(field_name, "name") == 0) ||
+				(strcmp(field_name, "after") == 0) || (strcmp(field_name, "optional") == 0) ||
+				(field == NULL) || mxIsEmpty(field)) {
+				continue;
+			}
+			if (!mxIsDouble(field) || mxIsComplex(field) || (strlen(field_name) >= STAGE_NAME) ||
+				(stage->nparam == MAX_STAGE_PARAM)) {
+				sprintf(err_msg, "OPTS.pipeline(%u).%s must be a real double array, at most %d per stage", g + 1,
+					field_name, MAX_STAGE_PARAM);
+				mexErrMsgTxt(err_msg);
+			}
+			strcpy(stage->param[stage->nparam].name, field_name);
+			stage->param[stage->nparam].value = mxGetPr(field);
+			stage->param[stage->nparam].nvalue = (uns32) mxGetNumberOfElements(field);
+			stage->nparam++;
+		}
+	}
+	return(nstage);
+}
+
+
+// hand frames finished by the pipeline to MATLAB, waiting for every frame when draining
+// frames dropped in flight keep DATA 0 and results NaN, 0 if a stage failed
+rs_bool pvcam_pipeline_deliver(pvcam_pipe *pipe, rs_bool drain, uns16 *data_ptr, double **result_ptr, double *overload_ptr) {
 
 	// declarations
-	mxArray		*field_value;	// pointer to field value
+	pvcam_pipe_out	out;		// frame handed back
+	pvcam_stage	*stage;			// stage of results
+	uns32		g;				// stage counter
 
-	// extract pointer to field value
-	field_value = mxGetFieldByNumber(struct_array, (int) nstruct, (int) nfield);
-	if (field_value == NULL) {
-		mexErrMsgTxt("ROI has empty field value");
+	while (pvcam_pipe_pull(pipe, &out, drain)) {
+		if (out.cancelled) {
+			overload_ptr[out.index] = (double) ADMIT_REFUSED;
+			pvcam_pipe_retire(pipe);
+			continue;
+		}
+		memcpy(data_ptr + (size_t) pipe->npixel * out.index, out.pixels, (size_t) pipe->npixel * sizeof(uns16));
+		for (g = 0; g < pipe->nstage; g++) {
+			stage = &pipe->stage[g];
+			if (result_ptr[g] != NULL) {
+				memcpy(result_ptr[g] + (size_t) stage->nresult * out.index, out.result + stage->result_offset,
+					(size_t) stage->nresult * sizeof(double));
+			}
+		}
+		pvcam_pipe_retire(pipe);
 	}
-	else if (!mxIsNumeric(field_value)) {
-		mexErrMsgTxt("ROI has non-numeric field value");
+	return(!pipe->failed);
+}
+
+
+// summarize time spent in each pipeline stage
+mxArray *pvcam_pipeline_struct(const pvcam_pipe *pipe) {
+
+	// declarations
+	const char	*field_list[PIPELINE_FIELD] = {"stage", "name", "frames", "skipped", "busy", "mean"};
+	const pvcam_stage	*stage;	// stage summarized
+	mxArray		*pipeline_struct;	// output structure array
+	uns32		g;				// stage counter
+
+	pipeline_struct = mxCreateStructMatrix(1, pipe->nstage, PIPELINE_FIELD, field_list);
+	for (g = 0; g < pipe->nstage; g++) {
+		stage = &pipe->stage[g];
+		mxSetFieldByNumber(pipeline_struct, g, 0, mxCreateString(stage->type->name));
+		mxSetFieldByNumber(pipeline_struct, g, 1, mxCreateString(stage->name));
+		mxSetFieldByNumber(pipeline_struct, g, 2, mxCreateDoubleScalar((double) stage->nframe));
+		mxSetFieldByNumber(pipeline_struct, g, 3, mxCreateDoubleScalar((double) stage->nskipped));
+		mxSetFieldByNumber(pipeline_struct, g, 4, mxCreateDoubleScalar((double) stage->busy_ns));
+		mxSetFieldByNumber(pipeline_struct, g, 5, mxCreateDoubleScalar((stage->nframe > 0) ?
+			(double) stage->busy_ns / (double) stage->nframe : mxGetNaN()));
 	}
+	return(pipeline_struct);
+}
+
 
-	// return field value
-	return((uns16) mxGetScalar(field_value));
+// summarize overload decisions of pipeline
+mxArray *pvcam_overload_struct(const pvcam_pipe *pipe, const char *policy) {
+
+	// declarations
+	const char	*field_list[OVERLOAD_FIELD] = {"policy", "overloaded", "blocked", "blockedtime", "droppedoldest",
+											"droppednewest", "skipped"};
+	mxArray		*overload_struct;	// output structure
+
+	overload_struct = mxCreateStructMatrix(1, 1, OVERLOAD_FIELD, field_list);
+	mxSetFieldByNumber(overload_struct, 0, 0, mxCreateString(policy));
+	mxSetFieldByNumber(overload_struct, 0, 1, mxCreateDoubleScalar((double) pipe->overload.noverload));
+	mxSetFieldByNumber(overload_struct, 0, 2, mxCreateDoubleScalar((double) pipe->overload.nblocked));
+	mxSetFieldByNumber(overload_struct, 0, 3, mxCreateDoubleScalar((double) pipe->overload.blocked_ns));
+	mxSetFieldByNumber(overload_struct, 0, 4, mxCreateDoubleScalar((double) pipe->overload.ndrop_oldest));
+	mxSetFieldByNumber(overload_struct, 0, 5, mxCreateDoubleScalar((double) pipe->overload.ndrop_newest));
+	mxSetFieldByNumber(overload_struct, 0, 6, mxCreateDoubleScalar((double) pipe->overload.nskipped));
+	return(overload_struct);
+}
+
+
+// summarize host latency from metadata columns
+// columns are frame, bof, eof, exptime, dropped, late, hostbof, hosteof, hostdata
+mxArray *pvcam_latency_struct(double **meta_ptr, uns32 nframe) {
+
+	// declarations
+	const char	*field_list[LATENCY_FIELD] = {"measure", "count", "mean", "std", "min", "p50", "p99", "max"};
+	double		*sample;		// latency samples (ns)
+	mxArray		*latency_struct;	// output structure array
+	uns32		k;				// frame counter
+
+	latency_struct = mxCreateStructMatrix(1, NUM_LATENCY, LATENCY_FIELD, field_list);
+	sample = (double *) mxCalloc((size_t) nframe + 1, sizeof(double));
+
+	// start of acquisition to first BOF, one sample per acquisition
+	sample[0] = (nframe > 0) ? meta_ptr[6][0] : mxGetNaN();
+	pvcam_latency_record(latency_struct, 0, "start_bof", sample, 1);
+
+	// host callback spacing and delivery
+	for (k = 0; k < nframe; k++) {
+		sample[k] = meta_ptr[7][k] - meta_ptr[6][k];
+	}
+	pvcam_latency_record(latency_struct, 1, "bof_eof", sample, nframe);
+	for (k = 0; k < nframe; k++) {
+		sample[k] = meta_ptr[8][k] - meta_ptr[7][k];
+	}
+	pvcam_latency_record(latency_struct, 2, "eof_data", sample, nframe);
+
+	// host EOF against camera EOF, only with metadata
+	for (k = 0; k < nframe; k++) {
+		sample[k] = (meta_ptr[2][k] > 0.0) ? meta_ptr[7][k] - meta_ptr[2][k] : mxGetNaN();
+	}
+	pvcam_latency_record(latency_struct, 3, "camera_host", sample, nframe);
+
+	mxFree((void *) sample);
+	return(latency_struct);
+}
+
+
+// distribution of latency samples, NaN samples are skipped
+// samples are sorted in place for nearest-rank percentiles
+void pvcam_latency_record(mxArray *latency_struct, int measure, const char *name, double *sample, uns32 nsample) {
+
+	// declarations
+	double		mean = 0.0;		// sample mean
+	double		var = 0.0;		// sample variance
+	uns32		i;				// sample counter
+	uns32		n = 0;			// valid samples
+
+	// drop samples without a callback stamp
+	for (i = 0; i < nsample; i++) {
+		if (!mxIsNaN(sample[i])) {
+			sample[n++] = sample[i];
+		}
+	}
+	mxSetFieldByNumber(latency_struct, measure, 0, mxCreateString(name));
+	mxSetFieldByNumber(latency_struct, measure, 1, mxCreateDoubleScalar((double) n));
+	if (n == 0) {
+		for (i = 2; i < LATENCY_FIELD; i++) {
+			mxSetFieldByNumber(latency_struct, measure, (int) i, mxCreateDoubleScalar(mxGetNaN()));
+		}
+		return;
+	}
+
+	// two passes keep the variance exact for large offsets
+	for (i = 0; i < n; i++) {
+		mean += sample[i];
+	}
+	mean /= (double) n;
+	for (i = 0; i < n; i++) {
+		var += (sample[i] - mean) * (sample[i] - mean);
+	}
+	var = (n > 1) ? var / (double) (n - 1) : 0.0;
+	qsort((void *) sample, (size_t) n, sizeof(double), pvcam_compare_double);
+	mxSetFieldByNumber(latency_struct, measure, 2, mxCreateDoubleScalar(mean));
+	mxSetFieldByNumber(latency_struct, measure, 3, mxCreateDoubleScalar(sqrt(var)));
+	mxSetFieldByNumber(latency_struct, measure, 4, mxCreateDoubleScalar(sample[0]));
+	mxSetFieldByNumber(latency_struct, measure, 5, mxCreateDoubleScalar(sample[(n - 1) / 2]));
+	mxSetFieldByNumber(latency_struct, measure, 6, mxCreateDoubleScalar(sample[(uns32) ceil(0.99 * (double) n) - 1]));
+	mxSetFieldByNumber(latency_struct, measure, 7, mxCreateDoubleScalar(sample[n - 1]));
+}
+
+
+// compare doubles for qsort
+int pvcam_compare_double(const void *a, const void *b) {
+	double	x = *(const double *) a;
+	double	y = *(const double *) b;
+	return((x > y) - (x < y));
+}
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_acq(nlhs, plhs, nrhs, prhs);
 }
+#endif
@@ -1,12 +1,12 @@
 % PVCAMACQ - acquire image sequence from PVCAM device
 %
 %     DATA = PVCAMACQ(HCAM, NI, ROI, EXPTIME, EXPMODE) acquires an image
-%     sequence of NI images over the CCD region(s) specified by the structure
-%     array ROI from the camera specified by HCAM.  The exposure time is
-%     specified by EXPTIME; the units depend on the PARAM_EXP_RES and the
-%     PARAM_EXP_RES_INDEX settings.  The exposure mode ('timed', 'trigger',
-%     'strobe', 'bulb' or 'flash') is provided by EXPMODE.  The structure
-%     array ROI must have the following scalar fields:
+%	  sequence of NI images over the CCD region(s) specified by the structure
+%	  array ROI from the camera specified by HCAM.  The exposure time is
+%	  specified by EXPTIME; the units depend on the PARAM_EXP_RES and the
+%	  PARAM_EXP_RES_INDEX settings.  The exposure mode ('timed', 'trigger',
+%	  'strobe', or 'bulb') is provided by EXPMODE.  The structure array ROI
+%	  must have the following scalar fields:
 %
 %					s1 = first serial register
 %					s2 = last serial register
@@ -20,6 +20,199 @@
 %	  (unsigned 16-bit integer) containing the data from the image sequence.
 %	  The calling routine must reshape this vector based upon ROIs and images
 %	  in the sequence.  If unsuccessful, DATA = [].
+%
+%	  Cameras that read fewer regions per frame than ROI holds (see
+%	  PARAM_ROI_COUNT) read the smallest region covering them all instead,
+%	  and the regions are cut and binned out of it in software.  DATA has
+%	  the same layout either way; binned pixels are clipped at 65535.
+%	  Such acquisitions always run through the acquisition engine below,
+%	  so DATA holds pixels only, without metadata headers.
+%
+%     [DATA, META] = PVCAMACQ(HCAM, NI, ROI, EXPTIME, EXPMODE, OPTS) runs the
+%	  sequence through the continuous acquisition engine instead.  DATA then
+%	  holds pixel data only, and the per-frame metadata is returned in the
+%	  structure META with fields frame, bof, eof, exptime, dropped, late,
+%	  hostbof, hosteof, hostdata, hosttime, utc, smart and overwritten
+%	  (1 x NI vectors, timestamps in ns).
+%	  dropped counts the frames missing just before each frame and late
+%	  flags frames whose EOF interval is well above the running average.
+%	  overwritten flags frames the camera wrote over in the circular buffer
+%	  while they were still being processed; their DATA may be corrupt.
+%	  hostdata is the host clock when the frame was taken from the buffer;
+%	  hostbof and hosteof are the host clock in the BOF and EOF callbacks
+%	  when OPTS.latency is set, NaN otherwise.  These host times are
+%	  measured from the start of the acquisition.  hosttime is the camera
+%	  EOF converted to the host monotonic clock and utc the same instant in
+%	  seconds since 1970 (POSIX time), both through the clock model of the
+%	  camera, which is refitted with every acquisition (see PVCAMCLOCK);
+%	  both are NaN without metadata.  smart is the position of the frame in
+%	  the SMART streaming exposure list (see PVCAMSMART), 0 with SMART
+%	  streaming off.  OPTS is an optional structure with
+%	  fields:
+%
+%					buffer = frames in circular buffer (default 16)
+%					accumulate = frames summed into each output frame (default 1)
+%					accummode = 'sum' (uint32 DATA) or 'mean' (single DATA)
+%					speckle = 'none', 'spatial' or 'temporal' speckle contrast
+%					specklewin = speckle window (default 7 pixels or 25 frames)
+%					hotpixels = N x 2 list of [serial parallel] defect coordinates
+%					latency = 1 to time the host path with frame callbacks (default 0)
+%					hdr = 1 to fuse each SMART streaming cycle into one HDR frame (default 0)
+%					hdrbias = camera offset removed before fusing (default 0 DN)
+%					hdrsat = saturation level (default 2^bitdepth - 1 DN)
+%					centroids = 1 to return PrimeLocate centroids instead of pixels (default 0)
+%					orient = 'none', 'transpose', 'rot90', 'rot180', 'rot270', 'fliplr' or 'flipud'
+%					record = file to record every frame into (default '', no recording)
+%					compress = 1 to Rice code the recording (default), 0 to bit-pack only
+%					pack = bits per pixel of packed DATA, 8, 10, 12, 14 or 16, 1 for the sensor bit depth (default 0, not packed)
+%					pipeline = structure array of processing stages (default [], no pipeline)
+%					pipedepth = frames in flight through the pipeline, 1 to 1024 (default 8)
+%					overload = 'block', 'dropoldest', 'dropnewest', 'skip' or 'decimate' (default 'block')
+%					decimate = optional stages run on every decimate-th frame under 'decimate' (default 4)
+%					highwater = frames waiting in the buffer that count as overload (default buffer / 2)
+%
+%	  NI must be a multiple of accumulate.  With speckle set, DATA is the
+%	  single precision speckle contrast K = std / mean of every frame; the
+%	  spatial window is clipped at ROI edges and the temporal window fills
+%	  up over the first frames.  Pixels listed in hotpixels (see PVCAMDEFECT)
+%	  are replaced by the mean of their good neighbors before any other
+%	  processing.  orient reorients each region of every frame as it is
+%	  copied out, exactly as PVCAMORIENT does afterwards; it applies to
+%	  plain 16-bit frames only.
+%
+%	  With record set, every frame is also written to the named file as it
+%	  arrives, after hot pixel correction and before any other processing,
+%	  and DATA is returned as usual.  Frames are coded losslessly in tiles
+%	  spread over the worker threads: bit-packed to their widest pixel,
+%	  which stores a 12-bit sensor in 12 bits per pixel, and with compress
+%	  set also delta coded in adaptive Rice codes wherever that is smaller.
+%	  PVCAMREAD maps the file and decodes any of its frames.  Raise
+%	  OPTS.buffer if the disk cannot keep up and overruns appear.
+%
+%	  With pack set, DATA is an unsigned 8-bit vector holding every plain
+%	  frame packed to pack bits per pixel, least significant bit first,
+%	  with each frame starting on a whole byte; pixels too large for pack
+%	  bits are clipped.  A 12-bit sensor then takes 3/4 of the memory.
+%	  pack = 1 uses the narrowest width that holds PARAM_BIT_DEPTH, 16 for
+%	  a 15 or 16-bit sensor, whose frames are then only copied, and the
+%	  acquisition stops with an error if frame metadata reports a deeper
+%	  sensor than pack.  STATS.pack gives the width used, and PVCAMUNPACK
+%	  turns DATA back into 16-bit frames.
+%
+%	  With pipeline set, every plain frame runs through a graph of
+%	  processing stages on the worker threads (see PVCAMTHREADS) while the
+%	  next frames are read out.  Each element of OPTS.pipeline is one
+%	  stage with fields:
+%
+%					stage = stage type, one of the types below
+%					name = name of the stage (default the stage type)
+%					after = stages that must finish a frame first, as positions
+%						in OPTS.pipeline or names (default the element before,
+%						0 for none, so an unset after makes a chain)
+%					optional = 1 if the stage may be left out under overload (default 0)
+%
+%	  and any other field is a parameter of the stage.  Built-in types:
+%
+%					defect = replace hotpixels (N x 2 [serial parallel]) by their neighbors
+%					offset = subtract level (DN) from every pixel, clipping at 0
+%					summary = mean, min and max of each region (3 x nregion results)
+%					diff = mean absolute difference to the previous frame (1 result, NaN first)
+%
+%	  defect and offset modify pixels, so every other stage must come
+%	  before or after them; stages that do not depend on each other run
+%	  side by side.  DATA holds each frame as the last stage left it, and
+%	  the results of each stage with any are returned in META.<name>, one
+%	  column per frame.  Stages see frames in any order except diff, which
+%	  sees them in frame order, and DATA and META are always in frame
+%	  order.  The pipeline applies to plain frames only; hotpixels and
+%	  record act on each frame before it enters.
+%
+%	  Only pipedepth frames are in flight at once.  The pipeline is
+%	  overloaded when all are taken or when highwater frames are waiting
+%	  in the circular buffer behind the frame just read, and overload
+%	  then decides what happens to that frame:
+%
+%					block = wait for the oldest frame in flight to be done
+%					dropoldest = drop the oldest frame in flight without waiting for it, or this frame if none can be dropped
+%					dropnewest = drop this frame
+%					skip = run this frame without its optional stages
+%					decimate = as skip, except every decimate-th frame runs all stages
+%
+%	  With skip and decimate a frame still waits when every slot is taken,
+%	  so no frame is lost to the policy; the optional stages give way
+%	  first.  With dropoldest the frame takes one of a few spare slots
+%	  while the dropped frame finishes the stage it is in, and is dropped
+%	  itself if every spare is still taken.  META.overload holds 0 for
+%	  frames that ran every stage, 1 for frames that skipped their
+%	  optional stages and 2 for dropped frames, whose DATA stays 0 and
+%	  whose results are NaN, as are the results of skipped stages.  A frame
+%	  the camera overwrote in the buffer is lost whatever the policy, so
+%	  raise OPTS.buffer if overruns appear.
+%
+%	  With hdr set, every cycle through the SMART streaming exposure list
+%	  (see PVCAMSMART) is fused into one single precision frame of
+%	  radiance in DN/s, so DATA holds NI / numel(EXPTIMES) frames and NI
+%	  must be a multiple of numel(EXPTIMES).  Each pixel is the sum of its
+%	  unsaturated, offset-corrected values over the sum of their metadata
+%	  exposure times, which weights every exposure by its length; a pixel
+%	  saturated in every exposure gets the lower bound from the shortest
+%	  one.  Frames are grouped by frame number, so a dropped frame leaves
+%	  its cycle with one exposure less rather than shifting later cycles,
+%	  and a cycle with no frames at all is NaN.
+%
+%	  With centroids set, PrimeLocate must be on (PARAM_CENTROIDS_ENABLED,
+%	  see PVCAMSET) and DATA is a structure of column vectors with one row
+%	  per spot found:
+%
+%					frame = frame number (as META.frame)
+%					roi = region number the camera gave the spot
+%					x = serial sensor coordinate of the centroid
+%					y = parallel sensor coordinate of the centroid
+%					intensity = region sum above background (DN)
+%					background = lowest pixel in the region (DN)
+%					bor = beginning of region readout (ns), NaN if not reported
+%					eor = end of region readout (ns), NaN if not reported
+%
+%	  x and y are intensity-weighted means above background, on the same
+%	  0-based sensor coordinates as ROI, with binned pixels counted at the
+%	  centre of the sensor pixels they cover.  Regions the camera flagged
+%	  invalid and flat regions are left out, so the number of rows varies
+%	  with the scene.  Centroids cannot be combined with the pixel
+%	  processing options.
+%
+%     [DATA, META, STATS] = PVCAMACQ(...) also returns the structure STATS
+%	  with fields frames (frames delivered), dropped (frames missing from the
+%	  sequence), late (late frames), overruns (frames overwritten in the
+%	  circular buffer before they were read, also counted in dropped),
+%	  backlog (most frames waiting in the buffer), interval (average EOF
+%	  interval in ns) and overwritten (frames overwritten while being
+%	  processed).  Increase OPTS.buffer if overruns or overwritten is
+%	  nonzero.
+%	  STATS.clock is the camera clock model after this acquisition, as
+%	  returned by PVCAMCLOCK, so other camera timestamps convert as
+%	  offset + rate * bof.  STATS.pack is the bits per pixel of packed DATA,
+%	  0 if DATA is not packed.  STATS.pipeline is a structure array with
+%	  fields stage, name, frames, skipped, busy and mean (frames run and
+%	  skipped under overload, total and mean time the stage ran in ns), one
+%	  element per stage, and STATS.overload a structure with fields policy,
+%	  overloaded (frames arriving overloaded), blocked (frames that waited),
+%	  blockedtime (ns), droppedoldest, droppednewest and skipped (frames run
+%	  without their optional stages); both are [] without a pipeline.
+%
+%	  With OPTS.latency set, STATS.latency is a structure array with fields
+%	  measure, count, mean, std, min, p50, p99 and max (ns), one element per
+%	  measure:
+%
+%					start_bof = start of acquisition to first BOF callback
+%					bof_eof = BOF callback to EOF callback
+%					eof_data = EOF callback to frame taken from buffer
+%					camera_host = EOF callback minus metadata EOF
+%
+%	  Metadata timestamps restart with every acquisition, so camera_host
+%	  holds a constant offset; its spread (std, p99 - p50) is the jitter
+%	  the host adds on top of the camera.  With the camera in 'trigger' mode
+%	  start_bof includes the wait for the first trigger.  STATS.latency is []
+%	  unless OPTS.latency is set.
 
-% 2/19/03 SCM
+% 10/18/26
 % mex DLL code
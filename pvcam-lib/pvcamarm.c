@@ -0,0 +1,353 @@
+/* PVCAMARM - set up an image sequence once and trigger it repeatedly
+
+      FLAG = PVCAMARM(HCAM, NI, ROI, EXPTIME, EXPMODE) sets up a sequence of
+	  NI images on the camera specified by HCAM, with the same arguments as
+	  PVCAMACQ, and keeps it armed together with a frame buffer that every
+	  trigger reuses.  Arming again with identical arguments does nothing;
+	  different arguments replace the armed sequence.  FLAG is 1 if
+	  successful, 0 if an error occurred.
+
+      DATA = PVCAMARM(HCAM) starts the armed sequence, waits for it to
+	  complete and returns DATA exactly as PVCAMACQ(HCAM, NI, ROI, EXPTIME,
+	  EXPMODE) would.  Nothing is set up or allocated on the camera side, so
+	  each call costs the exposure, the readout and one copy into DATA.  If
+	  unsuccessful, DATA = [].
+
+      FLAG = PVCAMARM(HCAM, 'start') starts the armed sequence and returns
+	  at once, so with EXPMODE 'trigger' the camera waits for its trigger
+	  while MATLAB carries on.  DATA = PVCAMARM(HCAM, 'read') then waits for
+	  the started sequence and returns its DATA.
+
+      PVCAMARM(HCAM, 'disarm') aborts a started sequence and frees the
+	  buffer.  Armed sequences are also dropped when the camera is closed.
+
+	  PVCAMACQ, PVCAMMULTI, PVCAMSET and PVCAMPPSELECT all change the setup
+	  of the camera.  The armed sequence notices and sets itself up again
+	  on its next start, so mixing them is safe but costs one setup. */
+
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamtime.h"
+#include "pvcambuffer.h"
+#include <stdlib.h>
+
+
+// armed sequence of one camera
+typedef struct armed_seq {
+	rs_bool		used;			// slot holds an armed sequence
+	rs_bool		started;		// sequence started and not yet read
+	int16		hcam;			// camera handle
+	int16		expmode;		// exposure mode
+	uns16		nimage;			// images in sequence
+	uns16		nregion;		// number of regions
+	rgn_type	*region;		// region list
+	uns32		exptime;		// exposure time
+	uns32		generation;		// camera setup generation when set up
+	uns32		image_size;		// sequence size in bytes
+	uns16		*buffer;		// recycled sequence buffer
+} armed_seq;
+
+
+// function prototypes
+
+// find armed sequence of camera, NULL if none
+armed_seq *pvcam_arm_find(int16 hcam);
+
+// arm sequence on camera, replacing any other
+rs_bool pvcam_arm(int16 hcam, uns16 nimage, uns16 nregion, const rgn_type *region, uns32 exptime, int16 expmode);
+
+// start armed sequence, setting it up again if the camera setup changed
+rs_bool pvcam_arm_start(armed_seq *seq);
+
+// wait for started sequence and copy it into MATLAB array
+mxArray *pvcam_arm_read(armed_seq *seq);
+
+// abort and free armed sequence
+void pvcam_arm_release(armed_seq *seq);
+
+// free every armed sequence when the MEX file is cleared
+void pvcam_arm_exit(void);
+
+
+// global variables
+static armed_seq	armed[MAX_CAMERA];		// armed sequences, one per camera
+static rs_bool		exit_registered = 0;	// pvcam_arm_exit registered
+
+
+// command routine, also reached as pvcam('arm', ...)
+void pvcam_cmd_arm(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	armed_seq	*seq;		// armed sequence of camera
+	char		*command;	// command string
+	int16		hcam;		// camera handle
+	int16		expmode;	// exposure mode
+	rgn_type	*region;	// ROI structure
+	uns16		nimage;		// number of images
+	uns16		nregion;	// number of regions
+	uns32		exptime;	// exposure time
+
+	// validate arguments
+	if (((nrhs != 1) && (nrhs != 2) && (nrhs != 5)) || (nlhs > 1)) {
+		mexErrMsgTxt("type 'help pvcamarm' for syntax");
+	}
+	if (!exit_registered) {
+		pvcam_at_exit(pvcam_arm_exit);
+		pvcam_at_exit(pvcam_buffer_trim);
+		exit_registered = 1;
+	}
+
+	// obtain camera handle
+	// sequence cannot survive its camera being closed
+	hcam = pvcam_camera_handle(prhs[0]);
+	seq = pvcam_arm_find(hcam);
+	if (!pl_cam_check(hcam)) {
+		if (seq != NULL) {
+			pvcam_arm_release(seq);
+		}
+		pvcam_error(hcam, "HCAM is not a handle to an open camera");
+		plhs[0] = (nrhs == 1) ? mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL) : mxCreateDoubleScalar(0.0);
+		return;
+	}
+
+	// arm new sequence
+	if (nrhs == 5) {
+		if (!mxIsNumeric(prhs[1]) || (mxGetNumberOfElements(prhs[1]) != 1)) {
+			mexErrMsgTxt("NI must be a numeric scalar");
+		}
+		nimage = (uns16) mxGetScalar(prhs[1]);
+		region = pvcam_region_array(prhs[2], &nregion);
+		if (!mxIsNumeric(prhs[3]) || (mxGetNumberOfElements(prhs[3]) != 1)) {
+			mexErrMsgTxt("EXPTIME must be a numeric scalar");
+		}
+		exptime = (uns32) mxGetScalar(prhs[3]);
+		expmode = pvcam_exposure_mode(prhs[4]);
+		plhs[0] = mxCreateDoubleScalar((double) pvcam_arm(hcam, nimage, nregion, region, exptime, expmode));
+		mxFree((void *) region);
+		return;
+	}
+
+	// obtain command, plain trigger is start then read
+	if (nrhs == 2) {
+		if (!mxIsChar(prhs[1])) {
+			mexErrMsgTxt("COMMAND must be a string");
+		}
+		command = mxArrayToString(prhs[1]);
+	}
+	else {
+		command = NULL;
+	}
+	if ((command != NULL) && (strcmp(command, "disarm") == 0)) {
+		if (seq != NULL) {
+			pvcam_arm_release(seq);
+		}
+		plhs[0] = mxCreateDoubleScalar(1.0);
+	}
+	else if (seq == NULL) {
+		mexErrMsgTxt("No sequence armed on HCAM, see 'help pvcamarm'");
+	}
+	else if ((command == NULL) || (strcmp(command, "read") == 0)) {
+		if ((command == NULL) && !pvcam_arm_start(seq)) {
+			plhs[0] = mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL);
+		}
+		else if (!seq->started) {
+			mexErrMsgTxt("Armed sequence has not been started");
+		}
+		else {
+			plhs[0] = pvcam_arm_read(seq);
+		}
+	}
+	else if (strcmp(command, "start") == 0) {
+		plhs[0] = mxCreateDoubleScalar((double) pvcam_arm_start(seq));
+	}
+	else {
+		mexErrMsgTxt("COMMAND must be 'start', 'read' or 'disarm'");
+	}
+	if (command != NULL) {
+		mxFree((void *) command);
+	}
+}
+
+
+// find armed sequence of camera, NULL if none
+armed_seq *pvcam_arm_find(int16 hcam) {
+
+	// declarations
+	int		i;				// loop counter
+
+	for (i = 0; i < MAX_CAMERA; i++) {
+		if (armed[i].used && (armed[i].hcam == hcam)) {
+			return(&armed[i]);
+		}
+	}
+	return(NULL);
+}
+
+
+// arm sequence on camera, replacing any other
+rs_bool pvcam_arm(int16 hcam, uns16 nimage, uns16 nregion, const rgn_type *region, uns32 exptime, int16 expmode) {
+
+	// declarations
+	armed_seq	*seq;		// armed sequence of camera
+	int			i;			// loop counter
+
+	// identical sequence still loaded on camera needs nothing
+	seq = pvcam_arm_find(hcam);
+	if ((seq != NULL) && !seq->started && (seq->nimage == nimage) && (seq->nregion == nregion) &&
+		(seq->exptime == exptime) && (seq->expmode == expmode) &&
+		(memcmp(seq->region, region, nregion * sizeof(rgn_type)) == 0) &&
+		(seq->generation != 0) && (seq->generation == pvcam_core_generation(hcam))) {
+		return(1);
+	}
+	if (seq != NULL) {
+		pvcam_arm_release(seq);
+	}
+	for (i = 0; (i < MAX_CAMERA) && armed[i].used; i++) {
+	}
+	if (i == MAX_CAMERA) {
+		pvcam_error(hcam, "Too many armed sequences");
+		return(0);
+	}
+	seq = &armed[i];
+
+	// keep configuration so the sequence can be set up again after other commands
+	memset(seq, 0, sizeof(armed_seq));
+	seq->hcam = hcam;
+	seq->nimage = nimage;
+	seq->nregion = nregion;
+	seq->exptime = exptime;
+	seq->expmode = expmode;
+	seq->region = (rgn_type *) malloc(nregion * sizeof(rgn_type));
+	if (seq->region == NULL) {
+		pvcam_error(hcam, "Cannot allocate armed sequence");
+		return(0);
+	}
+	memcpy(seq->region, region, nregion * sizeof(rgn_type));
+	seq->used = 1;
+
+	// set up sequence now so the first trigger is as fast as the rest
+	if (!pl_exp_setup_seq(hcam, nimage, nregion, seq->region, expmode, exptime, &seq->image_size)) {
+		pvcam_error(hcam, "Cannot setup exposure sequence");
+		pvcam_arm_release(seq);
+		return(0);
+	}
+	seq->generation = pvcam_core_touch(hcam);
+	seq->buffer = (uns16 *) pvcam_buffer_alloc((size_t) seq->image_size);
+	if (seq->buffer == NULL) {
+		pvcam_error(hcam, "Cannot allocate armed sequence buffer");
+		pvcam_arm_release(seq);
+		return(0);
+	}
+	return(1);
+}
+
+
+// start armed sequence, setting it up again if the camera setup changed
+// handles outside the core registry have generation 0 and are always set up
+rs_bool pvcam_arm_start(armed_seq *seq) {
+
+	// declarations
+	uns32	image_size;		// sequence size in bytes
+
+	if (seq->started) {
+		pvcam_error(seq->hcam, "Armed sequence already started");
+		return(0);
+	}
+	if ((seq->generation == 0) || (seq->generation != pvcam_core_generation(seq->hcam))) {
+		if (!pl_exp_setup_seq(seq->hcam, seq->nimage, seq->nregion, seq->region, seq->expmode, seq->exptime,
+			&image_size)) {
+			pvcam_error(seq->hcam, "Cannot setup exposure sequence");
+			return(0);
+		}
+		if (image_size != seq->image_size) {
+			pvcam_error(seq->hcam, "Sequence size changed, arm the sequence again");
+			return(0);
+		}
+		seq->generation = pvcam_core_touch(seq->hcam);
+	}
+	if (!pl_exp_start_seq(seq->hcam, seq->buffer)) {
+		pvcam_error(seq->hcam, "Cannot start exposure sequence");
+		return(0);
+	}
+	seq->started = 1;
+	return(1);
+}
+
+
+// wait for started sequence and copy it into MATLAB array
+mxArray *pvcam_arm_read(armed_seq *seq) {
+
+	// declarations
+	int16	status;			// camera read status
+	mxArray	*data_struct;	// output data
+	uns32	bytes_read;		// bytes read by camera
+	ulong64	stage_ns;		// start of current instrumented stage
+
+	// loop until exposure sequence is complete
+	stage_ns = pvcam_stats_mark();
+	status = -1;
+	while ((status != READOUT_COMPLETE) && (status != READOUT_NOT_ACTIVE) && (status != READOUT_FAILED)) {
+		if (!pl_exp_check_status(seq->hcam, &status, &bytes_read)) {
+			pvcam_error(seq->hcam, "Cannot check camera status during exposure");
+			status = READOUT_FAILED;
+			break;
+		}
+	}
+	stage_ns = pvcam_stats_lap(STAGE_WAIT, stage_ns);
+	seq->started = 0;
+	pl_exp_finish_seq(seq->hcam, seq->buffer, 0);
+
+	// determine how exposure sequence terminated
+	switch (status) {
+	case READOUT_COMPLETE:
+		data_struct = mxCreateNumericMatrix(1, seq->image_size / sizeof(uns16), mxUINT16_CLASS, mxREAL);
+		memcpy(mxGetData(data_struct), seq->buffer, (size_t) seq->image_size);
+		pvcam_stats_lap(STAGE_HANDOFF, stage_ns);
+		return(data_struct);
+	case READOUT_NOT_ACTIVE:
+		pvcam_error(seq->hcam, "Camera readout never started");
+		break;
+	default:
+		pvcam_error(seq->hcam, "Camera readout failed");
+		break;
+	}
+	return(mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL));
+}
+
+
+// abort and free armed sequence
+void pvcam_arm_release(armed_seq *seq) {
+	if (seq->started && pl_cam_check(seq->hcam)) {
+		pl_exp_abort(seq->hcam, CCS_HALT);
+	}
+	free((void *) seq->region);
+	pvcam_buffer_free((void *) seq->buffer);
+	memset(seq, 0, sizeof(armed_seq));
+}
+
+
+// free every armed sequence when the MEX file is cleared
+void pvcam_arm_exit(void) {
+
+	// declarations
+	int		i;				// loop counter
+
+	for (i = 0; i < MAX_CAMERA; i++) {
+		if (armed[i].used) {
+			pvcam_arm_release(&armed[i]);
+		}
+	}
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_arm(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -0,0 +1,29 @@
+% PVCAMARM - set up an image sequence once and trigger it repeatedly
+%
+%     FLAG = PVCAMARM(HCAM, NI, ROI, EXPTIME, EXPMODE) sets up a sequence of
+%	  NI images on the camera specified by HCAM, with the same arguments as
+%	  PVCAMACQ, and keeps it armed together with a frame buffer that every
+%	  trigger reuses.  Arming again with identical arguments does nothing;
+%	  different arguments replace the armed sequence.  FLAG is 1 if
+%	  successful, 0 if an error occurred.
+%
+%     DATA = PVCAMARM(HCAM) starts the armed sequence, waits for it to
+%	  complete and returns DATA exactly as PVCAMACQ(HCAM, NI, ROI, EXPTIME,
+%	  EXPMODE) would.  Nothing is set up or allocated on the camera side, so
+%	  each call costs the exposure, the readout and one copy into DATA.  If
+%	  unsuccessful, DATA = [].
+%
+%     FLAG = PVCAMARM(HCAM, 'start') starts the armed sequence and returns
+%	  at once, so with EXPMODE 'trigger' the camera waits for its trigger
+%	  while MATLAB carries on.  DATA = PVCAMARM(HCAM, 'read') then waits for
+%	  the started sequence and returns its DATA.
+%
+%     PVCAMARM(HCAM, 'disarm') aborts a started sequence and frees the
+%	  buffer.  Armed sequences are also dropped when the camera is closed.
+%
+%	  PVCAMACQ, PVCAMMULTI, PVCAMSET and PVCAMPPSELECT all change the setup
+%	  of the camera.  The armed sequence notices and sets itself up again
+%	  on its next start, so mixing them is safe but costs one setup.
+
+% 10/18/26
+% mex DLL code
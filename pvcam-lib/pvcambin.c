@@ -0,0 +1,154 @@
+/* PVCAMBIN - rebin recorded image sequence
+
+      BINNED = PVCAMBIN(DATA, ROI, SBIN, PBIN) sums every SBIN x PBIN block
+	  of pixels of the image sequence DATA acquired over the CCD region(s)
+	  specified by the structure array ROI, as if the camera had binned
+	  by a further SBIN serially and PBIN in parallel.  DATA must be the
+	  unsigned 16-bit pixel data returned by PVCAMACQ with OPTS (pixel data
+	  only, no metadata headers) and may contain any number of frames.
+	  Each region is rebinned on its own; rows and columns that do not
+	  fill a whole block at the far edge of a region are dropped.  BINNED
+	  is an unsigned 16-bit vector laid out like DATA, with sums above
+	  65535 clipped as a saturated camera would report them.
+
+      BINNED = PVCAMBIN(DATA, ROI, SBIN, PBIN, OPTS) takes an optional
+	  structure with fields:
+
+					mode = 'sum' (default) or 'mean' (rounded to the nearest integer)
+					class = 'uint16' (default, clipped) or 'uint32' (never clips)
+
+      [BINNED, ROIB] = PVCAMBIN(...) also returns the ROI structure array
+	  describing BINNED, with the binning factors multiplied and s2 and p2
+	  trimmed to the dropped edges, for PVCAMDEFECT, PVCAMACQ hot pixel
+	  lists and reshaping.  Rows are spread over the worker threads and
+	  summed eight pixels at a time for the unbinned and 2x serial cases. */
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamproc.h"
+#include "pvcamthread.h"
+
+
+// definitions
+#define MAX_BIN_WINDOW	65536	// largest SBIN x PBIN whose sums fit in 32 bits
+
+
+// command routine, also reached as pvcam('bin', ...)
+void pvcam_cmd_bin(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	char		*modestr;	// mode or class string
+	const mxArray	*opts;	// options structure
+	double		pbin_value;	// parallel binning factor as given
+	double		sbin_value;	// serial binning factor as given
+	int			bin_mode;	// BIN_SUM or BIN_MEAN
+	rgn_type	*binned;	// rebinned regions
+	rgn_type	*region;	// ROI structure
+	rs_bool		wide;		// uns32 output
+	uns16		i;			// region counter
+	uns16		nregion;	// number of regions
+	uns32		nframe;		// number of frames
+	uns32		npixel;		// pixels per input frame
+
+	// validate arguments
+	if ((nrhs < 4) || (nrhs > 5) || (nlhs > 2)) {
+		mexErrMsgTxt("type 'help pvcambin' for syntax");
+	}
+	pvcam_at_exit(pvcam_thread_stop);
+
+	// obtain image sequence
+	if (!mxIsUint16(prhs[0])) {
+		mexErrMsgTxt("DATA must be uint16");
+	}
+
+	// obtain ROI structure from MATLAB structure array
+	region = pvcam_region_array(prhs[1], &nregion);
+	npixel = pvcam_region_pixels(nregion, region);
+	if ((mxGetNumberOfElements(prhs[0]) < npixel) || (mxGetNumberOfElements(prhs[0]) % npixel != 0)) {
+		mexErrMsgTxt("DATA must hold a whole number of frames over ROI");
+	}
+	nframe = (uns32) (mxGetNumberOfElements(prhs[0]) / npixel);
+
+	// obtain binning factors
+	if (!mxIsNumeric(prhs[2]) || (mxGetNumberOfElements(prhs[2]) != 1) ||
+		!mxIsNumeric(prhs[3]) || (mxGetNumberOfElements(prhs[3]) != 1)) {
+		mexErrMsgTxt("SBIN and PBIN must be numeric scalars");
+	}
+	sbin_value = mxGetScalar(prhs[2]);
+	pbin_value = mxGetScalar(prhs[3]);
+	if ((sbin_value < 1.0) || (pbin_value < 1.0) || (sbin_value != (double) (uns32) sbin_value) ||
+		(pbin_value != (double) (uns32) pbin_value) || (sbin_value * pbin_value > (double) MAX_BIN_WINDOW)) {
+		mexErrMsgTxt("SBIN and PBIN must be positive integers with SBIN * PBIN <= 65536");
+	}
+
+	// obtain options
+	opts = NULL;
+	if (nrhs > 4) {
+		if (!mxIsStruct(prhs[4]) && !mxIsEmpty(prhs[4])) {
+			mexErrMsgTxt("OPTS must be a structure");
+		}
+		else if (mxIsStruct(prhs[4])) {
+			opts = prhs[4];
+		}
+	}
+	modestr = pvcam_option_string(opts, "mode", "sum");
+	if (strcmp(modestr, "sum") == 0) {
+		bin_mode = BIN_SUM;
+	}
+	else if (strcmp(modestr, "mean") == 0) {
+		bin_mode = BIN_MEAN;
+	}
+	else {
+		mexErrMsgTxt("OPTS.mode must be 'sum' or 'mean'");
+	}
+	mxFree((void *) modestr);
+	modestr = pvcam_option_string(opts, "class", "uint16");
+	if (strcmp(modestr, "uint16") == 0) {
+		wide = 0;
+	}
+	else if (strcmp(modestr, "uint32") == 0) {
+		wide = 1;
+	}
+	else {
+		mexErrMsgTxt("OPTS.class must be 'uint16' or 'uint32'");
+	}
+	mxFree((void *) modestr);
+
+	// every region must hold at least one block
+	binned = (rgn_type *) mxCalloc((size_t) nregion, sizeof(rgn_type));
+	for (i = 0; i < nregion; i++) {
+		if (((region[i].s2 - region[i].s1 + 1) / region[i].sbin < sbin_value) ||
+			((region[i].p2 - region[i].p1 + 1) / region[i].pbin < pbin_value) ||
+			(region[i].sbin * sbin_value > 65535.0) || (region[i].pbin * pbin_value > 65535.0)) {
+			mexErrMsgTxt("SBIN and PBIN must fit within every region of ROI");
+		}
+	}
+	pvcam_bin_regions(nregion, region, (uns16) sbin_value, (uns16) pbin_value, binned);
+
+	// rebin frames
+	plhs[0] = mxCreateNumericMatrix(1, (size_t) pvcam_region_pixels(nregion, binned) * nframe,
+		wide ? mxUINT32_CLASS : mxUINT16_CLASS, mxREAL);
+	if (!pvcam_bin_frames((const uns16 *) mxGetData(prhs[0]), nframe, nregion, region,
+		(uns16) sbin_value, (uns16) pbin_value, bin_mode, wide, mxGetData(plhs[0]))) {
+		mexErrMsgTxt("Cannot allocate rebinning storage");
+	}
+	if (nlhs > 1) {
+		plhs[1] = pvcam_region_struct(nregion, binned);
+	}
+
+	// free allocated arrays
+	mxFree((void *) binned);
+	mxFree((void *) region);
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_bin(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -0,0 +1,27 @@
+% PVCAMBIN - rebin recorded image sequence
+%
+%     BINNED = PVCAMBIN(DATA, ROI, SBIN, PBIN) sums every SBIN x PBIN block
+%	  of pixels of the image sequence DATA acquired over the CCD region(s)
+%	  specified by the structure array ROI, as if the camera had binned
+%	  by a further SBIN serially and PBIN in parallel.  DATA must be the
+%	  unsigned 16-bit pixel data returned by PVCAMACQ with OPTS (pixel data
+%	  only, no metadata headers) and may contain any number of frames.
+%	  Each region is rebinned on its own; rows and columns that do not
+%	  fill a whole block at the far edge of a region are dropped.  BINNED
+%	  is an unsigned 16-bit vector laid out like DATA, with sums above
+%	  65535 clipped as a saturated camera would report them.
+%
+%     BINNED = PVCAMBIN(DATA, ROI, SBIN, PBIN, OPTS) takes an optional
+%	  structure with fields:
+%
+%					mode = 'sum' (default) or 'mean' (rounded to the nearest integer)
+%					class = 'uint16' (default, clipped) or 'uint32' (never clips)
+%
+%     [BINNED, ROIB] = PVCAMBIN(...) also returns the ROI structure array
+%	  describing BINNED, with the binning factors multiplied and s2 and p2
+%	  trimmed to the dropped edges, for PVCAMDEFECT, PVCAMACQ hot pixel
+%	  lists and reshaping.  Rows are spread over the worker threads and
+%	  summed eight pixels at a time for the unbinned and 2x serial cases.
+
+% 10/18/26
+% mex DLL code
@@ -0,0 +1,454 @@
+/* Frame buffers for PVCAM MEX files */
+
+/* 10/18/26 */
+
+/* Frame buffers (the circular buffer of the acquisition engine, the rings
+   of pvcamring, armed sequence buffers) come straight from the system in
+   whole pages, placed as the core placement says (see pvcamthreads.c):
+   bound to a NUMA node, on huge pages and locked in memory.  Huge pages
+   cut TLB misses when a frame is walked by the kernels; locking keeps the
+   pages resident, so readout never waits on a page fault.  A buffer that
+   is not locked is touched page by page when it is mapped, which at least
+   moves the first faults out of the acquisition.  Whatever the system
+   refuses (huge pages not reserved, no privilege to lock) is quietly left
+   out; pvcam_buffer_probe tells the caller up front.
+
+   Mapping, faulting in and locking a large buffer costs far more than an
+   acquisition start, so freed buffers go to a pool and the next buffer of
+   the same size and placement is taken from it.  Repeated acquisitions
+   with one ROI thus map their buffer once.  The pool keeps the most
+   recently freed buffers up to the pool size of the placement and gives
+   the oldest back to the system.  Buffers are handed out from the MATLAB
+   thread and from acquisition threads, so the pool is guarded by a spin
+   lock; nothing in here calls the MEX API. */
+
+// inclusions
+#if !defined(_WIN32) && !defined(_WIN64)
+#define _GNU_SOURCE
+#endif
+#include "pvcambuffer.h"
+#include "pvcamcore.h"
+#include "pvcamthread.h"
+#include <stdlib.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+// definitions
+#define HUGE_DEFAULT	((size_t) 2 << 20)	// huge page size if the system does not say
+#define MPOL_PREFERRED	1		// Linux memory policy: prefer node, fall back to others
+
+
+// frame buffer known to the pool
+typedef struct buffer_slab {
+	void		*base;			// first byte, NULL if entry is free
+	size_t		nask;			// size asked for, whole pages
+	size_t		nbyte;			// size mapped, whole huge pages if on them
+	int			node;			// NUMA node asked for, -1 for the system default
+	rs_bool		huge;			// huge pages asked for
+	rs_bool		lock;			// locking asked for
+	rs_bool		got_huge;		// on huge pages
+	rs_bool		locked;			// locked in memory
+	rs_bool		in_use;			// handed out, otherwise pooled
+	uns32		stamp;			// pool clock when freed, oldest goes first
+} buffer_slab;
+
+
+// function prototypes
+
+// take pool lock
+static void pool_enter(void);
+
+// give up pool lock
+static void pool_leave(void);
+
+// free table entry, giving the oldest pooled buffer back if there is none, NULL if all are in use
+static buffer_slab *pool_entry(void);
+
+// give pooled buffers back, oldest first, until no more than nkeep bytes are pooled
+static void pool_shrink(size_t nkeep);
+
+// map buffer for slab as it asks, 0 if out of memory
+static rs_bool slab_map(buffer_slab *slab);
+
+// give slab buffer back to the system
+static void slab_unmap(buffer_slab *slab);
+
+// fault in every page of slab buffer
+static void slab_touch(buffer_slab *slab);
+
+// system page size
+static size_t page_size(void);
+
+
+// global variables
+static buffer_slab		pool_slab[BUFFER_SLAB];	// buffers in use or pooled
+static size_t			pool_bytes = 0;		// bytes pooled
+static uns32			pool_clock = 0;		// stamps freed buffers
+static volatile long	pool_lock = 0;		// 1 while a thread works on the pool
+
+
+// page-aligned frame buffer placed as the core placement says, from the pool if one fits, NULL if none
+void *pvcam_buffer_alloc(size_t nbyte) {
+
+	// declarations
+	const pvcam_placement	*placement;	// where buffers go
+	buffer_slab	*slab;			// buffer entry
+	size_t		nask;			// size in whole pages
+	size_t		npage;			// page size
+	uns32		i;				// entry counter
+	void		*buffer;		// buffer handed out
+
+	placement = pvcam_core_placement();
+	npage = page_size();
+	nask = (nbyte + npage - 1) / npage * npage;
+	buffer = NULL;
+	pool_enter();
+
+	// pooled buffer of same size and placement is already faulted in
+	for (i = 0; i < BUFFER_SLAB; i++) {
+		slab = &pool_slab[i];
+		if ((slab->base != NULL) && !slab->in_use && (slab->nask == nask) && (slab->node == placement->node) &&
+			(slab->huge == placement->huge) && (slab->lock == placement->lock)) {
+			slab->in_use = 1;
+			pool_bytes -= slab->nbyte;
+			buffer = slab->base;
+			break;
+		}
+	}
+
+	// otherwise map a new one, making room from the pool if the system is short
+	if ((buffer == NULL) && ((slab = pool_entry()) != NULL)) {
+		slab->nask = nask;
+		slab->node = placement->node;
+		slab->huge = placement->huge;
+		slab->lock = placement->lock;
+		if (!slab_map(slab) && (pool_bytes > 0)) {
+			pool_shrink(0);
+			slab_map(slab);
+		}
+		if (slab->base != NULL) {
+			if (!slab->locked) {
+				slab_touch(slab);
+			}
+			slab->in_use = 1;
+			buffer = slab->base;
+		}
+	}
+	pool_leave();
+	return(buffer);
+}
+
+
+// return frame buffer from pvcam_buffer_alloc to the pool
+void pvcam_buffer_free(void *buffer) {
+
+	// declarations
+	uns32	i;				// entry counter
+
+	if (buffer == NULL) {
+		return;
+	}
+	pool_enter();
+	for (i = 0; i < BUFFER_SLAB; i++) {
+		if (pool_slab[i].base == buffer) {
+			pool_slab[i].in_use = 0;
+			pool_slab[i].stamp = ++pool_clock;
+			pool_bytes += pool_slab[i].nbyte;
+			break;
+		}
+	}
+	pool_shrink((size_t) pvcam_core_placement()->pool << 20);
+	pool_leave();
+}
+
+
+// release every pooled frame buffer to the system
+void pvcam_buffer_trim(void) {
+	pool_enter();
+	pool_shrink(0);
+	pool_leave();
+}
+
+
+// check that frame buffers get the huge pages and locking the core placement asks for
+rs_bool pvcam_buffer_probe(void) {
+
+	// declarations
+	const pvcam_placement	*placement;	// where buffers go
+	buffer_slab	slab;			// probe buffer, kept out of the pool
+	rs_bool		granted;		// system gave what was asked
+
+	placement = pvcam_core_placement();
+	if (!placement->huge && !placement->lock) {
+		return(1);
+	}
+	slab.nask = page_size();
+	slab.node = placement->node;
+	slab.huge = placement->huge;
+	slab.lock = placement->lock;
+	if (!slab_map(&slab)) {
+		return(0);
+	}
+	granted = (!slab.huge || slab.got_huge) && (!slab.lock || slab.locked);
+	slab_unmap(&slab);
+	return(granted);
+}
+
+
+// take pool lock
+static void pool_enter(void) {
+	while (pvcam_atomic_swap(&pool_lock, 0, 1) != 0) {
+		pvcam_thread_sleep(0);
+	}
+}
+
+
+// give up pool lock
+static void pool_leave(void) {
+	pvcam_atomic_swap(&pool_lock, 1, 0);
+}
+
+
+// free table entry, giving the oldest pooled buffer back if there is none, NULL if all are in use
+static buffer_slab *pool_entry(void) {
+
+	// declarations
+	buffer_slab	*oldest;		// oldest pooled buffer
+	uns32		i;				// entry counter
+
+	oldest = NULL;
+	for (i = 0; i < BUFFER_SLAB; i++) {
+		if (pool_slab[i].base == NULL) {
+			return(&pool_slab[i]);
+		}
+		if (!pool_slab[i].in_use && ((oldest == NULL) || (pool_clock - pool_slab[i].stamp > pool_clock - oldest->stamp))) {
+			oldest = &pool_slab[i];
+		}
+	}
+	if (oldest != NULL) {
+		pool_bytes -= oldest->nbyte;
+		slab_unmap(oldest);
+	}
+	return(oldest);
+}
+
+
+// give pooled buffers back, oldest first, until no more than nkeep bytes are pooled
+static void pool_shrink(size_t nkeep) {
+
+	// declarations
+	buffer_slab	*oldest;		// oldest pooled buffer
+	uns32		i;				// entry counter
+
+	while (pool_bytes > nkeep) {
+		oldest = NULL;
+		for (i = 0; i < BUFFER_SLAB; i++) {
+			if ((pool_slab[i].base != NULL) && !pool_slab[i].in_use &&
+				((oldest == NULL) || (pool_clock - pool_slab[i].stamp > pool_clock - oldest->stamp))) {
+				oldest = &pool_slab[i];
+			}
+		}
+		if (oldest == NULL) {
+			pool_bytes = 0;
+			break;
+		}
+		pool_bytes -= oldest->nbyte;
+		slab_unmap(oldest);
+	}
+}
+
+
+// fault in every page of slab buffer
+static void slab_touch(buffer_slab *slab) {
+
+	// declarations
+	size_t	npage;			// page size
+	size_t	offset;			// byte offset of page
+
+	npage = page_size();
+	for (offset = 0; offset < slab->nbyte; offset += npage) {
+		((volatile uns8 *) slab->base)[offset] = 0;
+	}
+}
+
+
+#if defined(_WIN32) || defined(_WIN64)
+
+static size_t page_size(void) {
+	SYSTEM_INFO		sys_info;
+
+	GetSystemInfo(&sys_info);
+	return((size_t) sys_info.dwPageSize);
+}
+
+// large pages need SeLockMemoryPrivilege enabled on the process token, tried once
+static rs_bool large_page_privilege(void) {
+	static int		granted = -1;	// privilege enabled, -1 until tried
+	HANDLE			token;		// process token
+	TOKEN_PRIVILEGES	priv;	// privilege to enable
+
+	if (granted < 0) {
+		granted = 0;
+		if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+			priv.PrivilegeCount = 1;
+			priv.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+			granted = LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &priv.Privileges[0].Luid) &&
+				AdjustTokenPrivileges(token, FALSE, &priv, 0, NULL, NULL) && (GetLastError() == ERROR_SUCCESS);
+			CloseHandle(token);
+		}
+	}
+	return((rs_bool) granted);
+}
+
+static void *slab_alloc(size_t nbyte, int node, DWORD type) {
+	if (node >= 0) {
+		return(VirtualAllocExNuma(GetCurrentProcess(), NULL, nbyte, type, PAGE_READWRITE, (DWORD) node));
+	}
+	return(VirtualAlloc(NULL, nbyte, type, PAGE_READWRITE));
+}
+
+// large pages are never paged out, so they count as locked
+static rs_bool slab_map(buffer_slab *slab) {
+	size_t		nhuge = GetLargePageMinimum();
+	SIZE_T		ws_min;
+	SIZE_T		ws_max;
+
+	slab->base = NULL;
+	slab->got_huge = 0;
+	slab->locked = 0;
+	if (slab->huge && (nhuge > 0) && large_page_privilege()) {
+		slab->nbyte = (slab->nask + nhuge - 1) / nhuge * nhuge;
+		if ((slab->base = slab_alloc(slab->nbyte, slab->node, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES)) != NULL) {
+			slab->got_huge = 1;
+			slab->locked = 1;
+			return(1);
+		}
+	}
+	slab->nbyte = slab->nask;
+	if ((slab->base = slab_alloc(slab->nbyte, slab->node, MEM_RESERVE | MEM_COMMIT)) == NULL) {
+		return(0);
+	}
+
+	// the working set must grow to hold locked pages
+	if (slab->lock) {
+		slab->locked = (rs_bool) VirtualLock(slab->base, slab->nbyte);
+		if (!slab->locked && GetProcessWorkingSetSize(GetCurrentProcess(), &ws_min, &ws_max) &&
+			SetProcessWorkingSetSize(GetCurrentProcess(), ws_min + slab->nbyte, ws_max + slab->nbyte)) {
+			slab->locked = (rs_bool) VirtualLock(slab->base, slab->nbyte);
+		}
+	}
+	return(1);
+}
+
+static void slab_unmap(buffer_slab *slab) {
+	if (slab->locked && !slab->got_huge) {
+		VirtualUnlock(slab->base, slab->nbyte);
+	}
+	VirtualFree(slab->base, 0, MEM_RELEASE);
+	slab->base = NULL;
+}
+
+uns32 pvcam_node_count(void) {
+	ULONG	highest;		// highest NUMA node number
+
+	return(GetNumaHighestNodeNumber(&highest) ? (uns32) highest + 1 : 1);
+}
+
+#else
+
+static size_t page_size(void) {
+	return((size_t) sysconf(_SC_PAGESIZE));
+}
+
+// default huge page size from /proc/meminfo, read once
+static size_t huge_page_size(void) {
+	static size_t	nhuge = 0;	// huge page size
+	char			line[128];	// meminfo line
+	unsigned long	nkb;		// size in kB
+	FILE			*meminfo;
+
+	if (nhuge == 0) {
+		nhuge = HUGE_DEFAULT;
+		if ((meminfo = fopen("/proc/meminfo", "r")) != NULL) {
+			while (fgets(line, sizeof(line), meminfo) != NULL) {
+				if (sscanf(line, "Hugepagesize: %lu kB", &nkb) == 1) {
+					nhuge = (size_t) nkb << 10;
+					break;
+				}
+			}
+			fclose(meminfo);
+		}
+	}
+	return(nhuge);
+}
+
+// without reserved huge pages, ask for transparent ones instead, which the kernel grants when it can
+static rs_bool slab_map(buffer_slab *slab) {
+	size_t			nhuge = huge_page_size();
+	unsigned long	node_mask;	// nodes the buffer may use
+	void			*base;
+
+	slab->base = NULL;
+	slab->got_huge = 0;
+	slab->locked = 0;
+	base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if (slab->huge) {
+		slab->nbyte = (slab->nask + nhuge - 1) / nhuge * nhuge;
+		base = mmap(NULL, slab->nbyte, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		slab->got_huge = (base != MAP_FAILED);
+	}
+#endif
+	if (base == MAP_FAILED) {
+		slab->nbyte = slab->nask;
+		if ((base = mmap(NULL, slab->nbyte, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+			return(0);
+		}
+#ifdef MADV_HUGEPAGE
+		if (slab->huge) {
+			madvise(base, slab->nbyte, MADV_HUGEPAGE);
+		}
+#endif
+	}
+	slab->base = base;
+
+	// bind before the first touch, which is what places a page
+	if (slab->node >= 0) {
+		node_mask = 1UL << slab->node;
+		syscall(SYS_mbind, base, slab->nbyte, MPOL_PREFERRED, &node_mask, 8 * sizeof(node_mask), 0);
+	}
+	if (slab->lock) {
+		slab->locked = (mlock(base, slab->nbyte) == 0);
+	}
+	return(1);
+}
+
+static void slab_unmap(buffer_slab *slab) {
+	if (slab->locked) {
+		munlock(slab->base, slab->nbyte);
+	}
+	munmap(slab->base, slab->nbyte);
+	slab->base = NULL;
+}
+
+uns32 pvcam_node_count(void) {
+	char	path[64];		// sysfs directory of node
+	uns32	nnode;			// nodes found
+
+	for (nnode = 0; nnode < MAX_PLACE_CPU; nnode++) {
+		sprintf(path, "/sys/devices/system/node/node%u", nnode);
+		if (access(path, F_OK) != 0) {
+			break;
+		}
+	}
+	return((nnode > 0) ? nnode : 1);
+}
+
+#endif
@@ -0,0 +1,34 @@
+/* Frame buffers for PVCAM MEX files */
+
+/* 10/18/26 */
+
+#ifndef _PVCAMBUFFER_H
+#define _PVCAMBUFFER_H
+
+// inclusions
+#include "master.h"
+#include <stddef.h>
+
+
+// definitions
+#define BUFFER_SLAB		32		// frame buffers held at once, in use or pooled
+
+
+// function prototypes
+
+// page-aligned frame buffer placed as the core placement says, from the pool if one fits, NULL if none
+void *pvcam_buffer_alloc(size_t nbyte);
+
+// return frame buffer from pvcam_buffer_alloc to the pool
+void pvcam_buffer_free(void *buffer);
+
+// release every pooled frame buffer to the system
+void pvcam_buffer_trim(void);
+
+// check that frame buffers get the huge pages and locking the core placement asks for
+rs_bool pvcam_buffer_probe(void);
+
+// number of NUMA nodes, 1 on machines without
+uns32 pvcam_node_count(void);
+
+#endif /* _PVCAMBUFFER_H */
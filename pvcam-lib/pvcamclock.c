@@ -0,0 +1,113 @@
+/* PVCAMCLOCK - camera to host clock correlation
+
+      CLOCK = PVCAMCLOCK(HCAM) returns the clock model of the camera
+	  specified by HCAM, which maps camera timestamps (the bof and eof
+	  metadata of PVCAMACQ, in ns) onto the host clock.  CLOCK is a
+	  structure with fields:
+
+					rate = host ns per camera ns
+					drift = rate - 1 in parts per million
+					offset = host clock at camera time 0 of the last acquisition (ns)
+					utcoffset = UTC minus host clock (ns)
+					residual = rms scatter of the last acquisition about the model (ns)
+					acquisitions = acquisitions in the drift fit
+					samples = frames in the last acquisition
+
+	  Camera timestamps restart with every acquisition, so offset belongs
+	  to the last acquisition only, while rate is fitted over all of them
+	  with older acquisitions weighted down, and follows slow drift of the
+	  camera oscillator.  Each frame pairs its metadata EOF with the host
+	  EOF callback when OPTS.latency is set.  Otherwise frames are paired
+	  with the moment they were taken from the buffer, skipping frames read
+	  from a backlog and keeping the least delayed of every 16; offset
+	  includes that smallest delay.  CLOCK = [] until PVCAMACQ has streamed
+	  frames with metadata from the camera.
+
+      [HOST, UTC] = PVCAMCLOCK(HCAM, T) converts camera timestamps T (ns)
+	  from the last acquisition to the host monotonic clock (ns) and to UTC
+	  (seconds since 1970), as PVCAMACQ does for META.hosttime and META.utc.
+
+      PVCAMCLOCK(HCAM, 'reset') discards the model, for instance after the
+	  camera clock source was changed.  Closing the camera also discards
+	  it. */
+
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamtime.h"
+
+
+// command routine, also reached as pvcam('clock', ...)
+void pvcam_cmd_clock(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	char		*command;	// command string
+	double		*camera_ptr;	// camera timestamps
+	double		*host_ptr;	// host clock output
+	double		*utc_ptr;	// UTC output
+	int16		hcam;		// camera handle
+	mwSize		i;			// timestamp counter
+	mwSize		ntime;		// number of timestamps
+	pvcam_clock_fit	fit;	// clock model
+
+	// validate arguments
+	if ((nrhs < 1) || (nrhs > 2) || (nlhs > 2)) {
+		mexErrMsgTxt("type 'help pvcamclock' for syntax");
+	}
+	hcam = pvcam_camera_handle(prhs[0]);
+
+	// no command returns clock model
+	if (nrhs == 1) {
+		if (nlhs > 1) {
+			mexErrMsgTxt("type 'help pvcamclock' for syntax");
+		}
+		plhs[0] = pvcam_clock_model(hcam, &fit) && (fit.nsample > 0) ?
+			pvcam_clock_struct(&fit) : mxCreateDoubleMatrix(0, 0, mxREAL);
+		return;
+	}
+
+	// reset command
+	if (mxIsChar(prhs[1])) {
+		command = mxArrayToString(prhs[1]);
+		if (strcmp(command, "reset") != 0) {
+			mexErrMsgTxt("COMMAND must be 'reset'");
+		}
+		mxFree((void *) command);
+		pvcam_clock_reset(hcam);
+		return;
+	}
+
+	// convert camera timestamps
+	if (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1])) {
+		mexErrMsgTxt("T must be a real double array");
+	}
+	if (!pvcam_clock_model(hcam, &fit) || (fit.nsample == 0)) {
+		mexErrMsgTxt("No clock model for HCAM, acquire with PVCAMACQ(..., OPTS) first");
+	}
+	ntime = mxGetNumberOfElements(prhs[1]);
+	camera_ptr = mxGetPr(prhs[1]);
+	plhs[0] = mxCreateNumericArray(mxGetNumberOfDimensions(prhs[1]), mxGetDimensions(prhs[1]), mxDOUBLE_CLASS, mxREAL);
+	host_ptr = mxGetPr(plhs[0]);
+	for (i = 0; i < ntime; i++) {
+		host_ptr[i] = fit.offset + fit.rate * camera_ptr[i];
+	}
+	if (nlhs > 1) {
+		plhs[1] = mxCreateNumericArray(mxGetNumberOfDimensions(prhs[1]), mxGetDimensions(prhs[1]), mxDOUBLE_CLASS, mxREAL);
+		utc_ptr = mxGetPr(plhs[1]);
+		for (i = 0; i < ntime; i++) {
+			utc_ptr[i] = (host_ptr[i] + fit.utc_offset) * 1e-9;
+		}
+	}
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_clock(nlhs, plhs, nrhs, prhs);
+}
+#endif
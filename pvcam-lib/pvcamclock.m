@@ -0,0 +1,35 @@
+% PVCAMCLOCK - camera to host clock correlation
+%
+%     CLOCK = PVCAMCLOCK(HCAM) returns the clock model of the camera
+%	  specified by HCAM, which maps camera timestamps (the bof and eof
+%	  metadata of PVCAMACQ, in ns) onto the host clock.  CLOCK is a
+%	  structure with fields:
+%
+%					rate = host ns per camera ns
+%					drift = rate - 1 in parts per million
+%					offset = host clock at camera time 0 of the last acquisition (ns)
+%					utcoffset = UTC minus host clock (ns)
+%					residual = rms scatter of the last acquisition about the model (ns)
+%					acquisitions = acquisitions in the drift fit
+%					samples = frames in the last acquisition
+%
+%	  Camera timestamps restart with every acquisition, so offset belongs
+%	  to the last acquisition only, while rate is fitted over all of them
+%	  with older acquisitions weighted down, and follows slow drift of the
+%	  camera oscillator.  Each frame pairs its metadata EOF with the host
+%	  EOF callback when OPTS.latency is set.  Otherwise frames are paired
+%	  with the moment they were taken from the buffer, skipping frames read
+%	  from a backlog and keeping the least delayed of every 16; offset
+%	  includes that smallest delay.  CLOCK = [] until PVCAMACQ has streamed
+%	  frames with metadata from the camera.
+%
+%     [HOST, UTC] = PVCAMCLOCK(HCAM, T) converts camera timestamps T (ns)
+%	  from the last acquisition to the host monotonic clock (ns) and to UTC
+%	  (seconds since 1970), as PVCAMACQ does for META.hosttime and META.utc.
+%
+%     PVCAMCLOCK(HCAM, 'reset') discards the model, for instance after the
+%	  camera clock source was changed.  Closing the camera also discards
+%	  it.
+
+% 10/18/26
+% mex DLL code
@@ -1,7 +1,13 @@
 /* PVCAMCLOSE - closes open PVCAM device
 
       STATUS = PVCAMCLOSE(HCAM) closes the PVCAM device specified by the
-	  handle to the open camera HCAM.  STATUS is 1 if there are no errors.  */
+	  handle to the open camera HCAM.  STATUS is 1 if there are no errors.
+	  A camera opened more than once (see PVCAMOPEN) stays open until every
+	  open has been matched by a close.  PVCAM itself stays initialized so
+	  the next PVCAMOPEN is fast.
+
+      STATUS = PVCAMCLOSE('all') closes every open camera and shuts PVCAM
+	  down. */
 
 
 /* 2/19/03 SCM */
@@ -9,12 +15,14 @@
 
 // inclusions
 #include "pvcamutil.h"
+#include "pvcamcmd.h"
 
 
-// gateway routine
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+// command routine, also reached as pvcam('close', ...)
+void pvcam_cmd_close(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
 	// declarations
+	char		*command;	// command string
 	int16		hcam;		// camera handle
 
 	// validate arguments
@@ -22,18 +30,30 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
         mexErrMsgTxt("type 'help pvcamclose' for syntax");
     }
 
-	// obtain camera handle
-	if (!mxIsNumeric(prhs[0])) {
-		mexErrMsgTxt("HCAM must be numeric");
-	}
-	else if (mxGetNumberOfElements(prhs[0]) != 1) {
-		mexErrMsgTxt("HCAM must be a scalar");
-	}
-	else {
-		hcam = (int16) mxGetScalar(prhs[0]);
+	// shut everything down on request
+	if (mxIsChar(prhs[0])) {
+		command = mxArrayToString(prhs[0]);
+		if (strcmp(command, "all") != 0) {
+			mexErrMsgTxt("COMMAND must be 'all'");
+		}
+		mxFree((void *) command);
+		pvcam_core_shutdown();
+		plhs[0] = mxCreateLogicalScalar(true);
+		return;
 	}
 
+	// obtain camera handle
+	hcam = pvcam_camera_handle(prhs[0]);
+
 	// close camera and return boolean
 	pvcam_close(hcam);
 	plhs[0] = mxCreateLogicalScalar(true);
 }
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_close(nlhs, plhs, nrhs, prhs);
+}
+#endif
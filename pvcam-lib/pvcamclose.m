@@ -2,6 +2,12 @@
 %
 %     STATUS = PVCAMCLOSE(HCAM) closes the PVCAM device specified by the
 %     handle to the open camera HCAM.  STATUS = 1 if there are no errors.
+%	  A camera opened more than once (see PVCAMOPEN) stays open until every
+%	  open has been matched by a close.  PVCAM itself stays initialized so
+%	  the next PVCAMOPEN is fast.
+%
+%     STATUS = PVCAMCLOSE('all') closes every open camera and shuts PVCAM
+%	  down.
 
 % 2/19/03 SCM
 % mex DLL code
@@ -0,0 +1,44 @@
+/* Commands shared by the pvcam gateway and the standalone MEX files */
+
+/* 10/18/26 */
+
+/* Each command is the body of one of the original MEX files.  Built on its
+   own, a file's mexFunction just calls its command; built into pvcam with
+   PVCAM_GATEWAY defined, the commands are reached through the opcode table
+   in pvcam.c and share one copy of the utilities. */
+
+#ifndef _PVCAMCMD_H
+#define _PVCAMCMD_H
+
+// inclusions
+#include "mex.h"
+
+
+// command routine, same arguments as mexFunction
+typedef void (*pvcam_command_fn)(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+
+
+// function prototypes
+void pvcam_cmd_open(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_close(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_list(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_get(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_set(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_shutter(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_acq(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_multi(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_defect(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_stats(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_ppshow(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_ppselect(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_arm(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_clock(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_smart(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_bin(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_orient(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_read(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_unpack(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_ring(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void pvcam_cmd_threads(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+
+#endif /* _PVCAMCMD_H */
@@ -0,0 +1,427 @@
+/* Shared PVCAM session for PVCAM MEX files */
+
+/* 10/18/26 */
+
+/* Built once as a shared library (pvcamcore.dll / libpvcamcore.so) that
+   every MEX file links against, so the globals in here exist once per MATLAB
+   process rather than once per MEX file.  PVCAM is initialized on first use
+   and left up when the last camera closes, so reopening a camera skips the
+   driver start-up; only pvcam_core_shutdown uninitializes it, and only
+   when it was initialized here rather than found running.  Open cameras
+   are kept in a handle registry with a reference count, so opening a camera
+   that is already open hands back the same handle.  The registry is only
+   touched from the MATLAB thread and is not locked.  Nothing in here calls
+   the MEX API; failures are left for pvcam_core_error.
+
+   Parameter attributes (availability, access, type, count) cost four driver
+   calls per lookup and are needed by every get and set, so they are kept in
+   a direct-mapped cache shared by all MEX files.  Setting a parameter can
+   change the count or availability of others (readout port and speed table,
+   post-processing indices), so commands that set parameters flush the
+   camera's entries, as does closing the camera.
+
+   Each camera also carries a setup generation, drawn from one counter so a
+   reopened camera never repeats a value.  Anything that sets up an
+   acquisition or sets a parameter moves it on, which lets a sequence that
+   was set up once (pvcamarm) tell whether it is still loaded.  Closing a
+   camera also drops its clock model (see pvcamtime.c), since the handle
+   may next belong to another camera.  The registry also remembers how
+   many SMART streaming exposures pvcamsmart loaded, since the driver only
+   hands the list back into a structure sized by the caller.
+
+   Thread and buffer placement (see pvcamthreads.c) lives here as well, so
+   the threads and buffers of every MEX file follow the one setting. */
+
+// inclusions
+#include "pvcamcore.h"
+#include "pvcamtime.h"
+#include <string.h>
+
+
+// cached attributes of one camera parameter
+typedef struct core_attr_entry {
+	rs_bool		valid;			// slot in use
+	int16		hcam;			// camera handle
+	pvcam_param_attr	attr;	// cached attributes
+} core_attr_entry;
+
+
+// session state
+static rs_bool		core_inited = 0;		// PVCAM initialized
+static rs_bool		core_owned = 0;			// PVCAM initialized by pvcam_core_init, not found running
+static uns32		core_nref = 0;			// session references held
+static uns32		core_ncamera = 0;		// cameras in registry
+static pvcam_camera_entry	core_camera[MAX_CAMERA];	// handle registry
+static const char	*core_err_msg = "";		// reason for last failure
+static core_attr_entry	core_attr[PARAM_CACHE];	// parameter attribute cache
+static uns32		core_generation = 0;	// last setup generation handed out
+static pvcam_placement	core_placement = {0, {0}, 0, {0}, PRIORITY_NORMAL, -1, 0, 0, POOL_DEFAULT};	// thread and buffer placement
+
+
+// function prototypes
+
+// open camera by number and add it to the registry
+static rs_bool core_open_camera(int16 ncamera, int16 *hcam);
+
+// read serial number of open camera, empty if not reported
+static void core_read_serial(int16 hcam, char *serial);
+
+// cache slot for parameter of camera
+static core_attr_entry *core_attr_slot(int16 hcam, uns32 param_id);
+
+
+// take a reference on the PVCAM session, initializing PVCAM on first use
+rs_bool pvcam_core_init(void) {
+
+	// declarations
+	int16	total_cameras;
+
+	// PVCAM may already be up if another program component started it
+	if (!core_inited) {
+		if (!pl_cam_get_total(&total_cameras)) {
+			if (!pl_pvcam_init()) {
+				core_err_msg = "Cannot init PVCAM";
+				return(0);
+			}
+			core_owned = 1;
+		}
+		core_inited = 1;
+	}
+	core_nref++;
+	return(1);
+}
+
+
+// drop a session reference; PVCAM stays initialized for the next open
+void pvcam_core_release(void) {
+	if (core_nref > 0) {
+		core_nref--;
+	}
+}
+
+
+// open camera by number, sharing the handle if it is already open
+rs_bool pvcam_core_open(int16 ncamera, int16 *hcam) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	for (i = 0; i < core_ncamera; i++) {
+		if (core_camera[i].ncamera == ncamera) {
+			core_camera[i].nref++;
+			*hcam = core_camera[i].hcam;
+			return(1);
+		}
+	}
+	return(core_open_camera(ncamera, hcam));
+}
+
+
+// open camera by serial number, sharing the handle if it is already open
+rs_bool pvcam_core_open_serial(const char *serial, int16 *hcam) {
+
+	// declarations
+	int16	i;				// loop counter
+	int16	total_cameras;
+	uns32	j;				// registry counter
+
+	for (j = 0; j < core_ncamera; j++) {
+		if ((serial[0] != '\0') && (strcmp(core_camera[j].serial, serial) == 0)) {
+			core_camera[j].nref++;
+			*hcam = core_camera[j].hcam;
+			return(1);
+		}
+	}
+
+	// open each camera not in the registry until serial number matches
+	if (!pvcam_core_init()) {
+		return(0);
+	}
+	if (!pl_cam_get_total(&total_cameras)) {
+		core_err_msg = "Cannot find number of cameras";
+		pvcam_core_release();
+		return(0);
+	}
+	for (i = 0; i < total_cameras; i++) {
+		if ((pvcam_core_lookup(i) != NULL) || !core_open_camera(i, hcam)) {
+			continue;
+		}
+		if (strcmp(core_camera[core_ncamera - 1].serial, serial) == 0) {
+			pvcam_core_release();
+			return(1);
+		}
+		pvcam_core_close(*hcam);
+	}
+	core_err_msg = "Specified camera serial number not found";
+	pvcam_core_release();
+	return(0);
+}
+
+
+// drop a camera reference, closing the camera after the last one
+void pvcam_core_close(int16 hcam) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	for (i = 0; i < core_ncamera; i++) {
+		if (core_camera[i].hcam != hcam) {
+			continue;
+		}
+		if (--core_camera[i].nref == 0) {
+			pvcam_core_param_flush(hcam);
+			pvcam_clock_reset(hcam);
+			pl_cam_close(hcam);
+			core_camera[i] = core_camera[--core_ncamera];
+			pvcam_core_release();
+		}
+		return;
+	}
+
+	// handle opened outside the registry
+	pvcam_core_param_flush(hcam);
+	pvcam_clock_reset(hcam);
+	if (pl_cam_check(hcam)) {
+		pl_cam_close(hcam);
+	}
+}
+
+
+// find registry entry of open camera by number, NULL if not open
+const pvcam_camera_entry *pvcam_core_lookup(int16 ncamera) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	for (i = 0; i < core_ncamera; i++) {
+		if (core_camera[i].ncamera == ncamera) {
+			return(&core_camera[i]);
+		}
+	}
+	return(NULL);
+}
+
+
+// obtain availability, access, type and count of parameter, cached per camera
+// access, type and count are not read for unavailable parameters
+rs_bool pvcam_core_param_attr(int16 hcam, uns32 param_id, pvcam_param_attr *attr) {
+
+	// declarations
+	core_attr_entry	*slot;		// cache slot for parameter
+
+	slot = core_attr_slot(hcam, param_id);
+	if (slot->valid && (slot->hcam == hcam) && (slot->attr.param_id == param_id)) {
+		*attr = slot->attr;
+		return(1);
+	}
+
+	// read attributes from driver, only complete records are cached
+	memset(attr, 0, sizeof(pvcam_param_attr));
+	attr->param_id = param_id;
+	if (!pl_get_param(hcam, param_id, ATTR_AVAIL, (void *) &attr->avail)) {
+		core_err_msg = "Cannot obtain parameter availability";
+		return(0);
+	}
+	if (attr->avail) {
+		if (!pl_get_param(hcam, param_id, ATTR_ACCESS, (void *) &attr->access)) {
+			core_err_msg = "Cannot obtain parameter accessibility";
+			return(0);
+		}
+		if (!pl_get_param(hcam, param_id, ATTR_TYPE, (void *) &attr->type)) {
+			core_err_msg = "Cannot obtain parameter type";
+			return(0);
+		}
+		if (!pl_get_param(hcam, param_id, ATTR_COUNT, (void *) &attr->count)) {
+			core_err_msg = "Cannot obtain parameter count";
+			return(0);
+		}
+	}
+	slot->valid = 1;
+	slot->hcam = hcam;
+	slot->attr = *attr;
+	return(1);
+}
+
+
+// forget cached parameter attributes of camera after a parameter is set
+void pvcam_core_param_flush(int16 hcam) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	for (i = 0; i < PARAM_CACHE; i++) {
+		if (core_attr[i].hcam == hcam) {
+			core_attr[i].valid = 0;
+		}
+	}
+	pvcam_core_touch(hcam);
+}
+
+
+// note that the acquisition setup of camera changed, returns new generation
+uns32 pvcam_core_touch(int16 hcam) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	for (i = 0; i < core_ncamera; i++) {
+		if (core_camera[i].hcam == hcam) {
+			core_camera[i].generation = ++core_generation;
+			return(core_camera[i].generation);
+		}
+	}
+	return(0);
+}
+
+
+// setup generation of open camera, 0 for handles outside the registry
+uns32 pvcam_core_generation(int16 hcam) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	for (i = 0; i < core_ncamera; i++) {
+		if (core_camera[i].hcam == hcam) {
+			return(core_camera[i].generation);
+		}
+	}
+	return(0);
+}
+
+
+// note number of SMART streaming exposures loaded on camera, 0 when switched off
+void pvcam_core_set_smart(int16 hcam, uns16 nsmart) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	for (i = 0; i < core_ncamera; i++) {
+		if (core_camera[i].hcam == hcam) {
+			core_camera[i].nsmart = nsmart;
+			return;
+		}
+	}
+}
+
+
+// SMART streaming exposures loaded on camera, 0 if none or not in registry
+uns16 pvcam_core_smart(int16 hcam) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	for (i = 0; i < core_ncamera; i++) {
+		if (core_camera[i].hcam == hcam) {
+			return(core_camera[i].nsmart);
+		}
+	}
+	return(0);
+}
+
+
+// thread and buffer placement shared by every MEX file
+const pvcam_placement *pvcam_core_placement(void) {
+	return(&core_placement);
+}
+
+
+// replace thread and buffer placement, used by threads and buffers created afterwards
+void pvcam_core_set_placement(const pvcam_placement *placement) {
+	core_placement = *placement;
+}
+
+
+// close every camera and uninitialize PVCAM if it was initialized here
+void pvcam_core_shutdown(void) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	for (i = 0; i < core_ncamera; i++) {
+		pvcam_clock_reset(core_camera[i].hcam);
+		pl_cam_close(core_camera[i].hcam);
+	}
+	memset(core_attr, 0, sizeof(core_attr));
+	core_ncamera = 0;
+	core_nref = 0;
+	if (core_owned) {
+		pl_pvcam_uninit();
+		core_owned = 0;
+	}
+	core_inited = 0;
+}
+
+
+// reason for the last failure
+const char *pvcam_core_error(void) {
+	return(core_err_msg);
+}
+
+
+// open camera by number and add it to the registry
+static rs_bool core_open_camera(int16 ncamera, int16 *hcam) {
+
+	// declarations
+	int16	total_cameras;
+	pvcam_camera_entry	*entry;	// new registry entry
+
+	// registry entry holds a session reference until the camera closes
+	if (core_ncamera >= MAX_CAMERA) {
+		core_err_msg = "Too many cameras open";
+		return(0);
+	}
+	if (!pvcam_core_init()) {
+		return(0);
+	}
+	entry = &core_camera[core_ncamera];
+	if (!pl_cam_get_total(&total_cameras)) {
+		core_err_msg = "Cannot find number of cameras";
+	}
+	else if ((ncamera < 0) || (total_cameras <= ncamera)) {
+		core_err_msg = "Specified camera number not found";
+	}
+	else if (!pl_cam_get_name(ncamera, entry->name)) {
+		core_err_msg = "Cannot obtain camera name";
+	}
+	else if (!pl_cam_open(entry->name, hcam, OPEN_EXCLUSIVE)) {
+		core_err_msg = "Cannot open specified camera";
+	}
+	else {
+		entry->hcam = *hcam;
+		entry->ncamera = ncamera;
+		entry->nref = 1;
+		entry->generation = ++core_generation;
+		entry->nsmart = 0;
+		core_read_serial(*hcam, entry->serial);
+		core_ncamera++;
+		return(1);
+	}
+	pvcam_core_release();
+	return(0);
+}
+
+
+// read serial number of open camera, empty if not reported
+static void core_read_serial(int16 hcam, char *serial) {
+
+	// declarations
+	rs_bool	attr_avail;		// flag for available parameter
+
+	serial[0] = '\0';
+	if (!pl_get_param(hcam, PARAM_HEAD_SER_NUM_ALPHA, ATTR_AVAIL, (void *) &attr_avail) || !attr_avail ||
+		!pl_get_param(hcam, PARAM_HEAD_SER_NUM_ALPHA, ATTR_CURRENT, (void *) serial)) {
+		serial[0] = '\0';
+	}
+}
+
+
+// cache slot for parameter of camera
+// parameter IDs pack class, type and index, so mix the bits before masking
+static core_attr_entry *core_attr_slot(int16 hcam, uns32 param_id) {
+
+	// declarations
+	uns32	hash;			// mixed key
+
+	hash = (param_id ^ ((uns32) (uns16) hcam << 16)) * 2654435761u;
+	return(&core_attr[(hash >> 16) % PARAM_CACHE]);
+}
@@ -0,0 +1,118 @@
+/* Shared PVCAM session for PVCAM MEX files */
+
+/* 10/18/26 */
+
+#ifndef _PVCAMCORE_H
+#define _PVCAMCORE_H
+
+// inclusions
+#include "master.h"
+#include "pvcam.h"
+
+
+// definitions
+#define MAX_CAMERA		16		// cameras held in handle registry
+#define PARAM_CACHE		256		// parameter attribute cache slots
+#define MAX_PLACE_CPU	64		// CPUs listed per thread role, numbered below this
+#define PRIORITY_NORMAL		0	// acquisition threads at normal priority
+#define PRIORITY_HIGH		1	// acquisition threads above normal priority
+#define PRIORITY_REALTIME	2	// acquisition threads at real-time priority
+#define POOL_DEFAULT	256		// MB of idle frame buffers kept for reuse by default
+
+// functions exported from the core library, imported by the MEX files
+#if defined(_WIN32) || defined(_WIN64)
+#ifdef PVCAM_CORE_EXPORTS
+#define PVCAM_CORE		__declspec(dllexport)
+#else
+#define PVCAM_CORE		__declspec(dllimport)
+#endif
+#else
+#define PVCAM_CORE		__attribute__((visibility("default")))
+#endif
+
+
+// open camera held in the handle registry
+typedef struct pvcam_camera_entry {
+	int16		hcam;			// camera handle
+	int16		ncamera;		// PVCAM camera number
+	uns32		nref;			// opens not yet matched by a close
+	uns32		generation;		// changes whenever the camera setup may have
+	uns16		nsmart;			// SMART streaming exposures loaded, 0 if none
+	char		name[CAM_NAME_LEN];				// PVCAM camera name
+	char		serial[MAX_ALPHA_SER_NUM_LEN];	// serial number, empty if not reported
+} pvcam_camera_entry;
+
+// parameter attributes that only change when camera settings change
+typedef struct pvcam_param_attr {
+	uns32		param_id;		// PVCAM parameter ID
+	rs_bool		avail;			// flag for available parameter
+	uns16		access;			// flag for read only, read/write
+	uns16		type;			// data type of parameter values
+	uns32		count;			// count for enumerated/char parameters
+} pvcam_param_attr;
+
+// where acquisition and worker threads run and frame buffers live
+typedef struct pvcam_placement {
+	uns32		nacquire;		// CPUs listed for acquisition threads, 0 to leave them unpinned
+	uns16		acquire_cpu[MAX_PLACE_CPU];	// CPUs taken in turn by acquisition threads
+	uns32		nworker;		// CPUs listed for worker threads, 0 for one unpinned worker per CPU
+	uns16		worker_cpu[MAX_PLACE_CPU];	// CPU of each worker thread
+	int			priority;		// PRIORITY_ of acquisition threads
+	int			node;			// NUMA node of frame buffers, -1 for the system default
+	rs_bool		huge;			// frame buffers on huge pages where the system grants them
+	rs_bool		lock;			// frame buffers locked in memory where the system grants it
+	uns32		pool;			// MB of idle frame buffers kept for reuse
+} pvcam_placement;
+
+
+// function prototypes
+
+// take a reference on the PVCAM session, initializing PVCAM on first use
+PVCAM_CORE rs_bool pvcam_core_init(void);
+
+// drop a session reference; PVCAM stays initialized for the next open
+PVCAM_CORE void pvcam_core_release(void);
+
+// open camera by number, sharing the handle if it is already open
+PVCAM_CORE rs_bool pvcam_core_open(int16 ncamera, int16 *hcam);
+
+// open camera by serial number, sharing the handle if it is already open
+PVCAM_CORE rs_bool pvcam_core_open_serial(const char *serial, int16 *hcam);
+
+// drop a camera reference, closing the camera after the last one
+PVCAM_CORE void pvcam_core_close(int16 hcam);
+
+// find registry entry of open camera by number, NULL if not open
+PVCAM_CORE const pvcam_camera_entry *pvcam_core_lookup(int16 ncamera);
+
+// obtain availability, access, type and count of parameter, cached per camera
+PVCAM_CORE rs_bool pvcam_core_param_attr(int16 hcam, uns32 param_id, pvcam_param_attr *attr);
+
+// forget cached parameter attributes of camera after a parameter is set
+PVCAM_CORE void pvcam_core_param_flush(int16 hcam);
+
+// note that the acquisition setup of camera changed, returns new generation
+PVCAM_CORE uns32 pvcam_core_touch(int16 hcam);
+
+// setup generation of open camera, 0 for handles outside the registry
+PVCAM_CORE uns32 pvcam_core_generation(int16 hcam);
+
+// note number of SMART streaming exposures loaded on camera, 0 when switched off
+PVCAM_CORE void pvcam_core_set_smart(int16 hcam, uns16 nsmart);
+
+// SMART streaming exposures loaded on camera, 0 if none or not in registry
+PVCAM_CORE uns16 pvcam_core_smart(int16 hcam);
+
+// thread and buffer placement shared by every MEX file
+PVCAM_CORE const pvcam_placement *pvcam_core_placement(void);
+
+// replace thread and buffer placement, used by threads and buffers created afterwards
+PVCAM_CORE void pvcam_core_set_placement(const pvcam_placement *placement);
+
+// close every camera and uninitialize PVCAM if it was initialized here
+PVCAM_CORE void pvcam_core_shutdown(void);
+
+// reason for the last failure
+PVCAM_CORE const char *pvcam_core_error(void);
+
+#endif /* _PVCAMCORE_H */
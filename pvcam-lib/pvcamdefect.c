@@ -0,0 +1,189 @@
+/* PVCAMDEFECT - locate defective pixels from dark frames
+
+      DEFECTS = PVCAMDEFECT(DARK, ROI, NSIGMA) returns the sensor coordinates
+	  of defective pixels found in the dark image sequence DARK acquired over
+	  the CCD region(s) specified by the structure array ROI.  DARK must be
+	  the unsigned 16-bit pixel data returned by PVCAMACQ with OPTS (pixel
+	  data only, no metadata headers) and may contain any number of frames.
+	  A pixel is defective if its mean over all frames differs from the
+	  median pixel mean by more than NSIGMA robust standard deviations
+	  (1.4826 x median absolute deviation, but no less than 1/frames, the
+	  step between pixel means).  DEFECTS is an N x 2 array of
+	  [serial parallel] coordinates suitable for OPTS.hotpixels in PVCAMACQ. */
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include <math.h>
+#include <stdlib.h>
+
+
+// definitions
+#define MAD_SCALE		1.4826	// median absolute deviation to standard deviation
+
+
+// function prototypes
+
+// find defective pixels from per-pixel mean
+mxArray *pvcam_defect_find(const uns16 *dark, uns32 nframe, uns16 nregion, const rgn_type *region, double nsigma);
+
+// median of array, reorders contents
+static double median_value(double *value, uns32 nvalue);
+
+// order doubles ascending
+static int double_compare(const void *a, const void *b);
+
+
+// command routine, also reached as pvcam('defect', ...)
+void pvcam_cmd_defect(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	double		nsigma;		// threshold in robust standard deviations
+	rgn_type	*region;	// ROI structure
+	uns16		nregion;	// number of regions
+	uns32		npixel;		// pixels per frame
+
+	// validate arguments
+	if ((nrhs != 3) || (nlhs > 1)) {
+        mexErrMsgTxt("type 'help pvcamdefect' for syntax");
+    }
+
+	// obtain dark frames
+	if (!mxIsUint16(prhs[0])) {
+		mexErrMsgTxt("DARK must be uint16");
+	}
+
+	// obtain ROI structure from MATLAB structure array
+	region = pvcam_region_array(prhs[1], &nregion);
+	npixel = pvcam_region_pixels(nregion, region);
+	if ((mxGetNumberOfElements(prhs[0]) < npixel) || (mxGetNumberOfElements(prhs[0]) % npixel != 0)) {
+		mexErrMsgTxt("DARK must hold a whole number of frames over ROI");
+	}
+
+	// obtain threshold
+	if (!mxIsNumeric(prhs[2])) {
+		mexErrMsgTxt("NSIGMA must be numeric");
+	}
+	else if (mxGetNumberOfElements(prhs[2]) != 1) {
+		mexErrMsgTxt("NSIGMA must be a scalar");
+	}
+	else {
+		nsigma = mxGetScalar(prhs[2]);
+	}
+
+	// locate defects
+	plhs[0] = pvcam_defect_find((const uns16 *) mxGetData(prhs[0]),
+		(uns32) (mxGetNumberOfElements(prhs[0]) / npixel), nregion, region, nsigma);
+
+	// free allocated arrays
+	mxFree((void *) region);
+}
+
+
+// find defective pixels from per-pixel mean
+mxArray *pvcam_defect_find(const uns16 *dark, uns32 nframe, uns16 nregion, const rgn_type *region, double nsigma) {
+
+	// declarations
+	double	*coord;			// output coordinates
+	double	*deviation;		// absolute deviation from median
+	double	*mean;			// per-pixel mean
+	double	limit;			// deviation threshold
+	double	median;			// median of pixel means
+	double	spread;			// robust standard deviation of pixel means
+	mxArray	*defect_list;	// output array
+	uns16	r;				// region counter
+	uns32	i;				// pixel counter
+	uns32	k;				// frame counter
+	uns32	ndefect;		// defects found
+	uns32	npixel;			// pixels per frame
+	uns32	offset;			// pixel offset within frame
+	uns32	width;			// binned serial size
+
+	// average each pixel over all frames
+	npixel = pvcam_region_pixels(nregion, region);
+	mean = (double *) mxCalloc((size_t) npixel, sizeof(double));
+	deviation = (double *) mxMalloc((size_t) npixel * sizeof(double));
+	for (k = 0; k < nframe; k++) {
+		for (i = 0; i < npixel; i++) {
+			mean[i] += dark[(size_t) k * npixel + i];
+		}
+	}
+	for (i = 0; i < npixel; i++) {
+		mean[i] /= (double) nframe;
+		deviation[i] = mean[i];
+	}
+
+	// robust spread from median absolute deviation
+	median = median_value(deviation, npixel);
+	for (i = 0; i < npixel; i++) {
+		deviation[i] = fabs(mean[i] - median);
+	}
+	spread = MAD_SCALE * median_value(deviation, npixel);
+
+	// pixel means are multiples of 1/nframe; when more than half of them
+	// are equal the deviation is 0 and any other pixel would be a defect
+	if (spread < 1.0 / (double) nframe) {
+		spread = 1.0 / (double) nframe;
+	}
+	limit = nsigma * spread;
+
+	// count defects, then fill in coordinates
+	ndefect = 0;
+	for (i = 0; i < npixel; i++) {
+		if (fabs(mean[i] - median) > limit) {
+			ndefect++;
+		}
+	}
+	defect_list = mxCreateDoubleMatrix((size_t) ndefect, 2, mxREAL);
+	coord = mxGetPr(defect_list);
+	ndefect = 0;
+	offset = 0;
+	for (r = 0; r < nregion; r++) {
+		width = (region[r].s2 - region[r].s1 + 1) / region[r].sbin;
+		for (i = 0; i < pvcam_region_pixels(1, &region[r]); i++) {
+			if (fabs(mean[offset + i] - median) > limit) {
+				coord[ndefect] = (double) (region[r].s1 + (i % width) * region[r].sbin);
+				coord[ndefect + mxGetM(defect_list)] = (double) (region[r].p1 + (i / width) * region[r].pbin);
+				ndefect++;
+			}
+		}
+		offset += pvcam_region_pixels(1, &region[r]);
+	}
+
+	// free allocated arrays
+	mxFree((void *) deviation);
+	mxFree((void *) mean);
+	return(defect_list);
+}
+
+
+// median of array, reorders contents
+static double median_value(double *value, uns32 nvalue) {
+	qsort((void *) value, (size_t) nvalue, sizeof(double), double_compare);
+	if (nvalue % 2 == 0) {
+		return(0.5 * (value[nvalue / 2 - 1] + value[nvalue / 2]));
+	}
+	return(value[nvalue / 2]);
+}
+
+
+// order doubles ascending
+static int double_compare(const void *a, const void *b) {
+
+	// declarations
+	double	value_a = *((const double *) a);
+	double	value_b = *((const double *) b);
+
+	return((value_a > value_b) - (value_a < value_b));
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_defect(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -0,0 +1,20 @@
+% PVCAMDEFECT - locate defective pixels from dark frames
+%
+%     DEFECTS = PVCAMDEFECT(DARK, ROI, NSIGMA) returns the sensor coordinates
+%	  of defective pixels found in the dark image sequence DARK acquired over
+%	  the CCD region(s) specified by the structure array ROI.  DARK must be
+%	  the unsigned 16-bit pixel data returned by PVCAMACQ with OPTS (pixel
+%	  data only, no metadata headers) and may contain any number of frames.
+%	  A pixel is defective if its mean over all frames differs from the
+%	  median pixel mean by more than NSIGMA robust standard deviations
+%	  (1.4826 x median absolute deviation, but no less than 1/frames, the
+%	  step between pixel means).  DEFECTS is an N x 2 array of
+%	  [serial parallel] coordinates suitable for OPTS.hotpixels in PVCAMACQ.
+%
+%	  Example:
+%		dark = pvcamacq(h_cam, 20, roi_struct, 100, 'timed', struct());
+%		opts.hotpixels = pvcamdefect(dark, roi_struct, 6);
+%		data = pvcamacq(h_cam, 100, roi_struct, 100, 'timed', opts);
+
+% 10/18/26
+% mex DLL code
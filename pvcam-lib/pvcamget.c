@@ -10,6 +10,7 @@
 
 // inclusions
 #include "pvcamutil.h"
+#include "pvcamcmd.h"
 
 
 // definitions
@@ -22,24 +23,17 @@
 // function prototypes
 
 // obtain string parameter
-mxArray *pvcam_param_string(int16 hcam, uns32 param_id);
+mxArray *pvcam_param_string(int16 hcam, const pvcam_param_attr *attr);
 
 // obtain numeric parameter
-mxArray *pvcam_param_numeric(int16 hcam, uns32 param_id);
+mxArray *pvcam_param_numeric(int16 hcam, const pvcam_param_attr *attr);
 
 // obtain enumerated parameter
-mxArray *pvcam_param_enum(int16 hcam, uns32 param_id);
+mxArray *pvcam_param_enum(int16 hcam, const pvcam_param_attr *attr);
 
 
-// global variables
-rs_bool	attr_avail;		// flag for available parameter
-uns16	attr_access;	// flag for read only, read/write
-uns16	attr_type;		// data type of parameter values
-uns32	attr_count;		// count for enumerated/char parameters
-
-
-// gateway routine
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+// command routine, also reached as pvcam('get', ...)
+void pvcam_cmd_get(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
 	// declarations
 	rs_bool	success = 0;	// flag for successful execution
@@ -47,6 +41,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 	int		param_len;		// parameter name length
 	int16	hcam;			// camera handle
 	uns32	param_id;		// parameter ID
+	pvcam_param_attr	attr;	// cached parameter attributes
 
 	// validate arguments
 	if ((nrhs != 2) || (nlhs > 1)) {
@@ -54,15 +49,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     }
 
 	// obtain camera handle
-	if (!mxIsNumeric(prhs[0])) {
-		mexErrMsgTxt("HCAM must be numeric");
-	}
-	else if (mxGetNumberOfElements(prhs[0]) != 1) {
-		mexErrMsgTxt("HCAM must be a scalar");
-	}
-	else {
-		hcam = (int16) mxGetScalar(prhs[0]);
-	}
+	hcam = pvcam_camera_handle(prhs[0]);
 
 	// obtain parameter name
 	if (!mxIsChar(prhs[1])) {
@@ -87,42 +74,27 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 	else if (!pvcam_param_id(hcam, param_name, &param_id)) {
 	}
 
-	// obtain parameter availability
-	else if (!pl_get_param(hcam, param_id, ATTR_AVAIL, (void *) &attr_avail)) {
-		pvcam_error(hcam, "Cannot obtain parameter availability");
+	// obtain parameter availability, accessibility, type and count
+	else if (!pvcam_core_param_attr(hcam, param_id, &attr)) {
+		pvcam_error(hcam, pvcam_core_error());
 	}
 
 	// do not proceed if parameter is not available
-	else if (!attr_avail) {
+	else if (!attr.avail) {
 		pvcam_error(hcam, "Parameter not available on this camera");
 	}
 
-	// obtain parameter accessibility 
-	else if (!pl_get_param(hcam, param_id, ATTR_ACCESS, (void *) &attr_access)) {
-		pvcam_error(hcam, "Cannot obtain parameter accessibility");
-	}
-
 	// do not proceed if parameter is not read only or read/write
-	//else if ((attr_access != ACC_READ_ONLY) && (attr_access != ACC_READ_WRITE)) {
-	//else if ((attr_access == ACC_ERROR) || (attr_access == ACC_EXIST_CHECK_ONLY)) {
+	//else if ((attr.access != ACC_READ_ONLY) && (attr.access != ACC_READ_WRITE)) {
+	//else if ((attr.access == ACC_ERROR) || (attr.access == ACC_EXIST_CHECK_ONLY)) {
 	//	pvcam_error(hcam, "Parameter cannot be read");
 	//}
 
-	// obtain parameter type 
-	else if (!pl_get_param(hcam, param_id, ATTR_TYPE, (void *) &attr_type)) {
-		pvcam_error(hcam, "Cannot obtain parameter type");
-	}
-
-	// obtain parameter count
-	else if (!pl_get_param(hcam, param_id, ATTR_COUNT, (void *) &attr_count)) {
-		pvcam_error(hcam, "Cannot obtain parameter count");
-	}
-
 	// obtain output structure STRUCT based on parameter type
 	else {
-		switch (attr_type) {
+		switch (attr.type) {
 		case TYPE_CHAR_PTR:
-			if ((plhs[0] = pvcam_param_string(hcam, param_id)) != NULL) {
+			if ((plhs[0] = pvcam_param_string(hcam, &attr)) != NULL) {
 				success = 1;
 			}
 			break;
@@ -134,12 +106,12 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 		case TYPE_UNS32:
 		case TYPE_FLT64:
 		case TYPE_BOOLEAN:
-			if ((plhs[0] = pvcam_param_numeric(hcam, param_id)) != NULL) {
+			if ((plhs[0] = pvcam_param_numeric(hcam, &attr)) != NULL) {
 				success = 1;
 			}
 			break;
 		case TYPE_ENUM:
-			if ((plhs[0] = pvcam_param_enum(hcam, param_id)) != NULL) {
+			if ((plhs[0] = pvcam_param_enum(hcam, &attr)) != NULL) {
 				success = 1;
 			}
 			break;
@@ -166,7 +138,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
 
 // obtain string parameter
-mxArray *pvcam_param_string(int16 hcam, uns32 param_id) {
+mxArray *pvcam_param_string(int16 hcam, const pvcam_param_attr *attr) {
 
 	// declarations
 	char	*param_string;	// parameter string
@@ -176,14 +148,14 @@ mxArray *pvcam_param_string(int16 hcam, uns32 param_id) {
 	char	**field_list;	// field names for output structure
 
 	// obtain strings and check for errors
-	param_string = (char *) mxCalloc((size_t) attr_count, sizeof(char));
-	if ((access_string = pvcam_access_string(hcam, attr_access)) == NULL) {
+	param_string = (char *) mxCalloc((size_t) attr->count, sizeof(char));
+	if ((access_string = pvcam_access_string(hcam, attr->access)) == NULL) {
 		param_struct = NULL;
 	}
-	else if ((type_string = pvcam_type_string(hcam, attr_type)) == NULL) {
+	else if ((type_string = pvcam_type_string(hcam, attr->type)) == NULL) {
 		param_struct = NULL;
 	}
-	else if (!pl_get_param(hcam, param_id, ATTR_CURRENT, (void *) param_string)) {
+	else if (!pl_get_param(hcam, attr->param_id, ATTR_CURRENT, (void *) param_string)) {
 		pvcam_error(hcam, "Error obtaining parameter string");
 		param_struct = NULL;
 	}
@@ -200,9 +172,9 @@ mxArray *pvcam_param_string(int16 hcam, uns32 param_id) {
 
 		// store field values
 		param_struct = mxCreateStructMatrix(1, 1, STRING_FIELD, field_list);
-		mxSetField(param_struct, 0, field_list[0], mxCreateDoubleScalar((double) attr_access));
+		mxSetField(param_struct, 0, field_list[0], mxCreateDoubleScalar((double) attr->access));
 		mxSetField(param_struct, 0, field_list[1], mxCreateString(access_string));
-		mxSetField(param_struct, 0, field_list[2], mxCreateDoubleScalar((double) attr_type));
+		mxSetField(param_struct, 0, field_list[2], mxCreateDoubleScalar((double) attr->type));
 		mxSetField(param_struct, 0, field_list[3], mxCreateString(type_string));
 		mxSetField(param_struct, 0, field_list[4], mxCreateString(param_string));
 		pvcam_destroy_array(field_list,	STRING_FIELD);
@@ -215,7 +187,7 @@ mxArray *pvcam_param_string(int16 hcam, uns32 param_id) {
 
 
 // obtain numeric parameter
-mxArray *pvcam_param_numeric(int16 hcam, uns32 param_id) {
+mxArray *pvcam_param_numeric(int16 hcam, const pvcam_param_attr *attr) {
 
 	// declarations
 	char	*access_string;	// access string
@@ -229,27 +201,27 @@ mxArray *pvcam_param_numeric(int16 hcam, uns32 param_id) {
 	char	**field_list;	// field names for output structure
 
 	// obtain strings and check for errors
-	if ((access_string = pvcam_access_string(hcam, attr_access)) == NULL) {
+	if ((access_string = pvcam_access_string(hcam, attr->access)) == NULL) {
 		param_struct = NULL;
 	}
-	else if ((type_string = pvcam_type_string(hcam, attr_type)) == NULL) {
+	else if ((type_string = pvcam_type_string(hcam, attr->type)) == NULL) {
 		param_struct = NULL;
 	}
 
 	// obtain values and check for errors
-	else if (!pvcam_param_value(hcam, param_id, ATTR_CURRENT, attr_type, &param_value)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_CURRENT, attr->type, &param_value)) {
 		param_struct = NULL;
 	}
-	else if (!pvcam_param_value(hcam, param_id, ATTR_DEFAULT, attr_type, &param_default)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_DEFAULT, attr->type, &param_default)) {
 		param_struct = NULL;
 	}
-	else if (!pvcam_param_value(hcam, param_id, ATTR_MIN, attr_type, &param_min)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_MIN, attr->type, &param_min)) {
 		param_struct = NULL;
 	}
-	else if (!pvcam_param_value(hcam, param_id, ATTR_MAX, attr_type, &param_max)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_MAX, attr->type, &param_max)) {
 		param_struct = NULL;
 	}
-	else if (!pvcam_param_value(hcam, param_id, ATTR_INCREMENT, attr_type, &param_inc)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_INCREMENT, attr->type, &param_inc)) {
 		param_struct = NULL;
 	}
 
@@ -269,9 +241,9 @@ mxArray *pvcam_param_numeric(int16 hcam, uns32 param_id) {
 
 		// store field values
 		param_struct = mxCreateStructMatrix(1, 1, NUMERIC_FIELD, field_list);
-		mxSetField(param_struct, 0, field_list[0], mxCreateDoubleScalar((double) attr_access));
+		mxSetField(param_struct, 0, field_list[0], mxCreateDoubleScalar((double) attr->access));
 		mxSetField(param_struct, 0, field_list[1], mxCreateString(access_string));
-		mxSetField(param_struct, 0, field_list[2], mxCreateDoubleScalar((double) attr_type));
+		mxSetField(param_struct, 0, field_list[2], mxCreateDoubleScalar((double) attr->type));
 		mxSetField(param_struct, 0, field_list[3], mxCreateString(type_string));
 		mxSetField(param_struct, 0, field_list[4], mxCreateDoubleScalar(param_value));
 		mxSetField(param_struct, 0, field_list[5], mxCreateDoubleScalar(param_default));
@@ -287,7 +259,7 @@ mxArray *pvcam_param_numeric(int16 hcam, uns32 param_id) {
 
 
 // obtain enumerated parameter
-mxArray *pvcam_param_enum(int16 hcam, uns32 param_id) {
+mxArray *pvcam_param_enum(int16 hcam, const pvcam_param_attr *attr) {
 
 	// declarations
 	char	*access_string;	// access string
@@ -308,32 +280,32 @@ mxArray *pvcam_param_enum(int16 hcam, uns32 param_id) {
 	char	**field_list;	// field names for output structure
 
 	// obtain strings and check for errors
-	if ((access_string = pvcam_access_string(hcam, attr_access)) == NULL) {
+	if ((access_string = pvcam_access_string(hcam, attr->access)) == NULL) {
 		param_struct = NULL;
 	}
-	else if ((type_string = pvcam_type_string(hcam, attr_type)) == NULL) {
+	else if ((type_string = pvcam_type_string(hcam, attr->type)) == NULL) {
 		param_struct = NULL;
 	}
 
 	// obtain values and check for errors
-	else if (!pvcam_param_value(hcam, param_id, ATTR_CURRENT, attr_type, &param_value)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_CURRENT, attr->type, &param_value)) {
 		param_struct = NULL;
 	}
-	else if (!pvcam_param_value(hcam, param_id, ATTR_DEFAULT, attr_type, &param_default)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_DEFAULT, attr->type, &param_default)) {
 		param_struct = NULL;
 	}
 
 	else {
 
 		// create storage for enumerated strings & values
-		enum_list = mxCreateCellMatrix(1, (int) attr_count);
-		enum_array = mxCreateDoubleMatrix(1, (int) attr_count, mxREAL);
+		enum_list = mxCreateCellMatrix(1, (int) attr->count);
+		enum_array = mxCreateDoubleMatrix(1, (int) attr->count, mxREAL);
 		enum_index = mxGetPr(enum_array);
 
 		// loop through indices to collect enumerated values & strings
 		// allocate storage for strings by obtaining string length first
-		for (i = 0; i < attr_count; i++) {
-			if (pl_enum_str_length(hcam, param_id, i, &enum_length)) {
+		for (i = 0; i < attr->count; i++) {
+			if (pl_enum_str_length(hcam, attr->param_id, i, &enum_length)) {
 				enum_string = (char *) mxCalloc((size_t) enum_length, sizeof(char));
 			}
 			else {
@@ -341,7 +313,7 @@ mxArray *pvcam_param_enum(int16 hcam, uns32 param_id) {
 				success = 0;
 				break;
 			}
-			if (pl_get_enum_param(hcam, param_id, i, &enum_value, enum_string, enum_length)) {
+			if (pl_get_enum_param(hcam, attr->param_id, i, &enum_value, enum_string, enum_length)) {
 				enum_index[i] = (double) enum_value;
 				mxSetCell(enum_list, i, mxCreateString(enum_string));
 			}
@@ -368,9 +340,9 @@ mxArray *pvcam_param_enum(int16 hcam, uns32 param_id) {
 
 			// store field values for scalar/string values
 			param_struct = mxCreateStructMatrix(1, 1, ENUM_FIELD, field_list);
-			mxSetField(param_struct, 0, field_list[0], mxCreateDoubleScalar((double) attr_access));
+			mxSetField(param_struct, 0, field_list[0], mxCreateDoubleScalar((double) attr->access));
 			mxSetField(param_struct, 0, field_list[1], mxCreateString(access_string));
-			mxSetField(param_struct, 0, field_list[2], mxCreateDoubleScalar((double) attr_type));
+			mxSetField(param_struct, 0, field_list[2], mxCreateDoubleScalar((double) attr->type));
 			mxSetField(param_struct, 0, field_list[3], mxCreateString(type_string));
 			mxSetField(param_struct, 0, field_list[4], mxCreateDoubleScalar(param_value));
 			mxSetField(param_struct, 0, field_list[5], mxCreateDoubleScalar(param_default));
@@ -383,3 +355,11 @@ mxArray *pvcam_param_enum(int16 hcam, uns32 param_id) {
 	// return parameter structure
 	return(param_struct);
 }
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_get(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -0,0 +1,85 @@
+/* PVCAMLIST - list PVCAM devices
+
+      CAMS = PVCAMLIST returns a 1 x N structure array describing every
+	  camera found by PVCAM, with fields:
+
+					index = camera number for PVCAMOPEN
+					name = PVCAM camera name
+					serial = camera serial number string
+					available = 1 if the camera could be opened
+
+	  Cameras that are not open yet are briefly opened to read their serial
+	  number.  Cameras in use by another program report an empty serial and
+	  available = 0. */
+
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+
+
+// definitions
+#define LIST_FIELD		4		// number of fields in camera list structure
+
+
+// command routine, also reached as pvcam('list', ...)
+void pvcam_cmd_list(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	const char	*field_list[LIST_FIELD] = {"index", "name", "serial", "available"};
+	char		cam_name[CAM_NAME_LEN];			// camera name
+	char		cam_serial[MAX_ALPHA_SER_NUM_LEN];	// camera serial number
+	int16		hcam;			// camera handle
+	int16		i;				// loop counter
+	int16		total_cameras;	// number of cameras
+	rs_bool		available;		// flag for camera opened
+	const pvcam_camera_entry	*entry;	// registry entry of open camera
+
+	// takes no input arguments
+	(void) prhs;
+
+	// validate arguments
+	if ((nrhs != 0) || (nlhs > 1)) {
+		mexErrMsgTxt("type 'help pvcamlist' for syntax");
+	}
+
+	// obtain number of cameras
+	if (!pvcam_init() || !pl_cam_get_total(&total_cameras)) {
+		pvcam_error(0, "Cannot find number of cameras");
+		plhs[0] = mxCreateStructMatrix(1, 0, LIST_FIELD, field_list);
+		return;
+	}
+
+	// describe each camera
+	plhs[0] = mxCreateStructMatrix(1, (mwSize) total_cameras, LIST_FIELD, field_list);
+	for (i = 0; i < total_cameras; i++) {
+		cam_name[0] = '\0';
+		cam_serial[0] = '\0';
+		available = 0;
+		if ((entry = pvcam_core_lookup(i)) != NULL) {
+			available = 1;
+			strcpy(cam_name, entry->name);
+			strcpy(cam_serial, entry->serial);
+		}
+		else if (pl_cam_get_name(i, cam_name) && pl_cam_open(cam_name, &hcam, OPEN_EXCLUSIVE)) {
+			available = 1;
+			pvcam_camera_serial(hcam, cam_serial);
+			pl_cam_close(hcam);
+		}
+		mxSetFieldByNumber(plhs[0], i, 0, mxCreateDoubleScalar((double) i));
+		mxSetFieldByNumber(plhs[0], i, 1, mxCreateString(cam_name));
+		mxSetFieldByNumber(plhs[0], i, 2, mxCreateString(cam_serial));
+		mxSetFieldByNumber(plhs[0], i, 3, mxCreateDoubleScalar((double) available));
+	}
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_list(nlhs, plhs, nrhs, prhs);
+}
+#endif
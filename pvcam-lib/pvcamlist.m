@@ -0,0 +1,16 @@
+% PVCAMLIST - list PVCAM devices
+%
+%     CAMS = PVCAMLIST returns a 1 x N structure array describing every
+%	  camera found by PVCAM, with fields:
+%
+%					index = camera number for PVCAMOPEN
+%					name = PVCAM camera name
+%					serial = camera serial number string
+%					available = 1 if the camera could be opened
+%
+%	  Cameras that are not open yet are briefly opened to read their serial
+%	  number.  Cameras in use by another program report an empty serial and
+%	  available = 0.
+
+% 10/18/26
+% mex DLL code
@@ -0,0 +1,381 @@
+/* PVCAMMULTI - acquire image sequences from several PVCAM devices at once
+
+      [DATA, META, TIMELINE] = PVCAMMULTI(HCAM, NI, ROI, EXPTIME, EXPMODE, OPTS)
+	  acquires NI frames from each camera in the handle vector HCAM (see
+	  PVCAMOPEN) concurrently, one acquisition thread per camera.  ROI is a
+	  structure array as in PVCAMACQ used by every camera, or a cell array
+	  with one ROI structure array per camera.  EXPTIME is a scalar or one
+	  exposure time per camera, and EXPMODE is shared by all cameras.
+
+	  DATA is a 1 x N cell array holding the pixel data of each camera as in
+	  PVCAMACQ, and META is a 1 x N structure array with the per-frame fields
+	  frame, bof, eof, exptime, dropped and late of each camera.  A camera
+	  that fails returns [] in DATA and does not appear in the timeline.
+
+	  TIMELINE aligns the frames of all cameras on a shared time axis and is
+	  a structure with fields:
+
+					time = 1 x NI BOF host times of the first camera from
+						   the earliest start (ns)
+					index = N x NI frame of each camera matched to each
+							frame of the first camera (1-based, 0 if none)
+					offset = N x NI BOF time of matched frame relative to
+							 first camera (ns, NaN if none)
+					start = 1 x N host start time of each camera (ns)
+
+	  Each camera's metadata timestamps are mapped to the host clock with
+	  its clock model (see PVCAMCLOCK), refitted from this acquisition, so
+	  the cameras share a time axis whatever the delay between starting
+	  acquisition and the first exposure.  Frames are matched to the
+	  nearest frame of the first camera within a tolerance.  Without
+	  metadata the frames are matched by order.  OPTS is an optional
+	  structure with fields:
+
+					buffer = frames in circular buffer (default 16)
+					tolerance = largest BOF difference for a match (ns, default
+								half the frame interval of the first camera) */
+
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamstream.h"
+#include "pvcambuffer.h"
+#include "pvcamthread.h"
+#include "pvcamtime.h"
+#include <math.h>
+
+
+// definitions
+#define META_FIELD		6		// number of fields in metadata structure
+#define TIMELINE_FIELD	4		// number of fields in timeline structure
+
+
+// acquisition state of one camera, filled in by its thread
+typedef struct multi_camera {
+	int16		hcam;			// camera handle
+	uns16		nregion;		// number of regions
+	rgn_type	*region;		// region list
+	uns32		exptime;		// exposure time
+	uns32		npixel;			// pixels per frame
+	uns16		*data_ptr;		// pixel output
+	double		*meta_ptr[META_FIELD];	// metadata output columns
+	double		*host_ptr;		// host clock when each frame was taken (ns), NaN if read from a backlog
+	double		start_ns;		// host time acquisition started (ns)
+	double		interval_ns;	// average EOF interval (ns)
+	rs_bool		has_meta;		// metadata enabled on camera
+	rs_bool		has_fit;		// clock model fitted to this acquisition
+	pvcam_clock_fit	fit;		// camera timestamps to host clock
+	rs_bool		success;		// acquisition completed
+	const char	*err_msg;		// reason for failure
+} multi_camera;
+
+// shared acquisition settings
+typedef struct multi_job {
+	multi_camera	*camera;	// per-camera state
+	uns16		nimage;			// frames per camera
+	int16		expmode;		// exposure mode
+	uns32		nbuffer;		// frames in circular buffer
+} multi_job;
+
+
+// function prototypes
+
+// acquisition thread for one camera
+static void multi_acquire(void *job_ctx, uns32 ncam);
+
+// build timeline aligning all cameras on the first one
+mxArray *pvcam_timeline(multi_camera *camera, uns32 ncamera, uns16 nimage, double tolerance);
+
+// BOF of frame on the host clock, relative to start_ns (ns)
+static double multi_time(const multi_camera *camera, uns32 frame, double start_ns);
+
+
+// command routine, also reached as pvcam('multi', ...)
+void pvcam_cmd_multi(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	const char	*field_list[META_FIELD] = {"frame", "bof", "eof", "exptime", "dropped", "late"};
+	const mxArray	*opts;		// options structure
+	const mxArray	*roi_struct;	// ROI structure array of camera
+	double		tolerance;		// largest BOF difference for a match (ns)
+	multi_camera	*camera;	// per-camera state
+	multi_job	job;			// shared acquisition settings
+	mxArray		*meta_struct;	// metadata output
+	uns32		i;				// camera counter
+	uns32		j;				// field, frame or earlier camera counter
+	uns32		ncamera;		// number of cameras
+
+	// validate arguments
+	if ((nrhs < 5) || (nrhs > 6) || (nlhs > 3)) {
+		mexErrMsgTxt("type 'help pvcammulti' for syntax");
+	}
+	pvcam_at_exit(pvcam_buffer_trim);
+
+	// obtain camera handles
+	if (!mxIsNumeric(prhs[0]) || mxIsEmpty(prhs[0])) {
+		mexErrMsgTxt("HCAM must be a numeric vector");
+	}
+	ncamera = (uns32) mxGetNumberOfElements(prhs[0]);
+	if (ncamera > MAX_THREADS) {
+		mexErrMsgTxt("Too many cameras in HCAM");
+	}
+
+	// obtain number of images
+	if (!mxIsNumeric(prhs[1]) || (mxGetNumberOfElements(prhs[1]) != 1)) {
+		mexErrMsgTxt("NI must be a numeric scalar");
+	}
+	job.nimage = (uns16) mxGetScalar(prhs[1]);
+
+	// obtain exposure times
+	if (!mxIsNumeric(prhs[3]) || ((mxGetNumberOfElements(prhs[3]) != 1) && (mxGetNumberOfElements(prhs[3]) != ncamera))) {
+		mexErrMsgTxt("EXPTIME must be a scalar or have one element per camera");
+	}
+	job.expmode = pvcam_exposure_mode(prhs[4]);
+
+	// obtain options structure
+	opts = NULL;
+	if (nrhs > 5) {
+		if (!mxIsStruct(prhs[5]) && !mxIsEmpty(prhs[5])) {
+			mexErrMsgTxt("OPTS must be a structure");
+		}
+		else if (mxIsStruct(prhs[5])) {
+			opts = prhs[5];
+		}
+	}
+	job.nbuffer = (uns32) pvcam_option_value(opts, "buffer", (double) STREAM_BUFFER);
+	tolerance = pvcam_option_value(opts, "tolerance", 0.0);
+
+	// set up each camera and its output arrays
+	// outputs are created here because acquisition threads cannot use the MEX API
+	camera = (multi_camera *) mxCalloc((size_t) ncamera, sizeof(multi_camera));
+	plhs[0] = mxCreateCellMatrix(1, ncamera);
+	meta_struct = mxCreateStructMatrix(1, ncamera, META_FIELD, field_list);
+	for (i = 0; i < ncamera; i++) {
+		camera[i].hcam = (int16) mxGetPr(prhs[0])[i];
+		if (!pl_cam_check(camera[i].hcam)) {
+			mexErrMsgTxt("HCAM is not a handle to an open camera");
+		}
+		for (j = 0; j < i; j++) {
+			if (camera[j].hcam == camera[i].hcam) {
+				mexErrMsgTxt("HCAM cannot list a camera more than once");
+			}
+		}
+		if (mxIsCell(prhs[2])) {
+			if (mxGetNumberOfElements(prhs[2]) != ncamera) {
+				mexErrMsgTxt("ROI cell array must have one element per camera");
+			}
+			roi_struct = mxGetCell(prhs[2], i);
+		}
+		else {
+			roi_struct = prhs[2];
+		}
+		camera[i].region = pvcam_region_array(roi_struct, &camera[i].nregion);
+		camera[i].npixel = pvcam_region_pixels(camera[i].nregion, camera[i].region);
+		camera[i].exptime = (uns32) mxGetPr(prhs[3])[(mxGetNumberOfElements(prhs[3]) > 1) ? i : 0];
+		pvcam_core_touch(camera[i].hcam);
+		mxSetCell(plhs[0], i, mxCreateNumericMatrix(1, (size_t) camera[i].npixel * job.nimage, mxUINT16_CLASS, mxREAL));
+		camera[i].data_ptr = (uns16 *) mxGetData(mxGetCell(plhs[0], i));
+		for (j = 0; j < META_FIELD; j++) {
+			mxSetFieldByNumber(meta_struct, i, (int) j, mxCreateDoubleMatrix(1, job.nimage, mxREAL));
+			camera[i].meta_ptr[j] = mxGetPr(mxGetFieldByNumber(meta_struct, i, (int) j));
+		}
+		camera[i].host_ptr = (double *) mxCalloc((size_t) job.nimage, sizeof(double));
+	}
+
+	// run all acquisitions concurrently
+	// clock models are only touched from this thread, before and after
+	for (i = 0; i < ncamera; i++) {
+		pvcam_clock_begin(camera[i].hcam);
+	}
+	job.camera = camera;
+	pvcam_thread_run(ncamera, multi_acquire, (void *) &job);
+
+	// refit each camera's clock model from the frames it took as they arrived
+	for (i = 0; i < ncamera; i++) {
+		if (camera[i].success && camera[i].has_meta) {
+			for (j = 0; j < job.nimage; j++) {
+				if (!mxIsNaN(camera[i].host_ptr[j])) {
+					pvcam_clock_sample_polled(camera[i].hcam, camera[i].meta_ptr[2][j], camera[i].host_ptr[j]);
+				}
+			}
+			camera[i].has_fit = pvcam_clock_end(camera[i].hcam, &camera[i].fit);
+		}
+	}
+
+	// report failures back on the MATLAB thread
+	for (i = 0; i < ncamera; i++) {
+		if (!camera[i].success) {
+			pvcam_error(camera[i].hcam, camera[i].err_msg);
+			mxDestroyArray(mxGetCell(plhs[0], i));
+			mxSetCell(plhs[0], i, mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL));
+		}
+	}
+
+	// return metadata and timeline
+	if (nlhs > 1) {
+		plhs[1] = meta_struct;
+	}
+	else {
+		mxDestroyArray(meta_struct);
+	}
+	if (nlhs > 2) {
+		plhs[2] = pvcam_timeline(camera, ncamera, job.nimage, tolerance);
+	}
+
+	// free allocated arrays
+	for (i = 0; i < ncamera; i++) {
+		mxFree((void *) camera[i].region);
+		mxFree((void *) camera[i].host_ptr);
+	}
+	mxFree((void *) camera);
+}
+
+
+// acquisition thread for one camera
+static void multi_acquire(void *job_ctx, uns32 ncam) {
+
+	// declarations
+	multi_job		*job = (multi_job *) job_ctx;
+	multi_camera	*camera = &job->camera[ncam];
+	pvcam_frame		frame;		// current frame
+	pvcam_stream	stream;		// acquisition engine state
+	uns32			i;			// frame counter
+
+	// start continuous acquisition and note when it started on the host clock
+	camera->success = pvcam_stream_open(&stream, camera->hcam, camera->nregion, camera->region,
+		camera->exptime, job->expmode, job->nbuffer, 0);
+	camera->start_ns = (double) stream.start_ns;
+	camera->has_meta = stream.has_meta;
+	camera->err_msg = stream.err_msg;
+
+	// pull each frame out of the circular buffer
+	for (i = 0; camera->success && (i < job->nimage); i++) {
+		if (!pvcam_stream_next(&stream, &frame)) {
+			camera->err_msg = stream.err_msg;
+			camera->success = 0;
+		}
+		else if (frame.npixel != camera->npixel) {
+			camera->err_msg = "Frame size does not match ROI";
+			camera->success = 0;
+		}
+		else {
+			memcpy(camera->data_ptr + (size_t) camera->npixel * i, frame.pixels, (size_t) camera->npixel * sizeof(uns16));
+			camera->meta_ptr[0][i] = (double) frame.frame_nr;
+			camera->meta_ptr[1][i] = frame.bof_ns;
+			camera->meta_ptr[2][i] = frame.eof_ns;
+			camera->meta_ptr[3][i] = frame.exp_ns;
+			camera->meta_ptr[4][i] = (double) frame.ndropped;
+			camera->meta_ptr[5][i] = (double) frame.late;
+			camera->host_ptr[i] = (stream.backlog == 0) ? (double) stream.start_ns + frame.host_data_ns : NAN;
+		}
+	}
+	camera->interval_ns = stream.stats.interval_ns;
+	pvcam_stream_close(&stream);
+}
+
+
+// build timeline aligning all cameras on the first one
+mxArray *pvcam_timeline(multi_camera *camera, uns32 ncamera, uns16 nimage, double tolerance) {
+
+	// declarations
+	const char	*field_list[TIMELINE_FIELD] = {"time", "index", "offset", "start"};
+	double		*index_ptr;		// matched frame output
+	double		*offset_ptr;	// BOF difference output
+	double		*start_ptr;		// host start output
+	double		*time_ptr;		// reference time output
+	double		start_min;		// earliest host start (ns)
+	double		t_ref;			// reference frame time (ns)
+	double		t_cam;			// candidate frame time (ns)
+	mxArray		*timeline;		// output structure
+	rs_bool		by_order;		// match frames by order without metadata
+	uns32		i;				// camera counter
+	uns32		j;				// candidate frame counter
+	uns32		k;				// reference frame counter
+	uns32		ref;			// reference camera
+
+	// create outputs, unmatched entries stay 0 / NaN
+	timeline = mxCreateStructMatrix(1, 1, TIMELINE_FIELD, field_list);
+	mxSetFieldByNumber(timeline, 0, 0, mxCreateDoubleMatrix(1, nimage, mxREAL));
+	mxSetFieldByNumber(timeline, 0, 1, mxCreateDoubleMatrix(ncamera, nimage, mxREAL));
+	mxSetFieldByNumber(timeline, 0, 2, mxCreateDoubleMatrix(ncamera, nimage, mxREAL));
+	mxSetFieldByNumber(timeline, 0, 3, mxCreateDoubleMatrix(1, ncamera, mxREAL));
+	time_ptr = mxGetPr(mxGetFieldByNumber(timeline, 0, 0));
+	index_ptr = mxGetPr(mxGetFieldByNumber(timeline, 0, 1));
+	offset_ptr = mxGetPr(mxGetFieldByNumber(timeline, 0, 2));
+	start_ptr = mxGetPr(mxGetFieldByNumber(timeline, 0, 3));
+	for (k = 0; k < (uns32) ncamera * nimage; k++) {
+		offset_ptr[k] = mxGetNaN();
+	}
+
+	// reference is the first camera that completed
+	for (ref = 0; (ref < ncamera) && !camera[ref].success; ref++);
+	if (ref == ncamera) {
+		return(timeline);
+	}
+	start_min = camera[ref].start_ns;
+	by_order = 0;
+	for (i = 0; i < ncamera; i++) {
+		if (camera[i].success) {
+			start_min = (camera[i].start_ns < start_min) ? camera[i].start_ns : start_min;
+			by_order |= !camera[i].has_meta;
+		}
+	}
+	for (i = 0; i < ncamera; i++) {
+		start_ptr[i] = camera[i].start_ns - start_min;
+	}
+	if (tolerance <= 0.0) {
+		tolerance = 0.5 * camera[ref].interval_ns;
+	}
+
+	// shared time of a frame is its BOF mapped to the host clock
+	for (k = 0; k < nimage; k++) {
+		time_ptr[k] = multi_time(&camera[ref], k, start_min);
+	}
+
+	// walk both frame lists in time order, keeping the nearest candidate
+	for (i = 0; i < ncamera; i++) {
+		if (!camera[i].success) {
+			continue;
+		}
+		for (j = 0, k = 0; k < nimage; k++) {
+			if (by_order) {
+				index_ptr[k * ncamera + i] = (double) (k + 1);
+				offset_ptr[k * ncamera + i] = 0.0;
+				continue;
+			}
+			t_ref = time_ptr[k];
+			while ((j + 1 < nimage) &&
+				   (fabs(multi_time(&camera[i], j + 1, start_min) - t_ref) <= fabs(multi_time(&camera[i], j, start_min) - t_ref))) {
+				j++;
+			}
+			t_cam = multi_time(&camera[i], j, start_min);
+			if ((i == ref) || (fabs(t_cam - t_ref) <= tolerance)) {
+				index_ptr[k * ncamera + i] = (double) (j + 1);
+				offset_ptr[k * ncamera + i] = t_cam - t_ref;
+			}
+		}
+	}
+	return(timeline);
+}
+
+
+// BOF of frame on the host clock, relative to start_ns (ns)
+// without a fitted clock model the BOF is taken from the host start
+static double multi_time(const multi_camera *camera, uns32 frame, double start_ns) {
+	if (camera->has_fit) {
+		return(camera->fit.offset + camera->fit.rate * camera->meta_ptr[1][frame] - start_ns);
+	}
+	return(camera->start_ns - start_ns + camera->meta_ptr[1][frame]);
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_multi(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -0,0 +1,39 @@
+% PVCAMMULTI - acquire image sequences from several PVCAM devices at once
+%
+%     [DATA, META, TIMELINE] = PVCAMMULTI(HCAM, NI, ROI, EXPTIME, EXPMODE, OPTS)
+%	  acquires NI frames from each camera in the handle vector HCAM (see
+%	  PVCAMOPEN) concurrently, one acquisition thread per camera.  ROI is a
+%	  structure array as in PVCAMACQ used by every camera, or a cell array
+%	  with one ROI structure array per camera.  EXPTIME is a scalar or one
+%	  exposure time per camera, and EXPMODE is shared by all cameras.
+%
+%	  DATA is a 1 x N cell array holding the pixel data of each camera as in
+%	  PVCAMACQ, and META is a 1 x N structure array with the per-frame fields
+%	  frame, bof, eof, exptime, dropped and late of each camera.  A camera
+%	  that fails returns [] in DATA and does not appear in the timeline.
+%
+%	  TIMELINE aligns the frames of all cameras on a shared time axis and is
+%	  a structure with fields:
+%
+%					time = 1 x NI BOF host times of the first camera from
+%						   the earliest start (ns)
+%					index = N x NI frame of each camera matched to each
+%							frame of the first camera (1-based, 0 if none)
+%					offset = N x NI BOF time of matched frame relative to
+%							 first camera (ns, NaN if none)
+%					start = 1 x N host start time of each camera (ns)
+%
+%	  Each camera's metadata timestamps are mapped to the host clock with
+%	  its clock model (see PVCAMCLOCK), refitted from this acquisition, so
+%	  the cameras share a time axis whatever the delay between starting
+%	  acquisition and the first exposure.  Frames are matched to the
+%	  nearest frame of the first camera within a tolerance.  Without
+%	  metadata the frames are matched by order.  OPTS is an optional
+%	  structure with fields:
+%
+%					buffer = frames in circular buffer (default 16)
+%					tolerance = largest BOF difference for a match (ns, default
+%								half the frame interval of the first camera)
+
+% 10/18/26
+% mex DLL code
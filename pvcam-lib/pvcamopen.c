@@ -2,7 +2,18 @@
 
       HCAM = PVCAMOPEN(NCAMERA) opens and initializes the PVCAM device specified
 	  by NCAM and returns a handle to the open camera HCAM.  NCAM is an integer
-	  from 0 to NCAMERA - 1.  If unsuccessful, HCAM = []. */
+	  from 0 to NCAMERA - 1.  If unsuccessful, HCAM = [].
+
+      HCAM = PVCAMOPEN(SERIAL) opens the camera whose serial number matches
+	  the string SERIAL (see PVCAMLIST).
+
+      HCAM = PVCAMOPEN([NCAM1 NCAM2 ...]) or PVCAMOPEN({SERIAL1, SERIAL2, ...})
+	  opens several cameras and returns a vector of handles in the same
+	  order.  If any camera cannot be opened, the others are closed again
+	  and HCAM = [].
+
+	  Opening a camera that is already open returns the same handle; each
+	  PVCAMOPEN must then be matched by its own PVCAMCLOSE. */
 
 
 /* 2/19/03 SCM */
@@ -10,37 +21,82 @@
 
 // inclusions
 #include "pvcamutil.h"
+#include "pvcamcmd.h"
 
 
-// gateway routine
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+// function prototypes
+
+// open camera selected by index or serial number in MATLAB array
+rs_bool pvcam_open_select(const mxArray *select, mwIndex i, int16 *hcam);
+
+
+// command routine, also reached as pvcam('open', ...)
+void pvcam_cmd_open(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
 	// declarations
+	double		*hcam_ptr;	// output handles
 	int16		hcam;		// camera handle
-	int16		ncam;		// camera number
+	mwIndex		i;			// loop counter
+	mwIndex		j;			// loop counter
+	mwSize		nselect;	// number of cameras requested
 
 	// validate arguments
 	if ((nrhs != 1) || (nlhs > 1)) {
         mexErrMsgTxt("type 'help pvcamopen' for syntax");
     }
 
-	// obtain camera handle
-	if (!mxIsNumeric(prhs[0])) {
-		mexErrMsgTxt("NCAMERA must be numeric");
-	}
-	else if (mxGetNumberOfElements(prhs[0]) != 1) {
-		mexErrMsgTxt("NCAMERA must be a scalar");
+	// obtain camera selection
+	if (!mxIsNumeric(prhs[0]) && !mxIsChar(prhs[0]) && !mxIsCell(prhs[0])) {
+		mexErrMsgTxt("NCAMERA must be numeric, a serial number string or a cell array of serial numbers");
 	}
-	else {
-		ncam = (int16) mxGetScalar(prhs[0]);
+	nselect = mxIsChar(prhs[0]) ? 1 : mxGetNumberOfElements(prhs[0]);
+	if (nselect < 1) {
+		mexErrMsgTxt("NCAMERA cannot be empty");
 	}
 
-	// return HCAM if camera opened
+	// return HCAM if all cameras opened
 	// return [] otherwise
-	if (pvcam_open(ncam, &hcam)) {
-		plhs[0] = mxCreateDoubleScalar((double) hcam);
+	plhs[0] = mxCreateDoubleMatrix(1, nselect, mxREAL);
+	hcam_ptr = mxGetPr(plhs[0]);
+	for (i = 0; i < nselect; i++) {
+		if (!pvcam_open_select(prhs[0], i, &hcam)) {
+			for (j = 0; j < i; j++) {
+				pvcam_close((int16) hcam_ptr[j]);
+			}
+			mxDestroyArray(plhs[0]);
+			plhs[0] = mxCreateDoubleMatrix(0, 0, mxREAL);
+			return;
+		}
+		hcam_ptr[i] = (double) hcam;
 	}
-	else {
-		plhs[0] = mxCreateDoubleMatrix(0, 0, mxREAL);
+}
+
+
+// open camera selected by index or serial number in MATLAB array
+rs_bool pvcam_open_select(const mxArray *select, mwIndex i, int16 *hcam) {
+
+	// declarations
+	char		*serial;	// serial number string
+	const mxArray	*cell;	// cell array element
+	rs_bool		status;		// flag for opened camera
+
+	if (mxIsNumeric(select)) {
+		return(pvcam_open((int16) mxGetPr(select)[i], hcam));
+	}
+	cell = mxIsCell(select) ? mxGetCell(select, i) : select;
+	if ((cell == NULL) || !mxIsChar(cell)) {
+		mexErrMsgTxt("SERIAL must be a string");
 	}
+	serial = mxArrayToString(cell);
+	status = pvcam_open_serial(serial, hcam);
+	mxFree((void *) serial);
+	return(status);
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_open(nlhs, plhs, nrhs, prhs);
 }
+#endif
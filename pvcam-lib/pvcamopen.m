@@ -1,8 +1,19 @@
 % PVCAMOPEN - opens PVCAM device
 %
-%	  HCAM = PVCAMACQ(NCAMERA) opens and initializes the PVCAM device specified
+%	  HCAM = PVCAMOPEN(NCAMERA) opens and initializes the PVCAM device specified
 %	  by NCAM and returns a handle to the open camera HCAM.  NCAM is an integer
-%	  from 0 to NCAMERA - 1.  If unsuccessful, HCAM = []. */
+%	  from 0 to NCAMERA - 1.  If unsuccessful, HCAM = [].
+%
+%	  HCAM = PVCAMOPEN(SERIAL) opens the camera whose serial number matches
+%	  the string SERIAL (see PVCAMLIST).
+%
+%	  HCAM = PVCAMOPEN([NCAM1 NCAM2 ...]) or PVCAMOPEN({SERIAL1, SERIAL2, ...})
+%	  opens several cameras and returns a vector of handles in the same
+%	  order.  If any camera cannot be opened, the others are closed again
+%	  and HCAM = [].
+%
+%	  Opening a camera that is already open returns the same handle; each
+%	  PVCAMOPEN must then be matched by its own PVCAMCLOSE.
 
 % 2/19/03 SCM
 % mex DLL code
@@ -0,0 +1,92 @@
+/* PVCAMORIENT - transpose, rotate or flip recorded image sequence
+
+      ORIENTED = PVCAMORIENT(DATA, ROI, OP) reorients every frame of the
+	  image sequence DATA acquired over the CCD region(s) specified by the
+	  structure array ROI.  DATA must be the unsigned 16-bit pixel data
+	  returned by PVCAMACQ with OPTS (pixel data only, no metadata headers)
+	  and may contain any number of frames.  Each region is taken as the
+	  W x H array reshape(DATA, W, H) with W binned serial pixels and H
+	  binned parallel pixels, and OP is one of
+
+					'none' = copy unchanged
+					'transpose' = A.' (parallel registers on rows, as ROIPARSE shows them)
+					'rot90' = rot90(A), a quarter turn counterclockwise
+					'rot180' = rot90(A, 2)
+					'rot270' = rot90(A, 3), a quarter turn clockwise
+					'fliplr' = fliplr(A)
+					'flipud' = flipud(A)
+
+	  ORIENTED is an unsigned 16-bit vector with the regions and frames in
+	  the same order as DATA, so reshape(ORIENTED, H, W, []) recovers the
+	  frames of a single region after 'transpose', 'rot90' or 'rot270'.
+	  Frames are moved in 64 x 64 pixel tiles spread over the worker
+	  threads, so the cost is close to that of copying the data once.
+	  PVCAMACQ(..., OPTS) applies the same operations while acquiring when
+	  OPTS.orient is set. */
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamproc.h"
+#include "pvcamthread.h"
+
+
+// command routine, also reached as pvcam('orient', ...)
+void pvcam_cmd_orient(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	char		*opstr;		// operation string
+	int			orient;		// ORIENT_ code
+	rgn_type	*region;	// ROI structure
+	uns16		nregion;	// number of regions
+	uns32		npixel;		// pixels per frame
+
+	// validate arguments
+	if ((nrhs != 3) || (nlhs > 1)) {
+		mexErrMsgTxt("type 'help pvcamorient' for syntax");
+	}
+	pvcam_at_exit(pvcam_thread_stop);
+
+	// obtain image sequence
+	if (!mxIsUint16(prhs[0])) {
+		mexErrMsgTxt("DATA must be uint16");
+	}
+
+	// obtain ROI structure from MATLAB structure array
+	region = pvcam_region_array(prhs[1], &nregion);
+	npixel = pvcam_region_pixels(nregion, region);
+	if ((mxGetNumberOfElements(prhs[0]) < npixel) || (mxGetNumberOfElements(prhs[0]) % npixel != 0)) {
+		mexErrMsgTxt("DATA must hold a whole number of frames over ROI");
+	}
+
+	// obtain operation
+	if (!mxIsChar(prhs[2])) {
+		mexErrMsgTxt("OP must be a string");
+	}
+	opstr = mxArrayToString(prhs[2]);
+	if ((orient = pvcam_orient_code(opstr)) < 0) {
+		mexErrMsgTxt("OP must be 'none', 'transpose', 'rot90', 'rot180', 'rot270', 'fliplr' or 'flipud'");
+	}
+	mxFree((void *) opstr);
+
+	// reorient frames
+	plhs[0] = mxCreateNumericMatrix(1, mxGetNumberOfElements(prhs[0]), mxUINT16_CLASS, mxREAL);
+	if (!pvcam_orient_frames((const uns16 *) mxGetData(prhs[0]), (uns32) (mxGetNumberOfElements(prhs[0]) / npixel),
+		nregion, region, orient, (uns16 *) mxGetData(plhs[0]))) {
+		mexErrMsgTxt("Cannot allocate reorientation storage");
+	}
+
+	// free allocated arrays
+	mxFree((void *) region);
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_orient(nlhs, plhs, nrhs, prhs);
+}
+#endif
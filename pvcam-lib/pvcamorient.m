@@ -0,0 +1,28 @@
+% PVCAMORIENT - transpose, rotate or flip recorded image sequence
+%
+%     ORIENTED = PVCAMORIENT(DATA, ROI, OP) reorients every frame of the
+%	  image sequence DATA acquired over the CCD region(s) specified by the
+%	  structure array ROI.  DATA must be the unsigned 16-bit pixel data
+%	  returned by PVCAMACQ with OPTS (pixel data only, no metadata headers)
+%	  and may contain any number of frames.  Each region is taken as the
+%	  W x H array reshape(DATA, W, H) with W binned serial pixels and H
+%	  binned parallel pixels, and OP is one of
+%
+%					'none' = copy unchanged
+%					'transpose' = A.' (parallel registers on rows, as ROIPARSE shows them)
+%					'rot90' = rot90(A), a quarter turn counterclockwise
+%					'rot180' = rot90(A, 2)
+%					'rot270' = rot90(A, 3), a quarter turn clockwise
+%					'fliplr' = fliplr(A)
+%					'flipud' = flipud(A)
+%
+%	  ORIENTED is an unsigned 16-bit vector with the regions and frames in
+%	  the same order as DATA, so reshape(ORIENTED, H, W, []) recovers the
+%	  frames of a single region after 'transpose', 'rot90' or 'rot270'.
+%	  Frames are moved in 64 x 64 pixel tiles spread over the worker
+%	  threads, so the cost is close to that of copying the data once.
+%	  PVCAMACQ(..., OPTS) applies the same operations while acquiring when
+%	  OPTS.orient is set.
+
+% 10/18/26
+% mex DLL code
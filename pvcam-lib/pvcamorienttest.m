@@ -0,0 +1,41 @@
+function pvcamorienttest
+
+% PVCAMORIENTTEST - check PVCAMORIENT against the MATLAB operations
+%
+%    PVCAMORIENTTEST reorients random frames over regions of several shapes
+%    with every operation of PVCAMORIENT and compares the result with
+%    reshape followed by .', rot90, fliplr or flipud.  The regions include
+%    ones a single binned pixel wide or high and longer than one 64 x 64
+%    tile, as full serial or parallel binning gives.  No camera is needed;
+%    an error names the first operation and region that differ.
+
+% 10/18/26
+
+% regions: 131 x 77, 10 x 8 binned, 1 x 100, 1 x 65 by full serial binning, 100 x 1
+roi_struct = struct('s1', {0, 3, 7, 0, 0}, 's2', {130, 22, 7, 63, 99}, 'sbin', {1, 2, 1, 64, 1}, ...
+    'p1', {0, 5, 0, 0, 4}, 'p2', {76, 20, 99, 64, 4}, 'pbin', {1, 2, 1, 1, 1});
+op_list = {'none', 'transpose', 'rot90', 'rot180', 'rot270', 'fliplr', 'flipud'};
+op_fcn = {@(a) a, @(a) a.', @(a) rot90(a), @(a) rot90(a, 2), @(a) rot90(a, 3), @fliplr, @flipud};
+width = ([roi_struct(:).s2] - [roi_struct(:).s1] + 1) ./ [roi_struct(:).sbin];
+height = ([roi_struct(:).p2] - [roi_struct(:).p1] + 1) ./ [roi_struct(:).pbin];
+npixel = width .* height;
+nframe = 3;
+data = uint16(randi([0 65535], sum(npixel) * nframe, 1));
+
+% compare every region of every frame
+for k = 1 : length(op_list)
+    oriented = pvcamorient(data, roi_struct, op_list{k});
+    offset = 0;
+    for f = 1 : nframe
+        for r = 1 : length(roi_struct)
+            index = offset + (1 : npixel(r));
+            expected = op_fcn{k}(reshape(data(index), width(r), height(r)));
+            if ~isequal(reshape(oriented(index), [], 1), expected(:))
+                error('PVCAMORIENT ''%s'' differs on region %d (%d x %d)', op_list{k}, r, width(r), height(r));
+            end
+            offset = offset + npixel(r);
+        end
+    end
+end
+disp('PVCAMORIENT matches the MATLAB operations');
+return
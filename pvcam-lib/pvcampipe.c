@@ -0,0 +1,855 @@
+/* Frame processing pipeline for PVCAM MEX files */
+
+/* 10/18/26 */
+
+/* Frames pushed into a pipeline run through a DAG of stages on a pool of
+   worker threads.  Each stage of each frame is one task; a task becomes
+   ready when every stage feeding it is done with the frame, and the
+   worker that finishes a task pushes the tasks it made ready onto its own
+   deque.  Workers take their newest task first, so a frame tends to stay
+   on one core from stage to stage, and an idle worker steals the oldest
+   task of another.  The deques are guarded by spin locks rather than
+   being lock-free; a task is a whole stage over a whole frame, so the
+   lock is taken a handful of times per frame.
+
+   Only ndepth frames are in flight.  A full pipeline takes no more frames
+   until the oldest one is pulled and retired, which pushes back on the
+   caller (and from there on the circular buffer of the camera) instead
+   of queueing without bound.  Frames are pulled in push order whatever
+   order their stages finish in.  Stages marked PIPE_ORDERED also see the
+   frames one at a time in push order: a frame that reaches one before its
+   turn is parked on the stage and started by whichever worker finishes
+   the frame before it.  Stages marked PIPE_WRITES change pixels in place,
+   so every other stage must come strictly before or after them.
+
+   The caller asks pvcam_pipe_admit before each push.  The pipeline is
+   overloaded when every slot is taken or when the caller says frames are
+   piling up behind it (the circular buffer of the camera), and the
+   overload policy then decides: wait for the oldest frame, cancel the
+   oldest frame in flight, refuse the new frame, or let the new frame
+   through without the stages configured as optional, on every frame or
+   on all but every decimate-th.  Tasks of cancelled frames and skipped
+   stages still pass through the workers without running, so ordered
+   stages and successors move on as usual.  Each decision is counted.
+
+   A cancelled frame no longer counts against the depth, but its slot is
+   only retired once a stage already running on it returns.  Under
+   OVERLOAD_DROP_OLDEST the pipeline therefore holds a spare slot per
+   worker, so the new frame takes a spare at once instead of waiting; if
+   the spares are all still draining, the new frame is refused.
+
+   Stage types are registered from C with pvcam_pipe_register; the built-in
+   types at the end of this file are registered on first use.  Nothing in
+   here calls the MEX API, so failures are left in err_msg. */
+
+// inclusions
+#include "pvcampipe.h"
+#include "pvcambuffer.h"
+#include "pvcamproc.h"
+#include "pvcamtime.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// frame in flight
+struct pipe_slot {
+	pvcam_frame	frame;			// frame with pixels pointing into the slot
+	uns32		seq;			// position in push order
+	uns32		index;			// frame number given by the caller
+	rs_bool		required_only;	// optional stages are skipped
+	volatile long	cancelled;	// frame dropped in flight, remaining stages are skipped
+	volatile long	nleft;		// stages still to run, 0 once frame is done
+	volatile long	npending[MAX_STAGE];	// unfinished stages feeding each stage
+	volatile long	parked[MAX_STAGE];	// ready at an ordered stage ahead of its turn
+};
+
+// tasks of one worker, a task is slot * MAX_STAGE + stage
+struct pipe_deque {
+	volatile long	lock;		// 1 while a thread works on the deque
+	uns32		head;			// oldest task, the one stolen
+	volatile long	count;		// tasks held, read without the lock to skip empty deques
+	uns32		capacity;		// tasks that fit, every task of every slot
+	long		*task;			// ring of tasks
+};
+
+// built-in stage state: sum, lowest and highest of each region
+typedef struct summary_state {
+	uns16		nregion;		// number of regions
+	uns32		*offset;		// first pixel of each region, then pixels per frame
+} summary_state;
+
+// built-in stage state: difference to previous frame
+typedef struct diff_state {
+	uns32		npixel;			// pixels per frame
+	rs_bool		has_previous;	// previous holds a frame
+	uns16		*previous;		// previous frame
+} diff_state;
+
+
+// function prototypes
+
+// worker thread, runs tasks until the pipeline stops
+static void pipe_worker(void *ctx, uns32 index);
+
+// run one task and start the tasks it makes ready
+static void pipe_run(pvcam_pipe *pipe, uns32 index, long task);
+
+// queue stage of slot on deque, or park it if an ordered stage is not at its frame yet
+static void pipe_ready(pvcam_pipe *pipe, uns32 index, uns32 s, uns32 g);
+
+// take spin lock
+static void pipe_lock(volatile long *lock);
+
+// give up spin lock
+static void pipe_unlock(volatile long *lock);
+
+// add task at the newest end
+static void deque_push(pipe_deque *deque, long task);
+
+// take newest task, 0 if none
+static rs_bool deque_pop(pipe_deque *deque, long *task);
+
+// take oldest task, 0 if none
+static rs_bool deque_steal(pipe_deque *deque, long *task);
+
+// register the built-in stage types once
+static void register_builtin(void);
+
+// built-in stages
+static rs_bool defect_init(pvcam_stage *stage, uns16 nregion, const rgn_type *region, uns32 nparam, const pvcam_stage_param *param);
+static rs_bool defect_run(pvcam_stage *stage, uns16 *pixels, const pvcam_frame *frame, double *result);
+static void defect_release(pvcam_stage *stage);
+static rs_bool offset_init(pvcam_stage *stage, uns16 nregion, const rgn_type *region, uns32 nparam, const pvcam_stage_param *param);
+static rs_bool offset_run(pvcam_stage *stage, uns16 *pixels, const pvcam_frame *frame, double *result);
+static rs_bool summary_init(pvcam_stage *stage, uns16 nregion, const rgn_type *region, uns32 nparam, const pvcam_stage_param *param);
+static rs_bool summary_run(pvcam_stage *stage, uns16 *pixels, const pvcam_frame *frame, double *result);
+static void summary_release(pvcam_stage *stage);
+static rs_bool diff_init(pvcam_stage *stage, uns16 nregion, const rgn_type *region, uns32 nparam, const pvcam_stage_param *param);
+static rs_bool diff_run(pvcam_stage *stage, uns16 *pixels, const pvcam_frame *frame, double *result);
+static void diff_release(pvcam_stage *stage);
+static void state_release(pvcam_stage *stage);
+
+
+// global variables
+static const pvcam_stage_type	*stage_registry[MAX_STAGE_TYPE];	// registered stage types
+static uns32	nregistered = 0;	// number of registered stage types
+static rs_bool	builtin_registered = 0;	// built-in types registered
+
+// built-in stage types
+static const pvcam_stage_type	defect_type = {"defect", PIPE_WRITES, defect_init, defect_run, defect_release};
+static const pvcam_stage_type	offset_type = {"offset", PIPE_WRITES, offset_init, offset_run, state_release};
+static const pvcam_stage_type	summary_type = {"summary", 0, summary_init, summary_run, summary_release};
+static const pvcam_stage_type	diff_type = {"diff", PIPE_ORDERED, diff_init, diff_run, diff_release};
+
+
+// register stage type, 0 if the name is taken or the registry is full
+rs_bool pvcam_pipe_register(const pvcam_stage_type *type) {
+	register_builtin();
+	if ((nregistered == MAX_STAGE_TYPE) || (strlen(type->name) >= STAGE_NAME) || (pvcam_pipe_find(type->name) != NULL)) {
+		return(0);
+	}
+	stage_registry[nregistered++] = type;
+	return(1);
+}
+
+
+// registered stage type, NULL if none has that name
+const pvcam_stage_type *pvcam_pipe_find(const char *name) {
+
+	// declarations
+	uns32	i;				// type counter
+
+	register_builtin();
+	for (i = 0; i < nregistered; i++) {
+		if (strcmp(stage_registry[i]->name, name) == 0) {
+			return(stage_registry[i]);
+		}
+	}
+	return(NULL);
+}
+
+
+// parameter of a stage by name, NULL if absent or empty
+const pvcam_stage_param *pvcam_pipe_param(uns32 nparam, const pvcam_stage_param *param, const char *name) {
+
+	// declarations
+	uns32	i;				// parameter counter
+
+	for (i = 0; i < nparam; i++) {
+		if ((strcmp(param[i].name, name) == 0) && (param[i].nvalue > 0)) {
+			return(&param[i]);
+		}
+	}
+	return(NULL);
+}
+
+
+// build pipeline from configured stages and start its workers, 0 with err_msg set on failure
+// ndepth frames in flight under OVERLOAD_ policy
+rs_bool pvcam_pipe_open(pvcam_pipe *pipe, uns32 nstage, const pvcam_stage_config *config,
+						uns16 nregion, const rgn_type *region, uns32 ndepth, int policy) {
+
+	// declarations
+	pvcam_stage	*stage;			// stage being built
+	uns32		ancestor[MAX_STAGE];	// stages each stage comes after, as bit masks
+	uns32		g, h;			// stage counters
+	uns32		i;				// loop counter
+	uns32		nslot;			// slots allocated
+
+	memset(pipe, 0, sizeof(pvcam_pipe));
+	if ((nstage == 0) || (nstage > MAX_STAGE) || (ndepth == 0) || (ndepth > PIPE_MAX_DEPTH)) {
+		pipe->err_msg = "Pipeline needs 1 to 16 stages and 1 to 1024 frames in flight";
+		return(0);
+	}
+
+	// check the graph: stages come after earlier stages only, so it has no cycles
+	for (g = 0; g < nstage; g++) {
+		if (pvcam_pipe_find(config[g].type) == NULL) {
+			pipe->err_msg = "Pipeline stage type is not registered";
+			return(0);
+		}
+		ancestor[g] = 0;
+		for (i = 0; i < config[g].nafter; i++) {
+			if (config[g].after[i] >= g) {
+				pipe->err_msg = "Pipeline stages can only come after stages listed before them";
+				return(0);
+			}
+			ancestor[g] |= ancestor[config[g].after[i]] | (1u << config[g].after[i]);
+		}
+		for (h = 0; h < g; h++) {
+			if (strcmp(config[g].name, config[h].name) == 0) {
+				pipe->err_msg = "Pipeline stage names must be unique";
+				return(0);
+			}
+		}
+	}
+
+	// a stage writing pixels must never run alongside another stage of the same frame
+	for (g = 0; g < nstage; g++) {
+		if (!(pvcam_pipe_find(config[g].type)->flags & PIPE_WRITES)) {
+			continue;
+		}
+		for (h = 0; h < nstage; h++) {
+			if ((h != g) && !(ancestor[g] & (1u << h)) && !(ancestor[h] & (1u << g))) {
+				pipe->err_msg = "A pipeline stage that modifies pixels must come before or after every other stage";
+				return(0);
+			}
+		}
+	}
+
+	// set stages up in order, so a failure releases only those before it
+	pipe->npixel = pvcam_region_pixels(nregion, region);
+	for (g = 0; g < nstage; g++) {
+		stage = &pipe->stage[g];
+		stage->type = pvcam_pipe_find(config[g].type);
+		strcpy(stage->name, config[g].name);
+		stage->optional = config[g].optional;
+		stage->nafter = config[g].nafter;
+		for (i = 0; i < config[g].nafter; i++) {
+			h = config[g].after[i];
+			pipe->stage[h].next[pipe->stage[h].nnext++] = g;
+		}
+		if (!stage->type->init(stage, nregion, region, config[g].nparam, config[g].param)) {
+			pipe->err_msg = (stage->err_msg != NULL) ? stage->err_msg : "Cannot set up pipeline stage";
+			pvcam_pipe_close(pipe);
+			return(0);
+		}
+		stage->result_offset = pipe->nresult;
+		pipe->nresult += stage->nresult;
+		pipe->nstage = g + 1;
+	}
+
+	// frames in flight, and a deque per worker able to hold every task, all in one block
+	// the calling thread feeds the pipeline, so it leaves one worker out
+	// a cancelled frame holds its slot while a stage runs on it, at most one per worker, hence the spares
+	pipe->policy = policy;
+	pipe->decimate = PIPE_DECIMATE;
+	pipe->nworker = pvcam_thread_count() - 1;
+	if (pipe->nworker < 1) {
+		pipe->nworker = 1;
+	}
+	else if (pipe->nworker > MAX_THREADS) {
+		pipe->nworker = MAX_THREADS;
+	}
+	nslot = (policy == OVERLOAD_DROP_OLDEST) ? ndepth + pipe->nworker : ndepth;
+	pipe->ndepth = ndepth;
+	pipe->nslot = nslot;
+	pipe->slot = (pipe_slot *) calloc((size_t) nslot, sizeof(pipe_slot));
+	pipe->pixels = (uns16 *) pvcam_buffer_alloc((size_t) nslot * pipe->npixel * sizeof(uns16));
+	pipe->result = (double *) malloc((size_t) nslot * (pipe->nresult + 1) * sizeof(double));
+	pipe->deque = (pipe_deque *) calloc((size_t) pipe->nworker, sizeof(pipe_deque));
+	if ((pipe->slot == NULL) || (pipe->pixels == NULL) || (pipe->result == NULL) || (pipe->deque == NULL) ||
+		((pipe->deque[0].task = (long *) malloc((size_t) pipe->nworker * nslot * nstage * sizeof(long))) == NULL)) {
+		pipe->err_msg = "Cannot allocate pipeline";
+		pvcam_pipe_close(pipe);
+		return(0);
+	}
+	for (i = 0; i < pipe->nworker; i++) {
+		pipe->deque[i].capacity = nslot * nstage;
+		pipe->deque[i].task = pipe->deque[0].task + (size_t) i * nslot * nstage;
+	}
+
+	// a worker that cannot be started leaves its share to the others,
+	// restarting the pool with as many workers as the system gave so none sees nworker change
+	for (;;) {
+		for (i = 0; (i < pipe->nworker) &&
+			((pipe->worker[i] = pvcam_thread_start_worker(pipe_worker, (void *) pipe, i)) != NULL); i++) {
+		}
+		if ((i == pipe->nworker) || (i == 0)) {
+			break;
+		}
+		pipe->stop = 1;
+		for (h = 0; h < i; h++) {
+			pvcam_thread_join(pipe->worker[h]);
+			pipe->worker[h] = NULL;
+		}
+		pipe->stop = 0;
+		pipe->nworker = i;
+	}
+	if (i == 0) {
+		pipe->nworker = 0;
+		pipe->err_msg = "Cannot start pipeline workers";
+		pvcam_pipe_close(pipe);
+		return(0);
+	}
+	return(1);
+}
+
+
+// ndepth frames in flight or no slot free, no room for another frame until the oldest is retired
+rs_bool pvcam_pipe_full(const pvcam_pipe *pipe) {
+	return((pipe->seq_in - pipe->seq_out - pipe->ncancelled >= pipe->ndepth) || (pipe->seq_in - pipe->seq_out == pipe->nslot));
+}
+
+
+// apply overload policy to the next frame, overloaded when full or when the caller is backlogged
+// the frame dropped is the oldest in flight not yet cancelled, the new frame taking a spare slot,
+// or the new frame itself if none is left to cancel or every spare is still draining
+int pvcam_pipe_admit(pvcam_pipe *pipe, rs_bool backlogged) {
+
+	// declarations
+	uns32	seq;			// oldest frame not yet cancelled
+
+	if (!backlogged && !pvcam_pipe_full(pipe)) {
+		return(ADMIT_ALL);
+	}
+	pipe->overload.noverload++;
+	switch (pipe->policy) {
+	case OVERLOAD_DROP_OLDEST:
+		seq = pipe->seq_out + pipe->ncancelled;
+		if ((seq != pipe->seq_in) && (pipe->seq_in - pipe->seq_out < pipe->nslot)) {
+			pvcam_atomic_swap(&pipe->slot[seq % pipe->nslot].cancelled, 0, 1);
+			pipe->ncancelled++;
+			pipe->overload.ndrop_oldest++;
+			return(ADMIT_ALL);
+		}
+		pipe->overload.ndrop_newest++;
+		return(ADMIT_REFUSED);
+	case OVERLOAD_DROP_NEWEST:
+		pipe->overload.ndrop_newest++;
+		return(ADMIT_REFUSED);
+	case OVERLOAD_SKIP:
+		pipe->overload.nskipped++;
+		return(ADMIT_REQUIRED);
+	case OVERLOAD_DECIMATE:
+		if (pipe->seq_in % pipe->decimate == 0) {
+			return(ADMIT_ALL);
+		}
+		pipe->overload.nskipped++;
+		return(ADMIT_REQUIRED);
+	default:
+		return(ADMIT_ALL);
+	}
+}
+
+
+// wait for the oldest frame to be done so it can be pulled, 0 if a stage failed (err_msg set)
+rs_bool pvcam_pipe_wait(pvcam_pipe *pipe) {
+
+	// declarations
+	pvcam_pipe_out	out;		// oldest frame, left in place
+	ulong64		start_ns;		// host clock when wait started
+
+	start_ns = pvcam_clock_ns();
+	pvcam_pipe_pull(pipe, &out, 1);
+	pipe->overload.nblocked++;
+	pipe->overload.blocked_ns += pvcam_clock_ns() - start_ns;
+	return(!pipe->failed);
+}
+
+
+// copy frame into the pipeline and start its first stages, the pipeline must not be full
+// region descriptors do not outlive the frame in the circular buffer, so they are not kept
+void pvcam_pipe_push(pvcam_pipe *pipe, const pvcam_frame *frame, uns32 index, int admit) {
+
+	// declarations
+	pipe_slot	*slot;			// slot taking the frame
+	uns32		g;				// stage counter
+	uns32		i;				// result counter
+	uns32		s;				// slot number
+
+	s = pipe->seq_in % pipe->nslot;
+	slot = &pipe->slot[s];
+	slot->frame = *frame;
+	slot->frame.pixels = pipe->pixels + (size_t) s * pipe->npixel;
+	slot->frame.npixel = pipe->npixel;
+	slot->frame.nroi = 0;
+	slot->frame.roi = NULL;
+	memcpy(slot->frame.pixels, frame->pixels, (size_t) pipe->npixel * sizeof(uns16));
+	for (i = 0; i < pipe->nresult; i++) {
+		pipe->result[(size_t) s * pipe->nresult + i] = NAN;
+	}
+	slot->seq = pipe->seq_in++;
+	slot->index = index;
+	slot->required_only = (admit == ADMIT_REQUIRED);
+	slot->cancelled = 0;
+	for (g = 0; g < pipe->nstage; g++) {
+		slot->npending[g] = (long) pipe->stage[g].nafter;
+		slot->parked[g] = 0;
+	}
+
+	// publishing the count is the barrier that makes the slot visible to the workers
+	pvcam_atomic_add(&slot->nleft, (long) pipe->nstage);
+	for (g = 0; g < pipe->nstage; g++) {
+		if (pipe->stage[g].nafter == 0) {
+			pipe_ready(pipe, slot->seq % pipe->nworker, s, g);
+		}
+	}
+}
+
+
+// oldest frame once every stage is done with it, waiting for it if asked and one is in flight
+// 0 if none is ready, none is in flight or a stage failed (err_msg set)
+rs_bool pvcam_pipe_pull(pvcam_pipe *pipe, pvcam_pipe_out *out, rs_bool wait) {
+
+	// declarations
+	pipe_slot	*slot;			// slot of oldest frame
+	uns32		nidle;			// polls without progress
+	uns32		s;				// slot number
+
+	for (nidle = 0; !pipe->failed && (pipe->seq_out != pipe->seq_in); nidle++) {
+		s = pipe->seq_out % pipe->nslot;
+		slot = &pipe->slot[s];
+		if (pvcam_atomic_add(&slot->nleft, 0) == 0) {
+			out->index = slot->index;
+			out->pixels = slot->frame.pixels;
+			out->result = pipe->result + (size_t) s * pipe->nresult;
+			out->cancelled = (slot->cancelled != 0);
+			return(1);
+		}
+		if (!wait) {
+			break;
+		}
+		if (nidle >= PIPE_SPIN) {
+			pvcam_thread_sleep((nidle >= 2 * PIPE_SPIN) ? 1 : 0);
+		}
+	}
+	return(0);
+}
+
+
+// free slot of the frame from pvcam_pipe_pull
+void pvcam_pipe_retire(pvcam_pipe *pipe) {
+	if (pipe->slot[pipe->seq_out % pipe->nslot].cancelled) {
+		pipe->ncancelled--;
+	}
+	pipe->seq_out++;
+}
+
+
+// stop workers, release stages and free storage, safe on a zeroed pipeline
+void pvcam_pipe_close(pvcam_pipe *pipe) {
+
+	// declarations
+	uns32	i;				// loop counter
+
+	pipe->stop = 1;
+	for (i = 0; i < pipe->nworker; i++) {
+		pvcam_thread_join(pipe->worker[i]);
+		pipe->worker[i] = NULL;
+	}
+	for (i = 0; i < pipe->nstage; i++) {
+		pipe->stage[i].type->release(&pipe->stage[i]);
+	}
+	if (pipe->deque != NULL) {
+		free((void *) pipe->deque[0].task);
+	}
+	free((void *) pipe->deque);
+	free((void *) pipe->slot);
+	free((void *) pipe->result);
+	pvcam_buffer_free((void *) pipe->pixels);
+	pipe->deque = NULL;
+	pipe->slot = NULL;
+	pipe->result = NULL;
+	pipe->pixels = NULL;
+	pipe->nstage = 0;
+	pipe->nworker = 0;
+}
+
+
+// worker thread, runs tasks until the pipeline stops
+// idle workers spin a little, then yield, then nap a millisecond at a time
+static void pipe_worker(void *ctx, uns32 index) {
+
+	// declarations
+	pvcam_pipe	*pipe;			// pipeline served
+	long		task;			// task taken
+	uns32		k;				// victim counter
+	uns32		nidle;			// polls without a task
+
+	pipe = (pvcam_pipe *) ctx;
+	nidle = 0;
+	while (!pipe->stop) {
+		if (!deque_pop(&pipe->deque[index], &task)) {
+			for (k = 1; (k < pipe->nworker) && !deque_steal(&pipe->deque[(index + k) % pipe->nworker], &task); k++) {
+			}
+			if (k >= pipe->nworker) {
+				if (++nidle >= PIPE_SPIN) {
+					pvcam_thread_sleep((nidle >= 2 * PIPE_SPIN) ? 1 : 0);
+				}
+				continue;
+			}
+		}
+		nidle = 0;
+		pipe_run(pipe, index, task);
+	}
+}
+
+
+// run one task and start the tasks it makes ready
+// after a failure, a cancel or for a skipped optional stage the task still passes through
+// without running its stage, so frames drain
+static void pipe_run(pvcam_pipe *pipe, uns32 index, long task) {
+
+	// declarations
+	pipe_slot	*slot;			// frame of task
+	pvcam_stage	*stage;			// stage of task
+	rs_bool		ran;			// stage ran on the frame
+	rs_bool		skipped;		// stage skipped for an optional stage under overload
+	rs_bool		unpark;			// next frame was parked on this ordered stage
+	ulong64		start_ns;		// host clock when task started
+	uns32		g;				// stage number
+	uns32		i;				// successor counter
+	uns32		s;				// slot number
+	uns32		s_next;			// slot of next frame at ordered stage
+
+	s = (uns32) task / MAX_STAGE;
+	g = (uns32) task % MAX_STAGE;
+	slot = &pipe->slot[s];
+	stage = &pipe->stage[g];
+	start_ns = pvcam_clock_ns();
+	skipped = (slot->required_only && stage->optional);
+	ran = (!pipe->failed && !slot->cancelled && !skipped);
+	if (ran &&
+		!stage->type->run(stage, slot->frame.pixels, &slot->frame, pipe->result + (size_t) s * pipe->nresult + stage->result_offset)) {
+		pipe->err_msg = (stage->err_msg != NULL) ? stage->err_msg : "Pipeline stage failed";
+		pvcam_atomic_swap(&pipe->failed, 0, 1);
+	}
+
+	// ordered stage moves on to the next frame, starting it if it was parked
+	pipe_lock(&stage->lock);
+	if (skipped) {
+		stage->nskipped++;
+	}
+	else if (ran) {
+		stage->nframe++;
+		stage->busy_ns += pvcam_clock_ns() - start_ns;
+	}
+	unpark = 0;
+	s_next = 0;
+	if (stage->type->flags & PIPE_ORDERED) {
+		stage->next_seq++;
+		s_next = (uns32) stage->next_seq % pipe->nslot;
+		if (pipe->slot[s_next].parked[g]) {
+			pipe->slot[s_next].parked[g] = 0;
+			unpark = 1;
+		}
+	}
+	pipe_unlock(&stage->lock);
+	if (unpark) {
+		deque_push(&pipe->deque[index], (long) (s_next * MAX_STAGE + g));
+	}
+
+	// successors whose last input this was become ready
+	for (i = 0; i < stage->nnext; i++) {
+		if (pvcam_atomic_add(&slot->npending[stage->next[i]], -1) == 0) {
+			pipe_ready(pipe, index, s, stage->next[i]);
+		}
+	}
+	pvcam_atomic_add(&slot->nleft, -1);
+}
+
+
+// queue stage of slot on deque, or park it if an ordered stage is not at its frame yet
+static void pipe_ready(pvcam_pipe *pipe, uns32 index, uns32 s, uns32 g) {
+
+	// declarations
+	pvcam_stage	*stage;			// stage made ready
+
+	stage = &pipe->stage[g];
+	if (stage->type->flags & PIPE_ORDERED) {
+		pipe_lock(&stage->lock);
+		if (pipe->slot[s].seq != (uns32) stage->next_seq) {
+			pipe->slot[s].parked[g] = 1;
+			pipe_unlock(&stage->lock);
+			return;
+		}
+		pipe_unlock(&stage->lock);
+	}
+	deque_push(&pipe->deque[index], (long) (s * MAX_STAGE + g));
+}
+
+
+// take spin lock
+static void pipe_lock(volatile long *lock) {
+	while (pvcam_atomic_swap(lock, 0, 1) != 0) {
+	}
+}
+
+
+// give up spin lock
+static void pipe_unlock(volatile long *lock) {
+	pvcam_atomic_swap(lock, 1, 0);
+}
+
+
+// add task at the newest end
+static void deque_push(pipe_deque *deque, long task) {
+	pipe_lock(&deque->lock);
+	deque->task[(deque->head + (uns32) deque->count) % deque->capacity] = task;
+	deque->count++;
+	pipe_unlock(&deque->lock);
+}
+
+
+// take newest task, 0 if none
+static rs_bool deque_pop(pipe_deque *deque, long *task) {
+
+	// declarations
+	rs_bool	taken;			// task found
+
+	if (deque->count == 0) {
+		return(0);
+	}
+	pipe_lock(&deque->lock);
+	taken = (deque->count > 0);
+	if (taken) {
+		deque->count--;
+		*task = deque->task[(deque->head + (uns32) deque->count) % deque->capacity];
+	}
+	pipe_unlock(&deque->lock);
+	return(taken);
+}
+
+
+// take oldest task, 0 if none
+static rs_bool deque_steal(pipe_deque *deque, long *task) {
+
+	// declarations
+	rs_bool	taken;			// task found
+
+	if (deque->count == 0) {
+		return(0);
+	}
+	pipe_lock(&deque->lock);
+	taken = (deque->count > 0);
+	if (taken) {
+		*task = deque->task[deque->head];
+		deque->head = (deque->head + 1) % deque->capacity;
+		deque->count--;
+	}
+	pipe_unlock(&deque->lock);
+	return(taken);
+}
+
+
+// register the built-in stage types once
+static void register_builtin(void) {
+	if (builtin_registered) {
+		return;
+	}
+	builtin_registered = 1;
+	pvcam_pipe_register(&defect_type);
+	pvcam_pipe_register(&offset_type);
+	pvcam_pipe_register(&summary_type);
+	pvcam_pipe_register(&diff_type);
+}
+
+
+// defect: replace the pixels listed in hotpixels (N x 2 [serial parallel]) by their good neighbors
+static rs_bool defect_init(pvcam_stage *stage, uns16 nregion, const rgn_type *region, uns32 nparam, const pvcam_stage_param *param) {
+
+	// declarations
+	const pvcam_stage_param	*hot;	// defect coordinates
+
+	// read defect list
+	if (((hot = pvcam_pipe_param(nparam, param, "hotpixels")) == NULL) || (hot->nvalue % 2 != 0)) {
+		stage->err_msg = "Pipeline stage defect needs hotpixels, an N x 2 list of [serial parallel] coordinates";
+		return(0);
+	}
+	if (((stage->state = calloc(1, sizeof(pvcam_defect))) == NULL) ||
+		!pvcam_defect_init((pvcam_defect *) stage->state, nregion, region, hot->value, hot->nvalue / 2)) {
+		free(stage->state);
+		stage->state = NULL;
+		stage->err_msg = "Cannot allocate defect list";
+		return(0);
+	}
+	return(1);
+}
+
+// correct defects of one frame in place
+static rs_bool defect_run(pvcam_stage *stage, uns16 *pixels, const pvcam_frame *frame, double *result) {
+	(void) frame;
+	(void) result;
+	pvcam_defect_correct((const pvcam_defect *) stage->state, pixels);
+	return(1);
+}
+
+// free defect list
+static void defect_release(pvcam_stage *stage) {
+	if (stage->state != NULL) {
+		pvcam_defect_free((pvcam_defect *) stage->state);
+	}
+	state_release(stage);
+}
+
+
+// offset: subtract level (DN) from every pixel, clipping at 0
+static rs_bool offset_init(pvcam_stage *stage, uns16 nregion, const rgn_type *region, uns32 nparam, const pvcam_stage_param *param) {
+
+	// declarations
+	const pvcam_stage_param	*level;	// offset level
+
+	(void) nregion;
+	(void) region;
+
+	// read level
+	if (((level = pvcam_pipe_param(nparam, param, "level")) == NULL) || (level->value[0] < 0.0) ||
+		(level->value[0] > 65535.0)) {
+		stage->err_msg = "Pipeline stage offset needs level from 0 to 65535";
+		return(0);
+	}
+	if ((stage->state = malloc(sizeof(uns16))) == NULL) {
+		stage->err_msg = "Cannot allocate pipeline stage";
+		return(0);
+	}
+	*(uns16 *) stage->state = (uns16) floor(level->value[0] + 0.5);
+	return(1);
+}
+
+// subtract offset from one frame in place
+static rs_bool offset_run(pvcam_stage *stage, uns16 *pixels, const pvcam_frame *frame, double *result) {
+	(void) result;
+	pvcam_offset_subtract(pixels, frame->npixel, *(const uns16 *) stage->state);
+	return(1);
+}
+
+
+// summary: mean, min and max of each region
+static rs_bool summary_init(pvcam_stage *stage, uns16 nregion, const rgn_type *region, uns32 nparam, const pvcam_stage_param *param) {
+
+	// declarations
+	summary_state	*summary;	// region offsets
+	uns16			r;			// region counter
+
+	(void) nparam;
+	(void) param;
+
+	// region offsets into the frame
+	if (((summary = (summary_state *) calloc(1, sizeof(summary_state))) == NULL) ||
+		((summary->offset = (uns32 *) malloc(((size_t) nregion + 1) * sizeof(uns32))) == NULL)) {
+		free((void *) summary);
+		stage->err_msg = "Cannot allocate pipeline stage";
+		return(0);
+	}
+	summary->nregion = nregion;
+	summary->offset[0] = 0;
+	for (r = 0; r < nregion; r++) {
+		summary->offset[r + 1] = summary->offset[r] + pvcam_region_pixels(1, &region[r]);
+	}
+	stage->state = (void *) summary;
+	stage->nresult = 3 * (uns32) nregion;
+	return(1);
+}
+
+// mean, min and max of each region of one frame
+static rs_bool summary_run(pvcam_stage *stage, uns16 *pixels, const pvcam_frame *frame, double *result) {
+
+	// declarations
+	summary_state	*summary;		// region offsets
+	pvcam_summary	region_summary;	// summary of one region
+	uns16			r;				// region counter
+
+	(void) frame;
+	summary = (summary_state *) stage->state;
+	for (r = 0; r < summary->nregion; r++) {
+		pvcam_summarize(pixels + summary->offset[r], summary->offset[r + 1] - summary->offset[r], &region_summary);
+		result[3 * r] = region_summary.sum / (double) region_summary.npixel;
+		result[3 * r + 1] = (double) region_summary.min;
+		result[3 * r + 2] = (double) region_summary.max;
+	}
+	return(1);
+}
+
+// free region offsets
+static void summary_release(pvcam_stage *stage) {
+	if (stage->state != NULL) {
+		free((void *) ((summary_state *) stage->state)->offset);
+	}
+	state_release(stage);
+}
+
+
+// diff: mean absolute difference to the previous frame, NaN for the first
+static rs_bool diff_init(pvcam_stage *stage, uns16 nregion, const rgn_type *region, uns32 nparam, const pvcam_stage_param *param) {
+
+	// declarations
+	diff_state	*diff;			// previous frame
+
+	(void) nparam;
+	(void) param;
+
+	// room for the previous frame
+	if (((diff = (diff_state *) calloc(1, sizeof(diff_state))) == NULL) ||
+		((diff->previous = (uns16 *) malloc((size_t) pvcam_region_pixels(nregion, region) * sizeof(uns16))) == NULL)) {
+		free((void *) diff);
+		stage->err_msg = "Cannot allocate pipeline stage";
+		return(0);
+	}
+	diff->npixel = pvcam_region_pixels(nregion, region);
+	stage->state = (void *) diff;
+	stage->nresult = 1;
+	return(1);
+}
+
+// difference of one frame to the previous one
+static rs_bool diff_run(pvcam_stage *stage, uns16 *pixels, const pvcam_frame *frame, double *result) {
+
+	// declarations
+	diff_state	*diff;			// previous frame
+
+	(void) frame;
+	diff = (diff_state *) stage->state;
+	if (diff->has_previous) {
+		result[0] = pvcam_frame_difference(pixels, diff->previous, diff->npixel) / (double) diff->npixel;
+	}
+	memcpy(diff->previous, pixels, (size_t) diff->npixel * sizeof(uns16));
+	diff->has_previous = 1;
+	return(1);
+}
+
+// free previous frame
+static void diff_release(pvcam_stage *stage) {
+	if (stage->state != NULL) {
+		free((void *) ((diff_state *) stage->state)->previous);
+	}
+	state_release(stage);
+}
+
+
+// free state of a stage that holds a single allocation
+static void state_release(pvcam_stage *stage) {
+	free(stage->state);
+	stage->state = NULL;
+}
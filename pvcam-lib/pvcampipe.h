@@ -0,0 +1,173 @@
+/* Frame processing pipeline for PVCAM MEX files */
+
+/* 10/18/26 */
+
+#ifndef _PVCAMPIPE_H
+#define _PVCAMPIPE_H
+
+// inclusions
+#include "pvcamstream.h"
+#include "pvcamthread.h"
+
+
+// definitions
+#define MAX_STAGE		16		// stages in one pipeline
+#define MAX_STAGE_TYPE	32		// stage types that can be registered
+#define MAX_STAGE_PARAM	8		// parameters passed to one stage
+#define STAGE_NAME		32		// max length of stage and parameter names
+#define PIPE_DEPTH		8		// default frames in flight
+#define PIPE_MAX_DEPTH	1024	// most frames in flight
+#define PIPE_SPIN		64		// idle polls before a waiting thread naps
+#define PIPE_ORDERED	0x1		// stage sees frames one at a time in frame order
+#define PIPE_WRITES		0x2		// stage modifies pixels
+#define PIPE_DECIMATE	4		// default optional stage rate under OVERLOAD_DECIMATE
+#define OVERLOAD_BLOCK	0		// frame waits for the oldest frame to be done
+#define OVERLOAD_DROP_OLDEST	1	// oldest frame in flight is cancelled, new frame takes a spare slot
+#define OVERLOAD_DROP_NEWEST	2	// new frame is refused
+#define OVERLOAD_SKIP	3		// new frame runs without optional stages
+#define OVERLOAD_DECIMATE	4	// new frame runs optional stages only every decimate frames
+#define ADMIT_ALL		0		// every stage runs on the frame
+#define ADMIT_REQUIRED	1		// optional stages are skipped
+#define ADMIT_REFUSED	2		// frame is dropped
+
+
+// named parameter of a stage, values borrowed for the life of the pipeline
+typedef struct pvcam_stage_param {
+	char		name[STAGE_NAME];	// parameter name
+	const double	*value;		// values
+	uns32		nvalue;			// number of values
+} pvcam_stage_param;
+
+// stage as configured, before the pipeline is built
+typedef struct pvcam_stage_config {
+	char		type[STAGE_NAME];	// registered stage type
+	char		name[STAGE_NAME];	// stage name, unique in the pipeline
+	uns32		nafter;			// stages that must finish a frame first
+	uns32		after[MAX_STAGE];	// their positions, each before this stage
+	rs_bool		optional;		// stage may be skipped under overload
+	uns32		nparam;			// number of parameters
+	pvcam_stage_param	param[MAX_STAGE_PARAM];	// parameters
+} pvcam_stage_config;
+
+typedef struct pvcam_stage pvcam_stage;
+
+// stage type registered from C
+// init sets nresult and state and may keep pointers to param values, run gets nresult results to fill
+// init and run leave the reason for a failure in err_msg, release frees state
+typedef struct pvcam_stage_type {
+	const char	*name;			// type name used in configurations
+	uns32		flags;			// PIPE_ORDERED, PIPE_WRITES
+	rs_bool		(*init)(pvcam_stage *stage, uns16 nregion, const rgn_type *region,
+						uns32 nparam, const pvcam_stage_param *param);
+	rs_bool		(*run)(pvcam_stage *stage, uns16 *pixels, const pvcam_frame *frame, double *result);
+	void		(*release)(pvcam_stage *stage);
+} pvcam_stage_type;
+
+// stage of a running pipeline
+struct pvcam_stage {
+	const pvcam_stage_type	*type;	// stage type
+	char		name[STAGE_NAME];	// stage name
+	void		*state;			// state owned by the stage type
+	uns32		nresult;		// results per frame
+	uns32		result_offset;	// first result of stage within a frame
+	rs_bool		optional;		// stage may be skipped under overload
+	uns32		nafter;			// stages feeding this one
+	uns32		nnext;			// stages fed by this one
+	uns32		next[MAX_STAGE];	// their positions
+	volatile long	next_seq;	// next frame due at an ordered stage
+	volatile long	lock;		// 1 while a thread updates next_seq or the counters
+	uns32		nframe;			// frames run
+	uns32		nskipped;		// frames skipped under overload
+	ulong64		busy_ns;		// time spent running (ns)
+	const char	*err_msg;		// reason for last failure
+};
+
+typedef struct pipe_slot pipe_slot;
+typedef struct pipe_deque pipe_deque;
+
+// frame handed back by pvcam_pipe_pull, valid until pvcam_pipe_retire
+typedef struct pvcam_pipe_out {
+	uns32		index;			// frame number given to pvcam_pipe_push
+	uns16		*pixels;		// pixels after every stage
+	const double	*result;	// results of every stage, at each stage's result_offset
+	rs_bool		cancelled;		// frame dropped in flight, pixels and results incomplete
+} pvcam_pipe_out;
+
+// overload decisions taken by pvcam_pipe_admit and pvcam_pipe_wait
+typedef struct pvcam_overload_stats {
+	uns32		noverload;		// frames arriving with the pipeline full or the camera backlogged
+	uns32		nblocked;		// frames that waited for a free slot
+	ulong64		blocked_ns;		// time spent waiting (ns)
+	uns32		ndrop_oldest;	// frames dropped as the oldest waiting
+	uns32		ndrop_newest;	// frames refused on arrival
+	uns32		nskipped;		// frames run without their optional stages
+} pvcam_overload_stats;
+
+// pipeline of stages run on a pool of worker threads
+typedef struct pvcam_pipe {
+	uns32		nstage;			// number of stages
+	pvcam_stage	stage[MAX_STAGE];	// stages in configuration order
+	uns32		npixel;			// pixels per frame
+	uns32		nresult;		// results per frame over all stages
+	uns32		ndepth;			// frames in flight, not counting cancelled ones
+	uns32		nslot;			// slots, ndepth plus a spare per worker under OVERLOAD_DROP_OLDEST
+	pipe_slot	*slot;			// frames in flight, by sequence modulo nslot
+	uns16		*pixels;		// pixels of every slot
+	double		*result;		// results of every slot
+	uns32		nworker;		// worker threads
+	pvcam_thread	*worker[MAX_THREADS];	// worker threads
+	pipe_deque	*deque;			// task deque of each worker
+	volatile long	stop;		// set to end the workers
+	uns32		seq_in;			// frames pushed
+	uns32		seq_out;		// frames retired
+	uns32		ncancelled;		// cancelled frames not yet retired, always the oldest in flight
+	volatile long	failed;		// a stage failed, err_msg holds why
+	int			policy;			// OVERLOAD_ policy
+	uns32		decimate;		// optional stage rate under OVERLOAD_DECIMATE, PIPE_DECIMATE unless set after opening
+	pvcam_overload_stats	overload;	// overload decisions
+	const char	*err_msg;		// reason for last failure
+} pvcam_pipe;
+
+
+// function prototypes
+
+// register stage type, 0 if the name is taken or the registry is full
+rs_bool pvcam_pipe_register(const pvcam_stage_type *type);
+
+// registered stage type, NULL if none has that name
+const pvcam_stage_type *pvcam_pipe_find(const char *name);
+
+// parameter of a stage by name, NULL if absent or empty
+const pvcam_stage_param *pvcam_pipe_param(uns32 nparam, const pvcam_stage_param *param, const char *name);
+
+// build pipeline from configured stages and start its workers, 0 with err_msg set on failure
+// ndepth frames in flight under OVERLOAD_ policy
+rs_bool pvcam_pipe_open(pvcam_pipe *pipe, uns32 nstage, const pvcam_stage_config *config,
+						uns16 nregion, const rgn_type *region, uns32 ndepth, int policy);
+
+// ndepth frames in flight or no slot free, no room for another frame until the oldest is retired
+rs_bool pvcam_pipe_full(const pvcam_pipe *pipe);
+
+// apply overload policy to the next frame, overloaded when full or when the caller is backlogged
+// returns ADMIT_ALL, ADMIT_REQUIRED or ADMIT_REFUSED
+int pvcam_pipe_admit(pvcam_pipe *pipe, rs_bool backlogged);
+
+// wait for the oldest frame to be done so it can be pulled, 0 if a stage failed (err_msg set)
+rs_bool pvcam_pipe_wait(pvcam_pipe *pipe);
+
+// copy frame into the pipeline and start its first stages, the pipeline must not be full
+// index is the caller's frame number handed back by pvcam_pipe_pull
+// admit from pvcam_pipe_admit, ADMIT_REQUIRED skips optional stages
+void pvcam_pipe_push(pvcam_pipe *pipe, const pvcam_frame *frame, uns32 index, int admit);
+
+// oldest frame once every stage is done with it, waiting for it if asked and one is in flight
+// 0 if none is ready, none is in flight or a stage failed (err_msg set)
+rs_bool pvcam_pipe_pull(pvcam_pipe *pipe, pvcam_pipe_out *out, rs_bool wait);
+
+// free slot of the frame from pvcam_pipe_pull
+void pvcam_pipe_retire(pvcam_pipe *pipe);
+
+// stop workers, release stages and free storage, safe on a zeroed pipeline
+void pvcam_pipe_close(pvcam_pipe *pipe);
+
+#endif /* _PVCAMPIPE_H */
@@ -8,21 +8,17 @@
 
 // inclusions
 #include "pvcamutil.h"
+#include "pvcamcmd.h"
 
 
 // function prototypes
 
 // acquire image(s) from camera
-mxArray *pvcam_pp_select(int16 hcam);
+mxArray *pvcam_pp_select(int16 hcam, int16 featureIndex, int16 functionIndex, uns32 featureValue);
 
-// global variables
-rs_bool	attr_avail;		// flag for available parameter
-uns16	attr_access;	// flag for read only, read/write
-uns16	attr_type;		// data type of parameter values
-uns32	attr_count;		// count for enumerated/char parameters
 
-// gateway routine
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+// command routine, also reached as pvcam('ppselect', ...)
+void pvcam_cmd_ppselect(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
 	// declarations
 	int16		hcam;		// camera handle
@@ -35,15 +31,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     }
 
 	// obtain camera handle
-	if (!mxIsNumeric(prhs[0])) {
-		mexErrMsgTxt("HCAM must be numeric");
-	}
-	else if (mxGetNumberOfElements(prhs[0]) != 1) {
-		mexErrMsgTxt("HCAM must be a scalar");
-	}
-	else {
-		hcam = (int16) mxGetScalar(prhs[0]);
-	}
+	hcam = pvcam_camera_handle(prhs[0]);
 	
 	if (!mxIsNumeric(prhs[1])) {
 		mexErrMsgTxt("Feature Index must be numeric");
@@ -81,6 +69,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 	
 	if (pl_cam_check(hcam)) {
 		pvcam_pp_select(hcam, featureIndex, functionIndex, featureValue);
+		pvcam_core_param_flush(hcam);
 	}
 	else {
 		pvcam_error(hcam, "HCAM is not a handle to an open camera");
@@ -159,4 +148,12 @@ mxArray *pvcam_pp_select(int16 hcam, int16 featureIndex, int16 functionIndex, un
     }
     // Show the current valure of thew parameter on the screen
     printf("\nThe value of the post processing function is set to: %d\n", curValue);
-}
\ No newline at end of file
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_ppselect(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -9,6 +9,7 @@
 
 // inclusions
 #include "pvcamutil.h"
+#include "pvcamcmd.h"
 
 
 // function prototypes
@@ -16,14 +17,9 @@
 // acquire image(s) from camera
 mxArray *pvcam_pp_show(int16 hcam);
 
-// global variables
-rs_bool	attr_avail;		// flag for available parameter
-uns16	attr_access;	// flag for read only, read/write
-uns16	attr_type;		// data type of parameter values
-uns32	attr_count;		// count for enumerated/char parameters
 
-// gateway routine
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+// command routine, also reached as pvcam('ppshow', ...)
+void pvcam_cmd_ppshow(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
 	// declarations
 	int16		hcam;		// camera handle
@@ -34,15 +30,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     }
 
 	// obtain camera handle
-	if (!mxIsNumeric(prhs[0])) {
-		mexErrMsgTxt("HCAM must be numeric");
-	}
-	else if (mxGetNumberOfElements(prhs[0]) != 1) {
-		mexErrMsgTxt("HCAM must be a scalar");
-	}
-	else {
-		hcam = (int16) mxGetScalar(prhs[0]);
-	}
+	hcam = pvcam_camera_handle(prhs[0]);
 
 	// check for open camera
 	// acquire image sequence
@@ -50,6 +38,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 	
 	if (pl_cam_check(hcam)) {
 		pvcam_pp_show(hcam);
+		pvcam_core_param_flush(hcam);
 	}
 	else {
 		pvcam_error(hcam, "HCAM is not a handle to an open camera");
@@ -169,4 +158,12 @@ mxArray *pvcam_pp_show(int16 hcam) {
                 functionID, functionIndex, functionName, minValue, maxValue, defValue, curValue);
         }
     }
-	}
\ No newline at end of file
+	}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_ppshow(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -0,0 +1,1335 @@
+/* Frame processing kernels for PVCAM MEX files */
+
+/* 10/18/26 */
+
+// inclusions
+#include "pvcamproc.h"
+#include "pvcamthread.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef PVCAM_SSE2
+#include <emmintrin.h>
+#endif
+
+
+// one region handed to the spatial contrast tasks
+typedef struct spatial_task {
+	const ulong64	*sum;			// integral image of pixel values
+	const ulong64	*sumsq;			// integral image of squared pixel values
+	flt32		*contrast;		// output for this region
+	uns32		width;			// binned serial size
+	uns32		height;			// binned parallel size
+	uns32		half;			// half window size
+} spatial_task;
+
+// one frame handed to the temporal contrast tasks
+typedef struct temporal_task {
+	pvcam_temporal	*temporal;	// running sums
+	const uns16	*frame;			// incoming frame
+	uns16		*oldest;		// frame leaving the window, NULL while filling
+	flt32		*contrast;		// output
+} temporal_task;
+
+// one frame handed to the HDR tasks
+typedef struct hdr_task {
+	pvcam_hdr	*hdr;			// running sums
+	const uns16	*frame;			// incoming frame, NULL when fusing
+	flt32		exposure;		// exposure of incoming frame (s)
+	flt32		*radiance;		// fused output, NULL when adding
+} hdr_task;
+
+// frames handed to the rebinning tasks
+typedef struct bin_task {
+	const uns16	*frame;			// input frames
+	void		*binned;		// output frames, uns16 or uns32
+	const rgn_type	*region;	// input regions
+	uns32		*row_start;		// first output row of each region within a frame
+	uns32		*in_offset;		// offset of each region within an input frame
+	uns32		*out_offset;	// offset of each region within an output frame
+	uns32		in_npixel;		// pixels per input frame
+	uns32		out_npixel;		// pixels per output frame
+	uns32		nrow;			// output rows over all frames
+	uns16		nregion;		// number of regions
+	uns16		sbin;			// serial binning factor
+	uns16		pbin;			// parallel binning factor
+	int			bin_mode;		// BIN_SUM or BIN_MEAN
+	rs_bool		wide;			// uns32 output
+} bin_task;
+
+// frames handed to the reorientation tasks
+typedef struct orient_task {
+	const uns16	*frame;			// input frames
+	uns16		*oriented;		// output frames
+	const rgn_type	*region;	// input regions
+	uns32		*band_start;	// first tile band of each region within a frame
+	uns32		*offset;		// offset of each region within a frame
+	uns32		npixel;			// pixels per frame
+	uns32		nband;			// tile bands over all frames
+	uns16		nregion;		// number of regions
+	int			orient;			// ORIENT_ code
+} orient_task;
+
+// frames handed to the unpacking tasks
+typedef struct pack_task {
+	const uns8	*packed;		// packed frames
+	uns16		*pixels;		// unpacked frames
+	uns32		npixel;			// pixels per frame
+	uns32		nblock;			// blocks per frame
+	uns32		depth;			// bits per pixel
+} pack_task;
+
+
+// function prototypes
+
+// order defects by frame offset
+static int defect_compare(const void *a, const void *b);
+
+// map sensor coordinates of defects onto frame offsets of the active regions
+rs_bool pvcam_defect_init(pvcam_defect *defect, uns16 nregion, const rgn_type *region,
+						  const double *coord, uns32 ncoord) {
+
+	// declarations
+	pvcam_defect_pixel	*pix;	// defect being filled in
+	uns8	*is_defect;			// map of defective pixels in frame
+	uns16	r;					// region counter
+	uns32	base;				// offset of region within frame
+	uns32	i;					// loop counter
+	uns32	j;					// neighbor counter
+	uns32	npixel;				// pixels per frame
+	uns32	s, p;				// binned coordinates within region
+	uns32	width, height;		// binned region size
+	long	ds[DEFECT_NEIGHBOR] = {-1, 1, 0, 0};	// neighbor serial steps
+	long	dp[DEFECT_NEIGHBOR] = {0, 0, -1, 1};	// neighbor parallel steps
+	long	ns, np;				// neighbor coordinates
+	double	cs, cp;				// sensor coordinates of defect
+
+	// coordinates are an ncoord x 2 column-major array of [serial parallel]
+	// overlapping regions can each hold the same defect
+	memset(defect, 0, sizeof(pvcam_defect));
+	npixel = pvcam_region_pixels(nregion, region);
+	is_defect = (uns8 *) calloc((size_t) npixel, sizeof(uns8));
+	defect->pixel = (pvcam_defect_pixel *) malloc(((size_t) ncoord * nregion + 1) * sizeof(pvcam_defect_pixel));
+	if ((is_defect == NULL) || (defect->pixel == NULL)) {
+		free((void *) is_defect);
+		pvcam_defect_free(defect);
+		return(0);
+	}
+
+	// keep defects that fall inside a region, once each
+	for (i = 0; i < ncoord; i++) {
+		cs = coord[i];
+		cp = coord[i + ncoord];
+		base = 0;
+		for (r = 0; r < nregion; r++) {
+			width = (region[r].s2 - region[r].s1 + 1) / region[r].sbin;
+			height = (region[r].p2 - region[r].p1 + 1) / region[r].pbin;
+			if ((cs >= region[r].s1) && (cp >= region[r].p1)) {
+				s = (uns32) (cs - region[r].s1) / region[r].sbin;
+				p = (uns32) (cp - region[r].p1) / region[r].pbin;
+				if ((s < width) && (p < height) && !is_defect[base + p * width + s]) {
+					is_defect[base + p * width + s] = 1;
+					defect->pixel[defect->ndefect].offset = base + p * width + s;
+					defect->pixel[defect->ndefect].nneighbor = 0;
+					defect->ndefect++;
+				}
+			}
+			base += width * height;
+		}
+	}
+	qsort((void *) defect->pixel, (size_t) defect->ndefect, sizeof(pvcam_defect_pixel), defect_compare);
+
+	// neighbors must be in the same region and not defective themselves
+	for (i = 0; i < defect->ndefect; i++) {
+		pix = &defect->pixel[i];
+		for (r = 0, base = 0; pix->offset >= base + pvcam_region_pixels(1, &region[r]); r++) {
+			base += pvcam_region_pixels(1, &region[r]);
+		}
+		width = (region[r].s2 - region[r].s1 + 1) / region[r].sbin;
+		height = (region[r].p2 - region[r].p1 + 1) / region[r].pbin;
+		s = (pix->offset - base) % width;
+		p = (pix->offset - base) / width;
+		for (j = 0; j < DEFECT_NEIGHBOR; j++) {
+			ns = (long) s + ds[j];
+			np = (long) p + dp[j];
+			if ((ns >= 0) && (np >= 0) && (ns < (long) width) && (np < (long) height) &&
+				!is_defect[base + (uns32) np * width + (uns32) ns]) {
+				pix->neighbor[pix->nneighbor++] = base + (uns32) np * width + (uns32) ns;
+			}
+		}
+	}
+	free((void *) is_defect);
+	return(1);
+}
+
+
+// replace defective pixels with mean of their good neighbors
+void pvcam_defect_correct(const pvcam_defect *defect, uns16 *frame) {
+
+	// declarations
+	const pvcam_defect_pixel	*pix;	// current defect
+	uns32	i;					// loop counter
+	uns32	j;					// neighbor counter
+	uns32	sum;				// neighbor sum
+
+	// defects without good neighbors are left alone
+	for (i = 0; i < defect->ndefect; i++) {
+		pix = &defect->pixel[i];
+		if (pix->nneighbor > 0) {
+			sum = 0;
+			for (j = 0; j < pix->nneighbor; j++) {
+				sum += frame[pix->neighbor[j]];
+			}
+			frame[pix->offset] = (uns16) ((sum + pix->nneighbor / 2) / pix->nneighbor);
+		}
+	}
+}
+
+
+// free defect list
+void pvcam_defect_free(pvcam_defect *defect) {
+	free((void *) defect->pixel);
+	memset(defect, 0, sizeof(pvcam_defect));
+}
+
+
+// order defects by frame offset
+static int defect_compare(const void *a, const void *b) {
+
+	// declarations
+	uns32	offset_a = ((const pvcam_defect_pixel *) a)->offset;
+	uns32	offset_b = ((const pvcam_defect_pixel *) b)->offset;
+
+	return((offset_a > offset_b) - (offset_a < offset_b));
+}
+
+
+// contrast from window sums
+static flt32 speckle_contrast(double sum, double sumsq, double count);
+
+// spatial contrast over a band of rows
+static void spatial_rows(void *task_ctx, uns32 task);
+
+// temporal contrast over a block of pixels
+static void temporal_pixels(void *task_ctx, uns32 task);
+
+// add frame to HDR sums, or fuse them, over a block of pixels
+static void hdr_pixels(void *task_ctx, uns32 task);
+
+// rebin a band of output rows
+static void bin_rows(void *task_ctx, uns32 task);
+
+// add bins of one input row into bin sums
+static void bin_add_row(uns32 *sum, const uns16 *row, uns32 nbin, uns16 sbin);
+
+// reorient a band of output columns of one region
+static void orient_band(void *task_ctx, uns32 task);
+
+// orientation swaps the serial and parallel sizes
+static rs_bool orient_swaps(int orient);
+
+// unpack one block of a frame
+static void unpack_block(void *task_ctx, uns32 task);
+
+
+// add 16-bit frame into 32-bit accumulator
+void pvcam_accum_add(uns32 *accum, const uns16 *frame, size_t npixel) {
+
+	// declarations
+	size_t	i = 0;			// loop counter
+#ifdef PVCAM_SSE2
+	__m128i	zero;			// zero register for widening
+	__m128i	pix;			// eight 16-bit pixels
+	__m128i	*acc_ptr;		// accumulator as vector pointer
+
+	// widen eight pixels at a time to 32 bits and add
+	zero = _mm_setzero_si128();
+	for (; i + 8 <= npixel; i += 8) {
+		pix = _mm_loadu_si128((const __m128i *) (frame + i));
+		acc_ptr = (__m128i *) (accum + i);
+		_mm_storeu_si128(acc_ptr, _mm_add_epi32(_mm_loadu_si128(acc_ptr), _mm_unpacklo_epi16(pix, zero)));
+		_mm_storeu_si128(acc_ptr + 1, _mm_add_epi32(_mm_loadu_si128(acc_ptr + 1), _mm_unpackhi_epi16(pix, zero)));
+	}
+#endif
+
+	// remaining pixels
+	for (; i < npixel; i++) {
+		accum[i] += frame[i];
+	}
+}
+
+
+// convert 32-bit accumulator into mean of nframe frames
+void pvcam_accum_mean(flt32 *mean, const uns32 *accum, size_t npixel, uns32 nframe) {
+
+	// declarations
+	size_t	i;				// loop counter
+	flt32	scale;			// reciprocal of frame count
+
+	// simple loop vectorizes under /O2
+	scale = 1.0f / (flt32) nframe;
+	for (i = 0; i < npixel; i++) {
+		mean[i] = (flt32) accum[i] * scale;
+	}
+}
+
+
+// allocate scratch for spatial speckle contrast
+rs_bool pvcam_spatial_init(pvcam_spatial *spatial, uns16 nregion, const rgn_type *region, uns32 window) {
+
+	// declarations
+	size_t	nmax = 0;		// largest integral image
+	size_t	nint;			// integral image size
+	uns16	i;				// loop counter
+
+	// integral images carry an extra row and column of zeros
+	memset(spatial, 0, sizeof(pvcam_spatial));
+	for (i = 0; i < nregion; i++) {
+		nint = (size_t) ((region[i].s2 - region[i].s1 + 1) / region[i].sbin + 1) *
+			(size_t) ((region[i].p2 - region[i].p1 + 1) / region[i].pbin + 1);
+		if (nint > nmax) {
+			nmax = nint;
+		}
+	}
+	spatial->nregion = nregion;
+	spatial->window = window | 1;
+	spatial->region = (rgn_type *) malloc((size_t) nregion * sizeof(rgn_type));
+	spatial->sum = (ulong64 *) malloc(nmax * sizeof(ulong64));
+	spatial->sumsq = (ulong64 *) malloc(nmax * sizeof(ulong64));
+	if ((spatial->region == NULL) || (spatial->sum == NULL) || (spatial->sumsq == NULL)) {
+		pvcam_spatial_free(spatial);
+		return(0);
+	}
+	memcpy(spatial->region, region, (size_t) nregion * sizeof(rgn_type));
+	return(1);
+}
+
+
+// spatial speckle contrast of each region over a sliding window
+void pvcam_spatial_contrast(pvcam_spatial *spatial, const uns16 *frame, flt32 *contrast) {
+
+	// declarations
+	spatial_task	task;		// region description for tasks
+	uns32	i;					// loop counter
+	uns32	s;					// serial index
+	uns32	p;					// parallel index
+	uns32	stride;				// integral image row length
+	ulong64	pix;				// pixel value
+	ulong64	row_sum;			// running row sum
+	ulong64	row_sumsq;			// running row sum of squares
+
+	for (i = 0; i < spatial->nregion; i++) {
+		task.width = (spatial->region[i].s2 - spatial->region[i].s1 + 1) / spatial->region[i].sbin;
+		task.height = (spatial->region[i].p2 - spatial->region[i].p1 + 1) / spatial->region[i].pbin;
+		task.half = spatial->window / 2;
+		task.sum = spatial->sum;
+		task.sumsq = spatial->sumsq;
+		task.contrast = contrast;
+
+		// build integral images, serial pixels are contiguous
+		stride = task.width + 1;
+		memset(spatial->sum, 0, (size_t) stride * sizeof(ulong64));
+		memset(spatial->sumsq, 0, (size_t) stride * sizeof(ulong64));
+		for (p = 0; p < task.height; p++) {
+			row_sum = 0;
+			row_sumsq = 0;
+			spatial->sum[(p + 1) * stride] = 0;
+			spatial->sumsq[(p + 1) * stride] = 0;
+			for (s = 0; s < task.width; s++) {
+				pix = frame[p * task.width + s];
+				row_sum += pix;
+				row_sumsq += pix * pix;
+				spatial->sum[(p + 1) * stride + s + 1] = spatial->sum[p * stride + s + 1] + row_sum;
+				spatial->sumsq[(p + 1) * stride + s + 1] = spatial->sumsq[p * stride + s + 1] + row_sumsq;
+			}
+		}
+
+		// evaluate windows in bands of rows
+		pvcam_parallel_for((task.height + SPECKLE_TILE - 1) / SPECKLE_TILE, spatial_rows, (void *) &task);
+		frame += task.width * task.height;
+		contrast += task.width * task.height;
+	}
+}
+
+
+// free spatial speckle scratch
+void pvcam_spatial_free(pvcam_spatial *spatial) {
+	free((void *) spatial->region);
+	free((void *) spatial->sum);
+	free((void *) spatial->sumsq);
+	memset(spatial, 0, sizeof(pvcam_spatial));
+}
+
+
+// allocate running sums for temporal speckle contrast
+rs_bool pvcam_temporal_init(pvcam_temporal *temporal, uns32 npixel, uns32 window) {
+	memset(temporal, 0, sizeof(pvcam_temporal));
+	temporal->npixel = npixel;
+	temporal->window = (window > 1) ? window : 2;
+	temporal->ring = (uns16 *) malloc((size_t) temporal->window * npixel * sizeof(uns16));
+	temporal->sum = (uns32 *) calloc((size_t) npixel, sizeof(uns32));
+	temporal->sumsq = (ulong64 *) calloc((size_t) npixel, sizeof(ulong64));
+	if ((temporal->ring == NULL) || (temporal->sum == NULL) || (temporal->sumsq == NULL)) {
+		pvcam_temporal_free(temporal);
+		return(0);
+	}
+	return(1);
+}
+
+
+// add frame to temporal window and compute per-pixel contrast
+void pvcam_temporal_contrast(pvcam_temporal *temporal, const uns16 *frame, flt32 *contrast) {
+
+	// declarations
+	temporal_task	task;		// frame description for tasks
+
+	// slot being overwritten holds the frame leaving the window once full
+	task.temporal = temporal;
+	task.frame = frame;
+	task.oldest = (temporal->nframe == temporal->window) ?
+		temporal->ring + (size_t) temporal->head * temporal->npixel : NULL;
+	task.contrast = contrast;
+	if (temporal->nframe < temporal->window) {
+		temporal->nframe++;
+	}
+
+	// update sums and contrast in blocks of pixels
+	pvcam_parallel_for((temporal->npixel + TEMPORAL_BLOCK - 1) / TEMPORAL_BLOCK, temporal_pixels, (void *) &task);
+	memcpy(temporal->ring + (size_t) temporal->head * temporal->npixel, frame, (size_t) temporal->npixel * sizeof(uns16));
+	temporal->head = (temporal->head + 1) % temporal->window;
+}
+
+
+// free temporal speckle running sums
+void pvcam_temporal_free(pvcam_temporal *temporal) {
+	free((void *) temporal->ring);
+	free((void *) temporal->sum);
+	free((void *) temporal->sumsq);
+	memset(temporal, 0, sizeof(pvcam_temporal));
+}
+
+
+// allocate running sums for HDR fusion
+rs_bool pvcam_hdr_init(pvcam_hdr *hdr, uns32 npixel, flt32 bias, flt32 saturation) {
+	memset(hdr, 0, sizeof(pvcam_hdr));
+	hdr->npixel = npixel;
+	hdr->bias = bias;
+	hdr->saturation = saturation;
+	hdr->signal = (flt32 *) calloc((size_t) npixel, sizeof(flt32));
+	hdr->exposure = (flt32 *) calloc((size_t) npixel, sizeof(flt32));
+	if ((hdr->signal == NULL) || (hdr->exposure == NULL)) {
+		pvcam_hdr_free(hdr);
+		return(0);
+	}
+	return(1);
+}
+
+
+// add frame of given exposure (s) to current bracket
+// each unsaturated sample is weighted by its exposure, which for shot noise
+// makes sum(signal) / sum(exposure) the maximum likelihood radiance
+void pvcam_hdr_add(pvcam_hdr *hdr, const uns16 *frame, flt32 exposure) {
+
+	// declarations
+	hdr_task	task;			// frame description for tasks
+
+	task.hdr = hdr;
+	task.frame = frame;
+	task.exposure = exposure;
+	task.radiance = NULL;
+	pvcam_parallel_for((hdr->npixel + HDR_BLOCK - 1) / HDR_BLOCK, hdr_pixels, (void *) &task);
+	if ((hdr->nframe == 0) || (exposure < hdr->min_exposure)) {
+		hdr->min_exposure = exposure;
+	}
+	hdr->nframe++;
+}
+
+
+// fuse current bracket into radiance (DN/s) and start a new bracket
+// pixels saturated in every frame get the lower bound from the shortest exposure
+void pvcam_hdr_fuse(pvcam_hdr *hdr, flt32 *radiance) {
+
+	// declarations
+	hdr_task	task;			// output description for tasks
+
+	task.hdr = hdr;
+	task.frame = NULL;
+	task.exposure = 0.0f;
+	task.radiance = radiance;
+	pvcam_parallel_for((hdr->npixel + HDR_BLOCK - 1) / HDR_BLOCK, hdr_pixels, (void *) &task);
+	memset(hdr->signal, 0, (size_t) hdr->npixel * sizeof(flt32));
+	memset(hdr->exposure, 0, (size_t) hdr->npixel * sizeof(flt32));
+	hdr->nframe = 0;
+}
+
+
+// free HDR running sums
+void pvcam_hdr_free(pvcam_hdr *hdr) {
+	free((void *) hdr->signal);
+	free((void *) hdr->exposure);
+	memset(hdr, 0, sizeof(pvcam_hdr));
+}
+
+
+// sub-pixel centroid of region pixels in sensor coordinates, 0 if region is flat
+// intensity-weighted mean position above the region minimum, binned pixels
+// counted at the centre of the sensor pixels they cover
+rs_bool pvcam_centroid_region(const uns16 *pixels, const rgn_type *roi, pvcam_centroid *centroid) {
+
+	// declarations
+	double	sum = 0.0;			// weight sum
+	double	sum_s = 0.0;		// serial moment
+	double	sum_p = 0.0;		// parallel moment
+	double	row_sum;			// weight sum of current row
+	double	weight;				// pixel above background
+	uns16	low;				// lowest pixel
+	uns32	npixel;				// pixels in region
+	uns32	i;					// pixel counter
+	uns32	s, p;				// binned coordinates within region
+	uns32	width, height;		// binned region size
+
+	width = (roi->s2 - roi->s1 + 1) / roi->sbin;
+	height = (roi->p2 - roi->p1 + 1) / roi->pbin;
+	npixel = width * height;
+	memset(centroid, 0, sizeof(pvcam_centroid));
+	if (npixel == 0) {
+		return(0);
+	}
+	low = pixels[0];
+	for (i = 1; i < npixel; i++) {
+		if (pixels[i] < low) {
+			low = pixels[i];
+		}
+	}
+	for (p = 0; p < height; p++) {
+		row_sum = 0.0;
+		for (s = 0; s < width; s++) {
+			weight = (double) (pixels[p * width + s] - low);
+			row_sum += weight;
+			sum_s += weight * (double) s;
+		}
+		sum += row_sum;
+		sum_p += row_sum * (double) p;
+	}
+	centroid->background = (double) low;
+	centroid->intensity = sum;
+	if (sum <= 0.0) {
+		return(0);
+	}
+	centroid->x = (double) roi->s1 + (sum_s / sum + 0.5) * (double) roi->sbin - 0.5;
+	centroid->y = (double) roi->p1 + (sum_p / sum + 0.5) * (double) roi->pbin - 0.5;
+	return(1);
+}
+
+
+// layout of regions rebinned by a further sbin x pbin, partial bins dropped
+// regions smaller than one bin come out empty (s2 < s1 or p2 < p1)
+void pvcam_bin_regions(uns16 nregion, const rgn_type *region, uns16 sbin, uns16 pbin, rgn_type *binned) {
+
+	// declarations
+	uns16	i;				// region counter
+	uns32	width, height;	// rebinned region size
+
+	for (i = 0; i < nregion; i++) {
+		width = (uns32) ((region[i].s2 - region[i].s1 + 1) / region[i].sbin) / sbin;
+		height = (uns32) ((region[i].p2 - region[i].p1 + 1) / region[i].pbin) / pbin;
+		binned[i] = region[i];
+		binned[i].sbin = (uns16) (region[i].sbin * sbin);
+		binned[i].pbin = (uns16) (region[i].pbin * pbin);
+		binned[i].s2 = (uns16) (region[i].s1 + width * binned[i].sbin - 1);
+		binned[i].p2 = (uns16) (region[i].p1 + height * binned[i].pbin - 1);
+	}
+}
+
+
+// rebin frames laid out over regions into uns16 (clipped) or, if wide, uns32 pixels
+// every output row is independent, so bands of rows across all frames are spread over
+// the worker threads; sums stay within 32 bits while sbin * pbin <= 65536
+rs_bool pvcam_bin_frames(const uns16 *frame, uns32 nframe, uns16 nregion, const rgn_type *region,
+						 uns16 sbin, uns16 pbin, int bin_mode, rs_bool wide, void *binned) {
+
+	// declarations
+	bin_task	task;			// shared task description
+	uns16	i;					// region counter
+	uns32	width, height;		// input region size
+
+	task.row_start = (uns32 *) malloc(3 * ((size_t) nregion + 1) * sizeof(uns32));
+	if (task.row_start == NULL) {
+		return(0);
+	}
+	task.in_offset = task.row_start + nregion + 1;
+	task.out_offset = task.in_offset + nregion + 1;
+	task.row_start[0] = task.in_offset[0] = task.out_offset[0] = 0;
+	for (i = 0; i < nregion; i++) {
+		width = (uns32) ((region[i].s2 - region[i].s1 + 1) / region[i].sbin);
+		height = (uns32) ((region[i].p2 - region[i].p1 + 1) / region[i].pbin);
+		task.row_start[i + 1] = task.row_start[i] + height / pbin;
+		task.in_offset[i + 1] = task.in_offset[i] + width * height;
+		task.out_offset[i + 1] = task.out_offset[i] + (width / sbin) * (height / pbin);
+	}
+	task.frame = frame;
+	task.binned = binned;
+	task.region = region;
+	task.in_npixel = task.in_offset[nregion];
+	task.out_npixel = task.out_offset[nregion];
+	task.nrow = nframe * task.row_start[nregion];
+	task.nregion = nregion;
+	task.sbin = sbin;
+	task.pbin = pbin;
+	task.bin_mode = bin_mode;
+	task.wide = wide;
+	pvcam_parallel_for((task.nrow + BIN_ROWS - 1) / BIN_ROWS, bin_rows, (void *) &task);
+	free((void *) task.row_start);
+	return(1);
+}
+
+
+// orientation code of name ('none', 'transpose', 'rot90', ...), -1 if not recognized
+int pvcam_orient_code(const char *name) {
+
+	// declarations
+	static const char	*orient_name[] = {"none", "transpose", "rot90", "rot180", "rot270", "fliplr", "flipud"};
+	int		i;				// code counter
+
+	for (i = ORIENT_NONE; i <= ORIENT_FLIPUD; i++) {
+		if (strcmp(name, orient_name[i]) == 0) {
+			return(i);
+		}
+	}
+	return(-1);
+}
+
+
+// reorient each region of frames laid out over regions
+// a region is a serial-fastest W x H array, as reshape(DATA, W, H) in MATLAB, and
+// comes out as the matching MATLAB operation (A.', rot90(A), fliplr(A), ...) would
+// leave it; bands of ORIENT_TILE output columns over all frames go to the workers
+rs_bool pvcam_orient_frames(const uns16 *frame, uns32 nframe, uns16 nregion, const rgn_type *region,
+							int orient, uns16 *oriented) {
+
+	// declarations
+	orient_task	task;			// shared task description
+	uns16	i;					// region counter
+	uns32	width, height;		// input region size
+	uns32	out_cols;			// output columns of region
+
+	task.band_start = (uns32 *) malloc(2 * ((size_t) nregion + 1) * sizeof(uns32));
+	if (task.band_start == NULL) {
+		return(0);
+	}
+	task.offset = task.band_start + nregion + 1;
+	task.band_start[0] = task.offset[0] = 0;
+	for (i = 0; i < nregion; i++) {
+		width = (uns32) ((region[i].s2 - region[i].s1 + 1) / region[i].sbin);
+		height = (uns32) ((region[i].p2 - region[i].p1 + 1) / region[i].pbin);
+		out_cols = orient_swaps(orient) ? width : height;
+		task.band_start[i + 1] = task.band_start[i] + (out_cols + ORIENT_TILE - 1) / ORIENT_TILE;
+		task.offset[i + 1] = task.offset[i] + width * height;
+	}
+	task.frame = frame;
+	task.oriented = oriented;
+	task.region = region;
+	task.npixel = task.offset[nregion];
+	task.nband = nframe * task.band_start[nregion];
+	task.nregion = nregion;
+	task.orient = orient;
+	pvcam_parallel_for(task.nband, orient_band, (void *) &task);
+	free((void *) task.band_start);
+	return(1);
+}
+
+
+// bytes taken by npixel pixels packed to depth bits
+size_t pvcam_packed_bytes(size_t npixel, uns32 depth) {
+	return((npixel * depth + 7) / 8);
+}
+
+
+// pack pixels into depth-bit (0 to 16) fields, least significant bit first, clipping larger pixels
+// eight pixels fill exactly depth bytes, so for even depths each group of eight is
+// merged in SSE2 registers into two 4 * depth bit halves stored depth / 2 bytes apart;
+// groups whose 8-byte stores would run past the output, and odd depths, go bit by bit
+void pvcam_pack_pixels(const uns16 *pixels, size_t npixel, uns32 depth, uns8 *packed) {
+
+	// declarations
+	size_t	i = 0;			// pixel counter
+	size_t	nbyte;			// packed bytes
+	uns8	*out;			// next output byte
+	uns32	limit;			// largest pixel that fits
+	uns32	nbit;			// bits held in acc
+	ulong64	acc;			// bits not yet stored
+#ifdef PVCAM_SSE2
+	__m128i	pix;			// eight pixels, merged in place
+	__m128i	max_pix;		// limit in every 16-bit lane
+	__m128i	low16;			// low half of each 32-bit lane
+	__m128i	low32;			// low half of each 64-bit lane
+	__m128i	shift1;			// depth as shift count
+	__m128i	shift2;			// twice depth as shift count
+	uns32	half;			// bytes per 64-bit half
+#endif
+
+	nbyte = pvcam_packed_bytes(npixel, depth);
+	limit = (1u << depth) - 1;
+	if (depth == 16) {
+		memcpy(packed, pixels, npixel * sizeof(uns16));
+		return;
+	}
+#ifdef PVCAM_SSE2
+	if ((depth > 0) && (depth % 2 == 0)) {
+		half = depth / 2;
+		max_pix = _mm_set1_epi16((short) limit);
+		low16 = _mm_set1_epi32(0xFFFF);
+		low32 = _mm_set_epi32(0, -1, 0, -1);
+		shift1 = _mm_cvtsi32_si128((int) depth);
+		shift2 = _mm_cvtsi32_si128((int) (2 * depth));
+		for (; (i + 8 <= npixel) && ((i / 8) * depth + half + 8 <= nbyte); i += 8) {
+			pix = _mm_loadu_si128((const __m128i *) (pixels + i));
+			pix = _mm_subs_epu16(pix, _mm_subs_epu16(pix, max_pix));
+			pix = _mm_or_si128(_mm_and_si128(pix, low16), _mm_sll_epi32(_mm_srli_epi32(pix, 16), shift1));
+			pix = _mm_or_si128(_mm_and_si128(pix, low32), _mm_sll_epi64(_mm_srli_epi64(pix, 32), shift2));
+			out = packed + (i / 8) * depth;
+			_mm_storel_epi64((__m128i *) out, pix);
+			_mm_storel_epi64((__m128i *) (out + half), _mm_srli_si128(pix, 8));
+		}
+	}
+#endif
+
+	// remaining pixels start on a byte boundary
+	out = packed + (i / 8) * depth;
+	acc = 0;
+	nbit = 0;
+	for (; i < npixel; i++) {
+		acc |= (ulong64) ((pixels[i] < limit) ? pixels[i] : limit) << nbit;
+		for (nbit += depth; nbit >= 8; nbit -= 8) {
+			*out++ = (uns8) acc;
+			acc >>= 8;
+		}
+	}
+	if (nbit > 0) {
+		*out = (uns8) acc;
+	}
+}
+
+
+// unpack depth-bit (0 to 16) fields into pixels
+// the reverse of pvcam_pack_pixels, splitting 64-bit halves into 32-bit then 16-bit lanes
+void pvcam_unpack_pixels(const uns8 *packed, size_t npixel, uns32 depth, uns16 *pixels) {
+
+	// declarations
+	const uns8	*in;		// next input byte
+	size_t	i = 0;			// pixel counter
+	size_t	nbyte;			// packed bytes
+	uns32	limit;			// field mask
+	uns32	nbit;			// bits held in acc
+	ulong64	acc;			// bits not yet unpacked
+#ifdef PVCAM_SSE2
+	__m128i	pix;			// eight fields, split in place
+	__m128i	mask1;			// depth-bit mask in every 32-bit lane
+	__m128i	mask2;			// twice depth-bit mask in every 64-bit lane
+	__m128i	shift1;			// depth as shift count
+	__m128i	shift2;			// twice depth as shift count
+	uns32	half;			// bytes per 64-bit half
+#endif
+
+	nbyte = pvcam_packed_bytes(npixel, depth);
+	limit = (1u << depth) - 1;
+	if (depth == 16) {
+		memcpy(pixels, packed, npixel * sizeof(uns16));
+		return;
+	}
+#ifdef PVCAM_SSE2
+	if ((depth > 0) && (depth % 2 == 0)) {
+		half = depth / 2;
+		mask1 = _mm_set1_epi32((int) limit);
+		mask2 = _mm_set_epi32(0, (int) ((1u << (2 * depth)) - 1), 0, (int) ((1u << (2 * depth)) - 1));
+		shift1 = _mm_cvtsi32_si128((int) depth);
+		shift2 = _mm_cvtsi32_si128((int) (2 * depth));
+		for (; (i + 8 <= npixel) && ((i / 8) * depth + half + 8 <= nbyte); i += 8) {
+			in = packed + (i / 8) * depth;
+			pix = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *) in), _mm_loadl_epi64((const __m128i *) (in + half)));
+			pix = _mm_or_si128(_mm_and_si128(pix, mask2), _mm_slli_epi64(_mm_and_si128(_mm_srl_epi64(pix, shift2), mask2), 32));
+			pix = _mm_or_si128(_mm_and_si128(pix, mask1), _mm_slli_epi32(_mm_and_si128(_mm_srl_epi32(pix, shift1), mask1), 16));
+			_mm_storeu_si128((__m128i *) (pixels + i), pix);
+		}
+	}
+#endif
+
+	// remaining pixels start on a byte boundary
+	in = packed + (i / 8) * depth;
+	acc = 0;
+	nbit = 0;
+	for (; i < npixel; i++) {
+		for (; nbit < depth; nbit += 8) {
+			acc |= (ulong64) *in++ << nbit;
+		}
+		pixels[i] = (uns16) (acc & limit);
+		acc >>= depth;
+		nbit -= depth;
+	}
+}
+
+
+// unpack frames that each start on a byte boundary
+// blocks of PACK_BLOCK pixels also start on byte boundaries and go to the workers
+void pvcam_unpack_frames(const uns8 *packed, uns32 nframe, uns32 npixel, uns32 depth, uns16 *pixels) {
+
+	// declarations
+	pack_task	task;			// shared task description
+
+	task.packed = packed;
+	task.pixels = pixels;
+	task.npixel = npixel;
+	task.nblock = (npixel + PACK_BLOCK - 1) / PACK_BLOCK;
+	task.depth = depth;
+	pvcam_parallel_for(nframe * task.nblock, unpack_block, (void *) &task);
+}
+
+
+// sum, lowest and highest of npixel pixels in one pass
+// SSE2 has signed 16-bit min, max and multiply-add only, so pixels are offset by 32768 first
+void pvcam_summarize(const uns16 *pixels, uns32 npixel, pvcam_summary *summary) {
+
+	// declarations
+	long64	total;			// sum of pixels
+	uns16	lo, hi;			// range so far
+	uns32	i = 0;			// loop counter
+#ifdef PVCAM_SSE2
+	__m128i	bias;			// 32768 in every lane
+	__m128i	ones;			// multiplier turning madd into pairwise add
+	__m128i	pix;			// eight offset pixels
+	__m128i	vmin, vmax;		// offset range per lane
+	__m128i	vsum;			// pairwise sums per lane, folded every SUMMARY_SPAN steps
+	int32	lane[4];		// lanes of vsum
+	int16	range[8];		// lanes of vmin or vmax
+	uns32	j;				// lane counter
+	uns32	nstep;			// steps since last fold
+#endif
+
+	total = 0;
+	lo = 0xFFFF;
+	hi = 0;
+#ifdef PVCAM_SSE2
+	if (npixel >= 8) {
+		bias = _mm_set1_epi16((short) 0x8000);
+		ones = _mm_set1_epi16(1);
+		vmin = _mm_set1_epi16(0x7FFF);
+		vmax = _mm_set1_epi16((short) 0x8000);
+		vsum = _mm_setzero_si128();
+		nstep = 0;
+		for (; i + 8 <= npixel; i += 8) {
+			pix = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (pixels + i)), bias);
+			vmin = _mm_min_epi16(vmin, pix);
+			vmax = _mm_max_epi16(vmax, pix);
+			vsum = _mm_add_epi32(vsum, _mm_madd_epi16(pix, ones));
+			if (++nstep == SUMMARY_SPAN) {
+				_mm_storeu_si128((__m128i *) lane, vsum);
+				total += (long64) lane[0] + lane[1] + lane[2] + lane[3];
+				vsum = _mm_setzero_si128();
+				nstep = 0;
+			}
+		}
+		_mm_storeu_si128((__m128i *) lane, vsum);
+		total += (long64) lane[0] + lane[1] + lane[2] + lane[3] + (long64) i * 0x8000;
+		_mm_storeu_si128((__m128i *) range, _mm_xor_si128(vmin, bias));
+		for (j = 0; j < 8; j++) {
+			lo = ((uns16) range[j] < lo) ? (uns16) range[j] : lo;
+		}
+		_mm_storeu_si128((__m128i *) range, _mm_xor_si128(vmax, bias));
+		for (j = 0; j < 8; j++) {
+			hi = ((uns16) range[j] > hi) ? (uns16) range[j] : hi;
+		}
+	}
+#endif
+
+	// remaining pixels
+	for (; i < npixel; i++) {
+		total += pixels[i];
+		lo = (pixels[i] < lo) ? pixels[i] : lo;
+		hi = (pixels[i] > hi) ? pixels[i] : hi;
+	}
+	summary->sum = (double) total;
+	summary->npixel = npixel;
+	summary->min = lo;
+	summary->max = hi;
+}
+
+
+// subtract level from pixels in place, clipping at 0
+void pvcam_offset_subtract(uns16 *pixels, uns32 npixel, uns16 level) {
+
+	// declarations
+	uns32	i = 0;			// loop counter
+#ifdef PVCAM_SSE2
+	__m128i	vlevel;			// level in every lane
+
+	vlevel = _mm_set1_epi16((short) level);
+	for (; i + 8 <= npixel; i += 8) {
+		_mm_storeu_si128((__m128i *) (pixels + i),
+			_mm_subs_epu16(_mm_loadu_si128((const __m128i *) (pixels + i)), vlevel));
+	}
+#endif
+
+	// remaining pixels
+	for (; i < npixel; i++) {
+		pixels[i] = (pixels[i] > level) ? (uns16) (pixels[i] - level) : 0;
+	}
+}
+
+
+// sum of absolute differences between two frames of npixel pixels
+// |a - b| is the saturating a - b or'ed with the saturating b - a, widened to 32 bits to sum
+double pvcam_frame_difference(const uns16 *pixels, const uns16 *previous, uns32 npixel) {
+
+	// declarations
+	ulong64	total;			// sum of differences
+	uns32	i = 0;			// loop counter
+#ifdef PVCAM_SSE2
+	__m128i	a, b;			// eight pixels of each frame
+	__m128i	diff;			// absolute differences
+	__m128i	vsum;			// sums per lane, folded every SUMMARY_SPAN steps
+	__m128i	zero;			// zero for widening
+	uns32	lane[4];		// lanes of vsum
+	uns32	nstep;			// steps since last fold
+#endif
+
+	total = 0;
+#ifdef PVCAM_SSE2
+	zero = _mm_setzero_si128();
+	vsum = _mm_setzero_si128();
+	nstep = 0;
+	for (; i + 8 <= npixel; i += 8) {
+		a = _mm_loadu_si128((const __m128i *) (pixels + i));
+		b = _mm_loadu_si128((const __m128i *) (previous + i));
+		diff = _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a));
+		vsum = _mm_add_epi32(vsum, _mm_add_epi32(_mm_unpacklo_epi16(diff, zero), _mm_unpackhi_epi16(diff, zero)));
+		if (++nstep == SUMMARY_SPAN) {
+			_mm_storeu_si128((__m128i *) lane, vsum);
+			total += (ulong64) lane[0] + lane[1] + lane[2] + lane[3];
+			vsum = _mm_setzero_si128();
+			nstep = 0;
+		}
+	}
+	_mm_storeu_si128((__m128i *) lane, vsum);
+	total += (ulong64) lane[0] + lane[1] + lane[2] + lane[3];
+#endif
+
+	// remaining pixels
+	for (; i < npixel; i++) {
+		total += (pixels[i] > previous[i]) ? pixels[i] - previous[i] : previous[i] - pixels[i];
+	}
+	return((double) total);
+}
+
+
+// contrast from window sums
+static flt32 speckle_contrast(double sum, double sumsq, double count) {
+
+	// declarations
+	double	mean;			// window mean
+	double	var;			// window variance
+
+	mean = sum / count;
+	var = sumsq / count - mean * mean;
+	if ((mean <= 0.0) || (var <= 0.0)) {
+		return(0.0f);
+	}
+	return((flt32) (sqrt(var) / mean));
+}
+
+
+// spatial contrast over a band of rows
+static void spatial_rows(void *task_ctx, uns32 task) {
+
+	// declarations
+	spatial_task	*region = (spatial_task *) task_ctx;
+	uns32	p;					// parallel index
+	uns32	p_end;				// last row of band
+	uns32	s;					// serial index
+	uns32	s0, s1, p0, p1;		// window corners, clipped to region
+	uns32	stride;				// integral image row length
+	double	sum;				// window sum
+	double	sumsq;				// window sum of squares
+
+	// windows are clipped at the region edges
+	stride = region->width + 1;
+	p_end = (task + 1) * SPECKLE_TILE;
+	if (p_end > region->height) {
+		p_end = region->height;
+	}
+	for (p = task * SPECKLE_TILE; p < p_end; p++) {
+		p0 = (p > region->half) ? p - region->half : 0;
+		p1 = (p + region->half + 1 < region->height) ? p + region->half + 1 : region->height;
+		for (s = 0; s < region->width; s++) {
+			s0 = (s > region->half) ? s - region->half : 0;
+			s1 = (s + region->half + 1 < region->width) ? s + region->half + 1 : region->width;
+			sum = (double) (region->sum[p1 * stride + s1] - region->sum[p0 * stride + s1] -
+				region->sum[p1 * stride + s0] + region->sum[p0 * stride + s0]);
+			sumsq = (double) (region->sumsq[p1 * stride + s1] - region->sumsq[p0 * stride + s1] -
+				region->sumsq[p1 * stride + s0] + region->sumsq[p0 * stride + s0]);
+			region->contrast[p * region->width + s] = speckle_contrast(sum, sumsq, (double) ((p1 - p0) * (s1 - s0)));
+		}
+	}
+}
+
+
+// temporal contrast over a block of pixels
+static void temporal_pixels(void *task_ctx, uns32 task) {
+
+	// declarations
+	temporal_task	*job = (temporal_task *) task_ctx;
+	pvcam_temporal	*temporal = job->temporal;
+	uns32	i;					// pixel index
+	uns32	i_end;				// end of block
+	ulong64	pix;				// pixel value
+
+	i_end = (task + 1) * TEMPORAL_BLOCK;
+	if (i_end > temporal->npixel) {
+		i_end = temporal->npixel;
+	}
+	for (i = task * TEMPORAL_BLOCK; i < i_end; i++) {
+		if (job->oldest != NULL) {
+			pix = job->oldest[i];
+			temporal->sum[i] -= (uns32) pix;
+			temporal->sumsq[i] -= pix * pix;
+		}
+		pix = job->frame[i];
+		temporal->sum[i] += (uns32) pix;
+		temporal->sumsq[i] += pix * pix;
+		job->contrast[i] = speckle_contrast((double) temporal->sum[i], (double) temporal->sumsq[i], (double) temporal->nframe);
+	}
+}
+
+
+// add frame to HDR sums, or fuse them, over a block of pixels
+static void hdr_pixels(void *task_ctx, uns32 task) {
+
+	// declarations
+	hdr_task	*job = (hdr_task *) task_ctx;
+	pvcam_hdr	*hdr = job->hdr;
+	flt32	floor_value;		// radiance of a pixel saturated in every frame
+	flt32	pix;				// pixel value
+	uns32	i;					// pixel index
+	uns32	i_end;				// end of block
+#ifdef PVCAM_SSE2
+	__m128i	zero;				// zero register for widening
+	__m128i	raw;				// eight 16-bit pixels
+	__m128	val[2];				// pixels as single precision
+	__m128	keep;				// mask of unsaturated pixels
+	__m128	bias;				// camera offset
+	__m128	sat;				// saturation level
+	__m128	exposure;			// frame exposure
+	int		j;					// half counter
+#endif
+
+	i = task * HDR_BLOCK;
+	i_end = (task + 1) * HDR_BLOCK;
+	if (i_end > hdr->npixel) {
+		i_end = hdr->npixel;
+	}
+
+	// fusing divides through, simple loop vectorizes under /O2
+	if (job->frame == NULL) {
+		floor_value = (hdr->nframe > 0) ? (hdr->saturation - hdr->bias) / hdr->min_exposure : 0.0f;
+		for (; i < i_end; i++) {
+			job->radiance[i] = (hdr->exposure[i] > 0.0f) ? hdr->signal[i] / hdr->exposure[i] : floor_value;
+		}
+		return;
+	}
+
+#ifdef PVCAM_SSE2
+	// widen eight pixels to single precision and mask out saturated ones
+	zero = _mm_setzero_si128();
+	bias = _mm_set1_ps(hdr->bias);
+	sat = _mm_set1_ps(hdr->saturation);
+	exposure = _mm_set1_ps(job->exposure);
+	for (; i + 8 <= i_end; i += 8) {
+		raw = _mm_loadu_si128((const __m128i *) (job->frame + i));
+		val[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(raw, zero));
+		val[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(raw, zero));
+		for (j = 0; j < 2; j++) {
+			keep = _mm_cmplt_ps(val[j], sat);
+			_mm_storeu_ps(hdr->signal + i + 4 * j, _mm_add_ps(_mm_loadu_ps(hdr->signal + i + 4 * j),
+				_mm_and_ps(keep, _mm_sub_ps(val[j], bias))));
+			_mm_storeu_ps(hdr->exposure + i + 4 * j, _mm_add_ps(_mm_loadu_ps(hdr->exposure + i + 4 * j),
+				_mm_and_ps(keep, exposure)));
+		}
+	}
+#endif
+
+	// remaining pixels
+	for (; i < i_end; i++) {
+		pix = (flt32) job->frame[i];
+		if (pix < hdr->saturation) {
+			hdr->signal[i] += pix - hdr->bias;
+			hdr->exposure[i] += job->exposure;
+		}
+	}
+}
+
+
+// rebin a band of output rows
+// each row is summed BIN_SPAN bins at a time in a small buffer on the stack
+static void bin_rows(void *task_ctx, uns32 task) {
+
+	// declarations
+	bin_task	*job = (bin_task *) task_ctx;
+	const uns16	*src;			// first input row of current output row
+	uns16	*out16;				// uns16 output row
+	uns32	sum[BIN_SPAN];		// bin sums of current span
+	uns32	*out32;				// uns32 output row
+	uns32	a;					// input row within bin
+	uns32	g;					// output row over all frames
+	uns32	g_end;				// end of band
+	uns32	half;				// half bin size for rounding
+	uns32	j;					// bin within span
+	uns32	k;					// frame of output row
+	uns32	nbin;				// bins in current span
+	uns32	nwin;				// input pixels per bin
+	uns32	o;					// first bin of current span
+	uns32	q;					// output row within region
+	uns32	r;					// region of output row
+	uns32	rows_per_frame;		// output rows per frame
+	uns32	value;				// output value
+	uns32	width;				// input region width
+	uns32	out_width;			// output region width
+
+	rows_per_frame = job->row_start[job->nregion];
+	nwin = (uns32) job->sbin * job->pbin;
+	half = nwin / 2;
+	g_end = (task + 1) * BIN_ROWS;
+	if (g_end > job->nrow) {
+		g_end = job->nrow;
+	}
+	for (g = task * BIN_ROWS; g < g_end; g++) {
+
+		// locate output row in its frame and region
+		k = g / rows_per_frame;
+		q = g % rows_per_frame;
+		for (r = 0; q >= job->row_start[r + 1]; r++) {
+		}
+		q -= job->row_start[r];
+		width = (uns32) ((job->region[r].s2 - job->region[r].s1 + 1) / job->region[r].sbin);
+		out_width = width / job->sbin;
+		src = job->frame + (size_t) k * job->in_npixel + job->in_offset[r] + (size_t) q * job->pbin * width;
+		out16 = (uns16 *) job->binned + (size_t) k * job->out_npixel + job->out_offset[r] + (size_t) q * out_width;
+		out32 = (uns32 *) job->binned + (size_t) k * job->out_npixel + job->out_offset[r] + (size_t) q * out_width;
+
+		// sum pbin input rows a span at a time, then scale and store
+		for (o = 0; o < out_width; o += nbin) {
+			nbin = (out_width - o < BIN_SPAN) ? out_width - o : BIN_SPAN;
+			memset(sum, 0, (size_t) nbin * sizeof(uns32));
+			for (a = 0; a < job->pbin; a++) {
+				bin_add_row(sum, src + (size_t) a * width + (size_t) o * job->sbin, nbin, job->sbin);
+			}
+			for (j = 0; j < nbin; j++) {
+				value = (job->bin_mode == BIN_MEAN) ? (sum[j] + half) / nwin : sum[j];
+				if (job->wide) {
+					out32[o + j] = value;
+				}
+				else {
+					out16[o + j] = (value > 0xFFFF) ? 0xFFFF : (uns16) value;
+				}
+			}
+		}
+	}
+}
+
+
+// add bins of one input row into bin sums
+// unbinned and 2x serial binning, the common cases, go eight pixels at a time
+static void bin_add_row(uns32 *sum, const uns16 *row, uns32 nbin, uns16 sbin) {
+
+	// declarations
+	uns32	b;					// pixel within bin
+	uns32	j = 0;				// bin counter
+	uns32	total;				// sum of one bin
+#ifdef PVCAM_SSE2
+	__m128i	low;				// mask of low 16 bits in each 32-bit lane
+	__m128i	pix;				// eight 16-bit pixels
+	__m128i	*sum_ptr;			// bin sums as vector pointer
+#endif
+
+	if (sbin == 1) {
+		pvcam_accum_add(sum, row, nbin);
+		return;
+	}
+#ifdef PVCAM_SSE2
+	// neighboring pixel pairs sit in one 32-bit lane, split and add them
+	if (sbin == 2) {
+		low = _mm_set1_epi32(0xFFFF);
+		for (; j + 4 <= nbin; j += 4) {
+			pix = _mm_loadu_si128((const __m128i *) (row + 2 * j));
+			sum_ptr = (__m128i *) (sum + j);
+			_mm_storeu_si128(sum_ptr, _mm_add_epi32(_mm_loadu_si128(sum_ptr),
+				_mm_add_epi32(_mm_and_si128(pix, low), _mm_srli_epi32(pix, 16))));
+		}
+	}
+#endif
+
+	// remaining bins
+	for (; j < nbin; j++) {
+		total = 0;
+		for (b = 0; b < sbin; b++) {
+			total += row[j * sbin + b];
+		}
+		sum[j] += total;
+	}
+}
+
+
+// reorient a band of output columns of one region
+// every orientation reads input pixel base + i * step_i + j * step_j for output
+// row i and column j, so one tiled loop serves them all; the swapped ones move
+// 8 x 8 blocks through SSE2 registers when the input runs forward along j
+static void orient_band(void *task_ctx, uns32 task) {
+
+	// declarations
+	orient_task	*job = (orient_task *) task_ctx;
+	const uns16	*src;			// input region
+	uns16	*dst;				// output region
+	long64	base;				// input offset of output pixel (0, 0)
+	long64	step_i;				// input stride along an output column
+	long64	step_j;				// input stride from one output column to the next
+	uns32	band;				// band within frame
+	uns32	i, j;				// output row and column
+	uns32	i0, j0;				// tile origin
+	uns32	i_end, j_end;		// tile end
+	uns32	k;					// frame of band
+	uns32	m, n;				// input rows (serial) and columns (parallel)
+	uns32	out_rows, out_cols;	// output size
+	uns32	r;					// region of band
+#ifdef PVCAM_SSE2
+	__m128i	row[8];				// eight input runs along j
+	__m128i	t[8];				// interleave stages
+	int		a;					// run counter
+	uns32	i1;					// output row past the last whole block
+#endif
+
+	// locate band in its frame and region
+	k = task / job->band_start[job->nregion];
+	band = task % job->band_start[job->nregion];
+	for (r = 0; band >= job->band_start[r + 1]; r++) {
+	}
+	band -= job->band_start[r];
+	m = (uns32) ((job->region[r].s2 - job->region[r].s1 + 1) / job->region[r].sbin);
+	n = (uns32) ((job->region[r].p2 - job->region[r].p1 + 1) / job->region[r].pbin);
+	src = job->frame + (size_t) k * job->npixel + job->offset[r];
+	dst = job->oriented + (size_t) k * job->npixel + job->offset[r];
+
+	// input offset of output pixel (i, j) is base + i * step_i + j * step_j
+	switch (job->orient) {
+	case ORIENT_TRANSPOSE:
+		base = 0;
+		step_i = m;
+		step_j = 1;
+		break;
+	case ORIENT_ROT90:
+		base = (long64) (n - 1) * m;
+		step_i = -(long64) m;
+		step_j = 1;
+		break;
+	case ORIENT_ROT180:
+		base = (long64) n * m - 1;
+		step_i = -1;
+		step_j = -(long64) m;
+		break;
+	case ORIENT_ROT270:
+		base = m - 1;
+		step_i = m;
+		step_j = -1;
+		break;
+	case ORIENT_FLIPLR:
+		base = (long64) (n - 1) * m;
+		step_i = 1;
+		step_j = -(long64) m;
+		break;
+	case ORIENT_FLIPUD:
+		base = m - 1;
+		step_i = -1;
+		step_j = m;
+		break;
+	default:
+		base = 0;
+		step_i = 1;
+		step_j = m;
+		break;
+	}
+	// strides cannot tell the shape apart when a region is one pixel wide, so it follows orient
+	out_rows = orient_swaps(job->orient) ? n : m;
+	out_cols = orient_swaps(job->orient) ? m : n;
+
+	// tiles down the band, all rows of ORIENT_TILE columns
+	j0 = band * ORIENT_TILE;
+	j_end = (j0 + ORIENT_TILE < out_cols) ? j0 + ORIENT_TILE : out_cols;
+	for (i0 = 0; i0 < out_rows; i0 += ORIENT_TILE) {
+		i_end = (i0 + ORIENT_TILE < out_rows) ? i0 + ORIENT_TILE : out_rows;
+		for (j = j0; j < j_end; j++) {
+			i = i0;
+#ifdef PVCAM_SSE2
+			// 8 x 8 block transpose: load eight runs along j, store eight runs along i
+			if ((step_j == 1) && ((j - j0) % 8 == 0) && (j + 8 <= j_end)) {
+				for (; i + 8 <= i_end; i += 8) {
+					for (a = 0; a < 8; a++) {
+						row[a] = _mm_loadu_si128((const __m128i *) (src + base + (long64) (i + a) * step_i + j));
+					}
+					for (a = 0; a < 4; a++) {
+						t[a] = _mm_unpacklo_epi16(row[2 * a], row[2 * a + 1]);
+						t[a + 4] = _mm_unpackhi_epi16(row[2 * a], row[2 * a + 1]);
+					}
+					row[0] = _mm_unpacklo_epi32(t[0], t[1]);
+					row[1] = _mm_unpackhi_epi32(t[0], t[1]);
+					row[2] = _mm_unpacklo_epi32(t[2], t[3]);
+					row[3] = _mm_unpackhi_epi32(t[2], t[3]);
+					row[4] = _mm_unpacklo_epi32(t[4], t[5]);
+					row[5] = _mm_unpackhi_epi32(t[4], t[5]);
+					row[6] = _mm_unpacklo_epi32(t[6], t[7]);
+					row[7] = _mm_unpackhi_epi32(t[6], t[7]);
+					t[0] = _mm_unpacklo_epi64(row[0], row[2]);
+					t[1] = _mm_unpackhi_epi64(row[0], row[2]);
+					t[2] = _mm_unpacklo_epi64(row[1], row[3]);
+					t[3] = _mm_unpackhi_epi64(row[1], row[3]);
+					t[4] = _mm_unpacklo_epi64(row[4], row[6]);
+					t[5] = _mm_unpackhi_epi64(row[4], row[6]);
+					t[6] = _mm_unpacklo_epi64(row[5], row[7]);
+					t[7] = _mm_unpackhi_epi64(row[5], row[7]);
+					for (a = 0; a < 8; a++) {
+						_mm_storeu_si128((__m128i *) (dst + (size_t) (j + a) * out_rows + i), t[a]);
+					}
+				}
+				for (a = 0; a < 8; a++) {
+					for (i1 = i; i1 < i_end; i1++) {
+						dst[(size_t) (j + a) * out_rows + i1] = src[base + (long64) i1 * step_i + j + a];
+					}
+				}
+				j += 7;
+				continue;
+			}
+#endif
+			for (; i < i_end; i++) {
+				dst[(size_t) j * out_rows + i] = src[base + (long64) i * step_i + (long64) j * step_j];
+			}
+		}
+	}
+}
+
+
+// orientation swaps the serial and parallel sizes
+static rs_bool orient_swaps(int orient) {
+	return((orient == ORIENT_TRANSPOSE) || (orient == ORIENT_ROT90) || (orient == ORIENT_ROT270));
+}
+
+
+// unpack one block of a frame
+static void unpack_block(void *task_ctx, uns32 task) {
+
+	// declarations
+	pack_task	*job = (pack_task *) task_ctx;
+	uns32	first;				// first pixel of block
+	uns32	k;					// frame of block
+
+	k = task / job->nblock;
+	first = (task % job->nblock) * PACK_BLOCK;
+	pvcam_unpack_pixels(job->packed + pvcam_packed_bytes(job->npixel, job->depth) * k + pvcam_packed_bytes(first, job->depth),
+		(job->npixel - first < PACK_BLOCK) ? job->npixel - first : PACK_BLOCK, job->depth,
+		job->pixels + (size_t) job->npixel * k + first);
+}
@@ -0,0 +1,188 @@
+/* Frame processing kernels for PVCAM MEX files */
+
+/* 10/18/26 */
+
+#ifndef _PVCAMPROC_H
+#define _PVCAMPROC_H
+
+// inclusions
+#include "pvcamutil.h"
+#include <stddef.h>
+
+// SSE2 is always present on x64 targets
+#if defined(_M_X64) || defined(__SSE2__)
+#define PVCAM_SSE2
+#endif
+
+
+// definitions
+#define ACCUM_SUM		0		// accumulate frames as 32-bit sums
+#define ACCUM_MEAN		1		// accumulate frames as single precision means
+#define SPECKLE_TILE	64		// rows per task for spatial speckle contrast
+#define TEMPORAL_BLOCK	65536	// pixels per task for temporal speckle contrast
+#define DEFECT_NEIGHBOR	4		// neighbors used to replace a defective pixel
+#define HDR_BLOCK		65536	// pixels per task for HDR fusion
+#define BIN_SUM			0		// rebinned pixel is sum of its bin
+#define BIN_MEAN		1		// rebinned pixel is rounded mean of its bin
+#define BIN_ROWS		16		// rebinned rows per task
+#define BIN_SPAN		1024	// rebinned pixels summed per pass along a row
+#define ORIENT_NONE		0		// frames copied as they are
+#define ORIENT_TRANSPOSE	1	// serial and parallel swapped
+#define ORIENT_ROT90	2		// rotated a quarter turn counterclockwise
+#define ORIENT_ROT180	3		// rotated a half turn
+#define ORIENT_ROT270	4		// rotated a quarter turn clockwise
+#define ORIENT_FLIPLR	5		// parallel order reversed
+#define ORIENT_FLIPUD	6		// serial order reversed
+#define ORIENT_TILE		64		// side of square tile moved at once
+#define PACK_BLOCK		65536	// pixels per task when unpacking frames, multiple of 8
+#define SUMMARY_SPAN	8192	// SIMD steps summed in 32 bits before folding into the total
+
+
+// scratch storage for spatial speckle contrast
+typedef struct pvcam_spatial {
+	uns32		nregion;		// number of regions per frame
+	rgn_type	*region;		// region list
+	uns32		window;			// window side length (odd)
+	ulong64		*sum;			// integral image of pixel values
+	ulong64		*sumsq;			// integral image of squared pixel values
+} pvcam_spatial;
+
+// running sums for temporal speckle contrast
+typedef struct pvcam_temporal {
+	uns32		npixel;			// pixels per frame
+	uns32		window;			// frames in window
+	uns32		nframe;			// frames currently in window
+	uns32		head;			// ring slot for next frame
+	uns16		*ring;			// last window frames
+	uns32		*sum;			// per-pixel sum over window
+	ulong64		*sumsq;			// per-pixel sum of squares over window
+} pvcam_temporal;
+
+// running sums for HDR fusion of one exposure bracket
+typedef struct pvcam_hdr {
+	uns32		npixel;			// pixels per frame
+	uns32		nframe;			// frames in current bracket
+	flt32		bias;			// camera offset removed before normalizing (DN)
+	flt32		saturation;		// pixel values at or above this are saturated (DN)
+	flt32		min_exposure;	// shortest exposure in current bracket (s)
+	flt32		*signal;		// per-pixel sum of unsaturated signal (DN)
+	flt32		*exposure;		// per-pixel sum of unsaturated exposure (s)
+} pvcam_hdr;
+
+// centroid of one PrimeLocate region
+typedef struct pvcam_centroid {
+	double		x;				// serial sensor coordinate of centroid (pixels)
+	double		y;				// parallel sensor coordinate of centroid (pixels)
+	double		intensity;		// region sum above background (DN)
+	double		background;		// lowest pixel in region (DN)
+} pvcam_centroid;
+
+// sum and range of a run of pixels
+typedef struct pvcam_summary {
+	double		sum;			// sum of pixels (DN)
+	uns32		npixel;			// number of pixels
+	uns16		min;			// lowest pixel (DN)
+	uns16		max;			// highest pixel (DN)
+} pvcam_summary;
+
+// defective pixel replaced from its good neighbors
+typedef struct pvcam_defect_pixel {
+	uns32		offset;			// pixel offset within frame
+	uns32		nneighbor;		// number of good neighbors
+	uns32		neighbor[DEFECT_NEIGHBOR];	// neighbor offsets within frame
+} pvcam_defect_pixel;
+
+// defect list mapped onto the active regions
+typedef struct pvcam_defect {
+	uns32		ndefect;		// number of defects inside regions
+	pvcam_defect_pixel	*pixel;	// defects sorted by offset
+} pvcam_defect;
+
+
+// function prototypes
+
+// add 16-bit frame into 32-bit accumulator
+void pvcam_accum_add(uns32 *accum, const uns16 *frame, size_t npixel);
+
+// convert 32-bit accumulator into mean of nframe frames
+void pvcam_accum_mean(flt32 *mean, const uns32 *accum, size_t npixel, uns32 nframe);
+
+// allocate scratch for spatial speckle contrast
+rs_bool pvcam_spatial_init(pvcam_spatial *spatial, uns16 nregion, const rgn_type *region, uns32 window);
+
+// spatial speckle contrast of each region over a sliding window
+void pvcam_spatial_contrast(pvcam_spatial *spatial, const uns16 *frame, flt32 *contrast);
+
+// free spatial speckle scratch
+void pvcam_spatial_free(pvcam_spatial *spatial);
+
+// allocate running sums for temporal speckle contrast
+rs_bool pvcam_temporal_init(pvcam_temporal *temporal, uns32 npixel, uns32 window);
+
+// add frame to temporal window and compute per-pixel contrast
+void pvcam_temporal_contrast(pvcam_temporal *temporal, const uns16 *frame, flt32 *contrast);
+
+// free temporal speckle running sums
+void pvcam_temporal_free(pvcam_temporal *temporal);
+
+// allocate running sums for HDR fusion
+rs_bool pvcam_hdr_init(pvcam_hdr *hdr, uns32 npixel, flt32 bias, flt32 saturation);
+
+// add frame of given exposure (s) to current bracket
+void pvcam_hdr_add(pvcam_hdr *hdr, const uns16 *frame, flt32 exposure);
+
+// fuse current bracket into radiance (DN/s) and start a new bracket
+void pvcam_hdr_fuse(pvcam_hdr *hdr, flt32 *radiance);
+
+// free HDR running sums
+void pvcam_hdr_free(pvcam_hdr *hdr);
+
+// sub-pixel centroid of region pixels in sensor coordinates, 0 if region is flat
+rs_bool pvcam_centroid_region(const uns16 *pixels, const rgn_type *roi, pvcam_centroid *centroid);
+
+// layout of regions rebinned by a further sbin x pbin, partial bins dropped
+void pvcam_bin_regions(uns16 nregion, const rgn_type *region, uns16 sbin, uns16 pbin, rgn_type *binned);
+
+// rebin frames laid out over regions into uns16 (clipped) or, if wide, uns32 pixels
+rs_bool pvcam_bin_frames(const uns16 *frame, uns32 nframe, uns16 nregion, const rgn_type *region,
+						 uns16 sbin, uns16 pbin, int bin_mode, rs_bool wide, void *binned);
+
+// orientation code of name ('none', 'transpose', 'rot90', ...), -1 if not recognized
+int pvcam_orient_code(const char *name);
+
+// reorient each region of frames laid out over regions
+rs_bool pvcam_orient_frames(const uns16 *frame, uns32 nframe, uns16 nregion, const rgn_type *region,
+							int orient, uns16 *oriented);
+
+// bytes taken by npixel pixels packed to depth bits
+size_t pvcam_packed_bytes(size_t npixel, uns32 depth);
+
+// pack pixels into depth-bit (0 to 16) fields, least significant bit first, clipping larger pixels
+void pvcam_pack_pixels(const uns16 *pixels, size_t npixel, uns32 depth, uns8 *packed);
+
+// unpack depth-bit (0 to 16) fields into pixels
+void pvcam_unpack_pixels(const uns8 *packed, size_t npixel, uns32 depth, uns16 *pixels);
+
+// unpack frames that each start on a byte boundary
+void pvcam_unpack_frames(const uns8 *packed, uns32 nframe, uns32 npixel, uns32 depth, uns16 *pixels);
+
+// sum, lowest and highest of npixel pixels in one pass
+void pvcam_summarize(const uns16 *pixels, uns32 npixel, pvcam_summary *summary);
+
+// subtract level from pixels in place, clipping at 0
+void pvcam_offset_subtract(uns16 *pixels, uns32 npixel, uns16 level);
+
+// sum of absolute differences between two frames of npixel pixels
+double pvcam_frame_difference(const uns16 *pixels, const uns16 *previous, uns32 npixel);
+
+// map sensor coordinates of defects onto frame offsets of the active regions
+rs_bool pvcam_defect_init(pvcam_defect *defect, uns16 nregion, const rgn_type *region,
+						  const double *coord, uns32 ncoord);
+
+// replace defective pixels with mean of their good neighbors
+void pvcam_defect_correct(const pvcam_defect *defect, uns16 *frame);
+
+// free defect list
+void pvcam_defect_free(pvcam_defect *defect);
+
+#endif /* _PVCAMPROC_H */
@@ -0,0 +1,150 @@
+/* PVCAMREAD - read frames back from a PVCAMACQ recording
+
+      DATA = PVCAMREAD(FILE) decodes every frame of the recording FILE
+	  written by PVCAMACQ with OPTS.record.  DATA is an unsigned 16-bit
+	  vector holding the frames one after another, exactly as PVCAMACQ
+	  returns plain frames (pixel data only, no metadata headers), so it is
+	  reshaped, rebinned or reoriented in the same way.
+
+      DATA = PVCAMREAD(FILE, FRAMES) decodes only the frames at the
+	  positions in the vector FRAMES (1 to INFO.frames), in the order
+	  given.  The file is mapped into memory rather than read, so picking
+	  a few frames out of a long recording only touches those frames.
+
+      [DATA, META, INFO] = PVCAMREAD(...) also returns the structure META
+	  with fields frame, bof, eof and exptime for the frames read (as in
+	  PVCAMACQ, timestamps in ns), and the structure INFO with fields:
+
+					roi = ROI structure array the frames were acquired over
+					frames = number of frames in the recording
+					bitdepth = sensor bit depth (PARAM_BIT_DEPTH), 0 if not known
+					codec = 'pack' or 'rice'
+					ratio = bytes of 16-bit pixel data over bytes in the file
+					closed = 1 if the recording was closed, 0 if it was cut short
+
+	  Frames are stored in tiles of 8192 pixels, either bit-packed to their
+	  widest pixel or coded as differences between neighbouring pixels in
+	  adaptive Rice codes, whichever is smaller, so the data comes back
+	  exactly as acquired.  Tiles are decoded in parallel over the worker
+	  threads.  A recording cut short still reads up to its last whole
+	  frame. */
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamrecord.h"
+#include "pvcamthread.h"
+
+
+// definitions
+#define READ_META_FIELD	4		// number of fields in metadata structure
+#define READ_INFO_FIELD	6		// number of fields in recording information structure
+
+
+// command routine, also reached as pvcam('read', ...)
+void pvcam_cmd_read(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	const char	*meta_list[READ_META_FIELD] = {"frame", "bof", "eof", "exptime"};
+	const char	*info_list[READ_INFO_FIELD] = {"roi", "frames", "bitdepth", "codec", "ratio", "closed"};
+	const pvcam_frame_record	*record;	// frame record
+	char		*path;			// recording file name
+	double		*frame_ptr;		// frame positions as given
+	double		*meta_ptr[READ_META_FIELD];	// metadata output columns
+	pvcam_recording	recording;	// mapped recording
+	uns32		i;				// frame counter
+	uns32		nselect;		// frames to decode
+	uns32		*select;		// frames to decode (0-based)
+
+	// validate arguments
+	if ((nrhs < 1) || (nrhs > 2) || (nlhs > 3)) {
+		mexErrMsgTxt("type 'help pvcamread' for syntax");
+	}
+	pvcam_at_exit(pvcam_thread_stop);
+	if (!mxIsChar(prhs[0])) {
+		mexErrMsgTxt("FILE must be a string");
+	}
+	if ((nrhs > 1) && (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1]))) {
+		mexErrMsgTxt("FRAMES must be a real double vector");
+	}
+
+	// map recording
+	path = mxArrayToString(prhs[0]);
+	if (!pvcam_recording_open(&recording, path)) {
+		mxFree((void *) path);
+		mexErrMsgTxt(recording.err_msg);
+	}
+	mxFree((void *) path);
+
+	// obtain frame selection
+	if (nrhs > 1) {
+		nselect = (uns32) mxGetNumberOfElements(prhs[1]);
+		frame_ptr = mxGetPr(prhs[1]);
+		select = (uns32 *) mxCalloc((size_t) nselect + 1, sizeof(uns32));
+		for (i = 0; i < nselect; i++) {
+			if ((frame_ptr[i] < 1.0) || (frame_ptr[i] > (double) recording.nframe) ||
+				(frame_ptr[i] != (double) (uns32) frame_ptr[i])) {
+				pvcam_recording_close(&recording);
+				mexErrMsgTxt("FRAMES must hold frame positions from 1 to the number of frames recorded");
+			}
+			select[i] = (uns32) frame_ptr[i] - 1;
+		}
+	}
+	else {
+		nselect = recording.nframe;
+		select = (uns32 *) mxCalloc((size_t) nselect + 1, sizeof(uns32));
+		for (i = 0; i < nselect; i++) {
+			select[i] = i;
+		}
+	}
+
+	// decode frames
+	plhs[0] = mxCreateNumericMatrix(1, (size_t) recording.header->npixel * nselect, mxUINT16_CLASS, mxREAL);
+	if (!pvcam_recording_read(&recording, select, nselect, (uns16 *) mxGetData(plhs[0]))) {
+		pvcam_recording_close(&recording);
+		mexErrMsgTxt(recording.err_msg);
+	}
+
+	// metadata of frames read
+	if (nlhs > 1) {
+		plhs[1] = mxCreateStructMatrix(1, 1, READ_META_FIELD, meta_list);
+		for (i = 0; i < READ_META_FIELD; i++) {
+			mxSetFieldByNumber(plhs[1], 0, (int) i, mxCreateDoubleMatrix(1, nselect, mxREAL));
+			meta_ptr[i] = mxGetPr(mxGetFieldByNumber(plhs[1], 0, (int) i));
+		}
+		for (i = 0; i < nselect; i++) {
+			record = recording.frame[select[i]];
+			meta_ptr[0][i] = (double) record->frame_nr;
+			meta_ptr[1][i] = record->bof_ns;
+			meta_ptr[2][i] = record->eof_ns;
+			meta_ptr[3][i] = record->exp_ns;
+		}
+	}
+
+	// recording layout
+	if (nlhs > 2) {
+		plhs[2] = mxCreateStructMatrix(1, 1, READ_INFO_FIELD, info_list);
+		mxSetFieldByNumber(plhs[2], 0, 0, pvcam_region_struct((uns16) recording.header->nregion, recording.region));
+		mxSetFieldByNumber(plhs[2], 0, 1, mxCreateDoubleScalar((double) recording.nframe));
+		mxSetFieldByNumber(plhs[2], 0, 2, mxCreateDoubleScalar((double) recording.header->bit_depth));
+		mxSetFieldByNumber(plhs[2], 0, 3, mxCreateString((recording.header->codec == CODEC_RICE) ? "rice" : "pack"));
+		mxSetFieldByNumber(plhs[2], 0, 4, mxCreateDoubleScalar(2.0 * (double) recording.header->npixel *
+			(double) recording.nframe / (double) recording.size));
+		mxSetFieldByNumber(plhs[2], 0, 5, mxCreateDoubleScalar((double) recording.indexed));
+	}
+
+	// free allocated arrays
+	mxFree((void *) select);
+	pvcam_recording_close(&recording);
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_read(nlhs, plhs, nrhs, prhs);
+}
+#endif
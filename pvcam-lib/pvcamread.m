@@ -0,0 +1,33 @@
+% PVCAMREAD - read frames back from a PVCAMACQ recording
+%
+%     DATA = PVCAMREAD(FILE) decodes every frame of the recording FILE
+%	  written by PVCAMACQ with OPTS.record.  DATA is an unsigned 16-bit
+%	  vector holding the frames one after another, exactly as PVCAMACQ
+%	  returns plain frames (pixel data only, no metadata headers), so it is
+%	  reshaped, rebinned or reoriented in the same way.
+%
+%     DATA = PVCAMREAD(FILE, FRAMES) decodes only the frames at the
+%	  positions in the vector FRAMES (1 to INFO.frames), in the order
+%	  given.  The file is mapped into memory rather than read, so picking
+%	  a few frames out of a long recording only touches those frames.
+%
+%     [DATA, META, INFO] = PVCAMREAD(...) also returns the structure META
+%	  with fields frame, bof, eof and exptime for the frames read (as in
+%	  PVCAMACQ, timestamps in ns), and the structure INFO with fields:
+%
+%					roi = ROI structure array the frames were acquired over
+%					frames = number of frames in the recording
+%					bitdepth = sensor bit depth (PARAM_BIT_DEPTH), 0 if not known
+%					codec = 'pack' or 'rice'
+%					ratio = bytes of 16-bit pixel data over bytes in the file
+%					closed = 1 if the recording was closed, 0 if it was cut short
+%
+%	  Frames are stored in tiles of 8192 pixels, either bit-packed to their
+%	  widest pixel or coded as differences between neighbouring pixels in
+%	  adaptive Rice codes, whichever is smaller, so the data comes back
+%	  exactly as acquired.  Tiles are decoded in parallel over the worker
+%	  threads.  A recording cut short still reads up to its last whole
+%	  frame.
+
+% 10/18/26
+% mex DLL code
@@ -0,0 +1,757 @@
+/* Compressed frame recording for PVCAM MEX files */
+
+/* 10/18/26 */
+
+/* A recording is a file header and region list followed by one record per
+   frame, and, once the recording is closed, an index of frame offsets and a
+   trailer.  A recording cut short (MATLAB killed, disk full) has no index,
+   and the reader finds its frames by walking the records from the front
+   instead, so every frame that reached the disk can still be read.
+
+   Each frame is cut into tiles of RECORD_TILE pixels that are coded on
+   their own, so coding and decoding spread over the worker threads and any
+   frame decodes without touching the others.  A tile is either bit-packed
+   to its widest pixel, which stores a 12-bit sensor (PARAM_BIT_DEPTH) in
+   12 bits per pixel, or, with CODEC_RICE, coded as differences between
+   neighbouring pixels in Rice codes whose parameter adapts every RICE_BLOCK
+   pixels, falling back to packing whenever that comes out smaller.  Both
+   are lossless, and packing goes through the SSE2 kernels of pvcamproc.
+   The differences follow the serial register, so the tiles
+   need no knowledge of region shapes.
+
+   Records are padded to RECORD_ALIGN bytes, so the reader addresses the
+   headers in the mapped file directly.  Nothing in here calls the MEX API;
+   failures are left in err_msg. */
+
+// inclusions
+#include "pvcamrecord.h"
+#include "pvcamproc.h"
+#include "pvcamthread.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// bit stream over a byte buffer, least significant bit first
+typedef struct codec_bits {
+	uns8		*ptr;			// next byte
+	uns8		*end;			// end of buffer
+	ulong64		acc;			// bits held back from the buffer
+	uns32		nbit;			// number of bits held
+	rs_bool		overrun;		// read ran past end of buffer
+} codec_bits;
+
+// frame handed to the tile coding tasks
+typedef struct record_task {
+	pvcam_recorder	*rec;		// recorder with tile scratch
+	const uns16	*pixels;		// frame pixels
+} record_task;
+
+// frames handed to the tile decoding tasks
+typedef struct recording_task {
+	const pvcam_recording	*recording;	// mapped recording
+	const uns32	*select;		// frames to decode
+	const uns32	*tile_offset;	// offset of each tile within its frame record
+	uns16		*pixels;		// decoded frames
+	volatile rs_bool	failed;	// a tile did not decode
+} recording_task;
+
+
+// function prototypes
+
+// append bytes to recording file
+static rs_bool record_write(pvcam_recorder *rec, const void *data, size_t nbyte);
+
+// code one tile of frame
+static void record_encode(void *task_ctx, uns32 task);
+
+// decode one tile of selected frames
+static void recording_decode(void *task_ctx, uns32 task);
+
+// frame record at file offset, NULL if there is no whole record there
+static const pvcam_frame_record *recording_record(const pvcam_recording *recording, ulong64 offset);
+
+// locate frames through the index of a closed recording
+static rs_bool recording_index(pvcam_recording *recording);
+
+// locate frames by walking the records from the first
+static rs_bool recording_scan(pvcam_recording *recording, ulong64 first);
+
+// map file read-only into memory
+static rs_bool recording_map(pvcam_recording *recording, const char *path);
+
+// code tile, bit-packed or Rice coded, returns coded bytes
+static uns32 codec_encode(const uns16 *pixel, uns32 npixel, int codec, uns8 *coded);
+
+// Rice code tile into at most limit bytes, 0 if it does not fit
+static uns32 codec_rice(const uns16 *pixel, uns32 npixel, uns8 *coded, uns32 limit);
+
+// decode tile, 0 if it is corrupt
+static rs_bool codec_decode(const uns8 *coded, uns32 nbyte, uns16 *pixel, uns32 npixel);
+
+// write count (<= 32) bits, 0 if buffer is full
+static rs_bool bits_put(codec_bits *bits, uns32 value, uns32 count);
+
+// write out bits still held, 0 if buffer is full
+static rs_bool bits_flush(codec_bits *bits);
+
+// read count (<= 32) bits
+static uns32 bits_get(codec_bits *bits, uns32 count);
+
+
+// create recording file for frames over regions
+rs_bool pvcam_record_open(pvcam_recorder *rec, const char *path, uns16 nregion, const rgn_type *region,
+						  uns32 bit_depth, int codec) {
+
+	// declarations
+	pvcam_record_header	header;	// file header
+	uns8		pad[RECORD_ALIGN];	// zero padding
+	size_t		nbyte;			// header and region list bytes
+
+	memset(rec, 0, sizeof(pvcam_recorder));
+	rec->codec = codec;
+	rec->npixel = pvcam_region_pixels(nregion, region);
+	rec->ntile = (rec->npixel + RECORD_TILE - 1) / RECORD_TILE;
+	rec->tile_bytes = (2 + 2 * RECORD_TILE + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+	rec->scratch = (uns8 *) malloc((size_t) rec->ntile * rec->tile_bytes);
+	rec->tile_size = (uns32 *) malloc((size_t) rec->ntile * sizeof(uns32));
+	rec->index = (ulong64 *) malloc(RECORD_INDEX * sizeof(ulong64));
+	rec->iobuf = (char *) malloc(RECORD_IOBUF);
+	rec->nindex = RECORD_INDEX;
+	if ((rec->scratch == NULL) || (rec->tile_size == NULL) || (rec->index == NULL) || (rec->iobuf == NULL)) {
+		pvcam_record_close(rec);
+		rec->err_msg = "Cannot allocate recording storage";
+		return(0);
+	}
+	if ((rec->file = fopen(path, "wb")) == NULL) {
+		pvcam_record_close(rec);
+		rec->err_msg = "Cannot create recording file";
+		return(0);
+	}
+	setvbuf(rec->file, rec->iobuf, _IOFBF, RECORD_IOBUF);
+
+	// header and region list, padded for the first frame record
+	memset(&header, 0, sizeof(pvcam_record_header));
+	memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+	header.version = RECORD_VERSION;
+	header.npixel = rec->npixel;
+	header.nregion = nregion;
+	header.tile_pixels = RECORD_TILE;
+	header.bit_depth = bit_depth;
+	header.codec = (uns32) codec;
+	memset(pad, 0, sizeof(pad));
+	nbyte = sizeof(pvcam_record_header) + (size_t) nregion * sizeof(rgn_type);
+	if (!record_write(rec, &header, sizeof(pvcam_record_header)) ||
+		!record_write(rec, region, (size_t) nregion * sizeof(rgn_type)) ||
+		!record_write(rec, pad, (RECORD_ALIGN - nbyte % RECORD_ALIGN) % RECORD_ALIGN)) {
+		pvcam_record_close(rec);
+		rec->err_msg = "Cannot write recording header";
+		return(0);
+	}
+	return(1);
+}
+
+
+// code tiles of frame across worker threads and append frame record
+rs_bool pvcam_record_frame(pvcam_recorder *rec, const pvcam_frame *frame) {
+
+	// declarations
+	pvcam_frame_record	header;	// frame record header
+	record_task	task;			// shared task description
+	ulong64		*index;			// grown frame index
+	uns8		pad[RECORD_ALIGN];	// zero padding
+	uns32		i;				// tile counter
+	uns32		nbyte;			// tile table and coded tiles
+
+	if (frame->npixel != rec->npixel) {
+		rec->err_msg = "Frame size does not match recording";
+		return(0);
+	}
+	task.rec = rec;
+	task.pixels = frame->pixels;
+	pvcam_parallel_for(rec->ntile, record_encode, (void *) &task);
+
+	// frame index doubles as it fills
+	if (rec->nframe == rec->nindex) {
+		if ((index = (ulong64 *) realloc(rec->index, 2 * (size_t) rec->nindex * sizeof(ulong64))) == NULL) {
+			rec->err_msg = "Cannot allocate recording index";
+			return(0);
+		}
+		rec->index = index;
+		rec->nindex *= 2;
+	}
+	rec->index[rec->nframe] = rec->offset;
+
+	// header, tile sizes, then tiles back to back
+	nbyte = rec->ntile * (uns32) sizeof(uns32);
+	for (i = 0; i < rec->ntile; i++) {
+		nbyte += rec->tile_size[i];
+	}
+	header.magic = RECORD_FRAME;
+	header.frame_nr = frame->frame_nr;
+	header.nbyte = (nbyte + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+	header.ntile = rec->ntile;
+	header.bof_ns = frame->bof_ns;
+	header.eof_ns = frame->eof_ns;
+	header.exp_ns = frame->exp_ns;
+	memset(pad, 0, sizeof(pad));
+	if (!record_write(rec, &header, sizeof(pvcam_frame_record)) ||
+		!record_write(rec, rec->tile_size, (size_t) rec->ntile * sizeof(uns32))) {
+		rec->err_msg = "Cannot write to recording file";
+		return(0);
+	}
+	for (i = 0; i < rec->ntile; i++) {
+		if (!record_write(rec, rec->scratch + (size_t) i * rec->tile_bytes, rec->tile_size[i])) {
+			rec->err_msg = "Cannot write to recording file";
+			return(0);
+		}
+	}
+	if (!record_write(rec, pad, header.nbyte - nbyte)) {
+		rec->err_msg = "Cannot write to recording file";
+		return(0);
+	}
+	rec->nframe++;
+	return(1);
+}
+
+
+// write frame index and close recording, 0 if anything failed to reach the file
+rs_bool pvcam_record_close(pvcam_recorder *rec) {
+
+	// declarations
+	pvcam_record_trailer	trailer;	// end of recording
+	rs_bool		success = 1;	// flag for complete recording
+
+	if (rec->file != NULL) {
+		trailer.index_offset = rec->offset;
+		trailer.nframe = rec->nframe;
+		trailer.magic = RECORD_END;
+		success = record_write(rec, rec->index, (size_t) rec->nframe * sizeof(ulong64)) &&
+			record_write(rec, &trailer, sizeof(pvcam_record_trailer));
+		success = (fflush(rec->file) == 0) && success;
+		success = (fclose(rec->file) == 0) && success;
+		if (!success) {
+			rec->err_msg = "Cannot finish recording file";
+		}
+		rec->file = NULL;
+	}
+	free((void *) rec->scratch);
+	free((void *) rec->tile_size);
+	free((void *) rec->index);
+	free((void *) rec->iobuf);
+	rec->scratch = NULL;
+	rec->tile_size = NULL;
+	rec->index = NULL;
+	rec->iobuf = NULL;
+	return(success);
+}
+
+
+// map recording into memory and locate its frames
+rs_bool pvcam_recording_open(pvcam_recording *recording, const char *path) {
+
+	// declarations
+	const pvcam_record_header	*header;	// file header
+	ulong64		first;			// offset of first frame record
+
+	memset(recording, 0, sizeof(pvcam_recording));
+	if (!recording_map(recording, path)) {
+		return(0);
+	}
+
+	// header must describe a layout this reader knows
+	header = (const pvcam_record_header *) recording->base;
+	first = sizeof(pvcam_record_header) + (ulong64) header->nregion * sizeof(rgn_type);
+	first = (first + RECORD_ALIGN - 1) & ~(ulong64) (RECORD_ALIGN - 1);
+	if ((memcmp(header->magic, RECORD_MAGIC, sizeof(header->magic)) != 0) || (header->version != RECORD_VERSION)) {
+		recording->err_msg = "File is not a PVCAM recording";
+	}
+	else if ((header->npixel == 0) || (header->tile_pixels == 0) || (header->nregion == 0) ||
+		(header->nregion > 0xFFFF) || (first > recording->size)) {
+		recording->err_msg = "Recording header is corrupt";
+	}
+	else {
+		recording->header = header;
+		recording->region = (const rgn_type *) (header + 1);
+		recording->ntile = (header->npixel + header->tile_pixels - 1) / header->tile_pixels;
+		if (recording_index(recording) || recording_scan(recording, first)) {
+			return(1);
+		}
+	}
+	pvcam_recording_close(recording);
+	return(0);
+}
+
+
+// decode selected frames (0-based) across worker threads
+// tile offsets are checked against their frame record before any tile is decoded
+rs_bool pvcam_recording_read(const pvcam_recording *recording, const uns32 *select, uns32 nselect, uns16 *pixels) {
+
+	// declarations
+	const pvcam_frame_record	*record;	// frame record
+	const uns32	*tile_size;		// coded bytes of each tile
+	recording_task	task;		// shared task description
+	uns32		*tile_offset;	// offset of each tile within its frame record
+	uns32		offset;			// offset of next tile
+	uns32		i;				// tile counter
+	uns32		s;				// selected frame counter
+
+	if ((ulong64) nselect * recording->ntile > 0xFFFFFFFF) {
+		((pvcam_recording *) recording)->err_msg = "Too many frames selected at once";
+		return(0);
+	}
+	tile_offset = (uns32 *) malloc(((size_t) nselect * recording->ntile + 1) * sizeof(uns32));
+	if (tile_offset == NULL) {
+		((pvcam_recording *) recording)->err_msg = "Cannot allocate decoding storage";
+		return(0);
+	}
+	for (s = 0; s < nselect; s++) {
+		record = recording->frame[select[s]];
+		tile_size = (const uns32 *) (record + 1);
+		offset = (uns32) sizeof(pvcam_frame_record) + recording->ntile * (uns32) sizeof(uns32);
+		for (i = 0; i < recording->ntile; i++) {
+			tile_offset[s * recording->ntile + i] = offset;
+			if (tile_size[i] > sizeof(pvcam_frame_record) + record->nbyte - offset) {
+				free((void *) tile_offset);
+				((pvcam_recording *) recording)->err_msg = "Recording frame is corrupt";
+				return(0);
+			}
+			offset += tile_size[i];
+		}
+	}
+	task.recording = recording;
+	task.select = select;
+	task.tile_offset = tile_offset;
+	task.pixels = pixels;
+	task.failed = 0;
+	pvcam_parallel_for(nselect * recording->ntile, recording_decode, (void *) &task);
+	free((void *) tile_offset);
+	if (task.failed) {
+		((pvcam_recording *) recording)->err_msg = "Recording frame is corrupt";
+		return(0);
+	}
+	return(1);
+}
+
+
+// unmap recording
+void pvcam_recording_close(pvcam_recording *recording) {
+	free((void *) recording->frame);
+	recording->frame = NULL;
+	recording->nframe = 0;
+#if defined(_WIN32) || defined(_WIN64)
+	if (recording->base != NULL) {
+		UnmapViewOfFile((LPCVOID) recording->base);
+	}
+	if (recording->map_handle != NULL) {
+		CloseHandle((HANDLE) recording->map_handle);
+	}
+	if (recording->file_handle != NULL) {
+		CloseHandle((HANDLE) recording->file_handle);
+	}
+#else
+	if (recording->base != NULL) {
+		munmap((void *) recording->base, (size_t) recording->size);
+	}
+#endif
+	recording->base = NULL;
+	recording->map_handle = NULL;
+	recording->file_handle = NULL;
+}
+
+
+// append bytes to recording file
+static rs_bool record_write(pvcam_recorder *rec, const void *data, size_t nbyte) {
+	if ((nbyte > 0) && (fwrite(data, 1, nbyte, rec->file) != nbyte)) {
+		return(0);
+	}
+	rec->offset += nbyte;
+	return(1);
+}
+
+
+// code one tile of frame
+static void record_encode(void *task_ctx, uns32 task) {
+
+	// declarations
+	record_task	*ctx = (record_task *) task_ctx;
+	uns32		first;			// first pixel of tile
+
+	first = task * RECORD_TILE;
+	ctx->rec->tile_size[task] = codec_encode(ctx->pixels + first,
+		(ctx->rec->npixel - first < RECORD_TILE) ? ctx->rec->npixel - first : RECORD_TILE,
+		ctx->rec->codec, ctx->rec->scratch + (size_t) task * ctx->rec->tile_bytes);
+}
+
+
+// decode one tile of selected frames
+static void recording_decode(void *task_ctx, uns32 task) {
+
+	// declarations
+	recording_task	*ctx = (recording_task *) task_ctx;
+	const pvcam_frame_record	*record;	// frame record
+	uns32		first;			// first pixel of tile
+	uns32		npixel;			// pixels per frame
+	uns32		s;				// selected frame
+	uns32		tile;			// tile within frame
+	uns32		tile_pixels;	// pixels per tile
+
+	s = task / ctx->recording->ntile;
+	tile = task % ctx->recording->ntile;
+	record = ctx->recording->frame[ctx->select[s]];
+	npixel = ctx->recording->header->npixel;
+	tile_pixels = ctx->recording->header->tile_pixels;
+	first = tile * tile_pixels;
+	if (!codec_decode((const uns8 *) record + ctx->tile_offset[task], ((const uns32 *) (record + 1))[tile],
+		ctx->pixels + (size_t) npixel * s + first, (npixel - first < tile_pixels) ? npixel - first : tile_pixels)) {
+		ctx->failed = 1;
+	}
+}
+
+
+// frame record at file offset, NULL if there is no whole record there
+static const pvcam_frame_record *recording_record(const pvcam_recording *recording, ulong64 offset) {
+
+	// declarations
+	const pvcam_frame_record	*record;	// candidate record
+
+	if ((offset % RECORD_ALIGN != 0) || (offset + sizeof(pvcam_frame_record) > recording->size)) {
+		return(NULL);
+	}
+	record = (const pvcam_frame_record *) (recording->base + offset);
+	if ((record->magic != RECORD_FRAME) || (record->ntile != recording->ntile) ||
+		(record->nbyte < recording->ntile * sizeof(uns32)) ||
+		(record->nbyte > recording->size - offset - sizeof(pvcam_frame_record))) {
+		return(NULL);
+	}
+	return(record);
+}
+
+
+// locate frames through the index of a closed recording
+static rs_bool recording_index(pvcam_recording *recording) {
+
+	// declarations
+	const ulong64	*index;		// frame offsets
+	pvcam_record_trailer	trailer;	// end of recording
+	uns32		i;				// frame counter
+
+	if (recording->size < sizeof(pvcam_record_header) + sizeof(pvcam_record_trailer)) {
+		return(0);
+	}
+	memcpy(&trailer, recording->base + recording->size - sizeof(pvcam_record_trailer), sizeof(pvcam_record_trailer));
+	if ((trailer.magic != RECORD_END) || (trailer.index_offset % RECORD_ALIGN != 0) ||
+		(trailer.index_offset > recording->size - sizeof(pvcam_record_trailer)) ||
+		(recording->size - sizeof(pvcam_record_trailer) - trailer.index_offset != (ulong64) trailer.nframe * sizeof(ulong64))) {
+		return(0);
+	}
+	recording->frame = (const pvcam_frame_record **) malloc(((size_t) trailer.nframe + 1) * sizeof(pvcam_frame_record *));
+	if (recording->frame == NULL) {
+		return(0);
+	}
+	index = (const ulong64 *) (recording->base + trailer.index_offset);
+	for (i = 0; i < trailer.nframe; i++) {
+		if ((recording->frame[i] = recording_record(recording, index[i])) == NULL) {
+			free((void *) recording->frame);
+			recording->frame = NULL;
+			return(0);
+		}
+	}
+	recording->nframe = trailer.nframe;
+	recording->indexed = 1;
+	return(1);
+}
+
+
+// locate frames by walking the records from the first
+// first pass counts the whole records, second pass collects them
+static rs_bool recording_scan(pvcam_recording *recording, ulong64 first) {
+
+	// declarations
+	const pvcam_frame_record	*record;	// current record
+	ulong64		offset;			// offset of current record
+	uns32		nframe;			// whole records found
+
+	nframe = 0;
+	for (offset = first; (record = recording_record(recording, offset)) != NULL;
+		offset += sizeof(pvcam_frame_record) + record->nbyte) {
+		nframe++;
+	}
+	recording->frame = (const pvcam_frame_record **) malloc(((size_t) nframe + 1) * sizeof(pvcam_frame_record *));
+	if (recording->frame == NULL) {
+		recording->err_msg = "Cannot allocate recording index";
+		return(0);
+	}
+	nframe = 0;
+	for (offset = first; (record = recording_record(recording, offset)) != NULL;
+		offset += sizeof(pvcam_frame_record) + record->nbyte) {
+		recording->frame[nframe++] = record;
+	}
+	recording->nframe = nframe;
+	recording->indexed = 0;
+	return(1);
+}
+
+
+#if defined(_WIN32) || defined(_WIN64)
+
+// map file read-only into memory
+static rs_bool recording_map(pvcam_recording *recording, const char *path) {
+
+	// declarations
+	HANDLE			file;		// file handle
+	HANDLE			map;		// mapping handle
+	LARGE_INTEGER	size;		// file size
+
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		recording->err_msg = "Cannot open recording file";
+		return(0);
+	}
+	recording->file_handle = (void *) file;
+	if (!GetFileSizeEx(file, &size) || (size.QuadPart < (LONGLONG) sizeof(pvcam_record_header))) {
+		recording->err_msg = "File is not a PVCAM recording";
+		pvcam_recording_close(recording);
+		return(0);
+	}
+	recording->size = (ulong64) size.QuadPart;
+	if ((map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL) {
+		recording->err_msg = "Cannot map recording file";
+		pvcam_recording_close(recording);
+		return(0);
+	}
+	recording->map_handle = (void *) map;
+	if ((recording->base = (const uns8 *) MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0)) == NULL) {
+		recording->err_msg = "Cannot map recording file";
+		pvcam_recording_close(recording);
+		return(0);
+	}
+	return(1);
+}
+
+#else
+
+// map file read-only into memory
+static rs_bool recording_map(pvcam_recording *recording, const char *path) {
+
+	// declarations
+	int			fd;				// file descriptor
+	struct stat	st;				// file status
+	void		*base;			// mapping
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		recording->err_msg = "Cannot open recording file";
+		return(0);
+	}
+	if ((fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(pvcam_record_header))) {
+		close(fd);
+		recording->err_msg = "File is not a PVCAM recording";
+		return(0);
+	}
+	base = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		recording->err_msg = "Cannot map recording file";
+		return(0);
+	}
+	recording->base = (const uns8 *) base;
+	recording->size = (ulong64) st.st_size;
+	return(1);
+}
+
+#endif
+
+
+// code tile, bit-packed or Rice coded, returns coded bytes
+// the first byte gives the tile mode, the second the packed width
+static uns32 codec_encode(const uns16 *pixel, uns32 npixel, int codec, uns8 *coded) {
+
+	// declarations
+	uns32		depth;			// bits in widest pixel
+	uns32		i;				// pixel counter
+	uns32		limit;			// packed tile size
+	uns32		nbyte;			// Rice coded tile size
+	uns32		wide;			// all pixel bits or-ed together
+
+	wide = 0;
+	for (i = 0; i < npixel; i++) {
+		wide |= pixel[i];
+	}
+	for (depth = 0; (depth < 16) && ((wide >> depth) != 0); depth++) {
+	}
+	limit = 2 + (uns32) pvcam_packed_bytes(npixel, depth);
+	if ((codec == CODEC_RICE) && (depth > 0) && ((nbyte = codec_rice(pixel, npixel, coded, limit)) > 0)) {
+		return(nbyte);
+	}
+	coded[0] = TILE_PACKED;
+	coded[1] = (uns8) depth;
+	pvcam_pack_pixels(pixel, npixel, depth, coded + 2);
+	return(limit);
+}
+
+
+// Rice code tile into at most limit bytes, 0 if it does not fit
+// residuals from the previous pixel are zigzag folded to 17 bits; each block of
+// RICE_BLOCK residuals starts with its parameter k (5 bits), then each residual
+// is its high bits in unary and its k low bits, or RICE_ESCAPE ones and 17 raw bits
+static uns32 codec_rice(const uns16 *pixel, uns32 npixel, uns8 *coded, uns32 limit) {
+
+	// declarations
+	codec_bits	bits;			// output stream
+	int32		prev;			// previous pixel
+	int32		residual;		// difference from previous pixel
+	uns32		fold[RICE_BLOCK];	// zigzag folded residuals of block
+	uns32		i;				// block start
+	uns32		j;				// pixel within block
+	uns32		k;				// Rice parameter
+	uns32		nblock;			// pixels in block
+	uns32		q;				// unary part
+	ulong64		sum;			// folded residuals of block
+
+	coded[0] = TILE_RICE;
+	coded[1] = 0;
+	bits.ptr = coded + 2;
+	bits.end = coded + limit;
+	bits.acc = 0;
+	bits.nbit = 0;
+	prev = 0;
+	for (i = 0; i < npixel; i += RICE_BLOCK) {
+		nblock = (npixel - i < RICE_BLOCK) ? npixel - i : RICE_BLOCK;
+		sum = 0;
+		for (j = 0; j < nblock; j++) {
+			residual = (int32) pixel[i + j] - prev;
+			prev = (int32) pixel[i + j];
+			fold[j] = ((uns32) residual << 1) ^ (uns32) (residual >> 31);
+			sum += fold[j];
+		}
+
+		// k near log2 of the mean residual
+		for (k = 0; (k < 16) && (((ulong64) nblock << (k + 1)) <= sum); k++) {
+		}
+		if (!bits_put(&bits, k, 5)) {
+			return(0);
+		}
+		for (j = 0; j < nblock; j++) {
+			q = fold[j] >> k;
+			if (q < RICE_ESCAPE) {
+				if (!bits_put(&bits, (1u << q) - 1, q + 1) || !bits_put(&bits, fold[j] & ((1u << k) - 1), k)) {
+					return(0);
+				}
+			}
+			else if (!bits_put(&bits, (1u << RICE_ESCAPE) - 1, RICE_ESCAPE) || !bits_put(&bits, fold[j], 17)) {
+				return(0);
+			}
+		}
+	}
+	if (!bits_flush(&bits)) {
+		return(0);
+	}
+	return((uns32) (bits.ptr - coded));
+}
+
+
+// decode tile, 0 if it is corrupt
+static rs_bool codec_decode(const uns8 *coded, uns32 nbyte, uns16 *pixel, uns32 npixel) {
+
+	// declarations
+	codec_bits	bits;			// input stream
+	int32		prev;			// previous pixel
+	uns32		depth;			// packed width
+	uns32		fold;			// zigzag folded residual
+	uns32		i;				// pixel counter
+	uns32		k;				// Rice parameter
+	uns32		q;				// unary part
+
+	if (nbyte < 2) {
+		return(0);
+	}
+	bits.ptr = (uns8 *) coded + 2;
+	bits.end = (uns8 *) coded + nbyte;
+	bits.acc = 0;
+	bits.nbit = 0;
+	bits.overrun = 0;
+	if (coded[0] == TILE_PACKED) {
+		if (((depth = coded[1]) > 16) || (nbyte != 2 + pvcam_packed_bytes(npixel, depth))) {
+			return(0);
+		}
+		pvcam_unpack_pixels(coded + 2, npixel, depth, pixel);
+	}
+	else if (coded[0] == TILE_RICE) {
+		prev = 0;
+		k = 0;
+		for (i = 0; i < npixel; i++) {
+			if ((i % RICE_BLOCK == 0) && ((k = bits_get(&bits, 5)) > 16)) {
+				return(0);
+			}
+			for (q = 0; (q < RICE_ESCAPE) && bits_get(&bits, 1); q++) {
+			}
+			fold = (q < RICE_ESCAPE) ? ((q << k) | bits_get(&bits, k)) : bits_get(&bits, 17);
+			prev += (int32) (fold >> 1) ^ -(int32) (fold & 1);
+			pixel[i] = (uns16) prev;
+		}
+	}
+	else {
+		return(0);
+	}
+	return(!bits.overrun);
+}
+
+
+// write count (<= 32) bits, 0 if buffer is full
+static rs_bool bits_put(codec_bits *bits, uns32 value, uns32 count) {
+	bits->acc |= (ulong64) value << bits->nbit;
+	bits->nbit += count;
+	while (bits->nbit >= 8) {
+		if (bits->ptr == bits->end) {
+			return(0);
+		}
+		*bits->ptr++ = (uns8) bits->acc;
+		bits->acc >>= 8;
+		bits->nbit -= 8;
+	}
+	return(1);
+}
+
+
+// write out bits still held, 0 if buffer is full
+static rs_bool bits_flush(codec_bits *bits) {
+	if (bits->nbit > 0) {
+		if (bits->ptr == bits->end) {
+			return(0);
+		}
+		*bits->ptr++ = (uns8) bits->acc;
+		bits->acc = 0;
+		bits->nbit = 0;
+	}
+	return(1);
+}
+
+
+// read count (<= 32) bits
+// bits past the end of the buffer read as zero and mark the stream overrun
+static uns32 bits_get(codec_bits *bits, uns32 count) {
+
+	// declarations
+	uns32		value;			// bits read
+
+	while (bits->nbit < count) {
+		if (bits->ptr < bits->end) {
+			bits->acc |= (ulong64) *bits->ptr++ << bits->nbit;
+		}
+		else {
+			bits->overrun = 1;
+		}
+		bits->nbit += 8;
+	}
+	value = (uns32) (bits->acc & (((ulong64) 1 << count) - 1));
+	bits->acc >>= count;
+	bits->nbit -= count;
+	return(value);
+}
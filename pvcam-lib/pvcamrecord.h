@@ -0,0 +1,113 @@
+/* Compressed frame recording for PVCAM MEX files */
+
+/* 10/18/26 */
+
+#ifndef _PVCAMRECORD_H
+#define _PVCAMRECORD_H
+
+// inclusions
+#include "pvcamstream.h"
+#include <stdio.h>
+
+
+// definitions
+#define RECORD_MAGIC	"PVCAMREC"	// first bytes of a recording
+#define RECORD_VERSION	1			// recording layout version
+#define RECORD_FRAME	0x4D415246	// 'FRAM', start of each frame record
+#define RECORD_END		0x58444E49	// 'INDX', end of the frame index
+#define RECORD_ALIGN	8			// records start on multiples of this
+#define RECORD_TILE		8192		// pixels per independently coded tile
+#define RECORD_IOBUF	(1 << 20)	// stdio buffer for the recording file
+#define RECORD_INDEX	1024		// frame index entries allocated at first
+#define CODEC_PACK		0			// tiles bit-packed to their widest pixel
+#define CODEC_RICE		1			// tiles delta and Rice coded, packed where smaller
+#define TILE_PACKED		0			// tile mode byte: bit-packed pixels
+#define TILE_RICE		1			// tile mode byte: Rice coded residuals
+#define RICE_BLOCK		32			// residuals sharing one Rice parameter
+#define RICE_ESCAPE		24			// unary length escaping to a raw residual
+
+
+// recording file header, followed by the region list
+typedef struct pvcam_record_header {
+	char		magic[8];		// RECORD_MAGIC, not terminated
+	uns32		version;		// RECORD_VERSION
+	uns32		npixel;			// pixels per frame
+	uns32		nregion;		// number of regions
+	uns32		tile_pixels;	// pixels per tile
+	uns32		bit_depth;		// sensor bit depth, 0 if not known
+	uns32		codec;			// CODEC_PACK or CODEC_RICE
+} pvcam_record_header;
+
+// frame record header, followed by the tile sizes and the coded tiles
+typedef struct pvcam_frame_record {
+	uns32		magic;			// RECORD_FRAME
+	uns32		frame_nr;		// frame number (1-based)
+	uns32		nbyte;			// bytes after this header, padding included
+	uns32		ntile;			// number of tiles
+	double		bof_ns;			// beginning of frame timestamp (ns)
+	double		eof_ns;			// end of frame timestamp (ns)
+	double		exp_ns;			// exposure time (ns)
+} pvcam_frame_record;
+
+// end of a closed recording, after the frame index
+typedef struct pvcam_record_trailer {
+	ulong64		index_offset;	// file offset of frame index
+	uns32		nframe;			// frames in index
+	uns32		magic;			// RECORD_END
+} pvcam_record_trailer;
+
+// recording being written
+typedef struct pvcam_recorder {
+	FILE		*file;			// recording file
+	char		*iobuf;			// stdio buffer
+	int			codec;			// CODEC_PACK or CODEC_RICE
+	uns32		npixel;			// pixels per frame
+	uns32		ntile;			// tiles per frame
+	uns32		tile_bytes;		// scratch per tile, worst case
+	uns8		*scratch;		// coded tiles, tile_bytes apart
+	uns32		*tile_size;		// coded bytes of each tile
+	ulong64		offset;			// bytes written so far
+	ulong64		*index;			// file offset of each frame record
+	uns32		nframe;			// frames written
+	uns32		nindex;			// index capacity
+	const char	*err_msg;		// reason for last failure
+} pvcam_recorder;
+
+// recording mapped read-only into memory
+typedef struct pvcam_recording {
+	const uns8	*base;			// start of mapping
+	ulong64		size;			// bytes mapped
+	const pvcam_record_header	*header;	// file header
+	const rgn_type	*region;	// region list
+	uns32		ntile;			// tiles per frame
+	uns32		nframe;			// frames found
+	const pvcam_frame_record	**frame;	// frame records in order
+	rs_bool		indexed;		// frames found through index, not by scanning
+	void		*file_handle;	// platform file handle
+	void		*map_handle;	// platform mapping handle
+	const char	*err_msg;		// reason for last failure
+} pvcam_recording;
+
+
+// function prototypes
+
+// create recording file for frames over regions
+rs_bool pvcam_record_open(pvcam_recorder *rec, const char *path, uns16 nregion, const rgn_type *region,
+						  uns32 bit_depth, int codec);
+
+// code tiles of frame across worker threads and append frame record
+rs_bool pvcam_record_frame(pvcam_recorder *rec, const pvcam_frame *frame);
+
+// write frame index and close recording, 0 if anything failed to reach the file
+rs_bool pvcam_record_close(pvcam_recorder *rec);
+
+// map recording into memory and locate its frames
+rs_bool pvcam_recording_open(pvcam_recording *recording, const char *path);
+
+// decode selected frames (0-based) across worker threads
+rs_bool pvcam_recording_read(const pvcam_recording *recording, const uns32 *select, uns32 nselect, uns16 *pixels);
+
+// unmap recording
+void pvcam_recording_close(pvcam_recording *recording);
+
+#endif /* _PVCAMRECORD_H */
@@ -0,0 +1,836 @@
+/* PVCAMRING - keep the latest frames in memory and capture them around a trigger
+
+      FLAG = PVCAMRING(HCAM, ROI, EXPTIME, EXPMODE, OPTS) starts continuous
+	  acquisition on the camera specified by HCAM, with ROI, EXPTIME and
+	  EXPMODE as in PVCAMACQ, and returns at once.  A background thread
+	  pulls every frame out of the circular buffer (CIRC_OVERWRITE) and
+	  copies it into a fixed ring of frames in host memory, so the ring
+	  always holds the latest frames while MATLAB carries on.  Starting
+	  again replaces a running ring.  FLAG is 1 if successful, 0 if an
+	  error occurred.  OPTS is an optional structure with fields:
+
+					pre = frames captured before the trigger frame (default 0)
+					post = frames captured after the trigger frame (default 0)
+					frames = frames held in the ring (default pre + post + 1)
+					buffer = frames in circular buffer (default 16)
+					rules = structure array of trigger rules (default none, see below)
+
+	  frames must be at least pre + 1.  Any more frames let a trigger
+	  reach further back in time (see T below).
+
+	  Each element of rules watches one statistic of every frame as it
+	  arrives and triggers an event by itself when the statistic crosses a
+	  level, so no frame has to reach MATLAB to be judged.  Its fields are:
+
+					region = position of the region in ROI, 0 for the whole frame (default 0)
+					stat = 'mean', 'min' or 'max' of the pixels (DN)
+					op = 'above', 'below' or 'change'
+					level = threshold (DN)
+
+	  'above' fires on the first frame whose statistic is above level
+	  after a frame that was not, 'below' likewise, and 'change' fires
+	  when the statistic moves by level or more from one frame to the
+	  next.  The frame that fires becomes the trigger frame.  The rules
+	  are evaluated on the acquisition thread right after each frame is
+	  copied into the ring; the first rule that fires wins, and rules that
+	  fire while the ring holds an event are ignored.
+
+      FLAG = PVCAMRING(HCAM, 'trigger') takes the newest frame in the ring
+	  as the trigger frame of an event, or the first frame if none has
+	  arrived yet.  The pre frames before it are already in the ring, and
+	  the thread goes on to capture the post frames after it.
+
+      FLAG = PVCAMRING(HCAM, 'trigger', T) takes the trigger frame from the
+	  frame metadata instead: it is the first frame whose bof timestamp
+	  (camera clock in ns, as META.bof of PVCAMACQ) is at or after T.  T
+	  may lie in the past, as long as the frame is still in the ring, or
+	  in the future, in which case the thread waits for the frame.  This
+	  needs frame metadata (PARAM_METADATA_ENABLED).
+
+	  FLAG = 1 when this call triggered an event.  The ring holds one
+	  event at a time, so FLAG = 0 when it was already triggered, by an
+	  earlier 'trigger' or by a rule, and that event was not read yet.
+
+      [DATA, META, EVENT] = PVCAMRING(HCAM, 'read') waits until the post
+	  frames of the triggered event have arrived and returns the event.
+	  DATA holds its frames one after another, pixel data only, as
+	  PVCAMACQ with OPTS returns them.  META has fields frame, bof, eof,
+	  exptime and dropped (1 x N vectors, as in PVCAMACQ), and EVENT has
+	  fields:
+
+					trigger = position of the trigger frame in DATA
+					pre = frames in DATA before the trigger frame
+					post = frames in DATA after the trigger frame
+					dropped = frames missing from the event
+					rule = position of the rule that fired in OPTS.rules, 0 for 'trigger'
+					value = statistic that fired the rule (DN), NaN for 'trigger'
+
+	  pre falls short of OPTS.pre when the trigger came before the ring
+	  had filled up, or when T pointed at a frame near the end of the
+	  ring.  Reading rearms the ring for the next trigger.
+
+      [...] = PVCAMRING(HCAM, 'read', TIMEOUT) gives up after TIMEOUT
+	  seconds, returning DATA = [] and leaving the event pending.
+
+      STATUS = PVCAMRING(HCAM, 'status') returns without waiting a
+	  structure with fields state ('idle', 'pending', 'capturing' or
+	  'ready'), frames (frames pulled since the start), overrun (frames
+	  overwritten in the circular buffer before the thread got to them or
+	  while it copied them),
+	  events (events read) and values (statistic of each rule on the
+	  latest frame, to help choose levels).
+
+      PVCAMRING(HCAM, 'stop') stops acquisition and frees the ring.  Rings
+	  are also stopped when the camera is closed or the MEX file cleared.
+	  Other commands that set up the camera must not run while the ring
+	  runs; the ring notices on its next call, stops and warns. */
+
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamstream.h"
+#include "pvcambuffer.h"
+#include "pvcamproc.h"
+#include "pvcamthread.h"
+#include "pvcamtime.h"
+#include <math.h>
+#include <stdlib.h>
+
+
+// definitions
+#define RING_IDLE		0		// no trigger given
+#define RING_PENDING	1		// trigger given, trigger frame not yet found
+#define RING_CAPTURING	2		// trigger frame found, post frames arriving
+#define RING_READY		3		// event complete, waiting to be read
+#define RING_POLL_MS	1		// sleep between checks while waiting for an event
+#define RING_META_FIELD	5		// number of fields in metadata structure
+#define RING_EVENT_FIELD	6	// number of fields in event structure
+#define RING_STATUS_FIELD	5	// number of fields in status structure
+#define RULE_MEAN		0		// rule watches mean pixel
+#define RULE_MIN		1		// rule watches lowest pixel
+#define RULE_MAX		2		// rule watches highest pixel
+#define RULE_ABOVE		0		// rule fires when statistic rises above level
+#define RULE_BELOW		1		// rule fires when statistic falls below level
+#define RULE_CHANGE		2		// rule fires when statistic moves by level between frames
+
+
+// metadata of one frame in the ring
+typedef struct ring_meta {
+	double		frame_nr;		// frame number (1-based)
+	double		bof_ns;			// beginning of frame timestamp (ns)
+	double		eof_ns;			// end of frame timestamp (ns)
+	double		exp_ns;			// exposure time (ns)
+	double		ndropped;		// frames missing just before this frame
+} ring_meta;
+
+// content rule evaluated on every frame
+typedef struct ring_rule {
+	uns16		region;			// region position in ROI (1-based), 0 for whole frame
+	int			stat;			// RULE_MEAN, RULE_MIN or RULE_MAX
+	int			op;				// RULE_ABOVE, RULE_BELOW or RULE_CHANGE
+	double		level;			// threshold (DN)
+	double		value;			// statistic of latest frame (DN), NaN before the first
+} ring_rule;
+
+// frame ring of one camera
+// the MATLAB thread only touches the ring slots through the event copy,
+// which the acquisition thread hands over by moving state to RING_READY
+typedef struct frame_ring {
+	rs_bool		used;			// slot holds a running ring
+	int16		hcam;			// camera handle
+	uns32		generation;		// camera setup generation when started
+	uns32		npixel;			// pixels per frame
+	uns32		nslot;			// frames held in ring
+	uns32		npre;			// frames captured before trigger frame
+	uns32		npost;			// frames captured after trigger frame
+	uns16		nregion;		// number of regions
+	uns32		*region_offset;	// first pixel of each region, then npixel
+	pvcam_summary	*summary;	// statistics of each region of the latest frame
+	uns32		nrule;			// number of content rules
+	ring_rule	*rule;			// content rules
+	uns16		*pixels;		// ring slots, npixel apart
+	ring_meta	*meta;			// metadata of each slot
+	volatile long	nwritten;	// frames written into ring, frame k in slot k % nslot
+	volatile long	state;		// RING_ state of the event
+	volatile long	failed;		// acquisition thread stopped on an error
+	long		trigger_nr;		// ring position of software trigger frame
+	double		trigger_ns;		// bof of metadata trigger frame (ns), -1 for software trigger
+	uns32		event_first;	// ring position of first event frame
+	uns32		event_trigger;	// ring position of trigger frame
+	uns32		event_end;		// ring position after last event frame
+	uns32		nevent;			// frames copied into event
+	uns32		event_rule;		// rule that fired event (1-based), 0 for software trigger
+	double		event_value;	// statistic that fired event (DN)
+	uns32		nread;			// events read
+	uns16		*event;			// event frames
+	ring_meta	*event_meta;	// metadata of event frames
+	pvcam_stream	stream;		// continuous acquisition
+	pvcam_thread	*thread;	// acquisition thread
+	const char	*err_msg;		// reason the acquisition thread stopped
+} frame_ring;
+
+
+// function prototypes
+
+// find ring of camera, NULL if none
+frame_ring *pvcam_ring_find(int16 hcam);
+
+// start ring on camera, replacing any other
+rs_bool pvcam_ring_start(int16 hcam, uns16 nregion, const rgn_type *region, uns32 exptime, int16 expmode,
+						 const mxArray *opts);
+
+// give trigger, software trigger when trigger_ns is negative
+// returns 0 if the ring was already triggered
+rs_bool pvcam_ring_trigger(frame_ring *ring, double trigger_ns);
+
+// wait for triggered event and copy it into MATLAB arrays
+void pvcam_ring_read(frame_ring *ring, double timeout, int nlhs, mxArray *plhs[]);
+
+// build status structure of ring
+mxArray *pvcam_ring_status(const frame_ring *ring);
+
+// stop acquisition and free ring
+void pvcam_ring_release(frame_ring *ring);
+
+// free every ring when the MEX file is cleared
+void pvcam_ring_exit(void);
+
+// acquisition thread, pulls frames into the ring until stopped
+static void ring_thread(void *task_ctx, uns32 task);
+
+// evaluate content rules on latest frame, returns rule that fired (1-based) or 0
+static uns32 ring_evaluate(frame_ring *ring, const uns16 *pixels, double *value);
+
+// set event around trigger frame, leaving out frames no longer held
+static void ring_locate(frame_ring *ring, uns32 trigger);
+
+// find trigger frame and copy newly arrived frames of the event
+static void ring_capture(frame_ring *ring);
+
+// parse OPTS.rules into MATLAB memory
+static ring_rule *ring_rules(const mxArray *opts, uns16 nregion, uns32 *nrule);
+
+
+// global variables
+static frame_ring	rings[MAX_CAMERA];		// frame rings, one per camera
+static rs_bool		exit_registered = 0;	// pvcam_ring_exit registered
+
+
+// command routine, also reached as pvcam('ring', ...)
+void pvcam_cmd_ring(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	char		*command;	// command string
+	frame_ring	*ring;		// ring of camera
+	int16		hcam;		// camera handle
+	int16		expmode;	// exposure mode
+	rgn_type	*region;	// ROI structure
+	uns16		nregion;	// number of regions
+	uns32		exptime;	// exposure time
+
+	// validate arguments
+	if ((nrhs < 2) || (nrhs > 5) || (nlhs > 3)) {
+		mexErrMsgTxt("type 'help pvcamring' for syntax");
+	}
+	if (!exit_registered) {
+		pvcam_at_exit(pvcam_ring_exit);
+		pvcam_at_exit(pvcam_buffer_trim);
+		exit_registered = 1;
+	}
+
+	// obtain camera handle
+	// ring cannot survive its camera being closed or set up by another command
+	hcam = pvcam_camera_handle(prhs[0]);
+	ring = pvcam_ring_find(hcam);
+	if (!pl_cam_check(hcam)) {
+		if (ring != NULL) {
+			pvcam_ring_release(ring);
+		}
+		pvcam_error(hcam, "HCAM is not a handle to an open camera");
+		plhs[0] = mxCreateDoubleScalar(0.0);
+		return;
+	}
+	if ((ring != NULL) && (ring->generation != pvcam_core_generation(hcam))) {
+		pvcam_ring_release(ring);
+		pvcam_error(hcam, "Camera was set up by another command, ring stopped");
+		ring = NULL;
+	}
+
+	// start new ring
+	if (!mxIsChar(prhs[1])) {
+		if (nrhs < 4) {
+			mexErrMsgTxt("type 'help pvcamring' for syntax");
+		}
+		region = pvcam_region_array(prhs[1], &nregion);
+		if (!mxIsNumeric(prhs[2]) || (mxGetNumberOfElements(prhs[2]) != 1)) {
+			mexErrMsgTxt("EXPTIME must be a numeric scalar");
+		}
+		exptime = (uns32) mxGetScalar(prhs[2]);
+		expmode = pvcam_exposure_mode(prhs[3]);
+		if ((nrhs > 4) && !mxIsStruct(prhs[4])) {
+			mexErrMsgTxt("OPTS must be a structure");
+		}
+		plhs[0] = mxCreateDoubleScalar((double) pvcam_ring_start(hcam, nregion, region, exptime, expmode,
+			(nrhs > 4) ? prhs[4] : NULL));
+		mxFree((void *) region);
+		return;
+	}
+
+	// obtain command
+	command = mxArrayToString(prhs[1]);
+	if ((nrhs > 3) || ((nrhs == 3) && (!mxIsNumeric(prhs[2]) || (mxGetNumberOfElements(prhs[2]) != 1)))) {
+		mxFree((void *) command);
+		mexErrMsgTxt("type 'help pvcamring' for syntax");
+	}
+	if (strcmp(command, "stop") == 0) {
+		if (ring != NULL) {
+			pvcam_ring_release(ring);
+		}
+		plhs[0] = mxCreateDoubleScalar(1.0);
+	}
+	else if ((strcmp(command, "trigger") != 0) && (strcmp(command, "read") != 0) && (strcmp(command, "status") != 0)) {
+		mxFree((void *) command);
+		mexErrMsgTxt("COMMAND must be 'trigger', 'read', 'status' or 'stop'");
+	}
+	else if (ring == NULL) {
+		mxFree((void *) command);
+		mexErrMsgTxt("No ring running on HCAM, see 'help pvcamring'");
+	}
+
+	// acquisition thread may have stopped on its own
+	else if (ring->failed) {
+		pvcam_error(hcam, ring->err_msg);
+		pvcam_ring_release(ring);
+		if (strcmp(command, "read") == 0) {
+			plhs[0] = mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL);
+			if (nlhs > 1) {
+				plhs[1] = mxCreateDoubleMatrix(0, 0, mxREAL);
+			}
+			if (nlhs > 2) {
+				plhs[2] = mxCreateDoubleMatrix(0, 0, mxREAL);
+			}
+		}
+		else {
+			plhs[0] = mxCreateDoubleScalar(0.0);
+		}
+	}
+	else if (strcmp(command, "trigger") == 0) {
+		plhs[0] = mxCreateDoubleScalar((double) pvcam_ring_trigger(ring, (nrhs == 3) ? mxGetScalar(prhs[2]) : -1.0));
+	}
+	else if (strcmp(command, "read") == 0) {
+		pvcam_ring_read(ring, (nrhs == 3) ? mxGetScalar(prhs[2]) : -1.0, nlhs, plhs);
+	}
+	else {
+		plhs[0] = pvcam_ring_status(ring);
+	}
+	mxFree((void *) command);
+}
+
+
+// find ring of camera, NULL if none
+frame_ring *pvcam_ring_find(int16 hcam) {
+
+	// declarations
+	int		i;				// loop counter
+
+	for (i = 0; i < MAX_CAMERA; i++) {
+		if (rings[i].used && (rings[i].hcam == hcam)) {
+			return(&rings[i]);
+		}
+	}
+	return(NULL);
+}
+
+
+// start ring on camera, replacing any other
+rs_bool pvcam_ring_start(int16 hcam, uns16 nregion, const rgn_type *region, uns32 exptime, int16 expmode,
+						 const mxArray *opts) {
+
+	// declarations
+	frame_ring	*ring;		// ring of camera
+	int			i;			// loop counter
+	ring_rule	*rule;		// content rules in MATLAB memory
+	uns32		nbuffer;	// frames in circular buffer
+	uns32		npost;		// frames after trigger frame
+	uns32		npre;		// frames before trigger frame
+	uns32		nrule;		// number of content rules
+	uns32		nslot;		// frames held in ring
+
+	// obtain options
+	npre = (uns32) pvcam_option_value(opts, "pre", 0.0);
+	npost = (uns32) pvcam_option_value(opts, "post", 0.0);
+	nslot = (uns32) pvcam_option_value(opts, "frames", (double) npre + npost + 1.0);
+	nbuffer = (uns32) pvcam_option_value(opts, "buffer", (double) STREAM_BUFFER);
+	if (nslot < npre + 1) {
+		mexErrMsgTxt("OPTS.frames must be at least OPTS.pre + 1");
+	}
+	rule = ring_rules(opts, nregion, &nrule);
+
+	// replace running ring
+	ring = pvcam_ring_find(hcam);
+	if (ring != NULL) {
+		pvcam_ring_release(ring);
+	}
+	for (i = 0; (i < MAX_CAMERA) && rings[i].used; i++) {
+	}
+	if (i == MAX_CAMERA) {
+		pvcam_error(hcam, "Too many frame rings");
+		return(0);
+	}
+	ring = &rings[i];
+	memset(ring, 0, sizeof(frame_ring));
+	ring->used = 1;
+	ring->hcam = hcam;
+	ring->npixel = pvcam_region_pixels(nregion, region);
+	ring->nslot = nslot;
+	ring->npre = npre;
+	ring->npost = npost;
+	ring->nregion = nregion;
+	ring->nrule = nrule;
+
+	// allocate ring and event storage
+	ring->pixels = (uns16 *) pvcam_buffer_alloc((size_t) nslot * ring->npixel * sizeof(uns16));
+	ring->meta = (ring_meta *) malloc((size_t) nslot * sizeof(ring_meta));
+	ring->event = (uns16 *) pvcam_buffer_alloc(((size_t) npre + npost + 1) * ring->npixel * sizeof(uns16));
+	ring->event_meta = (ring_meta *) malloc(((size_t) npre + npost + 1) * sizeof(ring_meta));
+	ring->region_offset = (uns32 *) malloc(((size_t) nregion + 1) * sizeof(uns32));
+	ring->summary = (pvcam_summary *) malloc((size_t) nregion * sizeof(pvcam_summary));
+	ring->rule = (ring_rule *) malloc(((size_t) nrule + 1) * sizeof(ring_rule));
+	if ((ring->pixels == NULL) || (ring->meta == NULL) || (ring->event == NULL) || (ring->event_meta == NULL) ||
+		(ring->region_offset == NULL) || (ring->summary == NULL) || (ring->rule == NULL)) {
+		mxFree((void *) rule);
+		pvcam_error(hcam, "Cannot allocate frame ring");
+		pvcam_ring_release(ring);
+		return(0);
+	}
+	memcpy(ring->rule, rule, (size_t) nrule * sizeof(ring_rule));
+	mxFree((void *) rule);
+	ring->region_offset[0] = 0;
+	for (i = 0; i < nregion; i++) {
+		ring->region_offset[i + 1] = ring->region_offset[i] + pvcam_region_pixels(1, &region[i]);
+	}
+
+	// start continuous acquisition, then hand the stream to the acquisition thread
+	if (!pvcam_stream_open(&ring->stream, hcam, nregion, region, exptime, expmode, nbuffer, 0)) {
+		pvcam_error(hcam, ring->stream.err_msg);
+		pvcam_ring_release(ring);
+		return(0);
+	}
+	ring->generation = pvcam_core_touch(hcam);
+	if (ring->stream.centroids) {
+		pvcam_error(hcam, "PrimeLocate is on, frame rings hold pixels only");
+		pvcam_ring_release(ring);
+		return(0);
+	}
+	if ((ring->thread = pvcam_thread_start(ring_thread, (void *) ring)) == NULL) {
+		pvcam_error(hcam, "Cannot start acquisition thread");
+		pvcam_ring_release(ring);
+		return(0);
+	}
+	return(1);
+}
+
+
+// give trigger, software trigger when trigger_ns is negative
+// returns 0 if the ring was already triggered
+rs_bool pvcam_ring_trigger(frame_ring *ring, double trigger_ns) {
+
+	// declarations
+	long	nwritten;		// frames written into ring
+
+	if ((trigger_ns >= 0.0) && !ring->stream.has_meta) {
+		pvcam_error(ring->hcam, "Triggering on T needs frame metadata, see PARAM_METADATA_ENABLED");
+		return(0);
+	}
+	if (ring->state != RING_IDLE) {
+		pvcam_error(ring->hcam, "Ring already holds an event, read it first");
+		return(0);
+	}
+
+	// trigger fields are published by the state change
+	// a rule firing since the check wins, and the fields are then never read
+	nwritten = ring->nwritten;
+	ring->trigger_nr = (nwritten > 0) ? nwritten - 1 : 0;
+	ring->trigger_ns = trigger_ns;
+	return(pvcam_atomic_swap(&ring->state, RING_IDLE, RING_PENDING) == RING_IDLE);
+}
+
+
+// wait for triggered event and copy it into MATLAB arrays
+void pvcam_ring_read(frame_ring *ring, double timeout, int nlhs, mxArray *plhs[]) {
+
+	// declarations
+	const char	*meta_list[RING_META_FIELD] = {"frame", "bof", "eof", "exptime", "dropped"};
+	const char	*event_list[RING_EVENT_FIELD] = {"trigger", "pre", "post", "dropped", "rule", "value"};
+	double		*meta_ptr[RING_META_FIELD];	// metadata output columns
+	double		ndropped;		// frames missing from event
+	ulong64		start_ns;		// host clock when waiting started
+	uns32		i;				// frame counter
+
+	if (ring->state == RING_IDLE) {
+		mexErrMsgTxt("No trigger given on ring, see 'help pvcamring'");
+	}
+
+	// wait for the acquisition thread to hand over the event
+	start_ns = pvcam_clock_ns();
+	while (pvcam_atomic_swap(&ring->state, RING_READY, RING_READY) != RING_READY) {
+		if (ring->failed || ((timeout >= 0.0) && ((double) (pvcam_clock_ns() - start_ns) > timeout * 1e9))) {
+			if (ring->failed) {
+				pvcam_error(ring->hcam, ring->err_msg);
+				pvcam_ring_release(ring);
+			}
+			plhs[0] = mxCreateNumericMatrix(0, 0, mxUINT16_CLASS, mxREAL);
+			if (nlhs > 1) {
+				plhs[1] = mxCreateDoubleMatrix(0, 0, mxREAL);
+			}
+			if (nlhs > 2) {
+				plhs[2] = mxCreateDoubleMatrix(0, 0, mxREAL);
+			}
+			return;
+		}
+		pvcam_thread_sleep(RING_POLL_MS);
+	}
+
+	// copy event frames and metadata
+	plhs[0] = mxCreateNumericMatrix(1, (size_t) ring->nevent * ring->npixel, mxUINT16_CLASS, mxREAL);
+	memcpy(mxGetData(plhs[0]), ring->event, (size_t) ring->nevent * ring->npixel * sizeof(uns16));
+	ndropped = 0.0;
+	for (i = 1; i < ring->nevent; i++) {
+		ndropped += ring->event_meta[i].ndropped;
+	}
+	if (nlhs > 1) {
+		plhs[1] = mxCreateStructMatrix(1, 1, RING_META_FIELD, meta_list);
+		for (i = 0; i < RING_META_FIELD; i++) {
+			mxSetFieldByNumber(plhs[1], 0, (int) i, mxCreateDoubleMatrix(1, ring->nevent, mxREAL));
+			meta_ptr[i] = mxGetPr(mxGetFieldByNumber(plhs[1], 0, (int) i));
+		}
+		for (i = 0; i < ring->nevent; i++) {
+			meta_ptr[0][i] = ring->event_meta[i].frame_nr;
+			meta_ptr[1][i] = ring->event_meta[i].bof_ns;
+			meta_ptr[2][i] = ring->event_meta[i].eof_ns;
+			meta_ptr[3][i] = ring->event_meta[i].exp_ns;
+			meta_ptr[4][i] = ring->event_meta[i].ndropped;
+		}
+	}
+	if (nlhs > 2) {
+		plhs[2] = mxCreateStructMatrix(1, 1, RING_EVENT_FIELD, event_list);
+		mxSetFieldByNumber(plhs[2], 0, 0, mxCreateDoubleScalar((double) (ring->event_trigger - ring->event_first + 1)));
+		mxSetFieldByNumber(plhs[2], 0, 1, mxCreateDoubleScalar((double) (ring->event_trigger - ring->event_first)));
+		mxSetFieldByNumber(plhs[2], 0, 2, mxCreateDoubleScalar((double) (ring->event_end - ring->event_trigger - 1)));
+		mxSetFieldByNumber(plhs[2], 0, 3, mxCreateDoubleScalar(ndropped));
+		mxSetFieldByNumber(plhs[2], 0, 4, mxCreateDoubleScalar((double) ring->event_rule));
+		mxSetFieldByNumber(plhs[2], 0, 5, mxCreateDoubleScalar((ring->event_rule > 0) ? ring->event_value : mxGetNaN()));
+	}
+
+	// rearm for next trigger
+	ring->nread++;
+	pvcam_atomic_swap(&ring->state, RING_READY, RING_IDLE);
+}
+
+
+// build status structure of ring
+mxArray *pvcam_ring_status(const frame_ring *ring) {
+
+	// declarations
+	const char	*field_list[RING_STATUS_FIELD] = {"state", "frames", "overrun", "events", "values"};
+	const char	*state_list[4] = {"idle", "pending", "capturing", "ready"};
+	double		*value_ptr;		// rule statistics output
+	mxArray		*status_struct;	// output structure
+	uns32		i;				// rule counter
+
+	status_struct = mxCreateStructMatrix(1, 1, RING_STATUS_FIELD, field_list);
+	mxSetFieldByNumber(status_struct, 0, 0, mxCreateString(state_list[ring->state]));
+	mxSetFieldByNumber(status_struct, 0, 1, mxCreateDoubleScalar((double) ring->nwritten));
+	mxSetFieldByNumber(status_struct, 0, 2, mxCreateDoubleScalar((double) (ring->stream.stats.noverrun +
+		ring->stream.stats.noverwritten)));
+	mxSetFieldByNumber(status_struct, 0, 3, mxCreateDoubleScalar((double) ring->nread));
+	mxSetFieldByNumber(status_struct, 0, 4, mxCreateDoubleMatrix(1, ring->nrule, mxREAL));
+	value_ptr = mxGetPr(mxGetFieldByNumber(status_struct, 0, 4));
+	for (i = 0; i < ring->nrule; i++) {
+		value_ptr[i] = ring->rule[i].value;
+	}
+	return(status_struct);
+}
+
+
+// stop acquisition and free ring
+void pvcam_ring_release(frame_ring *ring) {
+	ring->stream.stop = 1;
+	pvcam_thread_join(ring->thread);
+	pvcam_stream_close(&ring->stream);
+	pvcam_buffer_free((void *) ring->pixels);
+	free((void *) ring->meta);
+	pvcam_buffer_free((void *) ring->event);
+	free((void *) ring->event_meta);
+	free((void *) ring->region_offset);
+	free((void *) ring->summary);
+	free((void *) ring->rule);
+	memset(ring, 0, sizeof(frame_ring));
+}
+
+
+// free every ring when the MEX file is cleared
+void pvcam_ring_exit(void) {
+
+	// declarations
+	int		i;				// loop counter
+
+	for (i = 0; i < MAX_CAMERA; i++) {
+		if (rings[i].used) {
+			pvcam_ring_release(&rings[i]);
+		}
+	}
+}
+
+
+// acquisition thread, pulls frames into the ring until stopped
+// runs off the MATLAB thread, so failures go to err_msg
+static void ring_thread(void *task_ctx, uns32 task) {
+
+	// declarations
+	frame_ring	*ring;			// ring being filled
+	pvcam_frame	frame;			// frame pulled from circular buffer
+	ring_meta	*meta;			// metadata of slot
+	double		value;			// statistic that fired a rule
+	uns32		fired;			// rule that fired, 0 if none
+	uns32		slot;			// ring slot of frame
+
+	(void) task;
+	ring = (frame_ring *) task_ctx;
+	while (pvcam_stream_next(&ring->stream, &frame)) {
+		if (frame.npixel != ring->npixel) {
+			ring->stream.err_msg = "Frame size does not match ROI";
+			break;
+		}
+		slot = (uns32) ring->nwritten % ring->nslot;
+		memcpy(ring->pixels + (size_t) slot * ring->npixel, frame.pixels, (size_t) ring->npixel * sizeof(uns16));
+		meta = &ring->meta[slot];
+		meta->frame_nr = (double) frame.frame_nr;
+		meta->bof_ns = frame.bof_ns;
+		meta->eof_ns = frame.eof_ns;
+		meta->exp_ns = frame.exp_ns;
+		meta->ndropped = (double) frame.ndropped;
+		ring->nwritten++;
+
+		// a rule firing on an idle ring triggers on this frame
+		// the state change keeps a 'trigger' from MATLAB out until the event is read
+		if ((ring->nrule > 0) && ((fired = ring_evaluate(ring, frame.pixels, &value)) > 0) &&
+			(ring->state == RING_IDLE)) {
+			ring_locate(ring, (uns32) ring->nwritten - 1);
+			ring->event_rule = fired;
+			ring->event_value = value;
+			pvcam_atomic_swap(&ring->state, RING_IDLE, RING_CAPTURING);
+		}
+		ring_capture(ring);
+	}
+
+	// stopping on request is not a failure
+	if (!ring->stream.stop) {
+		ring->err_msg = ring->stream.err_msg;
+		pvcam_atomic_swap(&ring->failed, 0, 1);
+	}
+}
+
+
+// find trigger frame and copy newly arrived frames of the event
+// runs on the acquisition thread after every frame
+static void ring_capture(frame_ring *ring) {
+
+	// declarations
+	long	state;			// event state
+	uns32	available;		// ring position after last event frame arrived so far
+	uns32	nwritten;		// frames written into ring
+	uns32	oldest;			// ring position of oldest frame still held
+	uns32	trigger;		// ring position of trigger frame
+
+	// barrier before the trigger fields are read
+	state = pvcam_atomic_swap(&ring->state, RING_PENDING, RING_PENDING);
+	if ((state == RING_IDLE) || (state == RING_READY)) {
+		return;
+	}
+	nwritten = (uns32) ring->nwritten;
+	oldest = (nwritten > ring->nslot) ? nwritten - ring->nslot : 0;
+
+	// software trigger names its frame, metadata trigger searches the ring for it
+	// frames already overwritten are left out of the event
+	if (state == RING_PENDING) {
+		if (ring->trigger_ns < 0.0) {
+			trigger = ((uns32) ring->trigger_nr > oldest) ? (uns32) ring->trigger_nr : oldest;
+		}
+		else {
+			for (trigger = oldest; (trigger < nwritten) && (ring->meta[trigger % ring->nslot].bof_ns < ring->trigger_ns);
+				trigger++) {
+			}
+			if (trigger == nwritten) {
+				return;
+			}
+		}
+		ring_locate(ring, trigger);
+		ring->event_rule = 0;
+		ring->state = RING_CAPTURING;
+	}
+
+	// copy what has arrived, in order
+	available = (nwritten < ring->event_end) ? nwritten : ring->event_end;
+	while (ring->event_first + ring->nevent < available) {
+		memcpy(ring->event + (size_t) ring->nevent * ring->npixel,
+			ring->pixels + (size_t) ((ring->event_first + ring->nevent) % ring->nslot) * ring->npixel,
+			(size_t) ring->npixel * sizeof(uns16));
+		ring->event_meta[ring->nevent] = ring->meta[(ring->event_first + ring->nevent) % ring->nslot];
+		ring->nevent++;
+	}
+	if (ring->event_first + ring->nevent == ring->event_end) {
+		pvcam_atomic_swap(&ring->state, RING_CAPTURING, RING_READY);
+	}
+}
+
+
+// evaluate content rules on latest frame, returns rule that fired (1-based) or 0
+// every rule sees every frame, so an edge is not carried over to a later frame
+static uns32 ring_evaluate(frame_ring *ring, const uns16 *pixels, double *value) {
+
+	// declarations
+	pvcam_summary	frame_summary;	// statistics of whole frame
+	const pvcam_summary	*summary;	// statistics the rule watches
+	ring_rule	*rule;			// current rule
+	double		current;		// statistic of this frame
+	double		previous;		// statistic of previous frame, NaN before the first
+	rs_bool		fire;			// rule fires on this frame
+	uns16		k;				// region counter
+	uns32		fired;			// first rule that fired
+	uns32		i;				// rule counter
+
+	// one pass over each region, merged for the whole frame
+	frame_summary.sum = 0.0;
+	frame_summary.npixel = 0;
+	frame_summary.min = 0xFFFF;
+	frame_summary.max = 0;
+	for (k = 0; k < ring->nregion; k++) {
+		pvcam_summarize(pixels + ring->region_offset[k], ring->region_offset[k + 1] - ring->region_offset[k],
+			&ring->summary[k]);
+		frame_summary.sum += ring->summary[k].sum;
+		frame_summary.npixel += ring->summary[k].npixel;
+		frame_summary.min = (ring->summary[k].min < frame_summary.min) ? ring->summary[k].min : frame_summary.min;
+		frame_summary.max = (ring->summary[k].max > frame_summary.max) ? ring->summary[k].max : frame_summary.max;
+	}
+
+	fired = 0;
+	for (i = 0; i < ring->nrule; i++) {
+		rule = &ring->rule[i];
+		summary = (rule->region == 0) ? &frame_summary : &ring->summary[rule->region - 1];
+		switch (rule->stat) {
+		case RULE_MIN:
+			current = (double) summary->min;
+			break;
+		case RULE_MAX:
+			current = (double) summary->max;
+			break;
+		default:
+			current = (summary->npixel > 0) ? summary->sum / (double) summary->npixel : 0.0;
+			break;
+		}
+
+		// comparisons with NaN are false, so nothing fires on the first frame
+		previous = rule->value;
+		switch (rule->op) {
+		case RULE_ABOVE:
+			fire = (previous <= rule->level) && (current > rule->level);
+			break;
+		case RULE_BELOW:
+			fire = (previous >= rule->level) && (current < rule->level);
+			break;
+		default:
+			fire = (fabs(current - previous) >= rule->level);
+			break;
+		}
+		rule->value = current;
+		if (fire && (fired == 0)) {
+			fired = i + 1;
+			*value = current;
+		}
+	}
+	return(fired);
+}
+
+
+// set event around trigger frame, leaving out frames no longer held
+static void ring_locate(frame_ring *ring, uns32 trigger) {
+
+	// declarations
+	uns32	nwritten;		// frames written into ring
+	uns32	oldest;			// ring position of oldest frame still held
+
+	nwritten = (uns32) ring->nwritten;
+	oldest = (nwritten > ring->nslot) ? nwritten - ring->nslot : 0;
+	ring->event_first = (trigger >= oldest + ring->npre) ? trigger - ring->npre : oldest;
+	ring->event_trigger = trigger;
+	ring->event_end = trigger + ring->npost + 1;
+	ring->nevent = 0;
+}
+
+
+// parse OPTS.rules into MATLAB memory
+static ring_rule *ring_rules(const mxArray *opts, uns16 nregion, uns32 *nrule) {
+
+	// declarations
+	const char	*stat_list[3] = {"mean", "min", "max"};
+	const char	*op_list[3] = {"above", "below", "change"};
+	char		*name;			// stat or op string
+	const mxArray	*field;		// field of current rule
+	const mxArray	*rules;		// rule structure array
+	ring_rule	*rule;			// parsed rules
+	double		region;			// region position
+	uns32		i;				// rule counter
+
+	rules = (opts != NULL) ? mxGetField(opts, 0, "rules") : NULL;
+	*nrule = ((rules != NULL) && !mxIsEmpty(rules)) ? (uns32) mxGetNumberOfElements(rules) : 0;
+	if ((*nrule > 0) && !mxIsStruct(rules)) {
+		mexErrMsgTxt("OPTS.rules must be a structure array");
+	}
+	rule = (ring_rule *) mxCalloc((size_t) *nrule + 1, sizeof(ring_rule));
+	for (i = 0; i < *nrule; i++) {
+
+		// region defaults to whole frame
+		field = mxGetField(rules, (mwIndex) i, "region");
+		region = ((field == NULL) || mxIsEmpty(field)) ? 0.0 : mxGetScalar(field);
+		if ((region < 0.0) || (region > (double) nregion) || (region != (double) (uns16) region)) {
+			mexErrMsgTxt("OPTS.rules region must be 0 or the position of a region in ROI");
+		}
+		rule[i].region = (uns16) region;
+
+		// statistic and comparison are named
+		field = mxGetField(rules, (mwIndex) i, "stat");
+		if ((field == NULL) || !mxIsChar(field)) {
+			mexErrMsgTxt("OPTS.rules stat must be 'mean', 'min' or 'max'");
+		}
+		name = mxArrayToString(field);
+		for (rule[i].stat = 0; (rule[i].stat < 3) && (strcmp(name, stat_list[rule[i].stat]) != 0); rule[i].stat++) {
+		}
+		mxFree((void *) name);
+		if (rule[i].stat == 3) {
+			mexErrMsgTxt("OPTS.rules stat must be 'mean', 'min' or 'max'");
+		}
+		field = mxGetField(rules, (mwIndex) i, "op");
+		if ((field == NULL) || !mxIsChar(field)) {
+			mexErrMsgTxt("OPTS.rules op must be 'above', 'below' or 'change'");
+		}
+		name = mxArrayToString(field);
+		for (rule[i].op = 0; (rule[i].op < 3) && (strcmp(name, op_list[rule[i].op]) != 0); rule[i].op++) {
+		}
+		mxFree((void *) name);
+		if (rule[i].op == 3) {
+			mexErrMsgTxt("OPTS.rules op must be 'above', 'below' or 'change'");
+		}
+		field = mxGetField(rules, (mwIndex) i, "level");
+		if ((field == NULL) || !mxIsNumeric(field) || (mxGetNumberOfElements(field) != 1)) {
+			mexErrMsgTxt("OPTS.rules level must be a numeric scalar");
+		}
+		rule[i].level = mxGetScalar(field);
+		rule[i].value = mxGetNaN();
+	}
+	return(rule);
+}
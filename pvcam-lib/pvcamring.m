@@ -0,0 +1,89 @@
+% PVCAMRING - keep the latest frames in memory and capture them around a trigger
+%
+%     FLAG = PVCAMRING(HCAM, ROI, EXPTIME, EXPMODE, OPTS) starts continuous
+%	  acquisition on the camera specified by HCAM, with ROI, EXPTIME and
+%	  EXPMODE as in PVCAMACQ, and returns at once.  A background thread
+%	  pulls every frame out of the circular buffer (CIRC_OVERWRITE) and
+%	  copies it into a fixed ring of frames in host memory, so the ring
+%	  always holds the latest frames while MATLAB carries on.  Starting
+%	  again replaces a running ring.  FLAG is 1 if successful, 0 if an
+%	  error occurred.  OPTS is an optional structure with fields:
+%
+%					pre = frames captured before the trigger frame (default 0)
+%					post = frames captured after the trigger frame (default 0)
+%					frames = frames held in the ring (default pre + post + 1)
+%					buffer = frames in circular buffer (default 16)
+%					rules = structure array of trigger rules (default none, see below)
+%
+%	  frames must be at least pre + 1.  Any more frames let a trigger
+%	  reach further back in time (see T below).
+%
+%	  Each element of rules watches one statistic of every frame as it
+%	  arrives and triggers an event by itself when the statistic crosses a
+%	  level, so no frame has to reach MATLAB to be judged.  Its fields are:
+%
+%					region = position of the region in ROI, 0 for the whole frame (default 0)
+%					stat = 'mean', 'min' or 'max' of the pixels (DN)
+%					op = 'above', 'below' or 'change'
+%					level = threshold (DN)
+%
+%	  'above' fires on the first frame whose statistic is above level
+%	  after a frame that was not, 'below' likewise, and 'change' fires
+%	  when the statistic moves by level or more from one frame to the
+%	  next.  The frame that fires becomes the trigger frame.  The rules
+%	  are evaluated on the acquisition thread right after each frame is
+%	  copied into the ring; the first rule that fires wins, and rules that
+%	  fire while the ring holds an event are ignored.
+%
+%     FLAG = PVCAMRING(HCAM, 'trigger') takes the newest frame in the ring
+%	  as the trigger frame of an event, or the first frame if none has
+%	  arrived yet.  The pre frames before it are already in the ring, and
+%	  the thread goes on to capture the post frames after it.
+%
+%     FLAG = PVCAMRING(HCAM, 'trigger', T) takes the trigger frame from the
+%	  frame metadata instead: it is the first frame whose bof timestamp
+%	  (camera clock in ns, as META.bof of PVCAMACQ) is at or after T.  T
+%	  may lie in the past, as long as the frame is still in the ring, or
+%	  in the future, in which case the thread waits for the frame.  This
+%	  needs frame metadata (PARAM_METADATA_ENABLED).
+%
+%	  FLAG = 1 when this call triggered an event.  The ring holds one
+%	  event at a time, so FLAG = 0 when it was already triggered, by an
+%	  earlier 'trigger' or by a rule, and that event was not read yet.
+%
+%     [DATA, META, EVENT] = PVCAMRING(HCAM, 'read') waits until the post
+%	  frames of the triggered event have arrived and returns the event.
+%	  DATA holds its frames one after another, pixel data only, as
+%	  PVCAMACQ with OPTS returns them.  META has fields frame, bof, eof,
+%	  exptime and dropped (1 x N vectors, as in PVCAMACQ), and EVENT has
+%	  fields:
+%
+%					trigger = position of the trigger frame in DATA
+%					pre = frames in DATA before the trigger frame
+%					post = frames in DATA after the trigger frame
+%					dropped = frames missing from the event
+%					rule = position of the rule that fired in OPTS.rules, 0 for 'trigger'
+%					value = statistic that fired the rule (DN), NaN for 'trigger'
+%
+%	  pre falls short of OPTS.pre when the trigger came before the ring
+%	  had filled up, or when T pointed at a frame near the end of the
+%	  ring.  Reading rearms the ring for the next trigger.
+%
+%     [...] = PVCAMRING(HCAM, 'read', TIMEOUT) gives up after TIMEOUT
+%	  seconds, returning DATA = [] and leaving the event pending.
+%
+%     STATUS = PVCAMRING(HCAM, 'status') returns without waiting a
+%	  structure with fields state ('idle', 'pending', 'capturing' or
+%	  'ready'), frames (frames pulled since the start), overrun (frames
+%	  overwritten in the circular buffer before the thread got to them or
+%	  while it copied them),
+%	  events (events read) and values (statistic of each rule on the
+%	  latest frame, to help choose levels).
+%
+%     PVCAMRING(HCAM, 'stop') stops acquisition and frees the ring.  Rings
+%	  are also stopped when the camera is closed or the MEX file cleared.
+%	  Other commands that set up the camera must not run while the ring
+%	  runs; the ring notices on its next call, stops and warns.
+
+% 10/18/26
+% mex DLL code
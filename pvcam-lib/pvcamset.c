@@ -12,6 +12,7 @@
 
 // inclusions
 #include "pvcamutil.h"
+#include "pvcamcmd.h"
 #include <math.h>				// for fmod() function used in pvcam_set_numeric
 
 // definitions
@@ -24,18 +25,11 @@
 // function prototypes
 
 // set numeric parameter value
-rs_bool pvcam_set_numeric(int16 hcam, uns32 param_id, double param_value);
+rs_bool pvcam_set_numeric(int16 hcam, const pvcam_param_attr *attr, double param_value);
 
 
-// global variables
-rs_bool	attr_avail;		// flag for available parameter
-uns16	attr_access;	// flag for read only, read/write
-uns16	attr_type;		// data type of parameter values
-uns32	attr_count;		// count for enumerated/char parameters
-
-
-// gateway routine
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+// command routine, also reached as pvcam('set', ...)
+void pvcam_cmd_set(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
 	// declarations
 	rs_bool	success = 0;	// flag for successful execution
@@ -44,6 +38,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 	int		param_len;		// parameter name length
 	int16	hcam;			// camera handle
 	uns32	param_id;		// parameter ID
+	pvcam_param_attr	attr;	// cached parameter attributes
 
 	// validate arguments
 	if ((nrhs != 3) || (nlhs > 1)) {
@@ -51,15 +46,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     }
 
 	// obtain camera handle
-	if (!mxIsNumeric(prhs[0])) {
-		mexErrMsgTxt("HCAM must be numeric");
-	}
-	else if (mxGetNumberOfElements(prhs[0]) != 1) {
-		mexErrMsgTxt("HCAM must be a scalar");
-	}
-	else {
-		hcam = (int16) mxGetScalar(prhs[0]);
-	}
+	hcam = pvcam_camera_handle(prhs[0]);
 
 	// obtain parameter name
 	if (!mxIsChar(prhs[1])) {
@@ -95,39 +82,28 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 	else if (!pvcam_param_id(hcam, param_name, &param_id)) {
 	}
 
-	// obtain parameter availability
-	else if (!pl_get_param(hcam, param_id, ATTR_AVAIL, (void *) &attr_avail)) {
-		pvcam_error(hcam, "Cannot obtain parameter availability");
+	// obtain parameter availability, accessibility, type and count
+	else if (!pvcam_core_param_attr(hcam, param_id, &attr)) {
+		pvcam_error(hcam, pvcam_core_error());
 	}
 
 	// do not proceed if parameter is not available
-	else if (!attr_avail) {
+	else if (!attr.avail) {
 		pvcam_error(hcam, "Parameter not available on this camera");
 	}
 
-	// obtain parameter accessibility 
-	else if (!pl_get_param(hcam, param_id, ATTR_ACCESS, (void *) &attr_access)) {
-		pvcam_error(hcam, "Cannot obtain parameter accessibility");
-	}
-
 	// do not proceed if parameter is not write only or read/write
-	else if ((attr_access != ACC_WRITE_ONLY) && (attr_access != ACC_READ_WRITE)) {
+	else if ((attr.access != ACC_WRITE_ONLY) && (attr.access != ACC_READ_WRITE)) {
 		pvcam_error(hcam, "Parameter cannot be set");
 	}
 
-	// obtain parameter type 
-	else if (!pl_get_param(hcam, param_id, ATTR_TYPE, (void *) &attr_type)) {
-		pvcam_error(hcam, "Cannot obtain parameter type");
-	}
-
-	// obtain parameter count
-	else if (!pl_get_param(hcam, param_id, ATTR_COUNT, (void *) &attr_count)) {
-		pvcam_error(hcam, "Cannot obtain parameter count");
-	}
-
 	// set success flag to return value of pvcam_set_numeric()
+	// new value may change availability or count of other parameters
 	else {
-		success = pvcam_set_numeric(hcam, param_id, *param_value);
+		success = pvcam_set_numeric(hcam, &attr, *param_value);
+		if (success) {
+			pvcam_core_param_flush(hcam);
+		}
 	}
 
 	// set output to return value of success flag
@@ -139,7 +115,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
 
 // set numeric parameter value
-rs_bool pvcam_set_numeric(int16 hcam, uns32 param_id, double param_value) {
+rs_bool pvcam_set_numeric(int16 hcam, const pvcam_param_attr *attr, double param_value) {
 
 	// declarations
 	rs_bool	success = 0;	// flag for successful execution
@@ -157,18 +133,18 @@ rs_bool pvcam_set_numeric(int16 hcam, uns32 param_id, double param_value) {
 
 	// obtain min, max & increment for numeric types
 	// enumerated parameter limits given in ATTR_COUNT
-	if (attr_type == TYPE_ENUM) {
+	if (attr->type == TYPE_ENUM) {
 		param_min = 0.0;
 		param_inc = 1.0;
-		param_max = (double) attr_count - param_inc;
+		param_max = (double) attr->count - param_inc;
 	}
-	else if (!pvcam_param_value(hcam, param_id, ATTR_MIN, attr_type, &param_min)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_MIN, attr->type, &param_min)) {
 		return(0);
 	}
-	else if (!pvcam_param_value(hcam, param_id, ATTR_MAX, attr_type, &param_max)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_MAX, attr->type, &param_max)) {
 		return(0);
 	}
-	else if (!pvcam_param_value(hcam, param_id, ATTR_INCREMENT, attr_type, &param_inc)) {
+	else if (!pvcam_param_value(hcam, attr->param_id, ATTR_INCREMENT, attr->type, &param_inc)) {
 		return(0);
 	}
 
@@ -190,39 +166,39 @@ rs_bool pvcam_set_numeric(int16 hcam, uns32 param_id, double param_value) {
 
 	// recast parameter value and save to appropriate storage variable
 	// set parameter value with appropriate storage variable
-	switch (attr_type) {
+	switch (attr->type) {
 	case TYPE_INT8:
 		int8_value = (int8) param_value;
-		success = pl_set_param(hcam, param_id, (void *) &int8_value);
+		success = pl_set_param(hcam, attr->param_id, (void *) &int8_value);
 		break;
 	case TYPE_UNS8:
 		uns8_value = (uns8) param_value;
-		success = pl_set_param(hcam, param_id, (void *) &uns8_value);
+		success = pl_set_param(hcam, attr->param_id, (void *) &uns8_value);
 		break;
 	case TYPE_INT16:
 		int16_value = (int16) param_value;
-		success = pl_set_param(hcam, param_id, (void *) &int16_value);
+		success = pl_set_param(hcam, attr->param_id, (void *) &int16_value);
 		break;
 	case TYPE_UNS16:
 		uns16_value = (uns16) param_value;
-		success = pl_set_param(hcam, param_id, (void *) &uns16_value);
+		success = pl_set_param(hcam, attr->param_id, (void *) &uns16_value);
 		break;
 	case TYPE_INT32:
 		int32_value = (int32) param_value;
-		success = pl_set_param(hcam, param_id, (void *) &int32_value);
+		success = pl_set_param(hcam, attr->param_id, (void *) &int32_value);
 		break;
 	case TYPE_UNS32:
 	case TYPE_ENUM:
 		uns32_value = (uns32) param_value;
-		success = pl_set_param(hcam, param_id, (void *) &uns32_value);
+		success = pl_set_param(hcam, attr->param_id, (void *) &uns32_value);
 		break;
 	case TYPE_FLT64:
 		flt64_value = (flt64) param_value;
-		success = pl_set_param(hcam, param_id, (void *) &flt64_value);
+		success = pl_set_param(hcam, attr->param_id, (void *) &flt64_value);
 		break;
 	case TYPE_BOOLEAN:
 		bool_value = (rs_bool)param_value;
-		success = pl_set_param(hcam, param_id, (void *) &bool_value);
+		success = pl_set_param(hcam, attr->param_id, (void *) &bool_value);
 		break;
 	default:
 		pvcam_error(hcam, "Invalid data type for setting numeric parameter value");
@@ -232,3 +208,11 @@ rs_bool pvcam_set_numeric(int16 hcam, uns32 param_id, double param_value) {
 	// return value of successful execution flag
 	return(success);
 }
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_set(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -0,0 +1,172 @@
+/* PVCAMSMART - load a SMART streaming exposure sequence
+
+      FLAG = PVCAMSMART(HCAM, EXPTIMES) loads the vector EXPTIMES as the
+	  SMART streaming exposure list of the camera specified by HCAM and
+	  switches SMART streaming on.  The camera then cycles through the
+	  exposures frame by frame at full speed, without the exposure being
+	  set again between acquisitions.  EXPTIMES uses the same units as the
+	  EXPTIME argument of PVCAMACQ (see PARAM_EXP_RES and
+	  PARAM_EXP_RES_INDEX), which the camera ignores while SMART streaming
+	  is on.  FLAG is 1 if successful, 0 if an error occurred.
+
+      FLAG = PVCAMSMART(HCAM, []) switches SMART streaming off again.
+
+      EXPTIMES = PVCAMSMART(HCAM) returns the exposure list loaded on the
+	  camera, or [] if SMART streaming is off.
+
+	  PVCAMACQ(..., OPTS) tags every frame with its position in the list in
+	  META.smart (1 to numel(EXPTIMES), 0 with SMART streaming off), taken
+	  from the frame number so dropped frames do not shift the cycle.  The
+	  list is forgotten when the camera is closed. */
+
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+
+
+// function prototypes
+
+// load exposure list and switch SMART streaming on, or off for an empty list
+rs_bool pvcam_smart_load(int16 hcam, uns16 nexposure, const double *exptime);
+
+// read exposure list back from camera
+mxArray *pvcam_smart_list(int16 hcam);
+
+
+// command routine, also reached as pvcam('smart', ...)
+void pvcam_cmd_smart(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	double		*exptime;	// exposure list
+	int16		hcam;		// camera handle
+	mwSize		i;			// exposure counter
+	mwSize		nexposure;	// number of exposures
+
+	// validate arguments
+	if ((nrhs < 1) || (nrhs > 2) || (nlhs > 1)) {
+		mexErrMsgTxt("type 'help pvcamsmart' for syntax");
+	}
+	hcam = pvcam_camera_handle(prhs[0]);
+
+	// no list returns loaded list
+	if (nrhs == 1) {
+		plhs[0] = pvcam_smart_list(hcam);
+		return;
+	}
+
+	// validate exposure list
+	if (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1])) {
+		mexErrMsgTxt("EXPTIMES must be a real double vector");
+	}
+	nexposure = mxGetNumberOfElements(prhs[1]);
+	if (nexposure > 0xFFFF) {
+		mexErrMsgTxt("EXPTIMES has too many entries");
+	}
+	exptime = mxGetPr(prhs[1]);
+	for (i = 0; i < nexposure; i++) {
+		if ((exptime[i] < 0.0) || (exptime[i] > 4294967295.0) || (exptime[i] != (double) (uns32) exptime[i])) {
+			mexErrMsgTxt("EXPTIMES must hold non-negative integers");
+		}
+	}
+	plhs[0] = mxCreateDoubleScalar((double) pvcam_smart_load(hcam, (uns16) nexposure, exptime));
+}
+
+
+// load exposure list and switch SMART streaming on, or off for an empty list
+// the camera wants the mode switched on before it takes the list
+rs_bool pvcam_smart_load(int16 hcam, uns16 nexposure, const double *exptime) {
+
+	// declarations
+	pvcam_param_attr	attr;	// SMART mode attributes
+	rs_bool		enable;			// SMART mode switch
+	smart_stream_type	*smart;	// exposure list for driver
+	uns16		i;				// exposure counter
+
+	if (!pvcam_core_param_attr(hcam, PARAM_SMART_STREAM_MODE_ENABLED, &attr)) {
+		pvcam_error(hcam, pvcam_core_error());
+		return(0);
+	}
+	if (!attr.avail) {
+		pvcam_error(hcam, "SMART streaming not available on this camera");
+		return(0);
+	}
+
+	// empty list switches SMART streaming off
+	enable = (nexposure > 0);
+	if (!pl_set_param(hcam, PARAM_SMART_STREAM_MODE_ENABLED, (void *) &enable)) {
+		pvcam_error(hcam, "Cannot set SMART streaming mode");
+		pvcam_core_param_flush(hcam);
+		return(0);
+	}
+	pvcam_core_set_smart(hcam, 0);
+	pvcam_core_param_flush(hcam);
+	if (!enable) {
+		return(1);
+	}
+
+	// driver allocates the list
+	if (!pl_create_smart_stream_struct(&smart, nexposure)) {
+		pvcam_error(hcam, "Cannot create SMART streaming exposure list");
+		return(0);
+	}
+	for (i = 0; i < nexposure; i++) {
+		smart->params[i] = (uns32) exptime[i];
+	}
+	if (!pl_set_param(hcam, PARAM_SMART_STREAM_EXP_PARAMS, (void *) smart)) {
+		pvcam_error(hcam, "Cannot load SMART streaming exposure list");
+		pl_release_smart_stream_struct(&smart);
+		return(0);
+	}
+	pl_release_smart_stream_struct(&smart);
+	pvcam_core_set_smart(hcam, nexposure);
+	return(1);
+}
+
+
+// read exposure list back from camera
+mxArray *pvcam_smart_list(int16 hcam) {
+
+	// declarations
+	double		*exptime_ptr;	// exposure list output
+	mxArray		*exptime_list;	// output vector
+	rs_bool		enable;			// SMART mode switch
+	smart_stream_type	*smart;	// exposure list from driver
+	uns16		i;				// exposure counter
+	uns16		nexposure;		// number of exposures
+
+	// list is only read back when it was loaded here and is still switched on
+	nexposure = pvcam_core_smart(hcam);
+	if ((nexposure == 0) ||
+		!pl_get_param(hcam, PARAM_SMART_STREAM_MODE_ENABLED, ATTR_CURRENT, (void *) &enable) || !enable) {
+		return(mxCreateDoubleMatrix(0, 0, mxREAL));
+	}
+	if (!pl_create_smart_stream_struct(&smart, nexposure)) {
+		pvcam_error(hcam, "Cannot create SMART streaming exposure list");
+		return(mxCreateDoubleMatrix(0, 0, mxREAL));
+	}
+	if (!pl_get_param(hcam, PARAM_SMART_STREAM_EXP_PARAMS, ATTR_CURRENT, (void *) smart)) {
+		pvcam_error(hcam, "Cannot read SMART streaming exposure list");
+		pl_release_smart_stream_struct(&smart);
+		return(mxCreateDoubleMatrix(0, 0, mxREAL));
+	}
+	nexposure = (smart->entries < nexposure) ? smart->entries : nexposure;
+	exptime_list = mxCreateDoubleMatrix(1, nexposure, mxREAL);
+	exptime_ptr = mxGetPr(exptime_list);
+	for (i = 0; i < nexposure; i++) {
+		exptime_ptr[i] = (double) smart->params[i];
+	}
+	pl_release_smart_stream_struct(&smart);
+	return(exptime_list);
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_smart(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -0,0 +1,23 @@
+% PVCAMSMART - load a SMART streaming exposure sequence
+%
+%     FLAG = PVCAMSMART(HCAM, EXPTIMES) loads the vector EXPTIMES as the
+%	  SMART streaming exposure list of the camera specified by HCAM and
+%	  switches SMART streaming on.  The camera then cycles through the
+%	  exposures frame by frame at full speed, without the exposure being
+%	  set again between acquisitions.  EXPTIMES uses the same units as the
+%	  EXPTIME argument of PVCAMACQ (see PARAM_EXP_RES and
+%	  PARAM_EXP_RES_INDEX), which the camera ignores while SMART streaming
+%	  is on.  FLAG is 1 if successful, 0 if an error occurred.
+%
+%     FLAG = PVCAMSMART(HCAM, []) switches SMART streaming off again.
+%
+%     EXPTIMES = PVCAMSMART(HCAM) returns the exposure list loaded on the
+%	  camera, or [] if SMART streaming is off.
+%
+%	  PVCAMACQ(..., OPTS) tags every frame with its position in the list in
+%	  META.smart (1 to numel(EXPTIMES), 0 with SMART streaming off), taken
+%	  from the frame number so dropped frames do not shift the cycle.  The
+%	  list is forgotten when the camera is closed.
+
+% 10/18/26
+% mex DLL code
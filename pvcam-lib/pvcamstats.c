@@ -0,0 +1,185 @@
+/* PVCAMSTATS - report acquisition latency statistics
+
+      STATS = PVCAMSTATS returns the per-stage latency statistics recorded
+	  by the acquisition engine as a 1 x N structure array with fields:
+
+					stage = stage name
+					count = samples recorded
+					total = sum of latencies (ns)
+					mean = mean latency (ns)
+					min = shortest latency (ns)
+					max = longest latency (ns)
+					hist = 1 x 40 latency histogram
+
+	  Bucket k of hist counts latencies from 2^(k-1) up to 2^k ns, so
+	  log2 of the latency is read straight off the bucket index.  The stages
+	  are wait (polling for the next frame), buffer (locating the frame in
+	  the circular buffer), decode (metadata decode), copy (gathering
+	  multiple regions), defect (hot pixel correction), process
+	  (accumulation and speckle contrast), handoff (copying into the MATLAB
+	  output), record (coding and writing to the OPTS.record file) and
+	  frame (all of the above for one frame).
+
+      PVCAMSTATS('reset') clears all statistics.
+
+      PVCAMSTATS('on') and PVCAMSTATS('off') switch recording on (default)
+	  or off.
+
+      JSON = PVCAMSTATS('json') returns the statistics as a JSON string, and
+	  PVCAMSTATS('json', FILE) writes the string to the file FILE. */
+
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamtime.h"
+#include <stdio.h>
+
+
+// definitions
+#define STATS_FIELD		7		// number of fields in statistics structure
+#define JSON_STAGE		1024	// JSON characters reserved per stage
+
+
+// function prototypes
+
+// build statistics structure array
+mxArray *pvcam_stats_struct(pvcam_stats_table *table);
+
+// format statistics as JSON
+char *pvcam_stats_json(pvcam_stats_table *table);
+
+
+// command routine, also reached as pvcam('stats', ...)
+void pvcam_cmd_stats(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	char		*command;	// command string
+	char		*file_name;	// JSON output file
+	char		*json_str;	// JSON text
+	FILE		*json_file;	// JSON output stream
+	pvcam_stats_table	*table;	// shared statistics
+
+	// validate arguments
+	if ((nrhs > 2) || (nlhs > 1)) {
+		mexErrMsgTxt("type 'help pvcamstats' for syntax");
+	}
+	table = pvcam_stats_attach();
+
+	// no command returns structure array
+	if (nrhs == 0) {
+		plhs[0] = pvcam_stats_struct(table);
+		return;
+	}
+
+	// obtain command
+	if (!mxIsChar(prhs[0])) {
+		mexErrMsgTxt("COMMAND must be a string");
+	}
+	command = mxArrayToString(prhs[0]);
+	if (strcmp(command, "reset") == 0) {
+		pvcam_stats_reset();
+	}
+	else if (strcmp(command, "on") == 0) {
+		table->enabled = 1;
+	}
+	else if (strcmp(command, "off") == 0) {
+		table->enabled = 0;
+	}
+	else if (strcmp(command, "json") == 0) {
+		json_str = pvcam_stats_json(table);
+		if (nrhs < 2) {
+			plhs[0] = mxCreateString(json_str);
+		}
+		else {
+			if (!mxIsChar(prhs[1])) {
+				mexErrMsgTxt("FILE must be a string");
+			}
+			file_name = mxArrayToString(prhs[1]);
+			if ((json_file = fopen(file_name, "w")) == NULL) {
+				mexErrMsgTxt("Cannot open FILE for writing");
+			}
+			fputs(json_str, json_file);
+			fclose(json_file);
+			mxFree((void *) file_name);
+		}
+		mxFree((void *) json_str);
+	}
+	else {
+		mexErrMsgTxt("COMMAND must be 'reset', 'on', 'off' or 'json'");
+	}
+	mxFree((void *) command);
+}
+
+
+// build statistics structure array
+mxArray *pvcam_stats_struct(pvcam_stats_table *table) {
+
+	// declarations
+	const char	*field_list[STATS_FIELD] = {"stage", "count", "total", "mean", "min", "max", "hist"};
+	double		*hist_ptr;		// histogram output
+	int			i;				// stage counter
+	int			j;				// bucket counter
+	mxArray		*stats_struct;	// output structure array
+	pvcam_stage_stats	*record;	// stage record
+
+	stats_struct = mxCreateStructMatrix(1, NUM_STAGE, STATS_FIELD, field_list);
+	for (i = 0; i < NUM_STAGE; i++) {
+		record = &table->stage[i];
+		mxSetFieldByNumber(stats_struct, i, 0, mxCreateString(pvcam_stats_stage_name(i)));
+		mxSetFieldByNumber(stats_struct, i, 1, mxCreateDoubleScalar((double) record->count));
+		mxSetFieldByNumber(stats_struct, i, 2, mxCreateDoubleScalar((double) record->total_ns));
+		mxSetFieldByNumber(stats_struct, i, 3,
+			mxCreateDoubleScalar((record->count > 0) ? (double) record->total_ns / (double) record->count : 0.0));
+		mxSetFieldByNumber(stats_struct, i, 4, mxCreateDoubleScalar((double) record->min_ns));
+		mxSetFieldByNumber(stats_struct, i, 5, mxCreateDoubleScalar((double) record->max_ns));
+		mxSetFieldByNumber(stats_struct, i, 6, mxCreateDoubleMatrix(1, STATS_BUCKET, mxREAL));
+		hist_ptr = mxGetPr(mxGetFieldByNumber(stats_struct, i, 6));
+		for (j = 0; j < STATS_BUCKET; j++) {
+			hist_ptr[j] = (double) record->hist[j];
+		}
+	}
+	return(stats_struct);
+}
+
+
+// format statistics as JSON
+char *pvcam_stats_json(pvcam_stats_table *table) {
+
+	// declarations
+	char		*json_str;		// JSON text
+	char		*json_ptr;		// end of JSON text
+	int			i;				// stage counter
+	int			j;				// bucket counter
+	pvcam_stage_stats	*record;	// stage record
+
+	// every number fits in 20 digits, so each stage fits in JSON_STAGE
+	json_str = (char *) mxCalloc(NUM_STAGE * JSON_STAGE + 64, sizeof(char));
+	json_ptr = json_str;
+	json_ptr += sprintf(json_ptr, "{\"enabled\": %d, \"stages\": [", table->enabled ? 1 : 0);
+	for (i = 0; i < NUM_STAGE; i++) {
+		record = &table->stage[i];
+		json_ptr += sprintf(json_ptr, "%s\n  {\"stage\": \"%s\", \"count\": %.0f, \"total_ns\": %.0f, "
+			"\"mean_ns\": %.1f, \"min_ns\": %.0f, \"max_ns\": %.0f, \"hist\": [",
+			(i > 0) ? "," : "", pvcam_stats_stage_name(i), (double) record->count, (double) record->total_ns,
+			(record->count > 0) ? (double) record->total_ns / (double) record->count : 0.0,
+			(double) record->min_ns, (double) record->max_ns);
+		for (j = 0; j < STATS_BUCKET; j++) {
+			json_ptr += sprintf(json_ptr, (j > 0) ? ", %ld" : "%ld", (long) record->hist[j]);
+		}
+		json_ptr += sprintf(json_ptr, "]}");
+	}
+	sprintf(json_ptr, "\n]}\n");
+	return(json_str);
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_stats(nlhs, plhs, nrhs, prhs);
+}
+#endif
@@ -0,0 +1,32 @@
+% PVCAMSTATS - report acquisition latency statistics
+%
+%     STATS = PVCAMSTATS returns the per-stage latency statistics recorded
+%	  by the acquisition engine as a 1 x N structure array with fields:
+%
+%					stage = stage name
+%					count = samples recorded
+%					total = sum of latencies (ns)
+%					mean = mean latency (ns)
+%					min = shortest latency (ns)
+%					max = longest latency (ns)
+%					hist = 1 x 40 latency histogram
+%
+%	  Bucket k of hist counts latencies from 2^(k-1) up to 2^k ns, so
+%	  log2 of the latency is read straight off the bucket index.  The stages
+%	  are wait (polling for the next frame), buffer (locating the frame in
+%	  the circular buffer), decode (metadata decode), copy (gathering
+%	  multiple regions), defect (hot pixel correction), process
+%	  (accumulation and speckle contrast), handoff (copying into the MATLAB
+%	  output), record (coding and writing to the OPTS.record file) and
+%	  frame (all of the above for one frame).
+%
+%     PVCAMSTATS('reset') clears all statistics.
+%
+%     PVCAMSTATS('on') and PVCAMSTATS('off') switch recording on (default)
+%	  or off.
+%
+%     JSON = PVCAMSTATS('json') returns the statistics as a JSON string, and
+%	  PVCAMSTATS('json', FILE) writes the string to the file FILE.
+
+% 10/18/26
+% mex DLL code
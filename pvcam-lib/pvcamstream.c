@@ -0,0 +1,505 @@
+/* Continuous acquisition engine for PVCAM MEX files */
+
+/* 10/18/26 */
+
+/* Frames are acquired with pl_exp_setup_cont in CIRC_OVERWRITE mode and read
+   in order straight out of the circular buffer; frame k always lives in slot
+   k modulo the buffer length.  Frames overwritten before they were read are
+   skipped and counted as overruns, and gaps in the metadata frame number
+   count as dropped frames.  A frame handed out in place can still be
+   overwritten while the caller uses it, so the buffer is checked again once
+   the caller is done with it (pvcam_stream_done), and frames gathered into
+   scratch are checked again once copied.  Nothing in here calls the MEX API, so failures
+   are left in err_msg for the caller to pass on to pvcam_error.
+
+   When timed, BOF and EOF callbacks read the host clock from the PVCAM
+   callback thread into small rings indexed by frame number.  Each stamp is
+   published by writing its frame number last, so the reader only trusts a
+   stamp whose frame number matches the frame it is decoding.
+
+   With PrimeLocate (PARAM_CENTROIDS_ENABLED) on, every frame carries its
+   own set of small regions around the spots the camera found, and their
+   number changes from frame to frame.  Those regions are not gathered
+   into pixels; the caller walks the region descriptors instead.
+
+   Cameras that read fewer regions per frame than requested (PARAM_ROI_COUNT)
+   read the unbinned region covering them all, and the stream cuts and bins
+   the requested regions out of it in software.  Binned pixels are summed
+   and clipped at 65535, and the regions are laid out one after another as
+   the camera would have delivered them, so callers cannot tell the two
+   apart except by the larger frame transfer. */
+
+// inclusions
+#include "pvcamstream.h"
+#include "pvcamtime.h"
+#include "pvcambuffer.h"
+#include <stdlib.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+
+// function prototypes
+
+// count frames written into circular buffer since start
+static rs_bool stream_arrived(pvcam_stream *stream, uns32 *narrived);
+
+// update continuity counters for delivered frame
+static void stream_account(pvcam_stream *stream, pvcam_frame *frame);
+
+// record host clock for frame in BOF or EOF ring
+static void stream_stamp(pvcam_host_stamp *ring, int32 frame_nr);
+
+// host time of frame since start from BOF (0) or EOF (TIMING_RING) ring, -1 if not stamped
+static double stream_stamp_time(const pvcam_stream *stream, uns32 ring, uns32 frame_nr);
+
+// full memory barrier between ring entry accesses
+static void stream_barrier(void);
+
+// cut and bin requested regions out of unbinned bounding region
+static void stream_cut_regions(const pvcam_stream *stream, const uns16 *bound_pixels);
+
+// PVCAM callbacks at beginning and end of frame
+static void PV_DECL stream_bof_callback(FRAME_INFO *frame_info, void *context);
+static void PV_DECL stream_eof_callback(FRAME_INFO *frame_info, void *context);
+
+
+// set up and start continuous acquisition into circular buffer
+rs_bool pvcam_stream_open(pvcam_stream *stream, int16 hcam, uns16 nregion, const rgn_type *region,
+						  uns32 exptime, int16 expmode, uns32 nbuffer, rs_bool timing) {
+
+	// declarations
+	rs_bool	attr_avail;		// flag for available parameter
+	rs_bool	md_enabled;		// metadata enabled flag
+	uns16	nmd_region;		// regions the metadata decoder can hold
+
+	// start from a clean state so pvcam_stream_close is always safe
+	memset(stream, 0, sizeof(pvcam_stream));
+	stream->hcam = hcam;
+	stream->nregion = nregion;
+	stream->nbuffer = (nbuffer > 0) ? nbuffer : STREAM_BUFFER;
+	stream->npixel = pvcam_region_pixels(nregion, region);
+
+	// metadata is optional; older cameras do not have the parameter
+	if (pl_get_param(hcam, PARAM_METADATA_ENABLED, ATTR_AVAIL, (void *) &attr_avail) && attr_avail &&
+		pl_get_param(hcam, PARAM_METADATA_ENABLED, ATTR_CURRENT, (void *) &md_enabled)) {
+		stream->has_meta = md_enabled;
+	}
+
+	// PrimeLocate frames hold up to PARAM_CENTROIDS_COUNT regions each
+	if (stream->has_meta &&
+		pl_get_param(hcam, PARAM_CENTROIDS_ENABLED, ATTR_AVAIL, (void *) &attr_avail) && attr_avail &&
+		pl_get_param(hcam, PARAM_CENTROIDS_ENABLED, ATTR_CURRENT, (void *) &stream->centroids) && stream->centroids &&
+		!pl_get_param(hcam, PARAM_CENTROIDS_COUNT, ATTR_CURRENT, (void *) &stream->ncentroid)) {
+		stream->err_msg = "Cannot obtain PrimeLocate region count";
+		return(0);
+	}
+	nmd_region = (stream->centroids && (stream->ncentroid > nregion)) ? stream->ncentroid : nregion;
+
+	// regions beyond the camera's limit are cut from their bounding region
+	if (!stream->centroids && !pvcam_region_hardware(hcam, nregion)) {
+		if ((stream->region = (rgn_type *) malloc((size_t) nregion * sizeof(rgn_type))) == NULL) {
+			stream->err_msg = "Cannot allocate region list";
+			return(0);
+		}
+		memcpy(stream->region, region, (size_t) nregion * sizeof(rgn_type));
+		pvcam_region_bounds(nregion, region, &stream->bound);
+		nmd_region = 1;
+	}
+
+	// load continuous sequence
+	if (!pl_exp_setup_cont(hcam, (stream->region != NULL) ? 1 : nregion, (stream->region != NULL) ? &stream->bound : region,
+		expmode, exptime, &stream->frame_bytes, CIRC_OVERWRITE)) {
+		stream->err_msg = "Cannot setup continuous acquisition";
+		return(0);
+	}
+
+	// allocate circular buffer and decoding storage
+	// the circular buffer sits on the NUMA node chosen for frame buffers
+	stream->buffer = (uns8 *) pvcam_buffer_alloc((size_t) stream->nbuffer * stream->frame_bytes);
+	if (stream->buffer == NULL) {
+		stream->err_msg = "Cannot allocate circular buffer";
+		return(0);
+	}
+	if (stream->has_meta) {
+		if (!pl_md_create_frame_struct_cont(&stream->md, nmd_region)) {
+			stream->err_msg = "Cannot allocate metadata decoder";
+			return(0);
+		}
+	}
+	if ((((nregion > 1) && stream->has_meta && !stream->centroids) || (stream->region != NULL)) &&
+		((stream->scratch = (uns16 *) malloc((size_t) stream->npixel * sizeof(uns16))) == NULL)) {
+		stream->err_msg = "Cannot allocate frame buffer";
+		return(0);
+	}
+
+	// callbacks must be in place before the first frame
+	if (timing) {
+		if ((stream->stamp = (pvcam_host_stamp *) calloc(2 * TIMING_RING, sizeof(pvcam_host_stamp))) == NULL) {
+			stream->err_msg = "Cannot allocate timing storage";
+			return(0);
+		}
+		if (!pl_cam_register_callback_ex3(hcam, PL_CALLBACK_BOF, (void *) stream_bof_callback, (void *) stream) ||
+			!pl_cam_register_callback_ex3(hcam, PL_CALLBACK_EOF, (void *) stream_eof_callback, (void *) stream)) {
+			stream->err_msg = "Cannot register frame callbacks";
+			return(0);
+		}
+	}
+
+	// start acquisition
+	stream->start_ns = pvcam_clock_ns();
+	if (!pl_exp_start_cont(hcam, (void *) stream->buffer, stream->nbuffer * stream->frame_bytes)) {
+		stream->err_msg = "Cannot start continuous acquisition";
+		return(0);
+	}
+	stream->running = 1;
+	return(1);
+}
+
+
+// wait for next frame and decode it
+rs_bool pvcam_stream_next(pvcam_stream *stream, pvcam_frame *frame) {
+
+	// declarations
+	md_frame_header	*header;	// frame metadata header
+	uns8	*frame_ptr;			// frame within circular buffer
+	uns16	i;					// loop counter
+	uns32	narrived;			// frames written since start
+	uns32	nsafe;				// first frame not yet overwritten
+	uns32	offset;				// pixel offset into scratch buffer
+	ulong64	stage_ns;			// start of current instrumented stage
+
+	// the previous frame is done with if the caller did not say so
+	if (!pvcam_stream_done(stream, frame)) {
+		return(0);
+	}
+
+	// poll until the camera has written past the next undelivered frame
+	stage_ns = pvcam_stats_mark();
+	do {
+		if (stream->stop) {
+			stream->err_msg = "Acquisition stopped";
+			return(0);
+		}
+		if (!stream_arrived(stream, &narrived)) {
+			return(0);
+		}
+	} while (narrived <= stream->ndelivered);
+	frame->host_data_ns = (double) (pvcam_clock_ns() - stream->start_ns);
+	stage_ns = pvcam_stats_lap(STAGE_WAIT, stage_ns);
+
+	// the slot of frame narrived - nbuffer is being rewritten right now
+	if (narrived - stream->ndelivered > stream->stats.max_backlog) {
+		stream->stats.max_backlog = narrived - stream->ndelivered;
+	}
+	nsafe = (narrived >= stream->nbuffer) ? narrived - stream->nbuffer + 1 : 0;
+	if (stream->ndelivered < nsafe) {
+		stream->stats.noverrun += nsafe - stream->ndelivered;
+		stream->ndelivered = nsafe;
+	}
+
+	// locate frame in circular buffer
+	frame_ptr = stream->buffer + (size_t) (stream->ndelivered % stream->nbuffer) * stream->frame_bytes;
+	stream->ndelivered++;
+	stream->backlog = narrived - stream->ndelivered;
+	stream->pending = 1;
+	frame->overwritten = 0;
+	stage_ns = pvcam_stats_lap(STAGE_BUFFER, stage_ns);
+
+	// raw frame is pixel data only without metadata
+	if (!stream->has_meta) {
+		if (stream->region != NULL) {
+			stream_cut_regions(stream, (const uns16 *) frame_ptr);
+			pvcam_stats_lap(STAGE_COPY, stage_ns);
+		}
+		frame->pixels = (stream->region != NULL) ? stream->scratch : (uns16 *) frame_ptr;
+		frame->npixel = stream->npixel;
+		frame->frame_nr = stream->ndelivered;
+		frame->bof_ns = 0.0;
+		frame->eof_ns = 0.0;
+		frame->exp_ns = 0.0;
+		frame->bit_depth = 0;
+		frame->host_bof_ns = stream_stamp_time(stream, 0, frame->frame_nr);
+		frame->host_eof_ns = stream_stamp_time(stream, TIMING_RING, frame->frame_nr);
+		frame->nroi = 0;
+		frame->roi = NULL;
+		frame->roi_res_ns = 0.0;
+		stream_account(stream, frame);
+		return((stream->region == NULL) || pvcam_stream_done(stream, frame));
+	}
+
+	// decode metadata headers
+	if (!pl_md_frame_decode(stream->md, (void *) frame_ptr, stream->frame_bytes)) {
+		stream->err_msg = "Cannot decode frame metadata";
+		return(0);
+	}
+	stage_ns = pvcam_stats_lap(STAGE_DECODE, stage_ns);
+	header = stream->md->header;
+	frame->frame_nr = header->frameNr;
+	frame->bof_ns = (double) header->timestampBOF * (double) header->timestampResNs;
+	frame->eof_ns = (double) header->timestampEOF * (double) header->timestampResNs;
+	frame->exp_ns = (double) header->exposureTime * (double) header->exposureTimeResNs;
+	frame->bit_depth = header->bitDepth;
+	frame->host_bof_ns = stream_stamp_time(stream, 0, frame->frame_nr);
+	frame->host_eof_ns = stream_stamp_time(stream, TIMING_RING, frame->frame_nr);
+	frame->nroi = stream->md->roiCount;
+	frame->roi = stream->md->roiArray;
+	frame->roi_res_ns = (header->flags & PL_MD_FRAME_FLAG_ROI_TS_SUPPORTED) ? (double) header->roiTimestampResNs : 0.0;
+
+	// PrimeLocate regions stay where they are
+	// regions cut in software come out of the one bounding region
+	// single region points straight at its data
+	// multiple regions are gathered without their headers
+	if (stream->centroids) {
+		frame->pixels = NULL;
+		frame->npixel = 0;
+	}
+	else if (stream->region != NULL) {
+		if (stream->md->roiArray[0].dataSize < pvcam_region_pixels(1, &stream->bound) * sizeof(uns16)) {
+			stream->err_msg = "Frame metadata describes fewer pixels than requested";
+			return(0);
+		}
+		stream_cut_regions(stream, (const uns16 *) stream->md->roiArray[0].data);
+		frame->pixels = stream->scratch;
+		frame->npixel = stream->npixel;
+		pvcam_stats_lap(STAGE_COPY, stage_ns);
+	}
+	else if (stream->md->roiCount == 1) {
+		frame->pixels = (uns16 *) stream->md->roiArray[0].data;
+		frame->npixel = stream->md->roiArray[0].dataSize / sizeof(uns16);
+	}
+	else {
+		offset = 0;
+		for (i = 0; i < stream->md->roiCount; i++) {
+			if (offset + stream->md->roiArray[i].dataSize / sizeof(uns16) > stream->npixel) {
+				stream->err_msg = "Frame metadata describes more pixels than requested";
+				return(0);
+			}
+			memcpy(stream->scratch + offset, stream->md->roiArray[i].data, stream->md->roiArray[i].dataSize);
+			offset += stream->md->roiArray[i].dataSize / sizeof(uns16);
+		}
+		frame->pixels = stream->scratch;
+		frame->npixel = offset;
+		pvcam_stats_lap(STAGE_COPY, stage_ns);
+	}
+	stream_account(stream, frame);
+
+	// gathered frames no longer depend on the circular buffer
+	if (frame->pixels == stream->scratch) {
+		return(pvcam_stream_done(stream, frame));
+	}
+	return(1);
+}
+
+
+// check once the caller is done with frame that the camera did not rewrite its slot meanwhile
+rs_bool pvcam_stream_done(pvcam_stream *stream, pvcam_frame *frame) {
+
+	// declarations
+	uns32	narrived;		// frames written since start
+
+	if (!stream->pending) {
+		return(1);
+	}
+	stream->pending = 0;
+	if (!stream_arrived(stream, &narrived)) {
+		return(0);
+	}
+
+	// frame ndelivered - 1 shares its slot with frame ndelivered - 1 + nbuffer,
+	// which the camera starts writing once narrived reaches it
+	if (narrived >= stream->ndelivered - 1 + stream->nbuffer) {
+		frame->overwritten = 1;
+		stream->stats.noverwritten++;
+	}
+	return(1);
+}
+
+
+// stop acquisition and free buffers
+void pvcam_stream_close(pvcam_stream *stream) {
+	if (stream->running) {
+		pl_exp_stop_cont(stream->hcam, CCS_HALT);
+		stream->running = 0;
+	}
+	if (stream->stamp != NULL) {
+		pl_cam_deregister_callback(stream->hcam, PL_CALLBACK_BOF);
+		pl_cam_deregister_callback(stream->hcam, PL_CALLBACK_EOF);
+		free((void *) stream->stamp);
+		stream->stamp = NULL;
+	}
+	if (stream->md != NULL) {
+		pl_md_release_frame_struct(stream->md);
+		stream->md = NULL;
+	}
+	free((void *) stream->scratch);
+	pvcam_buffer_free((void *) stream->buffer);
+	free((void *) stream->region);
+	stream->scratch = NULL;
+	stream->buffer = NULL;
+	stream->region = NULL;
+}
+
+
+// count frames written into circular buffer since start
+static rs_bool stream_arrived(pvcam_stream *stream, uns32 *narrived) {
+
+	// declarations
+	int16	status;			// camera read status
+	uns32	bytes_arrived;	// bytes written this pass through buffer
+	uns32	buffer_cnt;		// completed passes through buffer
+
+	if (!pl_exp_check_cont_status(stream->hcam, &status, &bytes_arrived, &buffer_cnt)) {
+		stream->err_msg = "Cannot check camera status during acquisition";
+		return(0);
+	}
+	if (status == READOUT_FAILED) {
+		stream->err_msg = "Camera readout failed";
+		return(0);
+	}
+	*narrived = buffer_cnt * stream->nbuffer + bytes_arrived / stream->frame_bytes;
+	return(1);
+}
+
+
+// update continuity counters for delivered frame
+static void stream_account(pvcam_stream *stream, pvcam_frame *frame) {
+
+	// declarations
+	double	interval;		// EOF interval to previous frame (ns)
+
+	// frame numbers are 1-based and consecutive unless frames were lost
+	frame->ndropped = (frame->frame_nr > stream->last_nr + 1) ? frame->frame_nr - stream->last_nr - 1 : 0;
+	stream->stats.ndropped += frame->ndropped;
+	stream->stats.nframe++;
+
+	// compare EOF spacing, per frame number step, against running average
+	// late intervals count clipped to the late threshold, so a single stall
+	// barely moves the average but a slower frame rate is caught up with
+	// within a few dozen frames instead of leaving every frame late
+	frame->late = 0;
+	if ((stream->stats.nframe > 1) && (frame->eof_ns > stream->last_eof) && (frame->frame_nr > stream->last_nr)) {
+		interval = (frame->eof_ns - stream->last_eof) / (double) (frame->frame_nr - stream->last_nr);
+		if (stream->stats.interval_ns <= 0.0) {
+			stream->stats.interval_ns = interval;
+		}
+		else {
+			if (interval > LATE_FACTOR * stream->stats.interval_ns) {
+				frame->late = 1;
+				stream->stats.nlate++;
+				interval = LATE_FACTOR * stream->stats.interval_ns;
+			}
+			stream->stats.interval_ns += INTERVAL_WEIGHT * (interval - stream->stats.interval_ns);
+		}
+	}
+	stream->last_nr = frame->frame_nr;
+	stream->last_eof = frame->eof_ns;
+}
+
+
+// record host clock for frame in BOF or EOF ring
+// runs on the PVCAM callback thread; frame_nr is cleared while ns changes and published after it,
+// so a reader finding the same frame_nr before and after reading ns has the time of that frame
+static void stream_stamp(pvcam_host_stamp *ring, int32 frame_nr) {
+
+	// declarations
+	pvcam_host_stamp	*stamp;	// ring entry of frame
+
+	stamp = &ring[(uns32) frame_nr % TIMING_RING];
+	stamp->frame_nr = 0;
+	stream_barrier();
+	stamp->ns = (long64) pvcam_clock_ns();
+	stream_barrier();
+	stamp->frame_nr = (long) frame_nr;
+}
+
+
+// cut and bin requested regions out of unbinned bounding region
+// bins are summed in 32 bits and clipped, as a saturated camera would report them
+static void stream_cut_regions(const pvcam_stream *stream, const uns16 *bound_pixels) {
+
+	// declarations
+	const rgn_type	*region;	// current requested region
+	const uns16	*row_ptr;		// first bounding row of current bin
+	uns16	*out_ptr;			// next output pixel
+	uns16	i;					// region counter
+	uns32	a, b;				// position within bin
+	uns32	bound_width;		// pixels per bounding row
+	uns32	s, p;				// binned coordinates within region
+	uns32	sum;				// bin sum
+	uns32	width, height;		// binned region size
+
+	bound_width = (uns32) (stream->bound.s2 - stream->bound.s1 + 1);
+	out_ptr = stream->scratch;
+	for (i = 0; i < stream->nregion; i++) {
+		region = &stream->region[i];
+		width = (uns32) ((region->s2 - region->s1 + 1) / region->sbin);
+		height = (uns32) ((region->p2 - region->p1 + 1) / region->pbin);
+		for (p = 0; p < height; p++) {
+			row_ptr = bound_pixels + (size_t) (region->p1 - stream->bound.p1 + p * region->pbin) * bound_width +
+				(region->s1 - stream->bound.s1);
+
+			// unbinned rows are a straight copy
+			if ((region->sbin == 1) && (region->pbin == 1)) {
+				memcpy(out_ptr, row_ptr, (size_t) width * sizeof(uns16));
+				out_ptr += width;
+				continue;
+			}
+			for (s = 0; s < width; s++) {
+				sum = 0;
+				for (a = 0; a < region->pbin; a++) {
+					for (b = 0; b < region->sbin; b++) {
+						sum += row_ptr[(size_t) a * bound_width + s * region->sbin + b];
+					}
+				}
+				*out_ptr++ = (sum > 0xFFFF) ? 0xFFFF : (uns16) sum;
+			}
+		}
+	}
+}
+
+
+// host time of frame since start from BOF (0) or EOF (TIMING_RING) ring, -1 if not stamped
+// ns is only taken if the entry holds frame_nr both before and after it is read
+static double stream_stamp_time(const pvcam_stream *stream, uns32 ring, uns32 frame_nr) {
+
+	// declarations
+	const pvcam_host_stamp	*stamp;	// ring entry of frame
+	long	first_nr;		// frame of entry before reading ns
+	long64	ns;				// stamped host clock
+
+	if (stream->stamp == NULL) {
+		return(-1.0);
+	}
+	stamp = &stream->stamp[ring + frame_nr % TIMING_RING];
+	first_nr = stamp->frame_nr;
+	stream_barrier();
+	ns = stamp->ns;
+	stream_barrier();
+	if ((first_nr != (long) frame_nr) || (stamp->frame_nr != first_nr) || ((ulong64) ns < stream->start_ns)) {
+		return(-1.0);
+	}
+	return((double) ((ulong64) ns - stream->start_ns));
+}
+
+
+// full memory barrier between ring entry accesses
+static void stream_barrier(void) {
+#if defined(_WIN32) || defined(_WIN64)
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
+
+// PVCAM callback at beginning of frame
+static void PV_DECL stream_bof_callback(FRAME_INFO *frame_info, void *context) {
+	stream_stamp(((pvcam_stream *) context)->stamp, frame_info->FrameNr);
+}
+
+
+// PVCAM callback at end of frame
+static void PV_DECL stream_eof_callback(FRAME_INFO *frame_info, void *context) {
+	stream_stamp(((pvcam_stream *) context)->stamp + TIMING_RING, frame_info->FrameNr);
+}
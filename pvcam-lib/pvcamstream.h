@@ -0,0 +1,102 @@
+/* Continuous acquisition engine for PVCAM MEX files */
+
+/* 10/18/26 */
+
+#ifndef _PVCAMSTREAM_H
+#define _PVCAMSTREAM_H
+
+// inclusions
+#include "pvcamutil.h"
+
+
+// definitions
+#define STREAM_BUFFER	16		// default frames held in circular buffer
+#define LATE_FACTOR		1.5		// frame interval over average counted as late
+#define INTERVAL_WEIGHT	0.05	// weight of newest interval in running average
+#define TIMING_RING		256		// host callback timestamps kept per event
+
+
+// frame pulled from the circular buffer
+typedef struct pvcam_frame {
+	uns16		*pixels;		// pixel data with metadata headers removed
+	uns32		npixel;			// number of pixels in frame
+	uns32		frame_nr;		// frame number (1-based)
+	double		bof_ns;			// beginning of frame timestamp (ns)
+	double		eof_ns;			// end of frame timestamp (ns)
+	double		exp_ns;			// exposure time (ns)
+	uns8		bit_depth;		// sensor bit depth, 0 without metadata
+	uns32		ndropped;		// frames missing just before this frame
+	rs_bool		late;			// EOF interval well above running average
+	rs_bool		overwritten;	// camera rewrote the slot while the frame was read or used
+	double		host_bof_ns;	// host clock at BOF callback since start (ns), -1 if not timed
+	double		host_eof_ns;	// host clock at EOF callback since start (ns), -1 if not timed
+	double		host_data_ns;	// host clock when frame was taken from buffer since start (ns)
+	uns16		nroi;			// regions described by metadata, 0 without metadata
+	const md_frame_roi	*roi;	// region descriptors, valid until the next frame
+	double		roi_res_ns;		// region timestamp resolution (ns), 0 if regions carry none
+} pvcam_frame;
+
+// host clock reading taken in a PVCAM callback
+typedef struct pvcam_host_stamp {
+	volatile long	frame_nr;		// frame stamped, 0 if none yet
+	volatile long64	ns;				// host clock (ns)
+} pvcam_host_stamp;
+
+// continuity counters kept while streaming
+typedef struct pvcam_stream_stats {
+	uns32		nframe;			// frames delivered
+	uns32		ndropped;		// frames missing from sequence, overruns included
+	uns32		nlate;			// frames arriving late
+	uns32		noverrun;		// frames overwritten in buffer before delivery
+	uns32		noverwritten;	// frames overwritten in buffer while read or used
+	uns32		max_backlog;	// most frames waiting in buffer
+	double		interval_ns;	// running average EOF interval (ns)
+} pvcam_stream_stats;
+
+// continuous acquisition state
+typedef struct pvcam_stream {
+	int16		hcam;			// camera handle
+	uns16		nregion;		// number of regions
+	uns32		frame_bytes;	// bytes per frame including metadata
+	uns32		npixel;			// pixels per frame excluding metadata
+	uns32		nbuffer;		// frames held in circular buffer
+	uns8		*buffer;		// circular buffer
+	uns16		*scratch;		// pixel buffer for multiple region frames
+	rgn_type	*region;		// requested regions when cut in software, NULL otherwise
+	rgn_type	bound;			// unbinned region read when regions are cut in software
+	md_frame	*md;			// metadata decoder
+	rs_bool		has_meta;		// metadata enabled on camera
+	rs_bool		centroids;		// PrimeLocate on, regions are left ungathered
+	uns16		ncentroid;		// most PrimeLocate regions per frame
+	rs_bool		running;		// acquisition started
+	volatile long	stop;		// set from another thread to end the wait in pvcam_stream_next
+	uns32		ndelivered;		// frames handed out by pvcam_stream_next
+	uns32		backlog;		// frames waiting in buffer behind the last one handed out
+	rs_bool		pending;		// last frame handed out still points into the buffer
+	uns32		last_nr;		// frame number of last delivered frame
+	double		last_eof;		// EOF timestamp of last delivered frame (ns)
+	ulong64		start_ns;		// host clock when acquisition started (ns)
+	pvcam_host_stamp	*stamp;	// BOF then EOF callback stamps, NULL unless timed
+	pvcam_stream_stats	stats;	// continuity counters
+	const char	*err_msg;		// reason for last failure
+} pvcam_stream;
+
+
+// function prototypes
+
+// set up and start continuous acquisition into circular buffer
+// timing registers BOF/EOF callbacks that stamp each frame with the host clock
+rs_bool pvcam_stream_open(pvcam_stream *stream, int16 hcam, uns16 nregion, const rgn_type *region,
+						  uns32 exptime, int16 expmode, uns32 nbuffer, rs_bool timing);
+
+// wait for next frame and decode it
+rs_bool pvcam_stream_next(pvcam_stream *stream, pvcam_frame *frame);
+
+// check once the caller is done with frame that the camera did not rewrite its slot meanwhile
+// flags and counts the frame if it did; pvcam_stream_next checks frames not checked here
+rs_bool pvcam_stream_done(pvcam_stream *stream, pvcam_frame *frame);
+
+// stop acquisition and free buffers
+void pvcam_stream_close(pvcam_stream *stream);
+
+#endif /* _PVCAMSTREAM_H */
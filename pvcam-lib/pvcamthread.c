@@ -0,0 +1,621 @@
+/* Worker threads for PVCAM MEX files */
+
+/* 10/18/26 */
+
+/* Worker threads must not call the MEX API (mxMalloc, mexWarnMsgTxt, ...),
+   which is only safe from the MATLAB thread.
+
+   Threads are placed as the core placement says (see pvcamthreads.c) when
+   they are created, before they run: Windows threads start suspended
+   until their affinity and priority are set, POSIX threads get them
+   through their creation attributes.  A thread the system will not place
+   (real-time priority without the privilege, a CPU that is offline) is
+   created unplaced instead, so placement never costs a thread.
+
+   pvcam_parallel_for runs on a pool of workers started by its first call,
+   which then sleep until the next one, so a call per frame costs a wake-up
+   instead of creating and joining threads.  A call made while the pool is
+   busy, from another thread or from inside a task, runs its tasks on the
+   calling thread.  The pool starts over when the worker CPUs change, and
+   pvcam_thread_stop ends it before the MEX file is cleared. */
+
+// inclusions
+#if !defined(_WIN32) && !defined(_WIN64)
+#define _GNU_SOURCE
+#endif
+#include "pvcamthread.h"
+#include "pvcamcore.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+
+// platform thread handle and entry point, pool lock and wake-up
+#if defined(_WIN32) || defined(_WIN64)
+typedef HANDLE	thread_handle;
+typedef DWORD (WINAPI *thread_entry)(LPVOID arg);
+typedef SRWLOCK	pool_mutex;
+typedef CONDITION_VARIABLE	pool_cond;
+#define POOL_MUTEX_INIT	SRWLOCK_INIT
+#define POOL_COND_INIT	CONDITION_VARIABLE_INIT
+#else
+typedef pthread_t	thread_handle;
+typedef void *(*thread_entry)(void *arg);
+typedef pthread_mutex_t	pool_mutex;
+typedef pthread_cond_t	pool_cond;
+#define POOL_MUTEX_INIT	PTHREAD_MUTEX_INITIALIZER
+#define POOL_COND_INIT	PTHREAD_COND_INITIALIZER
+#endif
+
+// shared state for one pvcam_parallel_for call
+typedef struct parallel_job {
+	pvcam_task_fn	task_fn;	// task routine
+	void			*task_ctx;	// task context
+	uns32			ntask;		// number of tasks
+	volatile long	next;		// next task index to hand out
+} parallel_job;
+
+// workers kept between pvcam_parallel_for calls, guarded by pool_lock
+typedef struct worker_pool {
+	parallel_job	*job;		// job of the call holding the pool, NULL if free
+	uns32			generation;	// jobs handed out, workers wake when it moves on
+	uns32			first_generation;	// generation when the workers were started
+	uns32			nbusy;		// workers not done with the current job
+	rs_bool			stop;		// workers are to return
+	rs_bool			started;	// workers started for the CPUs below
+	uns32			nworker;	// workers running
+	thread_handle	thread[MAX_THREADS];	// worker threads
+	uns32			ncpu;		// worker CPUs listed when started
+	uns16			cpu[MAX_PLACE_CPU];	// worker CPUs when started
+} worker_pool;
+
+// single task given its own thread by pvcam_thread_run
+typedef struct thread_task {
+	pvcam_task_fn	task_fn;	// task routine
+	void			*task_ctx;	// task context
+	uns32			task;		// task index
+} thread_task;
+
+// background thread left running by pvcam_thread_start
+struct pvcam_thread {
+	thread_task		task;		// task run by thread
+	thread_handle	handle;		// thread handle
+};
+
+
+// function prototypes
+
+// claim next task index
+static long job_claim(parallel_job *job);
+
+// run tasks until none are left
+static void job_run(parallel_job *job);
+
+// serve jobs handed to the pool until it stops
+static void pool_loop(void);
+
+// start workers if there are none or the worker CPUs changed, caller holds the pool
+static void pool_start(void);
+
+// stop and join all workers, caller holds the pool
+static void pool_end(void);
+
+// take and give up pool_lock
+static void pool_enter(void);
+static void pool_leave(void);
+
+// wait on condition with pool_lock held, wake all waiting on condition
+static void pool_sleep(pool_cond *cond);
+static void pool_wake(pool_cond *cond);
+
+// create thread placed for its role, falling back to an unplaced thread, 0 if none could be created
+static rs_bool thread_create(thread_handle *handle, thread_entry entry, void *arg, int role, uns32 index,
+							 rs_bool *placed);
+
+// wait for thread to finish and release its handle
+static void thread_wait(thread_handle handle);
+
+// start background thread running task, placed for its role, NULL if it cannot be started
+static pvcam_thread *thread_start(pvcam_task_fn task_fn, void *task_ctx, uns32 task, int role, uns32 index);
+
+
+// global variables
+static uns32	next_acquire = 0;	// acquisition CPU for next background thread
+static worker_pool	pool;			// pvcam_parallel_for workers
+static pool_mutex	pool_lock = POOL_MUTEX_INIT;	// guards pool
+static pool_cond	pool_ready = POOL_COND_INIT;	// new job or stop for workers
+static pool_cond	pool_done = POOL_COND_INIT;		// last worker done with job
+
+
+// number of processors online
+uns32 pvcam_cpu_count(void) {
+
+	// declarations
+	static uns32	ncpu = 0;	// cached processor count
+#if defined(_WIN32) || defined(_WIN64)
+	SYSTEM_INFO		sys_info;
+
+	if (ncpu == 0) {
+		GetSystemInfo(&sys_info);
+		ncpu = (uns32) sys_info.dwNumberOfProcessors;
+	}
+#else
+	if (ncpu == 0) {
+		ncpu = (uns32) sysconf(_SC_NPROCESSORS_ONLN);
+	}
+#endif
+	return(ncpu);
+}
+
+
+// number of worker threads used by pvcam_parallel_for
+// with worker CPUs listed, one worker per CPU plus the calling thread
+uns32 pvcam_thread_count(void) {
+
+	// declarations
+	uns32	nthread;		// threads to use
+
+	nthread = (pvcam_core_placement()->nworker > 0) ? pvcam_core_placement()->nworker + 1 : pvcam_cpu_count();
+	if (nthread < 1) {
+		nthread = 1;
+	}
+	else if (nthread > MAX_THREADS) {
+		nthread = MAX_THREADS;
+	}
+	return(nthread);
+}
+
+
+#if defined(_WIN32) || defined(_WIN64)
+
+// pool worker thread entry
+static DWORD WINAPI pool_thread(LPVOID arg) {
+	(void) arg;
+	pool_loop();
+	return(0);
+}
+
+static void pool_enter(void) {
+	AcquireSRWLockExclusive(&pool_lock);
+}
+
+static void pool_leave(void) {
+	ReleaseSRWLockExclusive(&pool_lock);
+}
+
+static void pool_sleep(pool_cond *cond) {
+	SleepConditionVariableSRW(cond, &pool_lock, INFINITE, 0);
+}
+
+static void pool_wake(pool_cond *cond) {
+	WakeAllConditionVariable(cond);
+}
+
+static long job_claim(parallel_job *job) {
+	return(InterlockedIncrement(&job->next) - 1);
+}
+
+long pvcam_atomic_swap(volatile long *value, long old_value, long new_value) {
+	return(InterlockedCompareExchange(value, new_value, old_value));
+}
+
+long pvcam_atomic_add(volatile long *value, long delta) {
+	return(InterlockedExchangeAdd(value, delta) + delta);
+}
+
+void pvcam_thread_sleep(uns32 ms) {
+	Sleep((DWORD) ms);
+}
+
+// dedicated task thread entry
+static DWORD WINAPI task_thread(LPVOID arg) {
+	thread_task	*task = (thread_task *) arg;
+
+	task->task_fn(task->task_ctx, task->task);
+	return(0);
+}
+
+// placement probe thread entry
+static DWORD WINAPI probe_thread(LPVOID arg) {
+	(void) arg;
+	return(0);
+}
+
+static rs_bool thread_create(thread_handle *handle, thread_entry entry, void *arg, int role, uns32 index,
+							 rs_bool *placed) {
+	const pvcam_placement	*placement = pvcam_core_placement();
+	const uns16	*cpu = (role == THREAD_ACQUIRE) ? placement->acquire_cpu : placement->worker_cpu;
+	uns32		ncpu = (role == THREAD_ACQUIRE) ? placement->nacquire : placement->nworker;
+
+	if ((*handle = CreateThread(NULL, 0, entry, (LPVOID) arg, CREATE_SUSPENDED, NULL)) == NULL) {
+		return(0);
+	}
+	*placed = 1;
+	if ((ncpu > 0) && (SetThreadAffinityMask(*handle, (DWORD_PTR) 1 << cpu[index % ncpu]) == 0)) {
+		*placed = 0;
+	}
+	if ((role == THREAD_ACQUIRE) && (placement->priority != PRIORITY_NORMAL) &&
+		!SetThreadPriority(*handle, (placement->priority == PRIORITY_REALTIME) ? THREAD_PRIORITY_TIME_CRITICAL :
+		THREAD_PRIORITY_HIGHEST)) {
+		*placed = 0;
+	}
+	ResumeThread(*handle);
+	return(1);
+}
+
+static void thread_wait(thread_handle handle) {
+	WaitForSingleObject(handle, INFINITE);
+	CloseHandle(handle);
+}
+
+#else
+
+// pool worker thread entry
+static void *pool_thread(void *arg) {
+	(void) arg;
+	pool_loop();
+	return(NULL);
+}
+
+static void pool_enter(void) {
+	pthread_mutex_lock(&pool_lock);
+}
+
+static void pool_leave(void) {
+	pthread_mutex_unlock(&pool_lock);
+}
+
+static void pool_sleep(pool_cond *cond) {
+	pthread_cond_wait(cond, &pool_lock);
+}
+
+static void pool_wake(pool_cond *cond) {
+	pthread_cond_broadcast(cond);
+}
+
+static long job_claim(parallel_job *job) {
+	return(__sync_fetch_and_add(&job->next, 1));
+}
+
+long pvcam_atomic_swap(volatile long *value, long old_value, long new_value) {
+	return(__sync_val_compare_and_swap(value, old_value, new_value));
+}
+
+long pvcam_atomic_add(volatile long *value, long delta) {
+	return(__sync_add_and_fetch(value, delta));
+}
+
+void pvcam_thread_sleep(uns32 ms) {
+	usleep((useconds_t) ms * 1000);
+}
+
+// dedicated task thread entry
+static void *task_thread(void *arg) {
+	thread_task	*task = (thread_task *) arg;
+
+	task->task_fn(task->task_ctx, task->task);
+	return(NULL);
+}
+
+// placement probe thread entry
+static void *probe_thread(void *arg) {
+	(void) arg;
+	return(NULL);
+}
+
+static rs_bool thread_create(thread_handle *handle, thread_entry entry, void *arg, int role, uns32 index,
+							 rs_bool *placed) {
+	const pvcam_placement	*placement = pvcam_core_placement();
+	const uns16	*cpu = (role == THREAD_ACQUIRE) ? placement->acquire_cpu : placement->worker_cpu;
+	uns32		ncpu = (role == THREAD_ACQUIRE) ? placement->nacquire : placement->nworker;
+	rs_bool		raise = (role == THREAD_ACQUIRE) && (placement->priority != PRIORITY_NORMAL);
+	cpu_set_t	cpu_set;
+	int			policy;
+	pthread_attr_t	attr;
+	struct sched_param	param;
+	rs_bool		created;
+
+	// SCHED_RR at its lowest level already preempts every normal thread
+	*placed = 1;
+	if ((ncpu > 0) || raise) {
+		pthread_attr_init(&attr);
+		if (ncpu > 0) {
+			CPU_ZERO(&cpu_set);
+			CPU_SET(cpu[index % ncpu], &cpu_set);
+			pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpu_set);
+		}
+		if (raise) {
+			policy = (placement->priority == PRIORITY_REALTIME) ? SCHED_FIFO : SCHED_RR;
+			param.sched_priority = (placement->priority == PRIORITY_REALTIME) ? sched_get_priority_max(policy) - 1 :
+				sched_get_priority_min(policy);
+			pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+			pthread_attr_setschedpolicy(&attr, policy);
+			pthread_attr_setschedparam(&attr, &param);
+		}
+		created = (pthread_create(handle, &attr, entry, arg) == 0);
+		pthread_attr_destroy(&attr);
+		if (created) {
+			return(1);
+		}
+		*placed = 0;
+	}
+	return(pthread_create(handle, NULL, entry, arg) == 0);
+}
+
+static void thread_wait(thread_handle handle) {
+	pthread_join(handle, NULL);
+}
+
+#endif
+
+
+// run tasks 0 .. ntask - 1 across worker threads and wait for completion
+void pvcam_parallel_for(uns32 ntask, pvcam_task_fn task_fn, void *task_ctx) {
+
+	// declarations
+	parallel_job	job;		// shared job state
+	rs_bool			pooled;		// job handed to the pool
+
+	job.task_fn = task_fn;
+	job.task_ctx = task_ctx;
+	job.ntask = ntask;
+	job.next = 0;
+
+	// a single task, or a pool busy with another call, runs here
+	pooled = 0;
+	if (ntask > 1) {
+		pool_enter();
+		if (pool.job == NULL) {
+			pool.job = &job;
+			pooled = 1;
+		}
+		pool_leave();
+	}
+
+	// wake the workers, the calling thread takes a share of the work
+	if (pooled) {
+		pool_start();
+		pool_enter();
+		pool.nbusy = pool.nworker;
+		pool.generation++;
+		pool_wake(&pool_ready);
+		pool_leave();
+	}
+	job_run(&job);
+
+	// wait for workers to finish their last task
+	if (pooled) {
+		pool_enter();
+		while (pool.nbusy > 0) {
+			pool_sleep(&pool_done);
+		}
+		pool.job = NULL;
+		pool_leave();
+	}
+}
+
+
+// stop the pvcam_parallel_for workers, the next call starts them again
+// MEX files calling pvcam_parallel_for register this with pvcam_at_exit
+void pvcam_thread_stop(void) {
+
+	// declarations
+	parallel_job	job;		// placeholder holding the pool
+
+	// wait for a running call to give up the pool
+	job.ntask = 0;
+	pool_enter();
+	while (pool.job != NULL) {
+		pool_leave();
+		pvcam_thread_sleep(1);
+		pool_enter();
+	}
+	pool.job = &job;
+	pool_leave();
+
+	pool_end();
+	pool_enter();
+	pool.job = NULL;
+	pool_leave();
+}
+
+
+// run tasks until none are left
+static void job_run(parallel_job *job) {
+
+	// declarations
+	long	task;			// claimed task index
+
+	while ((task = job_claim(job)) < (long) job->ntask) {
+		job->task_fn(job->task_ctx, (uns32) task);
+	}
+}
+
+
+// run each task 0 .. ntask - 1 on its own thread and wait for completion
+void pvcam_thread_run(uns32 ntask, pvcam_task_fn task_fn, void *task_ctx) {
+
+	// declarations
+	rs_bool			placed;		// thread placed as asked
+	rs_bool			started[MAX_THREADS];	// thread running task
+	thread_task		task[MAX_THREADS];		// per-thread task
+	uns32			i;			// loop counter
+	thread_handle	thread[MAX_THREADS];
+
+	// tasks block (e.g. waiting on a camera), so none may share a thread
+	// a task whose thread cannot be started runs inline afterwards
+	if (ntask > MAX_THREADS) {
+		ntask = MAX_THREADS;
+	}
+	for (i = 0; i < ntask; i++) {
+		task[i].task_fn = task_fn;
+		task[i].task_ctx = task_ctx;
+		task[i].task = i;
+		started[i] = thread_create(&thread[i], task_thread, (void *) &task[i], THREAD_ACQUIRE, i, &placed);
+	}
+	for (i = 0; i < ntask; i++) {
+		if (!started[i]) {
+			task_fn(task_ctx, i);
+			continue;
+		}
+		thread_wait(thread[i]);
+	}
+}
+
+
+// run task 0 on a background thread and return at once, NULL if the thread cannot be started
+// the task must watch a flag of its own to know when to return
+// successive background threads take the acquisition CPUs in turn
+pvcam_thread *pvcam_thread_start(pvcam_task_fn task_fn, void *task_ctx) {
+	return(thread_start(task_fn, task_ctx, 0, THREAD_ACQUIRE, next_acquire++));
+}
+
+
+// run task on a background thread placed as worker number task, NULL if the thread cannot be started
+// for pools that outlive one pvcam_parallel_for, the task returns when its pool stops
+pvcam_thread *pvcam_thread_start_worker(pvcam_task_fn task_fn, void *task_ctx, uns32 task) {
+	return(thread_start(task_fn, task_ctx, task, THREAD_WORKER, task));
+}
+
+
+// wait for background thread to finish and free it
+void pvcam_thread_join(pvcam_thread *thread) {
+	if (thread == NULL) {
+		return;
+	}
+	thread_wait(thread->handle);
+	free((void *) thread);
+}
+
+
+// check that threads of role can be placed as the core placement says, one probe per listed CPU
+rs_bool pvcam_thread_probe(int role) {
+
+	// declarations
+	const pvcam_placement	*placement;	// placement to check
+	rs_bool			placed;		// probe placed as asked
+	thread_handle	thread;		// probe thread
+	uns32			i;			// CPU counter
+	uns32			ncpu;		// CPUs listed for role
+
+	placement = pvcam_core_placement();
+	ncpu = (role == THREAD_ACQUIRE) ? placement->nacquire : placement->nworker;
+	for (i = 0; (i == 0) || (i < ncpu); i++) {
+		if (!thread_create(&thread, probe_thread, NULL, role, i, &placed)) {
+			return(0);
+		}
+		thread_wait(thread);
+		if (!placed) {
+			return(0);
+		}
+	}
+	return(1);
+}
+
+
+// start background thread running task, placed for its role, NULL if it cannot be started
+static pvcam_thread *thread_start(pvcam_task_fn task_fn, void *task_ctx, uns32 task, int role, uns32 index) {
+
+	// declarations
+	pvcam_thread	*thread;	// thread state, freed by pvcam_thread_join
+	rs_bool			placed;		// thread placed as asked
+
+	if ((thread = (pvcam_thread *) malloc(sizeof(pvcam_thread))) == NULL) {
+		return(NULL);
+	}
+	thread->task.task_fn = task_fn;
+	thread->task.task_ctx = task_ctx;
+	thread->task.task = task;
+	if (!thread_create(&thread->handle, task_thread, (void *) &thread->task, role, index, &placed)) {
+		free((void *) thread);
+		return(NULL);
+	}
+	return(thread);
+}
+
+
+// serve jobs handed to the pool until it stops
+static void pool_loop(void) {
+
+	// declarations
+	parallel_job	*job;		// job to work on
+	uns32			seen;		// last generation served
+
+	pool_enter();
+	seen = pool.first_generation;
+	for (;;) {
+		while (!pool.stop && (pool.generation == seen)) {
+			pool_sleep(&pool_ready);
+		}
+		if (pool.stop) {
+			break;
+		}
+		seen = pool.generation;
+		job = pool.job;
+		pool_leave();
+		job_run(job);
+		pool_enter();
+		if (--pool.nbusy == 0) {
+			pool_wake(&pool_done);
+		}
+	}
+	pool_leave();
+}
+
+
+// start workers if there are none or the worker CPUs changed, caller holds the pool
+// one worker per thread of pvcam_thread_count, less the calling thread
+static void pool_start(void) {
+
+	// declarations
+	const pvcam_placement	*placement;	// current placement
+	rs_bool			placed;		// worker placed as asked
+	uns32			i;			// worker counter
+	uns32			nthread;	// threads to use, including caller
+
+	placement = pvcam_core_placement();
+	if (pool.started && (pool.ncpu == placement->nworker) &&
+		(memcmp(pool.cpu, placement->worker_cpu, (size_t) pool.ncpu * sizeof(uns16)) == 0)) {
+		return;
+	}
+	pool_end();
+	pool.ncpu = placement->nworker;
+	memcpy(pool.cpu, placement->worker_cpu, (size_t) pool.ncpu * sizeof(uns16));
+
+	// workers serve generations after the current one, which moves only once all are started
+	// fewer workers if some cannot be started
+	pool.first_generation = pool.generation;
+	nthread = pvcam_thread_count();
+	for (i = 0; i + 1 < nthread; i++) {
+		if (!thread_create(&pool.thread[i], pool_thread, NULL, THREAD_WORKER, i, &placed)) {
+			break;
+		}
+	}
+	pool.nworker = i;
+	pool.started = 1;
+}
+
+
+// stop and join all workers, caller holds the pool
+static void pool_end(void) {
+
+	// declarations
+	uns32	i;				// worker counter
+
+	pool_enter();
+	pool.stop = 1;
+	pool_wake(&pool_ready);
+	pool_leave();
+	for (i = 0; i < pool.nworker; i++) {
+		thread_wait(pool.thread[i]);
+	}
+	pool.nworker = 0;
+	pool.stop = 0;
+	pool.started = 0;
+}
@@ -0,0 +1,64 @@
+/* Worker threads for PVCAM MEX files */
+
+/* 10/18/26 */
+
+#ifndef _PVCAMTHREAD_H
+#define _PVCAMTHREAD_H
+
+// inclusions
+#include "master.h"
+
+
+// definitions
+#define MAX_THREADS		64		// upper limit on worker threads
+#define THREAD_ACQUIRE	0		// role of threads that wait on cameras
+#define THREAD_WORKER	1		// role of pvcam_parallel_for workers
+
+
+// task run by pvcam_parallel_for, called once per task index
+typedef void (*pvcam_task_fn)(void *task_ctx, uns32 task);
+
+// background thread started by pvcam_thread_start
+typedef struct pvcam_thread pvcam_thread;
+
+
+// function prototypes
+
+// number of processors online
+uns32 pvcam_cpu_count(void);
+
+// number of worker threads used by pvcam_parallel_for
+uns32 pvcam_thread_count(void);
+
+// run tasks 0 .. ntask - 1 across worker threads and wait for completion
+void pvcam_parallel_for(uns32 ntask, pvcam_task_fn task_fn, void *task_ctx);
+
+// stop the pvcam_parallel_for workers, the next call starts them again
+// MEX files calling pvcam_parallel_for register this with pvcam_at_exit
+void pvcam_thread_stop(void);
+
+// run each task 0 .. ntask - 1 on its own thread and wait for completion
+void pvcam_thread_run(uns32 ntask, pvcam_task_fn task_fn, void *task_ctx);
+
+// run task 0 on a background thread and return at once, NULL if the thread cannot be started
+pvcam_thread *pvcam_thread_start(pvcam_task_fn task_fn, void *task_ctx);
+
+// run task on a background thread placed as worker number task, NULL if the thread cannot be started
+pvcam_thread *pvcam_thread_start_worker(pvcam_task_fn task_fn, void *task_ctx, uns32 task);
+
+// wait for background thread to finish and free it
+void pvcam_thread_join(pvcam_thread *thread);
+
+// give up the processor for about ms milliseconds
+void pvcam_thread_sleep(uns32 ms);
+
+// check that threads of role can be placed as the core placement says, one probe per listed CPU
+rs_bool pvcam_thread_probe(int role);
+
+// replace value by new_value if it equals old_value, returns previous value, full memory barrier
+long pvcam_atomic_swap(volatile long *value, long old_value, long new_value);
+
+// add delta to value, returns new value, full memory barrier
+long pvcam_atomic_add(volatile long *value, long delta);
+
+#endif /* _PVCAMTHREAD_H */
@@ -0,0 +1,203 @@
+/* PVCAMTHREADS - place acquisition threads, worker threads and frame buffers
+
+      CONFIG = PVCAMTHREADS returns the current placement as a structure
+	  with fields:
+
+					acquire = CPUs for acquisition threads, [] to leave them unpinned
+					workers = CPUs for worker threads, [] for one unpinned worker per CPU
+					priority = 'normal', 'high' or 'realtime' for acquisition threads
+					node = NUMA node of frame buffers, -1 for the system default
+					huge = 1 to put frame buffers on huge pages
+					lock = 1 to lock frame buffers in memory
+					pool = MB of idle frame buffers kept for reuse
+					cpus = processors online (read only)
+					nodes = NUMA nodes (read only)
+
+	  Acquisition threads are the threads that wait on cameras: one per
+	  camera in PVCAMMULTI and the background thread of PVCAMRING.  They
+	  take the acquire CPUs in turn.  Worker threads run the processing
+	  kernels (speckle contrast, binning, recording, ...); with workers
+	  set there is one worker on each listed CPU, and the calling MATLAB
+	  thread takes a share of the work as well.  CPUs are numbered from 0
+	  as the operating system numbers them.
+
+	  Frame buffers (the circular buffer of the acquisition engine, the
+	  rings of PVCAMRING and the buffer of PVCAMARM) are allocated in whole
+	  pages on node, so readout and processing on that node's CPUs never
+	  cross to the other socket.  Huge pages cut TLB misses on large frames
+	  and locked buffers never page fault during readout; on Linux huge
+	  pages must be reserved (vm.nr_hugepages) and locking needs a large
+	  enough RLIMIT_MEMLOCK, on Windows both need the 'Lock pages in
+	  memory' right.  A freed frame buffer is kept in a pool and the next
+	  acquisition of the same size takes it back without mapping or
+	  faulting anything in; pool bounds the memory kept this way.
+
+      CONFIG = PVCAMTHREADS(OPTS) changes the fields of the structure OPTS
+	  that are present and returns the new placement.  It applies to
+	  threads and buffers created afterwards, so set it before starting
+	  an acquisition.  A test thread and a test buffer are placed right
+	  away, and a warning is given if the system refused, for instance
+	  'realtime' without the privilege to raise priority (CAP_SYS_NICE on
+	  Linux); threads the system will not place run unplaced and buffers
+	  fall back to ordinary pages.  Pooled buffers are released, since
+	  they no longer match.
+
+	  A real-time acquisition thread polls the camera without sleeping,
+	  so give it a CPU of its own in acquire.  The placement is kept in
+	  the core library and shared by every MEX file. */
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamthread.h"
+#include "pvcambuffer.h"
+
+
+// definitions
+#define THREADS_FIELD	9		// number of fields in placement structure
+
+
+// function prototypes
+
+// read CPU list field of options, leaving list unchanged if absent
+void pvcam_threads_cpus(const mxArray *opts, const char *name, uns32 *ncpu, uns16 *cpu);
+
+// build placement structure
+mxArray *pvcam_threads_struct(const pvcam_placement *placement);
+
+
+// command routine, also reached as pvcam('threads', ...)
+void pvcam_cmd_threads(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	const char	*priority_list[3] = {"normal", "high", "realtime"};
+	char		*priority;		// priority string
+	double		node;			// NUMA node
+	double		pool;			// pool size (MB)
+	pvcam_placement	placement;	// new placement
+
+	// validate arguments
+	if ((nrhs > 1) || (nlhs > 1)) {
+		mexErrMsgTxt("type 'help pvcamthreads' for syntax");
+	}
+	if ((nrhs == 1) && !mxIsStruct(prhs[0])) {
+		mexErrMsgTxt("OPTS must be a structure");
+	}
+	placement = *pvcam_core_placement();
+
+	// change fields given
+	if (nrhs == 1) {
+		pvcam_threads_cpus(prhs[0], "acquire", &placement.nacquire, placement.acquire_cpu);
+		pvcam_threads_cpus(prhs[0], "workers", &placement.nworker, placement.worker_cpu);
+		priority = pvcam_option_string(prhs[0], "priority", priority_list[placement.priority]);
+		for (placement.priority = 0; (placement.priority < 3) &&
+			(strcmp(priority, priority_list[placement.priority]) != 0); placement.priority++) {
+		}
+		mxFree((void *) priority);
+		if (placement.priority == 3) {
+			mexErrMsgTxt("OPTS.priority must be 'normal', 'high' or 'realtime'");
+		}
+		node = pvcam_option_value(prhs[0], "node", (double) placement.node);
+		if ((node < -1.0) || (node >= (double) pvcam_node_count()) || (node != (double) (int) node)) {
+			mexErrMsgTxt("OPTS.node must be -1 or a NUMA node number");
+		}
+		placement.node = (int) node;
+		placement.huge = (pvcam_option_value(prhs[0], "huge", (double) placement.huge) != 0.0);
+		placement.lock = (pvcam_option_value(prhs[0], "lock", (double) placement.lock) != 0.0);
+		pool = pvcam_option_value(prhs[0], "pool", (double) placement.pool);
+		if ((pool < 0.0) || (pool > 4294967295.0) || (pool != (double) (uns32) pool)) {
+			mexErrMsgTxt("OPTS.pool must be a whole number of MB");
+		}
+		placement.pool = (uns32) pool;
+		pvcam_core_set_placement(&placement);
+		pvcam_buffer_trim();
+
+		// let the user know now rather than find threads unplaced later
+		if (!pvcam_thread_probe(THREAD_ACQUIRE)) {
+			mexWarnMsgTxt("System refused to place acquisition threads as asked, they will run unplaced");
+		}
+		if (!pvcam_thread_probe(THREAD_WORKER)) {
+			mexWarnMsgTxt("System refused to place worker threads as asked, they will run unplaced");
+		}
+		if (!pvcam_buffer_probe()) {
+			mexWarnMsgTxt("System refused huge pages or locking for frame buffers, they will use ordinary pages");
+		}
+	}
+	plhs[0] = pvcam_threads_struct(&placement);
+}
+
+
+// read CPU list field of options, leaving list unchanged if absent
+void pvcam_threads_cpus(const mxArray *opts, const char *name, uns32 *ncpu, uns16 *cpu) {
+
+	// declarations
+	char		err_msg[ERROR_MSG];	// error message
+	const mxArray	*field;		// field value
+	double		*cpu_ptr;		// CPU numbers
+	uns32		i;				// CPU counter
+	uns32		ncpu_new;		// CPUs listed
+
+	if ((field = mxGetField(opts, 0, name)) == NULL) {
+		return;
+	}
+	ncpu_new = (uns32) mxGetNumberOfElements(field);
+	if ((ncpu_new > 0) && (!mxIsDouble(field) || mxIsComplex(field) || (ncpu_new > MAX_PLACE_CPU))) {
+		sprintf(err_msg, "OPTS.%s must be a real double vector of at most %d CPU numbers", name, MAX_PLACE_CPU);
+		mexErrMsgTxt(err_msg);
+	}
+	cpu_ptr = (ncpu_new > 0) ? mxGetPr(field) : NULL;
+	for (i = 0; i < ncpu_new; i++) {
+		if ((cpu_ptr[i] < 0.0) || (cpu_ptr[i] >= (double) MAX_PLACE_CPU) || (cpu_ptr[i] != (double) (int) cpu_ptr[i])) {
+			sprintf(err_msg, "OPTS.%s must hold CPU numbers from 0 to %d", name, MAX_PLACE_CPU - 1);
+			mexErrMsgTxt(err_msg);
+		}
+		cpu[i] = (uns16) cpu_ptr[i];
+	}
+	*ncpu = ncpu_new;
+}
+
+
+// build placement structure
+mxArray *pvcam_threads_struct(const pvcam_placement *placement) {
+
+	// declarations
+	const char	*field_list[THREADS_FIELD] = {"acquire", "workers", "priority", "node", "huge", "lock",
+											"pool", "cpus", "nodes"};
+	const char	*priority_list[3] = {"normal", "high", "realtime"};
+	double		*cpu_ptr;		// CPU list output
+	mxArray		*placement_struct;	// output structure
+	uns32		i;				// CPU counter
+
+	placement_struct = mxCreateStructMatrix(1, 1, THREADS_FIELD, field_list);
+	mxSetFieldByNumber(placement_struct, 0, 0, mxCreateDoubleMatrix((placement->nacquire > 0) ? 1 : 0,
+		placement->nacquire, mxREAL));
+	cpu_ptr = mxGetPr(mxGetFieldByNumber(placement_struct, 0, 0));
+	for (i = 0; i < placement->nacquire; i++) {
+		cpu_ptr[i] = (double) placement->acquire_cpu[i];
+	}
+	mxSetFieldByNumber(placement_struct, 0, 1, mxCreateDoubleMatrix((placement->nworker > 0) ? 1 : 0,
+		placement->nworker, mxREAL));
+	cpu_ptr = mxGetPr(mxGetFieldByNumber(placement_struct, 0, 1));
+	for (i = 0; i < placement->nworker; i++) {
+		cpu_ptr[i] = (double) placement->worker_cpu[i];
+	}
+	mxSetFieldByNumber(placement_struct, 0, 2, mxCreateString(priority_list[placement->priority]));
+	mxSetFieldByNumber(placement_struct, 0, 3, mxCreateDoubleScalar((double) placement->node));
+	mxSetFieldByNumber(placement_struct, 0, 4, mxCreateDoubleScalar((double) placement->huge));
+	mxSetFieldByNumber(placement_struct, 0, 5, mxCreateDoubleScalar((double) placement->lock));
+	mxSetFieldByNumber(placement_struct, 0, 6, mxCreateDoubleScalar((double) placement->pool));
+	mxSetFieldByNumber(placement_struct, 0, 7, mxCreateDoubleScalar((double) pvcam_cpu_count()));
+	mxSetFieldByNumber(placement_struct, 0, 8, mxCreateDoubleScalar((double) pvcam_node_count()));
+	return(placement_struct);
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_threads(nlhs, plhs, nrhs, prhs);
+}
+#endif
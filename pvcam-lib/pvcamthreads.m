@@ -0,0 +1,52 @@
+% PVCAMTHREADS - place acquisition threads, worker threads and frame buffers
+%
+%     CONFIG = PVCAMTHREADS returns the current placement as a structure
+%	  with fields:
+%
+%					acquire = CPUs for acquisition threads, [] to leave them unpinned
+%					workers = CPUs for worker threads, [] for one unpinned worker per CPU
+%					priority = 'normal', 'high' or 'realtime' for acquisition threads
+%					node = NUMA node of frame buffers, -1 for the system default
+%					huge = 1 to put frame buffers on huge pages
+%					lock = 1 to lock frame buffers in memory
+%					pool = MB of idle frame buffers kept for reuse
+%					cpus = processors online (read only)
+%					nodes = NUMA nodes (read only)
+%
+%	  Acquisition threads are the threads that wait on cameras: one per
+%	  camera in PVCAMMULTI and the background thread of PVCAMRING.  They
+%	  take the acquire CPUs in turn.  Worker threads run the processing
+%	  kernels (speckle contrast, binning, recording, ...); with workers
+%	  set there is one worker on each listed CPU, and the calling MATLAB
+%	  thread takes a share of the work as well.  Workers are started by
+%	  the first call that needs them and then wait for the next one;
+%	  changing workers restarts them.  CPUs are numbered from 0 as the
+%	  operating system numbers them.
+%
+%	  Frame buffers (the circular buffer of the acquisition engine, the
+%	  rings of PVCAMRING and the buffer of PVCAMARM) are allocated in whole
+%	  pages on node, so readout and processing on that node's CPUs never
+%	  cross to the other socket.  Huge pages cut TLB misses on large frames
+%	  and locked buffers never page fault during readout; on Linux huge
+%	  pages must be reserved (vm.nr_hugepages) and locking needs a large
+%	  enough RLIMIT_MEMLOCK, on Windows both need the 'Lock pages in
+%	  memory' right.  A freed frame buffer is kept in a pool and the next
+%	  acquisition of the same size takes it back without mapping or
+%	  faulting anything in; pool bounds the memory kept this way.
+%
+%     CONFIG = PVCAMTHREADS(OPTS) changes the fields of the structure OPTS
+%	  that are present and returns the new placement.  It applies to
+%	  threads and buffers created afterwards, so set it before starting
+%	  an acquisition.  A test thread and a test buffer are placed right
+%	  away, and a warning is given if the system refused, for instance
+%	  'realtime' without the privilege to raise priority (CAP_SYS_NICE on
+%	  Linux); threads the system will not place run unplaced and buffers
+%	  fall back to ordinary pages.  Pooled buffers are released, since
+%	  they no longer match.
+%
+%	  A real-time acquisition thread polls the camera without sleeping,
+%	  so give it a CPU of its own in acquire.  The placement is kept in
+%	  the core library and shared by every MEX file.
+
+% 10/18/26
+% mex DLL code
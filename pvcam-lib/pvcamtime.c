@@ -0,0 +1,431 @@
+/* Latency instrumentation and clock correlation for PVCAM MEX files */
+
+/* 10/18/26 */
+
+/* Built into the core library (see pvcamcore.c), so the statistics table
+   below exists once per MATLAB process: pvcamacq records into it and
+   pvcamstats reads it back.  Recording uses atomic operations only, so
+   acquisition and worker threads never take a lock; a reset while an
+   acquisition is running may lose a few samples.
+
+   Camera timestamps (md_frame_header) count from the start of each
+   acquisition on the camera's own oscillator.  The clock models below map
+   them onto the host clock with a straight line per camera: the slope
+   (oscillator drift) is a least squares fit pooled over acquisitions, each
+   about its own mean, with older acquisitions decayed by CLOCK_DECAY; the
+   intercept is refitted every acquisition because the camera clock
+   restarts.  Host UTC is tied to the host clock by a paired reading at the
+   start of every acquisition, so wall clock steps land between
+   acquisitions rather than inside one.  Host readings taken in the EOF
+   callback are paired with the frame as they are; readings taken when a
+   frame is polled lag it by however far behind the reader is, so of those
+   only the least delayed one of every CLOCK_WINDOW is kept.  Models live
+   here in the core library so they outlast a MEX call, and are only
+   touched from the MATLAB thread. */
+
+// inclusions
+#include "pvcamtime.h"
+#include <math.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+
+// process-wide statistics
+static pvcam_stats_table	stats_table = {.enabled = 1};
+
+// clock model of one camera with running sums of the current acquisition
+// sums are taken about the first sample to keep large clock values out of the squares
+typedef struct clock_record {
+	rs_bool		used;			// record in use
+	int16		hcam;			// camera handle
+	pvcam_clock_fit	fit;		// current model
+	double		pool_xx;		// decayed centered camera sum of squares, earlier acquisitions
+	double		pool_xy;		// decayed centered cross sum, earlier acquisitions
+	double		x0;				// first camera timestamp of acquisition (ns)
+	double		y0;				// first host clock reading of acquisition (ns)
+	double		n;				// samples in acquisition
+	double		sx;				// sum of camera offsets from x0
+	double		sy;				// sum of host offsets from y0
+	double		sxx;			// sum of squared camera offsets
+	double		sxy;			// sum of products
+	double		syy;			// sum of squared host offsets
+	double		win_camera;		// camera timestamp of least delayed polled sample in window (ns)
+	double		win_host;		// its host clock reading (ns)
+	uns32		nwindow;		// polled samples in window
+} clock_record;
+
+
+// clock models by camera
+static clock_record	clock_table[MAX_CAMERA];
+
+// stage names in STAGE_* order
+static const char *stage_name[NUM_STAGE] = {"wait", "buffer", "decode", "copy", "defect", "process", "handoff", "record", "frame"};
+
+
+// function prototypes
+
+// add to 32-bit counter
+static void stats_add(volatile long *value);
+
+// add to 64-bit sum
+static void stats_add64(volatile long64 *value, long64 delta);
+
+// replace 64-bit value if it still holds old_value
+static long64 stats_swap64(volatile long64 *value, long64 old_value, long64 new_value);
+
+// UTC since 1970 (ns)
+static double clock_utc_ns(void);
+
+// clock record of camera, created if create is set, NULL if none
+static clock_record *clock_lookup(int16 hcam, rs_bool create);
+
+// add sample to the sums of the current acquisition
+static void clock_add(clock_record *record, double camera_ns, double host_ns);
+
+
+#if defined(_WIN32) || defined(_WIN64)
+
+// monotonic host clock (ns)
+ulong64 pvcam_clock_ns(void) {
+
+	// declarations
+	static LARGE_INTEGER	freq = {0};	// counter frequency
+	LARGE_INTEGER			count;		// counter value
+
+	if (freq.QuadPart == 0) {
+		QueryPerformanceFrequency(&freq);
+	}
+	QueryPerformanceCounter(&count);
+	return((ulong64) (count.QuadPart / freq.QuadPart) * 1000000000ULL +
+		(ulong64) (count.QuadPart % freq.QuadPart) * 1000000000ULL / (ulong64) freq.QuadPart);
+}
+
+static void stats_add(volatile long *value) {
+	InterlockedIncrement(value);
+}
+
+static void stats_add64(volatile long64 *value, long64 delta) {
+	InterlockedExchangeAdd64(value, delta);
+}
+
+static long64 stats_swap64(volatile long64 *value, long64 old_value, long64 new_value) {
+	return(InterlockedCompareExchange64(value, new_value, old_value));
+}
+
+// UTC since 1970 (ns), FILETIME counts 100 ns from 1601
+static double clock_utc_ns(void) {
+
+	// declarations
+	FILETIME		now;		// clock reading
+	ULARGE_INTEGER	ticks;		// 100 ns ticks
+
+	GetSystemTimePreciseAsFileTime(&now);
+	ticks.LowPart = now.dwLowDateTime;
+	ticks.HighPart = now.dwHighDateTime;
+	return((double) (ticks.QuadPart - 116444736000000000ULL) * 100.0);
+}
+
+#else
+
+// monotonic host clock (ns)
+ulong64 pvcam_clock_ns(void) {
+
+	// declarations
+	struct timespec	now;		// clock reading
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((ulong64) now.tv_sec * 1000000000ULL + (ulong64) now.tv_nsec);
+}
+
+static void stats_add(volatile long *value) {
+	__sync_fetch_and_add(value, 1);
+}
+
+static void stats_add64(volatile long64 *value, long64 delta) {
+	__sync_fetch_and_add(value, delta);
+}
+
+static long64 stats_swap64(volatile long64 *value, long64 old_value, long64 new_value) {
+	return(__sync_val_compare_and_swap(value, old_value, new_value));
+}
+
+// UTC since 1970 (ns)
+static double clock_utc_ns(void) {
+
+	// declarations
+	struct timespec	now;		// clock reading
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	return((double) now.tv_sec * 1e9 + (double) now.tv_nsec);
+}
+
+#endif
+
+
+// process-wide statistics table, shared by all MEX files through the core library
+pvcam_stats_table *pvcam_stats_attach(void) {
+	return(&stats_table);
+}
+
+
+// name of instrumented stage
+const char *pvcam_stats_stage_name(int stage) {
+	return(((stage >= 0) && (stage < NUM_STAGE)) ? stage_name[stage] : "unknown");
+}
+
+
+// start timing, returns 0 when recording is off
+ulong64 pvcam_stats_mark(void) {
+
+	// declarations
+	pvcam_stats_table	*table;		// shared statistics
+
+	table = pvcam_stats_attach();
+	return(table->enabled ? pvcam_clock_ns() : 0);
+}
+
+
+// record time since start_ns against stage and return current time
+ulong64 pvcam_stats_lap(int stage, ulong64 start_ns) {
+
+	// declarations
+	pvcam_stage_stats	*record;	// stage record
+	pvcam_stats_table	*table;		// shared statistics
+	int		bucket;			// histogram bucket
+	long64	elapsed;		// latency (ns)
+	long64	old_value;		// current min / max
+	ulong64	now;			// current time (ns)
+
+	// a zero start means recording was off when timing began
+	table = pvcam_stats_attach();
+	if (!table->enabled || (start_ns == 0) || (stage < 0) || (stage >= NUM_STAGE)) {
+		return(table->enabled ? pvcam_clock_ns() : 0);
+	}
+	now = pvcam_clock_ns();
+	elapsed = (now > start_ns) ? (long64) (now - start_ns) : 0;
+
+	// histogram bucket is floor(log2(elapsed))
+	for (bucket = 0; (bucket < STATS_BUCKET - 1) && ((elapsed >> (bucket + 1)) != 0); bucket++);
+	record = &table->stage[stage];
+	stats_add(&record->count);
+	stats_add(&record->hist[bucket]);
+	stats_add64(&record->total_ns, elapsed);
+
+	// min and max retry until no other thread got there first
+	old_value = record->min_ns;
+	while (((old_value == 0) || (elapsed < old_value)) && (stats_swap64(&record->min_ns, old_value, elapsed) != old_value)) {
+		old_value = record->min_ns;
+	}
+	old_value = record->max_ns;
+	while ((elapsed > old_value) && (stats_swap64(&record->max_ns, old_value, elapsed) != old_value)) {
+		old_value = record->max_ns;
+	}
+	return(now);
+}
+
+
+// clear all stage records
+void pvcam_stats_reset(void) {
+
+	// declarations
+	pvcam_stats_table	*table;		// shared statistics
+
+	table = pvcam_stats_attach();
+	memset((void *) table->stage, 0, sizeof(table->stage));
+}
+
+
+// start a new acquisition on camera, camera timestamps restart from here
+// UTC is read between two host clock readings, best of three
+void pvcam_clock_begin(int16 hcam) {
+
+	// declarations
+	clock_record	*record;	// camera model
+	double		gap;			// host clock spread around UTC reading (ns)
+	double		best_gap = -1.0;	// narrowest spread so far (ns)
+	double		utc;			// UTC reading (ns)
+	int			i;				// attempt counter
+	ulong64		before;			// host clock before UTC reading (ns)
+	ulong64		after;			// host clock after UTC reading (ns)
+
+	if ((record = clock_lookup(hcam, 1)) == NULL) {
+		return;
+	}
+	for (i = 0; i < 3; i++) {
+		before = pvcam_clock_ns();
+		utc = clock_utc_ns();
+		after = pvcam_clock_ns();
+		gap = (double) (after - before);
+		if ((best_gap < 0.0) || (gap < best_gap)) {
+			best_gap = gap;
+			record->fit.utc_offset = utc - ((double) before + 0.5 * gap);
+		}
+	}
+	record->n = 0.0;
+	record->sx = record->sy = record->sxx = record->sxy = record->syy = 0.0;
+	record->nwindow = 0;
+}
+
+
+// add camera timestamp and matching host clock reading (ns)
+void pvcam_clock_sample(int16 hcam, double camera_ns, double host_ns) {
+
+	// declarations
+	clock_record	*record;	// camera model
+
+	if ((record = clock_lookup(hcam, 0)) != NULL) {
+		clock_add(record, camera_ns, host_ns);
+	}
+}
+
+
+// add camera timestamp and a host clock reading taken some delay after it (ns)
+// the least delayed reading of a window is the one least behind the camera
+void pvcam_clock_sample_polled(int16 hcam, double camera_ns, double host_ns) {
+
+	// declarations
+	clock_record	*record;	// camera model
+
+	if ((record = clock_lookup(hcam, 0)) == NULL) {
+		return;
+	}
+	if ((record->nwindow == 0) || (host_ns - camera_ns < record->win_host - record->win_camera)) {
+		record->win_camera = camera_ns;
+		record->win_host = host_ns;
+	}
+	if (++record->nwindow == CLOCK_WINDOW) {
+		clock_add(record, record->win_camera, record->win_host);
+		record->nwindow = 0;
+	}
+}
+
+
+// fold acquisition into the drift fit and return the model, 0 if nothing was sampled
+// a single frame only moves the intercept
+rs_bool pvcam_clock_end(int16 hcam, pvcam_clock_fit *fit) {
+
+	// declarations
+	clock_record	*record;	// camera model
+	double		cxx;			// centered camera sum of squares
+	double		cxy;			// centered cross sum
+	double		cyy;			// centered host sum of squares
+	double		pool_xx;		// pooled camera sum of squares
+	double		pool_xy;		// pooled cross sum
+	double		rate;			// fitted slope
+	double		rss;			// residual sum of squares
+
+	if ((record = clock_lookup(hcam, 0)) == NULL) {
+		return(0);
+	}
+	if (record->nwindow > 0) {
+		clock_add(record, record->win_camera, record->win_host);
+		record->nwindow = 0;
+	}
+	if (record->n == 0.0) {
+		return(0);
+	}
+	cxx = record->sxx - record->sx * record->sx / record->n;
+	cxy = record->sxy - record->sx * record->sy / record->n;
+	cyy = record->syy - record->sy * record->sy / record->n;
+
+	// slope pooled with earlier acquisitions, implausible drift keeps the old slope
+	if (cxx > 0.0) {
+		pool_xx = CLOCK_DECAY * record->pool_xx + cxx;
+		pool_xy = CLOCK_DECAY * record->pool_xy + cxy;
+		rate = pool_xy / pool_xx;
+		if (fabs(rate - 1.0) * 1e6 <= CLOCK_MAX_PPM) {
+			record->pool_xx = pool_xx;
+			record->pool_xy = pool_xy;
+			record->fit.rate = rate;
+			record->fit.nacq++;
+		}
+	}
+
+	// intercept through the means with the pooled slope
+	rate = record->fit.rate;
+	record->fit.offset = record->y0 + record->sy / record->n - rate * (record->x0 + record->sx / record->n);
+	rss = cyy - 2.0 * rate * cxy + rate * rate * cxx;
+	record->fit.residual = (rss > 0.0) ? sqrt(rss / record->n) : 0.0;
+	record->fit.nsample = (uns32) record->n;
+	*fit = record->fit;
+	return(1);
+}
+
+
+// current model of camera, 0 if camera has none
+rs_bool pvcam_clock_model(int16 hcam, pvcam_clock_fit *fit) {
+
+	// declarations
+	clock_record	*record;	// camera model
+
+	if ((record = clock_lookup(hcam, 0)) == NULL) {
+		return(0);
+	}
+	*fit = record->fit;
+	return(1);
+}
+
+
+// forget model of camera
+void pvcam_clock_reset(int16 hcam) {
+
+	// declarations
+	clock_record	*record;	// camera model
+
+	if ((record = clock_lookup(hcam, 0)) != NULL) {
+		record->used = 0;
+	}
+}
+
+
+// clock record of camera, created if create is set, NULL if none
+static clock_record *clock_lookup(int16 hcam, rs_bool create) {
+
+	// declarations
+	int		i;				// record counter
+	int		free_slot = -1;	// first unused record
+
+	for (i = 0; i < MAX_CAMERA; i++) {
+		if (clock_table[i].used && (clock_table[i].hcam == hcam)) {
+			return(&clock_table[i]);
+		}
+		if (!clock_table[i].used && (free_slot < 0)) {
+			free_slot = i;
+		}
+	}
+	if (!create || (free_slot < 0)) {
+		return(NULL);
+	}
+	memset(&clock_table[free_slot], 0, sizeof(clock_record));
+	clock_table[free_slot].used = 1;
+	clock_table[free_slot].hcam = hcam;
+	clock_table[free_slot].fit.rate = 1.0;
+	return(&clock_table[free_slot]);
+}
+
+
+// add sample to the sums of the current acquisition
+// sums are taken about the first sample
+static void clock_add(clock_record *record, double camera_ns, double host_ns) {
+
+	// declarations
+	double		dx;				// camera offset from first sample (ns)
+	double		dy;				// host offset from first sample (ns)
+
+	if (record->n == 0.0) {
+		record->x0 = camera_ns;
+		record->y0 = host_ns;
+	}
+	dx = camera_ns - record->x0;
+	dy = host_ns - record->y0;
+	record->n += 1.0;
+	record->sx += dx;
+	record->sy += dy;
+	record->sxx += dx * dx;
+	record->sxy += dx * dy;
+	record->syy += dy * dy;
+}
@@ -0,0 +1,96 @@
+/* Latency instrumentation and clock correlation for PVCAM MEX files */
+
+/* 10/18/26 */
+
+#ifndef _PVCAMTIME_H
+#define _PVCAMTIME_H
+
+// inclusions
+#include "pvcamcore.h"
+
+
+// definitions
+#define STAGE_WAIT		0		// polling for next frame
+#define STAGE_BUFFER	1		// locating frame in circular buffer
+#define STAGE_DECODE	2		// metadata decode
+#define STAGE_COPY		3		// gathering regions out of buffer
+#define STAGE_DEFECT	4		// hot pixel correction
+#define STAGE_PROCESS	5		// accumulation and speckle contrast
+#define STAGE_HANDOFF	6		// copying into MATLAB output
+#define STAGE_RECORD	7		// coding and writing frame to recording
+#define STAGE_FRAME		8		// whole frame, wait through record
+#define NUM_STAGE		9		// number of instrumented stages
+#define STATS_BUCKET	40		// log2 histogram buckets, 1 ns to 18 min
+#define CLOCK_DECAY		0.9		// weight kept by earlier acquisitions in the drift fit
+#define CLOCK_MAX_PPM	1000.0	// drift beyond this is taken as a bad fit
+#define CLOCK_WINDOW	16		// polled samples of which the least delayed one is kept
+
+
+// latency record for one stage
+// bucket k counts latencies in [2^k, 2^(k + 1)) ns, bucket 0 also holds 0 ns
+typedef struct pvcam_stage_stats {
+	volatile long	count;				// samples recorded
+	volatile long	hist[STATS_BUCKET];	// latency histogram
+	volatile long64	total_ns;			// sum of latencies (ns)
+	volatile long64	min_ns;				// shortest latency (ns), 0 if none
+	volatile long64	max_ns;				// longest latency (ns)
+} pvcam_stage_stats;
+
+// statistics shared by every MEX file through the core library
+typedef struct pvcam_stats_table {
+	volatile long	enabled;			// recording switched on
+	pvcam_stage_stats	stage[NUM_STAGE];	// per-stage records
+} pvcam_stats_table;
+
+// linear model from camera timestamps to host clock for one camera
+// host clock (ns) = offset + rate * camera timestamp (ns), UTC (ns) = host clock + utc_offset
+typedef struct pvcam_clock_fit {
+	double		rate;			// host ns per camera ns, drift fitted across acquisitions
+	double		offset;			// host clock at camera time 0 of last acquisition (ns)
+	double		utc_offset;		// UTC since 1970 minus host clock at last acquisition (ns)
+	double		residual;		// rms residual of last acquisition about the fit (ns)
+	uns32		nacq;			// acquisitions in the drift fit
+	uns32		nsample;		// samples in last acquisition
+} pvcam_clock_fit;
+
+
+// function prototypes
+
+// monotonic host clock (ns)
+PVCAM_CORE ulong64 pvcam_clock_ns(void);
+
+// process-wide statistics table, shared by all MEX files through the core library
+PVCAM_CORE pvcam_stats_table *pvcam_stats_attach(void);
+
+// name of instrumented stage
+PVCAM_CORE const char *pvcam_stats_stage_name(int stage);
+
+// start timing, returns 0 when recording is off
+PVCAM_CORE ulong64 pvcam_stats_mark(void);
+
+// record time since start_ns against stage and return current time
+PVCAM_CORE ulong64 pvcam_stats_lap(int stage, ulong64 start_ns);
+
+// clear all stage records
+PVCAM_CORE void pvcam_stats_reset(void);
+
+// start a new acquisition on camera, camera timestamps restart from here
+PVCAM_CORE void pvcam_clock_begin(int16 hcam);
+
+// add camera timestamp and matching host clock reading (ns)
+PVCAM_CORE void pvcam_clock_sample(int16 hcam, double camera_ns, double host_ns);
+
+// add camera timestamp and a host clock reading taken some delay after it (ns)
+// only the least delayed reading of every CLOCK_WINDOW is added
+PVCAM_CORE void pvcam_clock_sample_polled(int16 hcam, double camera_ns, double host_ns);
+
+// fold acquisition into the drift fit and return the model, 0 if nothing was sampled
+PVCAM_CORE rs_bool pvcam_clock_end(int16 hcam, pvcam_clock_fit *fit);
+
+// current model of camera, 0 if camera has none
+PVCAM_CORE rs_bool pvcam_clock_model(int16 hcam, pvcam_clock_fit *fit);
+
+// forget model of camera
+PVCAM_CORE void pvcam_clock_reset(int16 hcam);
+
+#endif /* _PVCAMTIME_H */
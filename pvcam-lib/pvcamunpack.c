@@ -0,0 +1,82 @@
+/* PVCAMUNPACK - unpack bit-packed image sequence
+
+      DATA = PVCAMUNPACK(PACKED, ROI, BITS) turns the image sequence PACKED,
+	  returned by PVCAMACQ with OPTS.pack set, back into unsigned 16-bit
+	  pixels.  PACKED must be the unsigned 8-bit vector of frames acquired
+	  over the CCD region(s) specified by the structure array ROI, each
+	  packed to BITS bits per pixel (STATS.pack of PVCAMACQ) and starting
+	  on a whole byte, and may contain any number of frames.  DATA is laid
+	  out exactly as PVCAMACQ returns unpacked frames.
+
+	  Eight pixels are unpacked at a time with SSE2 for even BITS, and
+	  large sequences are spread over the worker threads, so unpacking
+	  runs at close to memory speed.  Packed sequences can therefore stay
+	  packed in memory and be unpacked a few frames at a time as they are
+	  needed: frame K (from 0) is PVCAMUNPACK(PACKED(K * N + (1:N)), ROI,
+	  BITS), where N = ceil(P * BITS / 8) bytes for P pixels per frame. */
+
+/* 10/18/26 */
+
+
+// inclusions
+#include "pvcamutil.h"
+#include "pvcamcmd.h"
+#include "pvcamproc.h"
+#include "pvcamthread.h"
+
+
+// command routine, also reached as pvcam('unpack', ...)
+void pvcam_cmd_unpack(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+	// declarations
+	double		depth;		// bits per pixel as given
+	rgn_type	*region;	// ROI structure
+	size_t		frame_bytes;	// packed bytes per frame
+	uns16		nregion;	// number of regions
+	uns32		nframe;		// number of frames
+	uns32		npixel;		// pixels per frame
+
+	// validate arguments
+	if ((nrhs != 3) || (nlhs > 1)) {
+		mexErrMsgTxt("type 'help pvcamunpack' for syntax");
+	}
+	pvcam_at_exit(pvcam_thread_stop);
+
+	// obtain packed sequence
+	if (!mxIsUint8(prhs[0])) {
+		mexErrMsgTxt("PACKED must be uint8");
+	}
+
+	// obtain packing width
+	if (!mxIsNumeric(prhs[2]) || (mxGetNumberOfElements(prhs[2]) != 1)) {
+		mexErrMsgTxt("BITS must be a numeric scalar");
+	}
+	depth = mxGetScalar(prhs[2]);
+	if ((depth < 1.0) || (depth > 16.0) || (depth != (double) (uns32) depth)) {
+		mexErrMsgTxt("BITS must be an integer from 1 to 16");
+	}
+
+	// obtain ROI structure from MATLAB structure array
+	region = pvcam_region_array(prhs[1], &nregion);
+	npixel = pvcam_region_pixels(nregion, region);
+	frame_bytes = pvcam_packed_bytes(npixel, (uns32) depth);
+	if ((mxGetNumberOfElements(prhs[0]) < frame_bytes) || (mxGetNumberOfElements(prhs[0]) % frame_bytes != 0)) {
+		mexErrMsgTxt("PACKED must hold a whole number of frames over ROI");
+	}
+	nframe = (uns32) (mxGetNumberOfElements(prhs[0]) / frame_bytes);
+
+	// unpack frames
+	plhs[0] = mxCreateNumericMatrix(1, (size_t) npixel * nframe, mxUINT16_CLASS, mxREAL);
+	pvcam_unpack_frames((const uns8 *) mxGetData(prhs[0]), nframe, npixel, (uns32) depth, (uns16 *) mxGetData(plhs[0]));
+
+	// free allocated arrays
+	mxFree((void *) region);
+}
+
+
+#ifndef PVCAM_GATEWAY
+// gateway routine
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+	pvcam_cmd_unpack(nlhs, plhs, nrhs, prhs);
+}
+#endif
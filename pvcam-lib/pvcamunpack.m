@@ -0,0 +1,19 @@
+% PVCAMUNPACK - unpack bit-packed image sequence
+%
+%     DATA = PVCAMUNPACK(PACKED, ROI, BITS) turns the image sequence PACKED,
+%	  returned by PVCAMACQ with OPTS.pack set, back into unsigned 16-bit
+%	  pixels.  PACKED must be the unsigned 8-bit vector of frames acquired
+%	  over the CCD region(s) specified by the structure array ROI, each
+%	  packed to BITS bits per pixel (STATS.pack of PVCAMACQ) and starting
+%	  on a whole byte, and may contain any number of frames.  DATA is laid
+%	  out exactly as PVCAMACQ returns unpacked frames.
+%
+%	  Eight pixels are unpacked at a time with SSE2 for even BITS, and
+%	  large sequences are spread over the worker threads, so unpacking
+%	  runs at close to memory speed.  Packed sequences can therefore stay
+%	  packed in memory and be unpacked a few frames at a time as they are
+%	  needed: frame K (from 0) is PVCAMUNPACK(PACKED(K * N + (1:N)), ROI,
+%	  BITS), where N = ceil(P * BITS / 8) bytes for P pixels per frame.
+
+% 10/18/26
+% mex DLL code
@@ -7,6 +7,20 @@
 #include "pvcamutil.h"
 
 
+// function prototypes
+
+// obtain field values from ROI structure
+static uns16 region_field_value(const mxArray *struct_array, uns16 nstruct, int nfield);
+
+// run exit routines in the order registered
+static void exit_run(void);
+
+
+// global variables
+static void		(*exit_list[MAX_EXIT])(void);	// exit routines registered
+static int		nexit = 0;		// number of exit routines
+
+
 // create 2D array
 char **pvcam_create_array(int nstring, int nchar) {
 
@@ -37,53 +51,69 @@ void pvcam_destroy_array(char **char_array, int nstring) {
 }
 
 
-// open PVCAM camera
-rs_bool pvcam_open(int16 ncamera, int16 *hcam) {
-	
-	// declarations
-	char	cam_name[CAM_NAME_LEN];
-	int16	total_cameras;
+// initialize PVCAM library unless already done
+rs_bool pvcam_init(void) {
 
-	// try to initialize PVCAM routines
-	if (!pl_pvcam_init()) {
-		pvcam_error(0, "Cannot init PVCAM");
+	// session stays up in the core library once started
+	if (!pvcam_core_init()) {
+		pvcam_error(0, pvcam_core_error());
 		return(0);
 	}
+	pvcam_core_release();
+	return(1);
+}
 
-	// obtain number of cameras
-	if (!pl_cam_get_total(&total_cameras)) {
-		pvcam_error(0, "Cannot find number of cameras");
-		return(0);
-	}
 
-	// check specified camera doesn't exceed number found
-	if (total_cameras <= ncamera) {
-		pvcam_error(0, "Specified camera number not found");
+// open PVCAM camera
+rs_bool pvcam_open(int16 ncamera, int16 *hcam) {
+	if (!pvcam_core_open(ncamera, hcam)) {
+		pvcam_error(0, pvcam_core_error());
 		return(0);
 	}
+	return(1);
+}
 
-	// obtain name of specified camera
-	if (!pl_cam_get_name(0, cam_name)) {
-		pvcam_error(0, "Cannot obtain camera name");
+
+// open PVCAM camera with matching serial number
+rs_bool pvcam_open_serial(const char *serial, int16 *hcam) {
+	if (!pvcam_core_open_serial(serial, hcam)) {
+		pvcam_error(0, pvcam_core_error());
 		return(0);
 	}
+	return(1);
+}
+
+
+// obtain camera serial number, empty if not reported
+rs_bool pvcam_camera_serial(int16 hcam, char *serial) {
 
-	// obtain camera handle
-	if (!pl_cam_open(cam_name, hcam, OPEN_EXCLUSIVE)) {
-		pvcam_error(*hcam, "Cannot open specified camera");
+	// declarations
+	pvcam_param_attr	attr;	// parameter attributes
+
+	serial[0] = '\0';
+	if (!pvcam_core_param_attr(hcam, PARAM_HEAD_SER_NUM_ALPHA, &attr) || !attr.avail) {
 		return(0);
 	}
-	
-	return(1);
+	return(pl_get_param(hcam, PARAM_HEAD_SER_NUM_ALPHA, ATTR_CURRENT, (void *) serial));
 }
 
 
 // close camera
+// PVCAM itself stays initialized in the core library
 void pvcam_close(int16 hcam) {
-	if (pl_cam_check(hcam)) {
-		pl_cam_close(hcam);
+	pvcam_core_close(hcam);
+}
+
+
+// obtain camera handle from MATLAB scalar
+int16 pvcam_camera_handle(const mxArray *hcam_array) {
+	if (!mxIsNumeric(hcam_array)) {
+		mexErrMsgTxt("HCAM must be numeric");
+	}
+	else if (mxGetNumberOfElements(hcam_array) != 1) {
+		mexErrMsgTxt("HCAM must be a scalar");
 	}
-	pl_pvcam_uninit();
+	return((int16) mxGetScalar(hcam_array));
 }
 
 
@@ -584,3 +614,299 @@ rs_bool pvcam_param_id(int16 hcam, const char *param_name, uns32 *param_id) {
 	}
 	return(1);
 }
+
+
+// obtain region list from MATLAB ROI structure array
+rgn_type *pvcam_region_array(const mxArray *roi_struct, uns16 *nregion) {
+
+	// declarations
+	int			nfield[6];	// field numbers in ROI structure
+	rgn_type	*region;	// ROI structure
+	uns16		i;			// loop counter
+
+	// validate ROI structure fields
+	if (!mxIsStruct(roi_struct)) {
+		mexErrMsgTxt("ROI must be a structure array");
+	}
+	else if ((*nregion = (uns16) mxGetNumberOfElements(roi_struct)) < 1) {
+		mexErrMsgTxt("ROI cannot be empty");
+	}
+	else if ((nfield[0] = mxGetFieldNumber(roi_struct, "s1")) < 0) {
+		mexErrMsgTxt("ROI must contain a field named s1");
+	}
+	else if ((nfield[1] = mxGetFieldNumber(roi_struct, "s2")) < 0) {
+		mexErrMsgTxt("ROI must contain a field named s2");
+	}
+	else if ((nfield[2] = mxGetFieldNumber(roi_struct, "sbin")) < 0) {
+		mexErrMsgTxt("ROI must contain a field named sbin");
+	}
+	else if ((nfield[3] = mxGetFieldNumber(roi_struct, "p1")) < 0) {
+		mexErrMsgTxt("ROI must contain a field named p1");
+	}
+	else if ((nfield[4] = mxGetFieldNumber(roi_struct, "p2")) < 0) {
+		mexErrMsgTxt("ROI must contain a field named p2");
+	}
+	else if ((nfield[5] = mxGetFieldNumber(roi_struct, "pbin")) < 0) {
+		mexErrMsgTxt("ROI must contain a field named pbin");
+	}
+
+	// allocate space for ROI data
+	// obtain elements from MATLAB structure
+	region = (rgn_type *) mxCalloc((size_t) *nregion, sizeof(rgn_type));
+	for (i = 0; i < *nregion; i++) {
+		region[i].s1 = region_field_value(roi_struct, i, nfield[0]);
+		region[i].s2 = region_field_value(roi_struct, i, nfield[1]);
+		region[i].sbin = region_field_value(roi_struct, i, nfield[2]);
+		region[i].p1 = region_field_value(roi_struct, i, nfield[3]);
+		region[i].p2 = region_field_value(roi_struct, i, nfield[4]);
+		region[i].pbin = region_field_value(roi_struct, i, nfield[5]);
+		if ((region[i].sbin < 1) || (region[i].pbin < 1) || (region[i].s2 < region[i].s1) || (region[i].p2 < region[i].p1)) {
+			mexErrMsgTxt("ROI has invalid coordinates or binning");
+		}
+	}
+	return(region);
+}
+
+
+// build MATLAB ROI structure array from region list
+mxArray *pvcam_region_struct(uns16 nregion, const rgn_type *region) {
+
+	// declarations
+	const char	*field_list[REGION_FIELD] = {"s1", "s2", "sbin", "p1", "p2", "pbin"};
+	mxArray		*roi_struct;	// output structure array
+	uns16		i;				// loop counter
+
+	roi_struct = mxCreateStructMatrix(1, nregion, REGION_FIELD, field_list);
+	for (i = 0; i < nregion; i++) {
+		mxSetFieldByNumber(roi_struct, i, 0, mxCreateDoubleScalar((double) region[i].s1));
+		mxSetFieldByNumber(roi_struct, i, 1, mxCreateDoubleScalar((double) region[i].s2));
+		mxSetFieldByNumber(roi_struct, i, 2, mxCreateDoubleScalar((double) region[i].sbin));
+		mxSetFieldByNumber(roi_struct, i, 3, mxCreateDoubleScalar((double) region[i].p1));
+		mxSetFieldByNumber(roi_struct, i, 4, mxCreateDoubleScalar((double) region[i].p2));
+		mxSetFieldByNumber(roi_struct, i, 5, mxCreateDoubleScalar((double) region[i].pbin));
+	}
+	return(roi_struct);
+}
+
+
+// return number of pixels read from a set of regions
+uns32 pvcam_region_pixels(uns16 nregion, const rgn_type *region) {
+
+	// declarations
+	uns16	i;				// loop counter
+	uns32	npixel = 0;		// pixel count
+
+	// binned width times binned height for each region
+	for (i = 0; i < nregion; i++) {
+		npixel += (uns32) ((region[i].s2 - region[i].s1 + 1) / region[i].sbin) *
+			(uns32) ((region[i].p2 - region[i].p1 + 1) / region[i].pbin);
+	}
+	return(npixel);
+}
+
+
+// camera reads NREGION regions in one frame (PARAM_ROI_COUNT)
+// cameras without the parameter read a single region
+rs_bool pvcam_region_hardware(int16 hcam, uns16 nregion) {
+
+	// declarations
+	rs_bool	attr_avail;		// flag for available parameter
+	uns16	max_region;		// most regions per frame
+
+	if (nregion <= 1) {
+		return(1);
+	}
+	if (!pl_get_param(hcam, PARAM_ROI_COUNT, ATTR_AVAIL, (void *) &attr_avail) || !attr_avail ||
+		!pl_get_param(hcam, PARAM_ROI_COUNT, ATTR_MAX, (void *) &max_region)) {
+		return(0);
+	}
+	return(max_region >= nregion);
+}
+
+
+// unbinned region covering a set of regions
+void pvcam_region_bounds(uns16 nregion, const rgn_type *region, rgn_type *bound) {
+
+	// declarations
+	uns16	i;				// loop counter
+
+	*bound = region[0];
+	for (i = 1; i < nregion; i++) {
+		bound->s1 = (region[i].s1 < bound->s1) ? region[i].s1 : bound->s1;
+		bound->s2 = (region[i].s2 > bound->s2) ? region[i].s2 : bound->s2;
+		bound->p1 = (region[i].p1 < bound->p1) ? region[i].p1 : bound->p1;
+		bound->p2 = (region[i].p2 > bound->p2) ? region[i].p2 : bound->p2;
+	}
+	bound->sbin = 1;
+	bound->pbin = 1;
+}
+
+
+// obtain scalar field from options structure, or default if absent
+double pvcam_option_value(const mxArray *opts, const char *name, double value) {
+
+	// declarations
+	char	*err_msg;
+	mxArray	*field_value;	// pointer to field value
+
+	// missing structure or field returns default
+	if ((opts == NULL) || ((field_value = mxGetField(opts, 0, name)) == NULL) || mxIsEmpty(field_value)) {
+		return(value);
+	}
+	else if ((!mxIsNumeric(field_value) && !mxIsLogical(field_value)) || (mxGetNumberOfElements(field_value) != 1)) {
+		err_msg = (char *) mxCalloc(strlen(name) + ERROR_MSG, sizeof(char));
+		sprintf(err_msg, "OPTS field %s must be a numeric scalar", name);
+		mexErrMsgTxt(err_msg);
+	}
+	return(mxGetScalar(field_value));
+}
+
+
+// obtain string field from options structure, or default if absent
+char *pvcam_option_string(const mxArray *opts, const char *name, const char *value) {
+
+	// declarations
+	char	*err_msg;
+	char	*field_str;		// output string
+	int		field_len;		// output string length
+	mxArray	*field_value;	// pointer to field value
+
+	// missing structure or field returns copy of default
+	if ((opts == NULL) || ((field_value = mxGetField(opts, 0, name)) == NULL) || mxIsEmpty(field_value)) {
+		field_str = (char *) mxCalloc(strlen(value) + 1, sizeof(char));
+		strcpy(field_str, value);
+		return(field_str);
+	}
+	else if (!mxIsChar(field_value)) {
+		err_msg = (char *) mxCalloc(strlen(name) + ERROR_MSG, sizeof(char));
+		sprintf(err_msg, "OPTS field %s must be a string", name);
+		mexErrMsgTxt(err_msg);
+	}
+	field_len = (int) mxGetNumberOfElements(field_value) + 1;
+	field_str = (char *) mxCalloc((size_t) field_len, sizeof(char));
+	mxGetString(field_value, field_str, field_len);
+	return(field_str);
+}
+
+
+// obtain exposure mode from MATLAB string
+int16 pvcam_exposure_mode(const mxArray *mode_str) {
+
+	// declarations
+	char	*modestr;	// exposure mode string
+	int		modelen;	// exposure mode string length
+	int16	expmode;	// exposure mode
+
+	if (!mxIsChar(mode_str)) {
+		mexErrMsgTxt("EXPMODE must be a string");
+	}
+	else if ((modelen = mxGetNumberOfElements(mode_str)) < 1) {
+		mexErrMsgTxt("EXPMODE cannot be empty");
+	}
+	modelen++;
+	modestr = (char *) mxCalloc(modelen, sizeof(char));
+	if (mxGetString(mode_str, modestr, modelen)) {
+		mexErrMsgTxt("Cannot read EXPMODE string");
+	}
+	else if (strcmp(modestr, "timed") == 0) {
+		expmode = TIMED_MODE;
+	}
+	else if (strcmp(modestr, "trigger") == 0) {
+		expmode = TRIGGER_FIRST_MODE;
+	}
+	else if (strcmp(modestr, "strobe") == 0) {
+		expmode = STROBED_MODE;
+	}
+	else if (strcmp(modestr, "bulb") == 0) {
+		expmode = BULB_MODE;
+	}
+	else if (strcmp(modestr, "flash") == 0) {
+		expmode = FLASH_MODE;
+	}
+	else {
+		mexWarnMsgTxt("EXPMODE not recognized, using timed mode");
+		expmode = TIMED_MODE;
+	}
+	mxFree((void *) modestr);
+	return(expmode);
+}
+
+
+// build MATLAB structure from camera clock model
+mxArray *pvcam_clock_struct(const pvcam_clock_fit *fit) {
+
+	// declarations
+	const char	*field_list[CLOCK_FIELD] = {"rate", "drift", "offset", "utcoffset", "residual",
+											"acquisitions", "samples"};
+	mxArray		*clock_struct;	// output structure
+
+	clock_struct = mxCreateStructMatrix(1, 1, CLOCK_FIELD, field_list);
+	mxSetFieldByNumber(clock_struct, 0, 0, mxCreateDoubleScalar(fit->rate));
+	mxSetFieldByNumber(clock_struct, 0, 1, mxCreateDoubleScalar((fit->rate - 1.0) * 1e6));
+	mxSetFieldByNumber(clock_struct, 0, 2, mxCreateDoubleScalar(fit->offset));
+	mxSetFieldByNumber(clock_struct, 0, 3, mxCreateDoubleScalar(fit->utc_offset));
+	mxSetFieldByNumber(clock_struct, 0, 4, mxCreateDoubleScalar(fit->residual));
+	mxSetFieldByNumber(clock_struct, 0, 5, mxCreateDoubleScalar((double) fit->nacq));
+	mxSetFieldByNumber(clock_struct, 0, 6, mxCreateDoubleScalar((double) fit->nsample));
+	return(clock_struct);
+}
+
+
+// run exit_fn when the MEX file is cleared, after routines registered before it
+// mexAtExit holds one routine per MEX file, which the commands of the gateway share
+// registering a routine again moves it to the end, so shared clean-up can follow its users
+void pvcam_at_exit(void (*exit_fn)(void)) {
+
+	// declarations
+	int		i;				// routine counter
+
+	for (i = 0; (i < nexit) && (exit_list[i] != exit_fn); i++) {
+	}
+	if (i < nexit) {
+		for (; i < nexit - 1; i++) {
+			exit_list[i] = exit_list[i + 1];
+		}
+		exit_list[i] = exit_fn;
+		return;
+	}
+	if (nexit == MAX_EXIT) {
+		mexErrMsgTxt("Too many exit routines, raise MAX_EXIT");
+	}
+	if (nexit == 0) {
+		mexAtExit(exit_run);
+	}
+	exit_list[nexit++] = exit_fn;
+}
+
+
+// obtain field values from ROI structure
+static uns16 region_field_value(const mxArray *struct_array, uns16 nstruct, int nfield) {
+
+	// declarations
+	mxArray		*field_value;	// pointer to field value
+
+	// extract pointer to field value
+	field_value = mxGetFieldByNumber(struct_array, (int) nstruct, nfield);
+	if (field_value == NULL) {
+		mexErrMsgTxt("ROI has empty field value");
+	}
+	else if (!mxIsNumeric(field_value)) {
+		mexErrMsgTxt("ROI has non-numeric field value");
+	}
+
+	// return field value
+	return((uns16) mxGetScalar(field_value));
+}
+
+
+// run exit routines in the order registered
+static void exit_run(void) {
+
+	// declarations
+	int		i;				// routine counter
+
+	for (i = 0; i < nexit; i++) {
+		exit_list[i]();
+	}
+	nexit = 0;
+}
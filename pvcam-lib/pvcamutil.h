@@ -6,6 +6,8 @@
 #include "mex.h"
 #include "master.h"
 #include "pvcam.h"
+#include "pvcamcore.h"
+#include "pvcamtime.h"
 #include <string.h>
 
 
@@ -13,6 +15,9 @@
 #define	ERROR_MSG		((size_t) 256)
 #define ACCESS_STR_LEN	32
 #define TYPE_STR_LEN	32
+#define CLOCK_FIELD		7		// number of fields in clock model structure
+#define REGION_FIELD	6		// number of fields in ROI structure
+#define MAX_EXIT		8		// exit routines run when the MEX file is cleared
 
 
 // function prototypes
@@ -23,12 +28,24 @@ char **pvcam_create_array(int nstring, int nchar);
 // free 2D array
 void pvcam_destroy_array(char **char_array, int nstring);
 
+// initialize PVCAM library unless already done
+rs_bool pvcam_init(void);
+
 // open PVCAM camera
 rs_bool pvcam_open(int16 ncamera, int16 *hcam);
 
+// open PVCAM camera with matching serial number
+rs_bool pvcam_open_serial(const char *serial, int16 *hcam);
+
+// obtain camera serial number, empty if not reported
+rs_bool pvcam_camera_serial(int16 hcam, char *serial);
+
 // close camera
 void pvcam_close(int16 hcam);
 
+// obtain camera handle from MATLAB scalar
+int16 pvcam_camera_handle(const mxArray *hcam_array);
+
 // display error message
 void pvcam_error(int16 hcam, const char *err_msg);
 
@@ -44,3 +61,33 @@ rs_bool pvcam_param_value(int16 hcam, uns32 param_id, int16 param_attrib,
 
 // return selected PVCAM parameter ID
 rs_bool pvcam_param_id(int16 hcam, const char *param_name, uns32 *param_id);
+
+// obtain region list from MATLAB ROI structure array
+rgn_type *pvcam_region_array(const mxArray *roi_struct, uns16 *nregion);
+
+// build MATLAB ROI structure array from region list
+mxArray *pvcam_region_struct(uns16 nregion, const rgn_type *region);
+
+// return number of pixels read from a set of regions
+uns32 pvcam_region_pixels(uns16 nregion, const rgn_type *region);
+
+// camera reads NREGION regions in one frame (PARAM_ROI_COUNT)
+rs_bool pvcam_region_hardware(int16 hcam, uns16 nregion);
+
+// unbinned region covering a set of regions
+void pvcam_region_bounds(uns16 nregion, const rgn_type *region, rgn_type *bound);
+
+// obtain exposure mode from MATLAB string
+int16 pvcam_exposure_mode(const mxArray *mode_str);
+
+// obtain scalar field from options structure, or default if absent
+double pvcam_option_value(const mxArray *opts, const char *name, double value);
+
+// obtain string field from options structure, or default if absent
+char *pvcam_option_string(const mxArray *opts, const char *name, const char *value);
+
+// build MATLAB structure from camera clock model
+mxArray *pvcam_clock_struct(const pvcam_clock_fit *fit);
+
+// run exit_fn when the MEX file is cleared, after routines registered before it, registering again moves it last
+void pvcam_at_exit(void (*exit_fn)(void));
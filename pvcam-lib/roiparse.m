@@ -15,6 +15,7 @@ function image_array = roiparse(image_stream, old_struct)
 
 % 2/26/03 SCM
 % MOD 1/5/04 SCM
+% MOD 10/18/26 transpose single ROI streams with PVCAMORIENT when built
 
 % validate arguments
 image_array = [];
@@ -87,7 +88,11 @@ else
     % extract pixels from stream for single or multiple ROIs
     % transpose arrays to reorient image
     image_array = feval(class(image_stream), zeros([fliplr(image_size) image_count]));
-    if (length(new_struct) == 1)
+    if ((length(new_struct) == 1) && isa(image_stream, 'uint16') && (exist('pvcamorient', 'file') == 3))
+        % single ROI, tiled transpose of every frame at once
+        flat_roi = struct('s1', 0, 's2', image_size(1) - 1, 'sbin', 1, 'p1', 0, 'p2', image_size(2) - 1, 'pbin', 1);
+        image_array = reshape(pvcamorient(image_stream, flat_roi, 'transpose'), [fliplr(image_size) image_count]);
+    elseif (length(new_struct) == 1)
         % single ROI
         for k = 1 : image_count
             beg_index = prod(image_size) * (k - 1) + 1;